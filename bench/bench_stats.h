@@ -0,0 +1,225 @@
+/*
+ * ===================================================================
+ * bench_stats.h - Is the Difference Between Two Benchmark Runs Real?
+ * ===================================================================
+ *
+ * Two runs of the same benchmark never give the same numbers. A 4%
+ * slowdown in the medians may be the change under test, or the machine
+ * having a busier minute. A fixed threshold cannot tell these apart: it
+ * is too strict for a noisy benchmark and too loose for a quiet one.
+ * This header answers the question from the repetitions themselves:
+ *
+ *   double p = bench_mann_whitney(base, nb, cur, nc);
+ *   bench_bootstrap_ratio(base, nb, cur, nc, &lo, &hi);
+ *   if (p < 0.05 && lo > 1.02) ... slower by more than 2%, and not by chance
+ *
+ * Key Components:
+ * - Mann-Whitney U test: ranks all repetitions of both runs together
+ *   and asks how likely a rank split this lopsided is if both runs
+ *   came from the same distribution. It needs no normality assumption,
+ *   which matters because timings are skewed: they cannot be faster
+ *   than the hardware, but an interrupt can make them arbitrarily slow.
+ *   The p-value is exact for small samples without ties (the U
+ *   distribution is the coefficient list of a Gaussian binomial), and
+ *   the tie-corrected normal approximation otherwise.
+ * - Bootstrap confidence interval for the ratio of medians: resample
+ *   each run with replacement many times and take the middle 95% of
+ *   the resampled ratios. The test says whether there is a difference,
+ *   and the interval says how large it could plausibly be.
+ * - Resampling uses a fixed seed, so the same data always gives the
+ *   same interval and verdict.
+ *
+ * A significant result can still be too small to matter. The caller
+ * decides how large a change must be to count, and compares the
+ * interval with it.
+ *
+ * References:
+ * - H. Mann, D. Whitney, "On a Test of Whether one of Two Random
+ *   Variables is Stochastically Larger than the Other", 1947
+ * - B. Efron, R. Tibshirani, "An Introduction to the Bootstrap", 1993
+ * - T. Kalibera, R. Jones, "Rigorous Benchmarking in Reasonable Time",
+ *   ISMM 2013
+ */
+
+#ifndef __bench_stats_h__
+#define __bench_stats_h__
+
+#include <errno.h>
+#include <math.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#define BENCH_EXACT_MAX 50          // Exact U distribution up to na + nb = 50
+#define BENCH_BOOTSTRAP_ITERATIONS 2000
+#define BENCH_CONFIDENCE 0.95
+
+static inline int bench_cmp_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return (x > y) - (x < y);
+}
+
+// Median of @n values, sorted in place
+static inline double bench_median(double *v, int n) {
+    qsort(v, n, sizeof(double), bench_cmp_double);
+    return n % 2 ? v[n / 2] : (v[n / 2 - 1] + v[n / 2]) / 2;
+}
+
+/*
+ * Mann-Whitney U Test
+ * ===================
+ */
+
+/*
+ * bench_u_counts() - How many rank orders give each value of U
+ *
+ * Coefficients of the Gaussian binomial [na+nb choose na] in q, built
+ * as the product over i of (1 - q^(nb+i)) / (1 - q^i). Every division
+ * is exact. The counts stay below 2^53 for na + nb <= BENCH_EXACT_MAX,
+ * so doubles hold them exactly.
+ *
+ * @counts: na * nb + 1 entries
+ */
+static inline void bench_u_counts(int na, int nb, double *counts) {
+    int max_u = na * nb;
+    memset(counts, 0, (max_u + 1) * sizeof(double));
+    counts[0] = 1;
+    for (int i = 1; i <= na; i++) {
+        int up = nb + i;
+        for (int k = max_u; k >= up; k--) {    // times (1 - q^up)
+            counts[k] -= counts[k - up];
+        }
+        for (int k = i; k <= max_u; k++) {     // divided by (1 - q^i)
+            counts[k] += counts[k - i];
+        }
+    }
+}
+
+/*
+ * bench_mann_whitney() - Two-sided p-value for "@a and @b come from the
+ * same distribution"
+ *
+ * Return: p in (0, 1]; 1 if either sample is empty
+ */
+static inline double bench_mann_whitney(const double *a, int na, const double *b, int nb) {
+    if (na == 0 || nb == 0) {
+        return 1;
+    }
+
+    // U counts the (a, b) pairs where a is larger; a tie counts half
+    double u = 0;
+    for (int i = 0; i < na; i++) {
+        for (int j = 0; j < nb; j++) {
+            u += a[i] > b[j] ? 1 : a[i] == b[j] ? 0.5 : 0;
+        }
+    }
+
+    // Tie groups over the pooled sample, for the variance correction
+    int n = na + nb;
+    double *pooled = malloc(n * sizeof(double)), ties = 0;
+    memcpy(pooled, a, na * sizeof(double));
+    memcpy(pooled + na, b, nb * sizeof(double));
+    qsort(pooled, n, sizeof(double), bench_cmp_double);
+    for (int i = 0; i < n;) {
+        int j = i;
+        while (j < n && pooled[j] == pooled[i]) {
+            j++;
+        }
+        double t = j - i;
+        ties += t * t * t - t;
+        i = j;
+    }
+    free(pooled);
+
+    double mean = na * nb / 2.0;
+    if (ties == 0 && n <= BENCH_EXACT_MAX) {
+        int max_u = na * nb;
+        double *counts = malloc((max_u + 1) * sizeof(double)), below = 0, total = 0;
+        bench_u_counts(na, nb, counts);
+        // The distribution is symmetric: P(U <= mean - d) = P(U >= mean + d)
+        double tail_u = u < mean ? u : max_u - u;
+        for (int k = 0; k <= max_u; k++) {
+            total += counts[k];
+            below += k <= tail_u ? counts[k] : 0;
+        }
+        free(counts);
+        double p = 2 * below / total;
+        return p < 1 ? p : 1;
+    }
+
+    double var = na * nb / 12.0 * ((n + 1) - ties / ((double)n * (n - 1)));
+    if (var <= 0) {
+        return 1;               // Every value identical
+    }
+    double z = (fabs(u - mean) - 0.5) / sqrt(var);     // With continuity correction
+    return z > 0 ? erfc(z / sqrt(2.0)) : 1;
+}
+
+// Smallest p-value bench_mann_whitney() can return for these sample sizes
+static inline double bench_min_p(int na, int nb) {
+    double ways = 1;            // (na + nb choose na)
+    for (int i = 1; i <= na; i++) {
+        ways = ways * (nb + i) / i;
+    }
+    return 2 / ways;
+}
+
+/*
+ * Bootstrap Confidence Interval
+ * =============================
+ */
+
+static inline uint64_t bench_rand(uint64_t *state) {
+    *state ^= *state << 13;     // xorshift64
+    *state ^= *state >> 7;
+    *state ^= *state << 17;
+    return *state;
+}
+
+static inline double bench_resampled_median(const double *v, int n, double *scratch,
+                                            uint64_t *state) {
+    for (int i = 0; i < n; i++) {
+        scratch[i] = v[bench_rand(state) % n];
+    }
+    return bench_median(scratch, n);
+}
+
+/*
+ * bench_bootstrap_ratio() - BENCH_CONFIDENCE interval for
+ * median(@b) / median(@a)
+ *
+ * Percentile bootstrap with BENCH_BOOTSTRAP_ITERATIONS resamples.
+ *
+ * Return: 0, or EINVAL if a sample is empty or a resampled median of
+ *         @a is zero
+ */
+static inline int bench_bootstrap_ratio(const double *a, int na, const double *b, int nb,
+                                        double *lo, double *hi) {
+    if (na == 0 || nb == 0) {
+        return EINVAL;
+    }
+    uint64_t state = 0x9e3779b97f4a7c15ull;
+    double *ratios = malloc(BENCH_BOOTSTRAP_ITERATIONS * sizeof(double));
+    double *scratch = malloc((na > nb ? na : nb) * sizeof(double));
+    int rc = 0;
+
+    for (int i = 0; i < BENCH_BOOTSTRAP_ITERATIONS && rc == 0; i++) {
+        double ma = bench_resampled_median(a, na, scratch, &state);
+        double mb = bench_resampled_median(b, nb, scratch, &state);
+        if (ma == 0) {
+            rc = EINVAL;
+        }
+        ratios[i] = ma != 0 ? mb / ma : 0;
+    }
+    if (rc == 0) {
+        qsort(ratios, BENCH_BOOTSTRAP_ITERATIONS, sizeof(double), bench_cmp_double);
+        int tail = (int)(BENCH_BOOTSTRAP_ITERATIONS * (1 - BENCH_CONFIDENCE) / 2);
+        *lo = ratios[tail];
+        *hi = ratios[BENCH_BOOTSTRAP_ITERATIONS - 1 - tail];
+    }
+    free(ratios);
+    free(scratch);
+    return rc;
+}
+
+#endif // __bench_stats_h__
@@ -0,0 +1,1181 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/socket.h>
+#include <sys/utsname.h>
+#include <sys/wait.h>
+
+#include "../common.h"
+#include "../locks.h"
+#include "../bounded_queue.h"
+#include "../ms_queue.h"
+#include "../spawner.h"
+#include "../coro.h"
+#include "../event_loop.h"
+#include "../workload.h"
+#include "bench_stats.h"
+
+/*
+ * cp386bench.c - One driver for the course's performance workloads
+ *
+ * The notes each ship their own demo or benchmark, each with its own
+ * output format. This driver runs the core operation behind them in
+ * process with a fixed operation count, so that runs can be repeated,
+ * stored and compared:
+ *
+ *   locks    acquire/release of every lock in locks.h, contended
+ *   queues   bounded_queue.h, mpsc_queue.h and ms_queue.h hand-offs
+ *   pools    thread create/join, spawner.h, coroutine switches,
+ *            event loop posts
+ *   sched    sched_yield(), condition-variable ping-pong, fork()+wait()
+ *   ipc      pipe and Unix socket ping-pong between two processes
+ *   memory   page faults, memcpy() bandwidth, pointer-chase latency,
+ *            streaming reads (workload.h kernels, uncalibrated)
+ *
+ * Each measurement is one benchmark running `ops` operations. It is
+ * timed with CLOCK_MONOTONIC and counted with pmu.h, covering all the
+ * threads and processes the benchmark creates. Repetitions are
+ * interleaved: rep 1 of every benchmark, then rep 2, and so on. Slow
+ * drift (thermal, other load) then spreads over all benchmarks instead
+ * of landing on the last one.
+ *
+ * Results are appended to a CSV file, one row per measurement. Each row
+ * records the run id, git revision, host, CPU model, CPU count and
+ * kernel. Existing rows are never rewritten. `compare` matches two runs
+ * benchmark by benchmark. It calls a change only when a rank test and
+ * a bootstrap interval (bench_stats.h) both say it is real, and it is
+ * larger than -T percent.
+ *
+ * Usage:
+ *   cp386bench list
+ *   cp386bench run [-s suites] [-b benches] [-r reps] [-t threads]
+ *                  [-x scale] [-o file] [-l label] [-R first rep]
+ *   cp386bench runs [-o file]
+ *   cp386bench compare [-o file] [-T percent] [-a alpha] <base run> <new run>
+ *
+ * Runs are named by -l label, or by start time and revision. `last`,
+ * `last~1`, ... name the newest runs in the file. Calls of `run` with
+ * the same label add to one run; -R numbers their repetitions on.
+ */
+
+#define DEFAULT_FILE "cp386bench.csv"
+#define DEFAULT_REPS 5
+#define DEFAULT_MIN_EFFECT 1.0  // percent: smaller changes count as unchanged
+#define DEFAULT_ALPHA 0.05      // significance level for compare
+#define MAX_THREADS 64
+#define MAX_FIELDS 32
+#define LINE_MAX_LEN 1024
+
+typedef struct {
+    long ops;                   // Operations actually performed
+    int ok;                     // Self-check passed
+} bench_result_t;
+
+typedef void (*bench_fn)(long ops, int threads, bench_result_t *r);
+
+typedef struct {
+    const char *suite;
+    const char *name;
+    const char *op;             // What one operation is
+    long ops;                   // Operations per measurement at scale 1
+    bench_fn fn;
+} bench_t;
+
+static volatile uint64_t sink;
+
+/*
+ * Locks
+ * =====
+ * `threads` threads each take the lock ops/threads times around one
+ * shared counter increment.
+ */
+
+static pthread_mutex_t bench_mutex = PTHREAD_MUTEX_INITIALIZER;
+static spinlock_t bench_spinlock = SPINLOCK_INITIALIZER;
+static ticket_lock_t bench_ticket = TICKET_LOCK_INITIALIZER;
+static adaptive_mutex_t bench_adaptive = ADAPTIVE_MUTEX_INITIALIZER;
+static long lock_counter;
+
+typedef struct {
+    long iterations;
+} lock_worker_t;
+
+#define DEFINE_LOCK_BENCH(name, acquire, release)                            \
+    static void *name##_worker(void *arg) {                                 \
+        lock_worker_t *w = (lock_worker_t *)arg;                            \
+        for (long i = 0; i < w->iterations; i++) {                          \
+            acquire;                                                        \
+            lock_counter++;                                                 \
+            release;                                                        \
+        }                                                                   \
+        return NULL;                                                        \
+    }                                                                       \
+    static void name##_bench(long ops, int threads, bench_result_t *r) {    \
+        run_lock_bench(name##_worker, ops, threads, r);                     \
+    }
+
+static void run_lock_bench(void *(*worker)(void *), long ops, int threads,
+                           bench_result_t *r) {
+    pthread_t tid[MAX_THREADS];
+    lock_worker_t w = { ops / threads };
+
+    lock_counter = 0;
+    adaptive_mutex_init(&bench_adaptive);
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&tid[i], NULL, worker, &w);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(tid[i], NULL);
+    }
+    r->ops = w.iterations * threads;
+    r->ok = lock_counter == r->ops;
+}
+
+DEFINE_LOCK_BENCH(mutex, pthread_mutex_lock(&bench_mutex), pthread_mutex_unlock(&bench_mutex))
+DEFINE_LOCK_BENCH(spinlock, spinlock_lock(&bench_spinlock), spinlock_unlock(&bench_spinlock))
+DEFINE_LOCK_BENCH(ticket, ticket_lock_lock(&bench_ticket), ticket_lock_unlock(&bench_ticket))
+DEFINE_LOCK_BENCH(adaptive, adaptive_mutex_lock(&bench_adaptive),
+                  adaptive_mutex_unlock(&bench_adaptive))
+
+/*
+ * Queues
+ * ======
+ */
+
+typedef struct {
+    void *queue;
+    long items;
+    long first;                 // Producers: first value to send
+    unsigned long sum;          // Consumers: sum of values received
+    ms_thread_t *handle;
+} queue_worker_t;
+
+static int producers_for(int threads) {
+    return threads > 1 ? threads / 2 : 1;
+}
+
+static void *bounded_producer(void *arg) {
+    queue_worker_t *w = (queue_worker_t *)arg;
+    for (long i = 0; i < w->items; i++) {
+        long v = w->first + i;
+        bounded_queue_put((bounded_queue_t *)w->queue, &v);
+    }
+    return NULL;
+}
+
+static void *bounded_consumer(void *arg) {
+    queue_worker_t *w = (queue_worker_t *)arg;
+    long v;
+    for (long i = 0; i < w->items; i++) {
+        bounded_queue_get((bounded_queue_t *)w->queue, &v);
+        w->sum += (unsigned long)v;
+    }
+    return NULL;
+}
+
+static void *ms_producer(void *arg) {
+    queue_worker_t *w = (queue_worker_t *)arg;
+    for (long i = 0; i < w->items; i++) {
+        ms_queue_enqueue((ms_queue_t *)w->queue, w->handle, (void *)(intptr_t)(w->first + i + 1));
+    }
+    return NULL;
+}
+
+static void *ms_consumer(void *arg) {
+    queue_worker_t *w = (queue_worker_t *)arg;
+    void *v;
+    for (long got = 0; got < w->items;) {
+        if (ms_queue_dequeue((ms_queue_t *)w->queue, w->handle, &v)) {
+            w->sum += (unsigned long)(intptr_t)v - 1;
+            got++;
+        } else {
+            sched_yield();
+        }
+    }
+    return NULL;
+}
+
+// Producers send 0..total-1 between them; consumers split the receiving
+static void run_queue_bench(void *queue, void *(*producer)(void *), void *(*consumer)(void *),
+                            long ops, int threads, bench_result_t *r, ms_queue_t *ms) {
+    pthread_t tid[MAX_THREADS];
+    queue_worker_t w[MAX_THREADS];
+    int producers = producers_for(threads);
+    int consumers = threads > 1 ? threads - producers : 1;
+    long total = ops / producers * producers;
+
+    for (int i = 0; i < producers + consumers; i++) {
+        w[i] = (queue_worker_t){ queue, 0, 0, 0, ms != NULL ? ms_queue_register(ms) : NULL };
+        if (i < producers) {
+            w[i].items = total / producers;
+            w[i].first = i * w[i].items;
+            pthread_create(&tid[i], NULL, producer, &w[i]);
+        } else {
+            int c = i - producers;
+            w[i].items = total / consumers + (c < total % consumers ? 1 : 0);
+            pthread_create(&tid[i], NULL, consumer, &w[i]);
+        }
+    }
+    unsigned long sum = 0;
+    for (int i = 0; i < producers + consumers; i++) {
+        pthread_join(tid[i], NULL);
+        sum += w[i].sum;
+        if (ms != NULL) {
+            ms_queue_unregister(ms, w[i].handle);
+        }
+    }
+    r->ops = total;
+    r->ok = sum == (unsigned long)total * (total - 1) / 2;
+}
+
+static void bounded_queue_bench(long ops, int threads, bench_result_t *r) {
+    bounded_queue_t q;
+    bounded_queue_init(&q, 1024, sizeof(long));
+    run_queue_bench(&q, bounded_producer, bounded_consumer, ops, threads, r, NULL);
+    bounded_queue_destroy(&q);
+}
+
+static void ms_queue_bench(long ops, int threads, bench_result_t *r) {
+    ms_queue_t q;
+    ms_queue_init(&q, MS_RECLAIM_EPOCH);
+    run_queue_bench(&q, ms_producer, ms_consumer, ops, threads, r, &q);
+    ms_queue_destroy(&q);
+}
+
+typedef struct {
+    mpsc_node_t node;
+    long value;
+} mpsc_item_t;
+
+typedef struct {
+    mpsc_queue_t *queue;
+    mpsc_item_t *items;
+    long count;
+} mpsc_producer_t;
+
+static void *mpsc_producer(void *arg) {
+    mpsc_producer_t *p = (mpsc_producer_t *)arg;
+    for (long i = 0; i < p->count; i++) {
+        mpsc_queue_push(p->queue, &p->items[i].node);
+    }
+    return NULL;
+}
+
+// `threads` producers, the calling thread consumes
+static void mpsc_queue_bench(long ops, int threads, bench_result_t *r) {
+    pthread_t tid[MAX_THREADS];
+    mpsc_producer_t p[MAX_THREADS];
+    mpsc_queue_t q;
+    long per = ops / threads, total = per * threads;
+    mpsc_item_t *items = malloc(total * sizeof(mpsc_item_t));
+
+    mpsc_queue_init(&q);
+    for (long i = 0; i < total; i++) {
+        items[i].node.owner = NULL;
+        items[i].value = i;
+    }
+    for (int i = 0; i < threads; i++) {
+        p[i] = (mpsc_producer_t){ &q, items + i * per, per };
+        pthread_create(&tid[i], NULL, mpsc_producer, &p[i]);
+    }
+    unsigned long sum = 0;
+    for (long i = 0; i < total; i++) {
+        sum += (unsigned long)mpsc_entry(mpsc_queue_pop_wait(&q), mpsc_item_t, node)->value;
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(tid[i], NULL);
+    }
+    mpsc_queue_destroy(&q);
+    free(items);
+    r->ops = total;
+    r->ok = sum == (unsigned long)total * (total - 1) / 2;
+}
+
+/*
+ * Pools and Threads
+ * =================
+ */
+
+static long pool_calls;
+
+static void *count_call(void *arg) {
+    (void)arg;
+    __atomic_fetch_add(&pool_calls, 1, __ATOMIC_RELAXED);
+    return NULL;
+}
+
+static void thread_create_bench(long ops, int threads, bench_result_t *r) {
+    (void)threads;
+    pool_calls = 0;
+    for (long i = 0; i < ops; i++) {
+        pthread_t t;
+        pthread_create(&t, NULL, count_call, NULL);
+        pthread_join(t, NULL);
+    }
+    r->ops = ops;
+    r->ok = pool_calls == ops;
+}
+
+static void spawner_bench(long ops, int threads, bench_result_t *r) {
+    spawner_t sp;
+    spawner_job_t job;
+    (void)threads;
+    pool_calls = 0;
+    spawner_init(&sp, 64 * 1024, 4);
+    for (long i = 0; i < ops; i++) {
+        spawner_spawn(&sp, &job, count_call, NULL);
+        spawner_join(&sp, &job);
+    }
+    spawner_destroy(&sp);
+    r->ops = ops;
+    r->ok = pool_calls == ops;
+}
+
+static long coro_switches;
+
+static void coro_yielder(void *arg) {
+    long n = *(long *)arg;
+    for (long i = 0; i < n; i++) {
+        coro_switches++;
+        coro_yield();
+    }
+}
+
+// Two coroutines yielding to each other: one op = one yield
+static void coro_switch_bench(long ops, int threads, bench_result_t *r) {
+    coro_sched_t s;
+    long each = ops / 2;
+    (void)threads;
+    coro_switches = 0;
+    coro_sched_init(&s, 64 * 1024, 0);
+    coro_spawn(&s, coro_yielder, &each);
+    coro_spawn(&s, coro_yielder, &each);
+    coro_sched_run(&s);
+    coro_sched_destroy(&s);
+    r->ops = 2 * each;
+    r->ok = coro_switches == r->ops;
+}
+
+typedef struct {
+    ev_loop_t *loop;
+    ev_work_t *work;
+    long count;
+} poster_t;
+
+static long posts_seen;
+
+static void on_post(ev_loop_t *loop, ev_work_t *w) {
+    (void)w;
+    posts_seen++;
+    ev_loop_unref(loop);
+}
+
+static void *poster(void *arg) {
+    poster_t *p = (poster_t *)arg;
+    for (long i = 0; i < p->count; i++) {
+        ev_work_init(&p->work[i], on_post, NULL);
+        ev_post(p->loop, &p->work[i]);
+    }
+    return NULL;
+}
+
+// `threads` threads post completions to one event loop
+static void event_post_bench(long ops, int threads, bench_result_t *r) {
+    pthread_t tid[MAX_THREADS];
+    poster_t p[MAX_THREADS];
+    ev_loop_t loop;
+    long per = ops / threads;
+    ev_work_t *work = malloc(per * threads * sizeof(ev_work_t));
+
+    posts_seen = 0;
+    ev_loop_init(&loop);
+    for (long i = 0; i < per * threads; i++) {
+        ev_loop_ref(&loop);     // Released by on_post()
+    }
+    for (int i = 0; i < threads; i++) {
+        p[i] = (poster_t){ &loop, work + i * per, per };
+        pthread_create(&tid[i], NULL, poster, &p[i]);
+    }
+    ev_loop_run(&loop);
+    for (int i = 0; i < threads; i++) {
+        pthread_join(tid[i], NULL);
+    }
+    ev_loop_destroy(&loop);
+    free(work);
+    r->ops = per * threads;
+    r->ok = posts_seen == r->ops;
+}
+
+/*
+ * Scheduling
+ * ==========
+ */
+
+static void *yielder(void *arg) {
+    long n = *(long *)arg;
+    for (long i = 0; i < n; i++) {
+        sched_yield();
+    }
+    return NULL;
+}
+
+static void yield_bench(long ops, int threads, bench_result_t *r) {
+    pthread_t tid[MAX_THREADS];
+    long per = ops / threads;
+    for (int i = 0; i < threads; i++) {
+        pthread_create(&tid[i], NULL, yielder, &per);
+    }
+    for (int i = 0; i < threads; i++) {
+        pthread_join(tid[i], NULL);
+    }
+    r->ops = per * threads;
+    r->ok = 1;
+}
+
+static struct {
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    long turn;                  // Even: ping's turn, odd: pong's
+    long rounds;
+} pingpong = { PTHREAD_MUTEX_INITIALIZER, PTHREAD_COND_INITIALIZER, 0, 0 };
+
+static void *pong(void *arg) {
+    (void)arg;
+    pthread_mutex_lock(&pingpong.mutex);
+    for (long i = 0; i < pingpong.rounds; i++) {
+        while (pingpong.turn % 2 == 0) {
+            pthread_cond_wait(&pingpong.cond, &pingpong.mutex);
+        }
+        pingpong.turn++;
+        pthread_cond_signal(&pingpong.cond);
+    }
+    pthread_mutex_unlock(&pingpong.mutex);
+    return NULL;
+}
+
+// Two threads hand a turn back and forth: one op = one round trip
+static void cond_pingpong_bench(long ops, int threads, bench_result_t *r) {
+    pthread_t t;
+    (void)threads;
+    pingpong.turn = 0;
+    pingpong.rounds = ops;
+    pthread_create(&t, NULL, pong, NULL);
+    pthread_mutex_lock(&pingpong.mutex);
+    for (long i = 0; i < ops; i++) {
+        pingpong.turn++;
+        pthread_cond_signal(&pingpong.cond);
+        while (pingpong.turn % 2 == 1) {
+            pthread_cond_wait(&pingpong.cond, &pingpong.mutex);
+        }
+    }
+    pthread_mutex_unlock(&pingpong.mutex);
+    pthread_join(t, NULL);
+    r->ops = ops;
+    r->ok = pingpong.turn == 2 * ops;
+}
+
+static void fork_wait_bench(long ops, int threads, bench_result_t *r) {
+    long exited = 0;
+    (void)threads;
+    for (long i = 0; i < ops; i++) {
+        pid_t pid = fork();
+        if (pid == 0) {
+            _exit(7);
+        }
+        int status;
+        if (pid > 0 && waitpid(pid, &status, 0) == pid && WEXITSTATUS(status) == 7) {
+            exited++;
+        }
+    }
+    r->ops = ops;
+    r->ok = exited == ops;
+}
+
+/*
+ * IPC
+ * ===
+ * A child echoes every byte back: one op = one round trip.
+ */
+
+static void pingpong_fds(int to_child[2], int to_parent[2], long ops, bench_result_t *r) {
+    char c = 0;
+    long echoed = 0;
+    pid_t pid = fork();
+    if (pid == 0) {
+        close(to_child[1]);
+        close(to_parent[0]);
+        while (read(to_child[0], &c, 1) == 1) {
+            if (write(to_parent[1], &c, 1) != 1) {
+                break;
+            }
+        }
+        _exit(0);
+    }
+    close(to_child[0]);
+    close(to_parent[1]);
+    for (long i = 0; i < ops; i++) {
+        c = (char)i;
+        char back;
+        if (write(to_child[1], &c, 1) != 1 || read(to_parent[0], &back, 1) != 1) {
+            break;
+        }
+        echoed += back == c;
+    }
+    close(to_child[1]);
+    close(to_parent[0]);
+    waitpid(pid, NULL, 0);
+    r->ops = ops;
+    r->ok = echoed == ops;
+}
+
+static void pipe_bench(long ops, int threads, bench_result_t *r) {
+    int a[2], b[2];
+    (void)threads;
+    if (pipe(a) != 0 || pipe(b) != 0) {
+        r->ok = 0;
+        return;
+    }
+    pingpong_fds(a, b, ops, r);
+}
+
+static void socket_bench(long ops, int threads, bench_result_t *r) {
+    int sv[2], a[2], b[2];
+    (void)threads;
+    if (socketpair(AF_UNIX, SOCK_STREAM, 0, sv) != 0) {
+        r->ok = 0;
+        return;
+    }
+    // One socketpair carries both directions; give each side its own fd
+    a[0] = sv[1];
+    a[1] = sv[0];
+    b[0] = dup(sv[0]);
+    b[1] = dup(sv[1]);
+    pingpong_fds(a, b, ops, r);
+}
+
+/*
+ * Memory
+ * ======
+ */
+
+#define FAULT_CHUNK_PAGES 1024
+
+// Map, touch and unmap anonymous memory: one op = one page fault
+static void page_fault_bench(long ops, int threads, bench_result_t *r) {
+    long page = sysconf(_SC_PAGESIZE), touched = 0;
+    (void)threads;
+    for (long done = 0; done < ops; done += FAULT_CHUNK_PAGES) {
+        char *p = mmap(NULL, FAULT_CHUNK_PAGES * page, PROT_READ | PROT_WRITE,
+                       MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+        if (p == MAP_FAILED) {
+            break;
+        }
+        for (long i = 0; i < FAULT_CHUNK_PAGES; i++) {
+            p[i * page] = 1;
+            touched++;
+        }
+        munmap(p, FAULT_CHUNK_PAGES * page);
+    }
+    r->ops = touched;
+    r->ok = touched >= ops;
+}
+
+#define COPY_BYTES 4096
+#define COPY_BUFFER (8 << 20)
+
+// memcpy() 4 KB blocks through an 8 MB buffer: one op = one block
+static void memcpy_bench(long ops, int threads, bench_result_t *r) {
+    char *src = malloc(COPY_BUFFER), *dst = malloc(COPY_BUFFER);
+    long blocks = COPY_BUFFER / COPY_BYTES;
+    (void)threads;
+    memset(src, 1, COPY_BUFFER);
+    memset(dst, 0, COPY_BUFFER);
+    for (long i = 0; i < ops; i++) {
+        long b = i % blocks;
+        memcpy(dst + b * COPY_BYTES, src + ((b * 7) % blocks) * COPY_BYTES, COPY_BYTES);
+    }
+    r->ops = ops;
+    r->ok = dst[0] == 1 && dst[(ops < blocks ? ops : blocks) * COPY_BYTES - 1] == 1;
+    free(src);
+    free(dst);
+}
+
+// workload.h kernels by iteration count: a unit would hide a slowdown
+static void chase_bench(long ops, int threads, bench_result_t *r) {
+    (void)threads;
+    r->ok = workload_init() == 0;
+    sink = work_kernel(WORK_CHASE, ops);
+    r->ops = ops;
+}
+
+static void stream_bench(long ops, int threads, bench_result_t *r) {
+    (void)threads;
+    r->ok = workload_init() == 0;
+    sink = work_kernel(WORK_STREAM, ops);
+    r->ops = ops;
+}
+
+static const bench_t benches[] = {
+    { "locks",  "mutex",          "acquire",     1000000, mutex_bench },
+    { "locks",  "spinlock",       "acquire",     1000000, spinlock_bench },
+    { "locks",  "ticket",         "acquire",     1000000, ticket_bench },
+    { "locks",  "adaptive",       "acquire",     1000000, adaptive_bench },
+    { "queues", "bounded_queue",  "item",        1000000, bounded_queue_bench },
+    { "queues", "mpsc_queue",     "item",        1000000, mpsc_queue_bench },
+    { "queues", "ms_queue",       "item",         500000, ms_queue_bench },
+    { "pools",  "thread_create",  "create+join",    2000, thread_create_bench },
+    { "pools",  "spawner",        "spawn+join",    20000, spawner_bench },
+    { "pools",  "coro_switch",    "yield",       2000000, coro_switch_bench },
+    { "pools",  "event_post",     "post",        1000000, event_post_bench },
+    { "sched",  "yield",          "sched_yield",  500000, yield_bench },
+    { "sched",  "cond_pingpong",  "round trip",    50000, cond_pingpong_bench },
+    { "sched",  "fork_wait",      "fork+wait",       500, fork_wait_bench },
+    { "ipc",    "pipe",           "round trip",    50000, pipe_bench },
+    { "ipc",    "unix_socket",    "round trip",    50000, socket_bench },
+    { "memory", "page_fault",     "page",          65536, page_fault_bench },
+    { "memory", "memcpy_4k",      "4 KB copy",    100000, memcpy_bench },
+    { "memory", "pointer_chase",  "load",        1000000, chase_bench },
+    { "memory", "stream",         "64 B line",   2000000, stream_bench },
+};
+#define NUM_BENCHES (int)(sizeof(benches) / sizeof(benches[0]))
+
+/*
+ * Machine and Revision
+ * ====================
+ */
+
+typedef struct {
+    char rev[64];
+    char host[72];              // uname() fields are 65 bytes
+    char cpu[128];
+    char kernel[72];
+    int cpus;
+} machine_t;
+
+// Commas and newlines would break the CSV
+static void csv_clean(char *s) {
+    for (; *s != '\0'; s++) {
+        if (*s == ',' || *s == '\n' || *s == '\r') {
+            *s = ' ';
+        }
+    }
+}
+
+static void read_command(const char *cmd, char *out, size_t len) {
+    FILE *f = popen(cmd, "r");
+    out[0] = '\0';
+    if (f != NULL) {
+        if (fgets(out, (int)len, f) == NULL) {
+            out[0] = '\0';
+        }
+        pclose(f);
+    }
+    out[strcspn(out, "\n")] = '\0';
+}
+
+static void machine_info(machine_t *m) {
+    struct utsname u;
+    char exe[PATH_MAX], cmd[PATH_MAX + 96];
+
+    // Ask git about the tree this binary lives in, not the current directory
+    ssize_t n = readlink("/proc/self/exe", exe, sizeof(exe) - 1);
+    exe[n > 0 ? n : 0] = '\0';
+    char *slash = strrchr(exe, '/');
+    if (slash != NULL) {
+        *slash = '\0';
+    }
+    snprintf(cmd, sizeof(cmd), "git -C '%s' describe --always --dirty 2>/dev/null",
+             exe[0] != '\0' ? exe : ".");
+    read_command(cmd, m->rev, sizeof(m->rev));
+    if (m->rev[0] == '\0') {
+        strcpy(m->rev, "unknown");
+    }
+
+    uname(&u);
+    snprintf(m->host, sizeof(m->host), "%s", u.nodename);
+    snprintf(m->kernel, sizeof(m->kernel), "%s", u.release);
+    snprintf(m->cpu, sizeof(m->cpu), "%s", u.machine);
+    FILE *f = fopen("/proc/cpuinfo", "r");
+    char line[256];
+    while (f != NULL && fgets(line, sizeof(line), f) != NULL) {
+        char *colon = strchr(line, ':');
+        if (strncmp(line, "model name", 10) == 0 && colon != NULL) {
+            snprintf(m->cpu, sizeof(m->cpu), "%s", colon + 2);
+            m->cpu[strcspn(m->cpu, "\n")] = '\0';
+            for (size_t len = strlen(m->cpu); len > 0 && m->cpu[len - 1] == ' '; len--) {
+                m->cpu[len - 1] = '\0';
+            }
+            break;
+        }
+    }
+    if (f != NULL) {
+        fclose(f);
+    }
+    m->cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    csv_clean(m->rev);
+    csv_clean(m->host);
+    csv_clean(m->cpu);
+    csv_clean(m->kernel);
+}
+
+/*
+ * Results File
+ * ============
+ */
+
+static const char *csv_header =
+    "run,time,rev,host,cpu,cpus,kernel,suite,bench,threads,scale,rep,ops,seconds,"
+    "ns_per_op,cycles,instructions,cache_misses,branch_misses,context_switches,"
+    "page_faults,check";
+
+// Column indexes in csv_header used when reading results back
+enum { COL_RUN = 0, COL_TIME = 1, COL_REV = 2, COL_HOST = 3, COL_SUITE = 7, COL_BENCH = 8,
+       COL_THREADS = 9, COL_NS = 14, COL_CHECK = 21, NUM_COLS = 22 };
+
+typedef struct {
+    char run[64];
+    char key[96];               // suite/bench/threads
+    char rev[64];
+    char time[32];
+    char host[64];
+    double ns;
+    int ok;
+} record_t;
+
+typedef struct {
+    record_t *rows;
+    int count;
+    char (*runs)[64];           // Distinct run ids, oldest first
+    int num_runs;
+} results_t;
+
+static int split_csv(char *line, char **fields) {
+    int n = 0;
+    line[strcspn(line, "\n")] = '\0';
+    for (char *p = line; n < MAX_FIELDS;) {
+        fields[n++] = p;
+        p = strchr(p, ',');
+        if (p == NULL) {
+            break;
+        }
+        *p++ = '\0';
+    }
+    return n;
+}
+
+static int load_results(const char *path, results_t *res) {
+    FILE *f = fopen(path, "r");
+    char line[LINE_MAX_LEN];
+    int cap = 0;
+
+    memset(res, 0, sizeof(*res));
+    if (f == NULL) {
+        return errno;
+    }
+    while (fgets(line, sizeof(line), f) != NULL) {
+        char *fields[MAX_FIELDS];
+        if (strncmp(line, "run,", 4) == 0 || split_csv(line, fields) < NUM_COLS) {
+            continue;
+        }
+        if (res->count == cap) {
+            cap = cap ? 2 * cap : 256;
+            res->rows = realloc(res->rows, cap * sizeof(record_t));
+            res->runs = realloc(res->runs, cap * sizeof(*res->runs));
+        }
+        record_t *r = &res->rows[res->count++];
+        snprintf(r->run, sizeof(r->run), "%s", fields[COL_RUN]);
+        snprintf(r->key, sizeof(r->key), "%s/%s/%s", fields[COL_SUITE], fields[COL_BENCH],
+                 fields[COL_THREADS]);
+        snprintf(r->rev, sizeof(r->rev), "%s", fields[COL_REV]);
+        snprintf(r->time, sizeof(r->time), "%s", fields[COL_TIME]);
+        snprintf(r->host, sizeof(r->host), "%s", fields[COL_HOST]);
+        r->ns = atof(fields[COL_NS]);
+        r->ok = strcmp(fields[COL_CHECK], "ok") == 0;
+        if (res->num_runs == 0 || strcmp(res->runs[res->num_runs - 1], r->run) != 0) {
+            int seen = 0;
+            for (int i = 0; i < res->num_runs && !seen; i++) {
+                seen = strcmp(res->runs[i], r->run) == 0;
+            }
+            if (!seen) {
+                snprintf(res->runs[res->num_runs++], 64, "%s", r->run);
+            }
+        }
+    }
+    fclose(f);
+    return 0;
+}
+
+static void free_results(results_t *res) {
+    free(res->rows);
+    free(res->runs);
+}
+
+// "last", "last~N" or a run id. Return: the run id, or NULL
+static const char *resolve_run(const results_t *res, const char *name) {
+    if (strncmp(name, "last", 4) == 0 && (name[4] == '\0' || name[4] == '~')) {
+        long back = 0;
+        if (name[4] == '~') {
+            char *end;
+            errno = 0;
+            back = strtol(name + 5, &end, 10);
+            if (end == name + 5 || *end != '\0' || errno != 0 || back < 0) {
+                return NULL;
+            }
+        }
+        return back < res->num_runs ? res->runs[res->num_runs - 1 - back] : NULL;
+    }
+    for (int i = 0; i < res->num_runs; i++) {
+        if (strcmp(res->runs[i], name) == 0) {
+            return res->runs[i];
+        }
+    }
+    return NULL;
+}
+
+/*
+ * Commands
+ * ========
+ */
+
+static void usage(const char *prog) {
+    fprintf(stderr,
+            "Usage: %s list\n"
+            "       %s run [-s suites] [-b benches] [-r reps] [-t threads] [-x scale]\n"
+            "                  [-o file] [-l label] [-R first rep]\n"
+            "       %s runs [-o file]\n"
+            "       %s compare [-o file] [-T percent] [-a alpha] <base run> <new run>\n"
+            "Suites and benches are comma-separated; runs may be `last`, `last~1`, ...\n",
+            prog, prog, prog, prog);
+}
+
+// Is @name in the comma-separated @list (NULL: everything is)?
+static int in_list(const char *list, const char *name) {
+    if (list == NULL) {
+        return 1;
+    }
+    size_t len = strlen(name);
+    for (const char *p = list; *p != '\0';) {
+        const char *end = strchr(p, ',');
+        size_t n = end != NULL ? (size_t)(end - p) : strlen(p);
+        if (n == len && strncmp(p, name, n) == 0) {
+            return 1;
+        }
+        p += n + (end != NULL);
+    }
+    return 0;
+}
+
+static int cmd_list(void) {
+    printf("%-8s %-15s %-12s %10s\n", "suite", "bench", "op", "ops/rep");
+    for (int i = 0; i < NUM_BENCHES; i++) {
+        printf("%-8s %-15s %-12s %10ld\n", benches[i].suite, benches[i].name, benches[i].op,
+               benches[i].ops);
+    }
+    return 0;
+}
+
+static void csv_counter(FILE *f, const pmu_sample_t *s, pmu_event_t e) {
+    if (s->valid[e]) {
+        fprintf(f, ",%llu", (unsigned long long)s->value[e]);
+    } else {
+        fprintf(f, ",");
+    }
+}
+
+static int cmd_run(const char *file, const char *suites, const char *names, int reps,
+                   int first_rep, int threads, double scale, const char *label) {
+    machine_t m;
+    char run_id[64], stamp[32], counter_text[160];
+    time_t now = time(NULL);
+    int selected[NUM_BENCHES], num_selected = 0, ok = 1;
+
+    for (int i = 0; i < NUM_BENCHES; i++) {
+        if (in_list(suites, benches[i].suite) && in_list(names, benches[i].name)) {
+            selected[num_selected++] = i;
+        }
+    }
+    if (num_selected == 0) {
+        fprintf(stderr, "No benchmark matches; see `cp386bench list`\n");
+        return 1;
+    }
+
+    FILE *out = fopen(file, "a");
+    if (out == NULL) {
+        perror(file);
+        return 1;
+    }
+    if (ftell(out) == 0) {
+        fprintf(out, "%s\n", csv_header);
+    }
+
+    machine_info(&m);
+    strftime(stamp, sizeof(stamp), "%Y-%m-%dT%H:%M:%S", localtime(&now));
+    if (label != NULL) {
+        snprintf(run_id, sizeof(run_id), "%s", label);
+        csv_clean(run_id);
+    } else {
+        snprintf(run_id, sizeof(run_id), "%.19s-%.40s", stamp, m.rev);
+    }
+    printf("Run %s: %d benchmarks x %d reps, %d threads, scale %g\n", run_id, num_selected,
+           reps, threads, scale);
+    printf("%s, %d CPUs, Linux %s, rev %s\n", m.cpu, m.cpus, m.kernel, m.rev);
+    pmu_describe(stdout);
+    printf("\n%-8s %-15s %3s %12s %12s  %-8s  %s\n", "suite", "bench", "rep", "ns/op",
+           "ops/s", "check", "counters");
+
+    double *ns = calloc((size_t)num_selected * reps, sizeof(double));
+    workload_init();            // Keep the memory kernels' setup out of the timings
+    for (int rep = 1; rep <= reps; rep++) {
+        for (int s = 0; s < num_selected; s++) {
+            const bench_t *b = &benches[selected[s]];
+            long ops = (long)(b->ops * scale);
+            bench_result_t r = { 0, 1 };
+            pmu_t pmu;
+            pmu_sample_t counters;
+
+            if (ops < threads) {
+                ops = threads;
+            }
+            fflush(stdout);     // Before fork(), or children inherit the buffer
+            fflush(out);
+            pmu_begin(&pmu, PMU_INHERIT);
+            uint64_t start = precise_now_ns();
+            b->fn(ops, threads, &r);
+            double seconds = (precise_now_ns() - start) / 1e9;
+            pmu_end(&pmu, &counters);
+
+            double per_op = r.ops > 0 ? 1e9 * seconds / r.ops : 0;
+            ns[s * reps + rep - 1] = per_op;
+            ok &= r.ok;
+            printf("%-8s %-15s %3d %12.1f %12.0f  %-8s  %s\n", b->suite, b->name,
+                   first_rep + rep - 1, per_op, r.ops / seconds, r.ok ? "ok" : "MISMATCH",
+                   pmu_format(&counters, counter_text, sizeof(counter_text)));
+            fprintf(out, "%s,%s,%s,%s,%s,%d,%s,%s,%s,%d,%g,%d,%ld,%.6f,%.3f", run_id, stamp,
+                    m.rev, m.host, m.cpu, m.cpus, m.kernel, b->suite, b->name, threads, scale,
+                    first_rep + rep - 1, r.ops, seconds, per_op);
+            for (int e = 0; e < PMU_EVENTS; e++) {
+                csv_counter(out, &counters, (pmu_event_t)e);
+            }
+            fprintf(out, ",%s\n", r.ok ? "ok" : "MISMATCH");
+        }
+    }
+    fclose(out);
+
+    printf("\n%-8s %-15s %12s %12s %12s\n", "suite", "bench", "min ns/op", "median", "max");
+    for (int s = 0; s < num_selected; s++) {
+        double *v = &ns[s * reps];
+        double mid = bench_median(v, reps);     // Sorts v
+        printf("%-8s %-15s %12.1f %12.1f %12.1f\n", benches[selected[s]].suite,
+               benches[selected[s]].name, v[0], mid, v[reps - 1]);
+    }
+    printf("\nAppended %d rows to %s as run %s\n", num_selected * reps, file, run_id);
+    free(ns);
+    return ok ? 0 : 1;
+}
+
+static int cmd_runs(const char *file) {
+    results_t res;
+    if (load_results(file, &res) != 0) {
+        perror(file);
+        return 1;
+    }
+    printf("%-40s %-20s %-20s %-16s %6s\n", "run", "started", "rev", "host", "rows");
+    for (int i = 0; i < res.num_runs; i++) {
+        const record_t *first = NULL;
+        int rows = 0;
+        for (int j = 0; j < res.count; j++) {
+            if (strcmp(res.rows[j].run, res.runs[i]) == 0) {
+                first = first != NULL ? first : &res.rows[j];
+                rows++;
+            }
+        }
+        printf("%-40s %-20s %-20s %-16s %6d\n", res.runs[i], first->time, first->rev,
+               first->host, rows);
+    }
+    free_results(&res);
+    return 0;
+}
+
+/*
+ * collect() - ns/op of every row of @run with @key that passed its
+ * self-check
+ *
+ * A MISMATCH row timed a broken run, so it is counted in @failed
+ * instead of being compared.
+ *
+ * Return: how many values are in @out
+ */
+static int collect(const results_t *res, const char *run, const char *key, double *out,
+                   int *failed) {
+    int n = 0;
+    *failed = 0;
+    for (int i = 0; i < res->count; i++) {
+        const record_t *r = &res->rows[i];
+        if (strcmp(r->run, run) == 0 && strcmp(r->key, key) == 0) {
+            if (r->ok) {
+                out[n++] = r->ns;
+            } else {
+                (*failed)++;
+            }
+        }
+    }
+    return n;
+}
+
+/*
+ * cmd_compare() - Benchmark by benchmark verdicts between two runs
+ *
+ * A benchmark regressed (or improved) only if all three agree:
+ * - the Mann-Whitney test rejects "same distribution" at @alpha,
+ * - the bootstrap interval of the median ratio excludes 1,
+ * - the median changed by more than @min_effect percent.
+ * Anything else is "unchanged": no detectable difference, or one too
+ * small to matter. Rows that failed their self-check are left out, and
+ * the benchmark is marked MISMATCH.
+ *
+ * Return: exit status, 1 if anything regressed or failed a self-check
+ */
+static int cmd_compare(const char *file, double min_effect, double alpha, const char *base_name,
+                       const char *new_name) {
+    results_t res;
+    if (load_results(file, &res) != 0) {
+        perror(file);
+        return 1;
+    }
+    const char *base = resolve_run(&res, base_name), *cur = resolve_run(&res, new_name);
+    if (base == NULL || cur == NULL) {
+        fprintf(stderr, "Unknown run %s; see `cp386bench runs`\n",
+                base == NULL ? base_name : new_name);
+        free_results(&res);
+        return 1;
+    }
+
+    double *a = malloc(res.count * sizeof(double)), *b = malloc(res.count * sizeof(double));
+    int regressed = 0, improved = 0, compared = 0, underpowered = 0, mismatched = 0;
+    printf("Comparing %s (base) with %s\n", base, cur);
+    printf("Mann-Whitney U at alpha %.3g, %.0f%% bootstrap interval, minimum effect %.1f%%\n\n",
+           alpha, 100 * BENCH_CONFIDENCE, min_effect);
+    printf("%-30s %6s %11s %11s %8s %19s %8s  %s\n", "benchmark", "reps", "base ns/op",
+           "new ns/op", "change", "interval", "p", "verdict");
+    for (int i = 0; i < res.count; i++) {
+        const record_t *r = &res.rows[i];
+        // First row of each key in the new run drives the comparison
+        int first = strcmp(r->run, cur) == 0;
+        for (int j = 0; first && j < i; j++) {
+            first = !(strcmp(res.rows[j].run, cur) == 0 && strcmp(res.rows[j].key, r->key) == 0);
+        }
+        if (!first) {
+            continue;
+        }
+        int fa, fb;
+        int na = collect(&res, base, r->key, a, &fa), nb = collect(&res, cur, r->key, b, &fb);
+        const char *failed = fa || fb ? ", MISMATCH rows skipped" : "";
+        mismatched += fa || fb;
+        if (na == 0 && fa == 0 && nb > 0) {
+            printf("%-30s %3d/%-2d %11s %11.1f %8s %19s %8s  new%s\n", r->key, 0, nb, "-",
+                   bench_median(b, nb), "", "", "", failed);
+            continue;
+        }
+        if (na == 0 || nb == 0) {
+            // Every row of one side failed its self-check: nothing to test
+            printf("%-30s %3d/%-2d %11s %11s %8s %19s %8s  MISMATCH\n", r->key, na, nb, "-",
+                   "-", "", "", "");
+            continue;
+        }
+
+        double p = bench_mann_whitney(a, na, b, nb), lo = 1, hi = 1;
+        bench_bootstrap_ratio(a, na, b, nb, &lo, &hi);
+        double ma = bench_median(a, na), mb = bench_median(b, nb);
+        double change = ma > 0 ? 100.0 * (mb - ma) / ma : 0;
+        const char *verdict = "unchanged";
+        if (p < alpha && lo > 1 && change > min_effect) {
+            verdict = "REGRESSED";
+            regressed++;
+        } else if (p < alpha && hi < 1 && change < -min_effect) {
+            verdict = "improved";
+            improved++;
+        } else if (bench_min_p(na, nb) >= alpha) {
+            verdict = "unchanged (too few reps)";
+            underpowered++;
+        }
+        compared++;
+        printf("%-30s %3d/%-2d %11.1f %11.1f %+7.1f%% [%+7.1f%%, %+7.1f%%] %8.4f  %s%s\n", r->key,
+               na, nb, ma, mb, change, 100 * (lo - 1), 100 * (hi - 1), p, verdict, failed);
+    }
+    printf("\n%d benchmarks compared: %d regressed, %d improved, %d unchanged\n", compared,
+           regressed, improved, compared - regressed - improved);
+    if (underpowered > 0) {
+        printf("%d had too few repetitions to ever reach p < %.3g; use -r 5 or more\n",
+               underpowered, alpha);
+    }
+    if (mismatched > 0) {
+        printf("%d had rows that failed their self-check (MISMATCH); their timings were left out\n",
+               mismatched);
+    }
+    free(a);
+    free(b);
+    free_results(&res);
+    return regressed || mismatched ? 1 : 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *file = DEFAULT_FILE, *suites = NULL, *names = NULL, *label = NULL;
+    int reps = DEFAULT_REPS, first_rep = 1, threads = 2;
+    double scale = 1.0, min_effect = DEFAULT_MIN_EFFECT, alpha = DEFAULT_ALPHA;
+    const char *positional[2];
+    int num_positional = 0;
+
+    if (argc < 2) {
+        usage(argv[0]);
+        return 1;
+    }
+    for (int i = 2; i < argc; i++) {
+        const char *opt = argv[i];
+        if (opt[0] == '-' && opt[1] != '\0' && opt[2] == '\0' && i + 1 < argc) {
+            const char *val = argv[++i];
+            switch (opt[1]) {
+            case 'o': file = val; break;
+            case 's': suites = val; break;
+            case 'b': names = val; break;
+            case 'l': label = val; break;
+            case 'r': reps = atoi(val); break;
+            case 'R': first_rep = atoi(val); break;
+            case 't': threads = atoi(val); break;
+            case 'x': scale = atof(val); break;
+            case 'T': min_effect = atof(val); break;
+            case 'a': alpha = atof(val); break;
+            default: usage(argv[0]); return 1;
+            }
+        } else if (num_positional < 2) {
+            positional[num_positional++] = opt;
+        } else {
+            usage(argv[0]);
+            return 1;
+        }
+    }
+    if (reps < 1 || threads < 1 || threads > MAX_THREADS || scale <= 0) {
+        usage(argv[0]);
+        return 1;
+    }
+
+    if (strcmp(argv[1], "list") == 0) {
+        return cmd_list();
+    } else if (strcmp(argv[1], "run") == 0) {
+        return cmd_run(file, suites, names, reps, first_rep, threads, scale, label);
+    } else if (strcmp(argv[1], "runs") == 0) {
+        return cmd_runs(file);
+    } else if (strcmp(argv[1], "compare") == 0 && num_positional == 2) {
+        return cmd_compare(file, min_effect, alpha, positional[0], positional[1]);
+    }
+    usage(argv[0]);
+    return 1;
+}
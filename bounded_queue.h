@@ -0,0 +1,507 @@
+/*
+ * ===================================================================
+ * CP386 Operating Systems Course - Generic Bounded Queue
+ * ===================================================================
+ *
+ * A blocking FIFO queue of fixed-size elements, shared by the
+ * producer/consumer demos in note4, note8 and note9. Each demo used to
+ * carry its own `int buffer[5]` ring; this header replaces all of them.
+ *
+ * Key Components:
+ * - Element size fixed at creation: the queue stores raw bytes, so it
+ *   can hold ints, structs or 4 KB records without a per-type copy of
+ *   the code.
+ * - Capacity chosen at run time and rounded up to a power of two, so
+ *   the slot index is `pos & mask` instead of a division (`pos % size`).
+ *   `head` and `tail` count up forever; `tail - head` is the fill level.
+ * - Copy API:    bounded_queue_put() / bounded_queue_get()
+ * - In-place API: bounded_queue_emplace() + bounded_queue_emplace_commit()
+ *   and bounded_queue_consume() + bounded_queue_consume_commit(). The
+ *   caller reads or writes the slot directly, which saves one memcpy
+ *   per element - the main cost for large elements.
+ * - try_ variants return EAGAIN instead of blocking; timed_ variants
+ *   give up with ETIMEDOUT after a relative timeout in nanoseconds.
+ * - Batched consumer: bounded_queue_get_batch() drains many elements
+ *   per lock hold and polls adaptively before sleeping.
+ * - Object handoff: bounded_handoff_t passes pointers to preallocated
+ *   buffers and returns them through a second (recycle) queue, so a
+ *   steady stream of heap objects needs no malloc() or free().
+ *
+ * Functions that can fail return 0 or an error number, like pthreads.
+ *
+ * Locking: one mutex and two condition variables (not_full, not_empty),
+ * as in OSTEP Chapter 30. Between emplace()/consume() and the matching
+ * commit the queue's mutex is held, so keep that window short and never
+ * block inside it.
+ *
+ * Timed waits use CLOCK_MONOTONIC, so wall-clock changes do not stretch
+ * or cut a timeout. This needs _GNU_SOURCE (or POSIX 2001) defined
+ * before any #include.
+ *
+ * References:
+ * - OSTEP Chapter 30: Condition Variables (the producer/consumer problem)
+ */
+
+#ifndef __bounded_queue_h__
+#define __bounded_queue_h__
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+typedef struct {
+    char *slots;                // capacity * elem_size bytes
+    size_t elem_size;
+    size_t capacity;            // Always a power of two
+    size_t mask;                // capacity - 1
+    size_t head;                // Next position to consume
+    size_t tail;                // Next position to fill
+    pthread_mutex_t mutex;
+    pthread_cond_t not_full;
+    pthread_cond_t not_empty;
+} bounded_queue_t;
+
+// Smallest power of two >= n (n >= 1)
+static inline size_t bounded_queue_round_up(size_t n) {
+    size_t p = 1;
+    while (p < n) {
+        p <<= 1;
+    }
+    return p;
+}
+
+/*
+ * bounded_queue_init() - Allocate a queue
+ *
+ * @capacity:  minimum number of elements; rounded up to a power of two
+ * @elem_size: size of one element in bytes
+ *
+ * Return: 0, EINVAL for a zero capacity or element size, or ENOMEM
+ */
+static inline int bounded_queue_init(bounded_queue_t *q, size_t capacity,
+                                     size_t elem_size) {
+    pthread_condattr_t attr;
+
+    if (capacity == 0 || elem_size == 0) {
+        return EINVAL;
+    }
+
+    q->capacity = bounded_queue_round_up(capacity);
+    q->mask = q->capacity - 1;
+    q->elem_size = elem_size;
+    q->head = 0;
+    q->tail = 0;
+    q->slots = malloc(q->capacity * elem_size);
+    if (q->slots == NULL) {
+        return ENOMEM;
+    }
+
+    pthread_mutex_init(&q->mutex, NULL);
+    pthread_condattr_init(&attr);
+    pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+    pthread_cond_init(&q->not_full, &attr);
+    pthread_cond_init(&q->not_empty, &attr);
+    pthread_condattr_destroy(&attr);
+    return 0;
+}
+
+static inline void bounded_queue_destroy(bounded_queue_t *q) {
+    pthread_mutex_destroy(&q->mutex);
+    pthread_cond_destroy(&q->not_full);
+    pthread_cond_destroy(&q->not_empty);
+    free(q->slots);
+    q->slots = NULL;
+}
+
+// Number of queued elements. Only a snapshot unless the caller holds q->mutex.
+static inline size_t bounded_queue_count(bounded_queue_t *q) {
+    pthread_mutex_lock(&q->mutex);
+    size_t count = q->tail - q->head;
+    pthread_mutex_unlock(&q->mutex);
+    return count;
+}
+
+static inline void *bounded_queue_slot(bounded_queue_t *q, size_t pos) {
+    return q->slots + (pos & q->mask) * q->elem_size;
+}
+
+// Absolute CLOCK_MONOTONIC deadline `timeout_ns` from now
+static inline struct timespec bounded_queue_deadline(long timeout_ns) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    ts.tv_sec += timeout_ns / 1000000000L;
+    ts.tv_nsec += timeout_ns % 1000000000L;
+    if (ts.tv_nsec >= 1000000000L) {
+        ts.tv_sec++;
+        ts.tv_nsec -= 1000000000L;
+    }
+    return ts;
+}
+
+/*
+ * Wait (with q->mutex held) until `ready` is true.
+ *
+ * @timeout_ns: < 0 waits forever, 0 does not wait, > 0 waits that long
+ *
+ * Return: 0 once ready, EAGAIN (timeout_ns == 0) or ETIMEDOUT otherwise
+ */
+#define BOUNDED_QUEUE_WAIT(q, cond, ready, timeout_ns, rc) do {              \
+    struct timespec deadline_ = { 0, 0 };                                    \
+    if ((timeout_ns) > 0) {                                                  \
+        deadline_ = bounded_queue_deadline(timeout_ns);                      \
+    }                                                                        \
+    (rc) = 0;                                                                \
+    while (!(ready)) {                                                       \
+        if ((timeout_ns) == 0) {                                             \
+            (rc) = EAGAIN;                                                   \
+            break;                                                           \
+        }                                                                    \
+        if ((timeout_ns) < 0) {                                              \
+            pthread_cond_wait((cond), &(q)->mutex);                          \
+        } else if (pthread_cond_timedwait((cond), &(q)->mutex,               \
+                                          &deadline_) == ETIMEDOUT &&        \
+                   !(ready)) {                                               \
+            (rc) = ETIMEDOUT;                                                \
+            break;                                                           \
+        }                                                                    \
+    }                                                                        \
+} while (0)
+
+/*
+ * In-Place (Zero-Copy) API
+ * ========================
+ *
+ * bounded_queue_emplace() waits for a free slot, locks the queue and
+ * returns a pointer to the slot; fill it and call
+ * bounded_queue_emplace_commit(). bounded_queue_consume() and
+ * bounded_queue_consume_commit() are the consumer-side pair.
+ *
+ * The *_timed() forms return NULL (queue unlocked) on timeout; a
+ * timeout of 0 makes them non-blocking try operations.
+ */
+static inline void *bounded_queue_emplace_timed(bounded_queue_t *q, long timeout_ns) {
+    int rc;
+    pthread_mutex_lock(&q->mutex);
+    BOUNDED_QUEUE_WAIT(q, &q->not_full, q->tail - q->head < q->capacity,
+                       timeout_ns, rc);
+    if (rc != 0) {
+        pthread_mutex_unlock(&q->mutex);
+        return NULL;
+    }
+    return bounded_queue_slot(q, q->tail);
+}
+
+static inline void *bounded_queue_emplace(bounded_queue_t *q) {
+    return bounded_queue_emplace_timed(q, -1);
+}
+
+static inline void bounded_queue_emplace_commit(bounded_queue_t *q) {
+    // Atomic so that spinning consumers (bounded_queue_get_batch) can
+    // peek at it without the mutex
+    __atomic_store_n(&q->tail, q->tail + 1, __ATOMIC_RELEASE);
+    pthread_cond_signal(&q->not_empty);
+    pthread_mutex_unlock(&q->mutex);
+}
+
+static inline void *bounded_queue_consume_timed(bounded_queue_t *q, long timeout_ns) {
+    int rc;
+    pthread_mutex_lock(&q->mutex);
+    BOUNDED_QUEUE_WAIT(q, &q->not_empty, q->tail != q->head, timeout_ns, rc);
+    if (rc != 0) {
+        pthread_mutex_unlock(&q->mutex);
+        return NULL;
+    }
+    return bounded_queue_slot(q, q->head);
+}
+
+static inline void *bounded_queue_consume(bounded_queue_t *q) {
+    return bounded_queue_consume_timed(q, -1);
+}
+
+static inline void bounded_queue_consume_commit(bounded_queue_t *q) {
+    __atomic_store_n(&q->head, q->head + 1, __ATOMIC_RELEASE);
+    pthread_cond_signal(&q->not_full);
+    pthread_mutex_unlock(&q->mutex);
+}
+
+/*
+ * Copy API
+ * ========
+ *
+ * put/get copy elem_size bytes in or out. Return 0, or EAGAIN from the
+ * try_ forms and ETIMEDOUT from the timed_ forms.
+ */
+static inline int bounded_queue_timed_put(bounded_queue_t *q, const void *elem,
+                                          long timeout_ns) {
+    void *slot = bounded_queue_emplace_timed(q, timeout_ns);
+    if (slot == NULL) {
+        return timeout_ns == 0 ? EAGAIN : ETIMEDOUT;
+    }
+    memcpy(slot, elem, q->elem_size);
+    bounded_queue_emplace_commit(q);
+    return 0;
+}
+
+static inline void bounded_queue_put(bounded_queue_t *q, const void *elem) {
+    bounded_queue_timed_put(q, elem, -1);
+}
+
+static inline int bounded_queue_try_put(bounded_queue_t *q, const void *elem) {
+    return bounded_queue_timed_put(q, elem, 0);
+}
+
+static inline int bounded_queue_timed_get(bounded_queue_t *q, void *elem,
+                                          long timeout_ns) {
+    void *slot = bounded_queue_consume_timed(q, timeout_ns);
+    if (slot == NULL) {
+        return timeout_ns == 0 ? EAGAIN : ETIMEDOUT;
+    }
+    memcpy(elem, slot, q->elem_size);
+    bounded_queue_consume_commit(q);
+    return 0;
+}
+
+static inline void bounded_queue_get(bounded_queue_t *q, void *elem) {
+    bounded_queue_timed_get(q, elem, -1);
+}
+
+static inline int bounded_queue_try_get(bounded_queue_t *q, void *elem) {
+    return bounded_queue_timed_get(q, elem, 0);
+}
+
+/*
+ * Batched Consumer
+ * ================
+ *
+ * bounded_queue_get() takes the mutex - and, when the queue is empty,
+ * sleeps on not_empty - once per element. Under steady load that is one
+ * lock round trip and often one futex wakeup per item.
+ *
+ * bounded_queue_get_batch() instead drains everything available (up to
+ * `max` elements) in one lock hold. Before sleeping on an empty queue
+ * it polls the tail without the lock for a while, because a wakeup
+ * costs several microseconds and the next element is often closer than
+ * that. The poll budget adapts per consumer: it tracks an average of how
+ * long the queue stayed empty, spins for up to twice that, and does not
+ * spin at all when the average exceeds BOUNDED_QUEUE_SPIN_MAX_NS or
+ * there is only one CPU (the producer cannot run while we spin).
+ */
+#define BOUNDED_QUEUE_SPIN_MAX_NS 50000     // Never spin longer than this
+
+// Per-consumer state and statistics; zero-initialize before first use
+typedef struct {
+    uint64_t empty_ewma_ns;     // Average time the queue stayed empty
+    unsigned long batches;
+    unsigned long items;
+    unsigned long spin_hits;    // Empty queue refilled while we spun
+    unsigned long sleeps;       // Had to block on not_empty
+} bounded_queue_consumer_t;
+
+static inline uint64_t bounded_queue_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static inline int bounded_queue_multicore(void) {
+    static int cpus = 0;
+    if (cpus == 0) {
+        cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    return cpus > 1;
+}
+
+// Poll for up to `budget_ns` for the queue to become non-empty
+static inline int bounded_queue_spin(bounded_queue_t *q, uint64_t start, uint64_t budget_ns) {
+    for (unsigned int i = 1; ; i++) {
+        if (__atomic_load_n(&q->tail, __ATOMIC_ACQUIRE) !=
+            __atomic_load_n(&q->head, __ATOMIC_ACQUIRE)) {
+            return 1;
+        }
+        if (i % 64 == 0 && bounded_queue_now_ns() - start >= budget_ns) {
+            return 0;
+        }
+#if defined(__x86_64__) || defined(__i386__)
+        __builtin_ia32_pause();
+#endif
+    }
+}
+
+/*
+ * bounded_queue_get_batch() - Remove up to `max` elements at once
+ *
+ * @out:  room for `max` elements
+ * @c:    this consumer's state (spin tuning and statistics)
+ * @spin: 0 to block immediately when empty, 1 to poll adaptively first
+ *
+ * Blocks until at least one element is available.
+ *
+ * Return: number of elements copied to @out (1..max)
+ */
+static inline size_t bounded_queue_get_batch(bounded_queue_t *q, void *out, size_t max,
+                                             bounded_queue_consumer_t *c, int spin) {
+    uint64_t empty_since = 0;
+
+    // Lock-free peek: if the queue looks empty, decide whether to spin
+    if (__atomic_load_n(&q->tail, __ATOMIC_ACQUIRE) ==
+        __atomic_load_n(&q->head, __ATOMIC_ACQUIRE)) {
+        empty_since = bounded_queue_now_ns();
+        uint64_t budget = 2 * c->empty_ewma_ns;
+        if (spin && bounded_queue_multicore() && budget > 0 &&
+            c->empty_ewma_ns <= BOUNDED_QUEUE_SPIN_MAX_NS &&
+            bounded_queue_spin(q, empty_since, budget)) {
+            c->spin_hits++;
+        }
+    }
+
+    pthread_mutex_lock(&q->mutex);
+    if (q->tail == q->head) {
+        c->sleeps++;
+        while (q->tail == q->head) {
+            pthread_cond_wait(&q->not_empty, &q->mutex);
+        }
+    }
+
+    size_t n = q->tail - q->head;
+    if (n > max) {
+        n = max;
+    }
+    // Copy out in at most two pieces (the ring may wrap)
+    size_t first = q->capacity - (q->head & q->mask);
+    if (first > n) {
+        first = n;
+    }
+    memcpy(out, bounded_queue_slot(q, q->head), first * q->elem_size);
+    memcpy((char *)out + first * q->elem_size, q->slots, (n - first) * q->elem_size);
+    __atomic_store_n(&q->head, q->head + n, __ATOMIC_RELEASE);
+
+    // n slots freed: wake up to n blocked producers
+    if (n == 1) {
+        pthread_cond_signal(&q->not_full);
+    } else {
+        pthread_cond_broadcast(&q->not_full);
+    }
+    pthread_mutex_unlock(&q->mutex);
+
+    if (empty_since != 0) {
+        // EWMA with weight 1/8, like TCP's RTT estimator
+        uint64_t empty_ns = bounded_queue_now_ns() - empty_since;
+        c->empty_ewma_ns = c->empty_ewma_ns == 0 ? empty_ns
+                         : (7 * c->empty_ewma_ns + empty_ns) / 8;
+    }
+    c->batches++;
+    c->items += n;
+    return n;
+}
+
+/*
+ * Object Handoff
+ * ==============
+ *
+ * Real producers hand off buffers, not ints. Allocating each one in the
+ * producer and freeing it in the consumer costs a malloc/free pair per
+ * item, and the free happens on another thread: glibc must return the
+ * chunk to the producer's arena (taking that arena's lock), and the
+ * memory arrives in the consumer's cache only to be written again by
+ * the producer.
+ *
+ * A handoff is two queues of pointers over one preallocated pool:
+ *
+ *   producer:  obj = bounded_handoff_acquire(h)   // from `recycle`
+ *              fill obj
+ *              bounded_handoff_send(h, obj)        // to `work`
+ *
+ *   consumer:  obj = bounded_handoff_receive(h)    // from `work`
+ *              use obj
+ *              bounded_handoff_release(h, obj)     // back to `recycle`
+ *
+ * Nothing is allocated after bounded_handoff_init(). The pool size also
+ * bounds the memory in flight: when every buffer is in use, acquire()
+ * blocks until a consumer releases one, which is backpressure for free.
+ * Give the pool at least the work queue's capacity plus one buffer per
+ * thread, or producers will stall before the queue is full.
+ */
+
+typedef struct {
+    bounded_queue_t work;       // Filled objects, producer -> consumer
+    bounded_queue_t recycle;    // Empty objects, consumer -> producer
+    char *pool;                 // count * stride bytes
+    size_t object_size;
+    size_t stride;              // object_size rounded up to a cache line
+    size_t count;
+} bounded_handoff_t;
+
+/*
+ * bounded_handoff_init() - Allocate @count objects of @object_size bytes
+ *
+ * @capacity: minimum capacity of the work queue
+ *
+ * Each object starts on its own cache line, so two threads working on
+ * neighbouring objects do not false-share.
+ *
+ * Return: 0, EINVAL or ENOMEM
+ */
+static inline int bounded_handoff_init(bounded_handoff_t *h, size_t capacity,
+                                       size_t count, size_t object_size) {
+    if (capacity == 0 || count == 0 || object_size == 0) {
+        return EINVAL;
+    }
+    h->object_size = object_size;
+    h->stride = (object_size + 63) & ~(size_t)63;
+    h->count = count;
+    if (posix_memalign((void **)&h->pool, 64, count * h->stride) != 0) {
+        return ENOMEM;
+    }
+    if (bounded_queue_init(&h->work, capacity, sizeof(void *)) != 0) {
+        free(h->pool);
+        return ENOMEM;
+    }
+    // The recycle queue must hold every object at once
+    if (bounded_queue_init(&h->recycle, count, sizeof(void *)) != 0) {
+        bounded_queue_destroy(&h->work);
+        free(h->pool);
+        return ENOMEM;
+    }
+    for (size_t i = 0; i < count; i++) {
+        void *obj = h->pool + i * h->stride;
+        bounded_queue_put(&h->recycle, &obj);
+    }
+    return 0;
+}
+
+static inline void bounded_handoff_destroy(bounded_handoff_t *h) {
+    bounded_queue_destroy(&h->work);
+    bounded_queue_destroy(&h->recycle);
+    free(h->pool);
+    h->pool = NULL;
+}
+
+// Take an empty object from the pool, waiting while all are in use
+static inline void *bounded_handoff_acquire(bounded_handoff_t *h) {
+    void *obj;
+    bounded_queue_get(&h->recycle, &obj);
+    return obj;
+}
+
+// Pass a filled object to a consumer, waiting while the queue is full
+static inline void bounded_handoff_send(bounded_handoff_t *h, void *obj) {
+    bounded_queue_put(&h->work, &obj);
+}
+
+// Take the next filled object, waiting while none is queued
+static inline void *bounded_handoff_receive(bounded_handoff_t *h) {
+    void *obj;
+    bounded_queue_get(&h->work, &obj);
+    return obj;
+}
+
+// Return an object to the pool once the consumer is done with it
+static inline void bounded_handoff_release(bounded_handoff_t *h, void *obj) {
+    bounded_queue_put(&h->recycle, &obj);
+}
+
+#endif // __bounded_queue_h__
@@ -9,6 +9,7 @@
  * 
  * Key Components:
  * - High-precision timing functions for performance measurement
+ *   (with hardware counters from pmu.h where available)
  * - CPU burning functions for demonstrating scheduling
  * - Thread synchronization utilities
  * 
@@ -87,7 +88,9 @@ double GetTime() {
  * - Busy-wait loop (actively consumes CPU)
  * - No system calls that might block or yield
  * - Designed to be interruptible by scheduler
- * - Duration in seconds (floating-point for precision)
+ * - Duration in whole seconds, checked with gettimeofday()
+ * - For sub-second waits, or a fixed amount of computation instead of
+ *   wall time, use precise_sleep_ns() / busy_work_ns() in precise_wait.h
  * 
  * Parameters:
  * @howlong: Duration in seconds to burn CPU cycles
@@ -115,13 +118,35 @@ void Spin(int howlong) {
  * and demonstrate performance characteristics of different operations.
  */
 
-// Macro to measure execution time of a code block
+// Macro to measure execution time of a code block. On Linux, in
+// programs built with _GNU_SOURCE, it also reports hardware counters
+// (pmu.h): IPC, cache and branch misses, context switches and page
+// faults, or "n/a" for whatever perf_event_open() does not allow.
+#if defined(__linux__) && defined(_GNU_SOURCE)
+#include "pmu.h"
+
+#define TIME_BLOCK(description, block) do { \
+    pmu_t pmu_; \
+    pmu_sample_t pmu_sample_; \
+    char pmu_text_[160]; \
+    pmu_open(&pmu_, PMU_INHERIT); \
+    double start = GetTime(); \
+    pmu_start(&pmu_); \
+    block; \
+    pmu_stop(&pmu_, &pmu_sample_); \
+    double end = GetTime(); \
+    printf("[TIMING] %s: %.6f seconds (%s)\n", description, end - start, \
+           pmu_format(&pmu_sample_, pmu_text_, sizeof(pmu_text_))); \
+    pmu_close(&pmu_); \
+} while(0)
+#else
 #define TIME_BLOCK(description, block) do { \
     double start = GetTime(); \
     block; \
     double end = GetTime(); \
     printf("[TIMING] %s: %.6f seconds\n", description, end - start); \
 } while(0)
+#endif
 
 // Convert nanoseconds to seconds (useful for high-precision timing)
 #define NS_TO_SEC(ns) ((double)(ns) / 1000000000.0)
@@ -0,0 +1,633 @@
+/*
+ * ===================================================================
+ * CP386 Operating Systems Course - Stackful Coroutines (User Threads)
+ * ===================================================================
+ *
+ * A cooperative user-level threading runtime. An OS thread costs a
+ * kernel task, a stack of megabytes of address space and a system call
+ * for every block and wakeup; 100,000 of them is more than most systems
+ * allow. A coroutine here is a stack from a pool plus a saved stack
+ * pointer, and switching between two of them is a handful of register
+ * moves in user space (OSTEP's many-to-one model).
+ *
+ *   coro_sched_t s;
+ *   coro_sched_init(&s, 64 * 1024, CORO_GUARD);
+ *   coro_spawn(&s, producer, &chan);
+ *   coro_spawn(&s, consumer, &chan);
+ *   coro_sched_run(&s);                 // returns when none can run
+ *   coro_sched_destroy(&s);
+ *
+ * Inside a coroutine: coro_yield() lets the others run, coro_park()
+ * blocks until someone calls coro_ready() on it, and channels
+ * (coro_chan_t) pass fixed-size elements between coroutines, parking
+ * the sender while the channel is full and the receiver while it is
+ * empty.
+ *
+ * Key Components:
+ * - Context switch in assembly for x86-64 and AArch64: push the
+ *   callee-saved registers, swap stack pointers, pop and return. The
+ *   caller-saved registers are already saved by the compiler at the
+ *   call, so nothing else needs to move. Other architectures (or the
+ *   CORO_UCONTEXT flag) use makecontext()/swapcontext(), which is
+ *   portable but also saves the signal mask with a system call on
+ *   every switch.
+ * - Stack pool: stacks are carved from slabs of CORO_SLAB_STACKS, and
+ *   a finished coroutine's stack goes back on a free list for the next
+ *   spawn. The coroutine's own descriptor lives at the top of its
+ *   stack, so spawning allocates nothing once the pool is warm. Pages
+ *   are only backed by memory when touched.
+ * - Guard pages (CORO_GUARD): the lowest page of each stack is made
+ *   inaccessible, so an overflow faults instead of silently corrupting
+ *   the neighbouring stack. Each guard splits the slab mapping, and
+ *   Linux allows about 65,000 mappings per process (vm.max_map_count),
+ *   so guarded stacks top out near 32,000 coroutines.
+ * - One scheduler per OS thread, with an intrusive FIFO run queue: the
+ *   `next` link is inside coro_t, so queueing never allocates. Wait
+ *   queues (coro_waitq_t) use the same link, since a coroutine is
+ *   either runnable or waiting, never both.
+ *
+ * A scheduler and its coroutines belong to the OS thread that runs
+ * coro_sched_run(); channels only connect coroutines of one scheduler.
+ * coro_sync.h runs one scheduler per worker thread and adds a mutex,
+ * condition variable and semaphore that work across them.
+ * Needs _GNU_SOURCE (MAP_ANONYMOUS, ucontext).
+ *
+ * References:
+ * - OSTEP Chapter 26: Concurrency: An Introduction (thread models)
+ * - R. von Behren et al., "Capriccio: Scalable Threads for Internet
+ *   Services" (SOSP 2003)
+ * - System V AMD64 ABI and the ARM Procedure Call Standard (which
+ *   registers a switch must preserve)
+ */
+
+#ifndef __coro_h__
+#define __coro_h__
+
+#include <errno.h>
+#include <limits.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <ucontext.h>
+
+#include "mpsc_queue.h"
+
+#define CORO_SLAB_STACKS 64     // Stacks per mmap()
+#define CORO_GUARD 1            // coro_sched_init() flag: guard pages
+#define CORO_UCONTEXT 2         // coro_sched_init() flag: no assembly
+
+#if defined(__x86_64__) || defined(__aarch64__)
+#define CORO_HAVE_ASM 1
+#else
+#define CORO_HAVE_ASM 0
+#endif
+
+typedef void (*coro_fn)(void *arg);
+
+typedef struct coro_sched coro_sched_t;
+
+typedef struct coro {
+    void *sp;                   // Saved stack pointer (assembly switch)
+    struct coro *next;          // Run queue or wait queue link
+    coro_sched_t *sched;
+    coro_fn fn;
+    void *arg;
+    char *stack;                // Lowest address of the stack slot
+    int done;
+    mpsc_node_t wake;           // Wakeup from another thread (coro_sync.h)
+    ucontext_t uc;              // ucontext switch only
+} coro_t;
+
+// Intrusive FIFO of coroutines
+typedef struct {
+    coro_t *head, *tail;
+} coro_waitq_t;
+
+struct coro_sched {
+    void *sp;                   // Scheduler's own stack pointer
+    ucontext_t uc;
+    int use_ucontext;
+    size_t stack_size;          // Usable bytes per stack
+    size_t slot_size;           // Stack plus guard page
+    size_t page;
+    int guard;
+    char **slabs;               // Every slab, for munmap()
+    size_t num_slabs, max_slabs;
+    char *free_stacks;          // Free list threaded through the stacks
+    coro_waitq_t run_queue;
+    coro_t *current;
+    long live;                  // Spawned and not yet finished
+    unsigned long switches;
+    void *owner;                // coro_worker_t driving it (coro_sync.h)
+};
+
+static __thread coro_sched_t *coro_this_sched;
+
+/*
+ * Context Switch
+ * ==============
+ *
+ * coro_switch_asm(&save_sp, new_sp) pushes the callee-saved registers
+ * on the current stack, stores the stack pointer in *save_sp, loads
+ * new_sp and pops the other context's registers. The final `ret` (x86)
+ * or `ret` through x30 (AArch64) resumes wherever that context called
+ * coro_switch_asm() - or, for a new coroutine, enters the trampoline
+ * placed there by coro_stack_init().
+ *
+ * The symbols are weak and hidden so that several files including this
+ * header link into one program.
+ */
+#if defined(__x86_64__)
+__asm__(
+    ".text\n"
+    ".weak coro_switch_asm\n"
+    ".hidden coro_switch_asm\n"
+    ".type coro_switch_asm, @function\n"
+    "coro_switch_asm:\n"
+    "    pushq %rbp\n"
+    "    pushq %rbx\n"
+    "    pushq %r12\n"
+    "    pushq %r13\n"
+    "    pushq %r14\n"
+    "    pushq %r15\n"
+    "    subq $8, %rsp\n"
+    "    stmxcsr (%rsp)\n"             // SSE control/status word
+    "    fnstcw 4(%rsp)\n"             // x87 control word
+    "    movq %rsp, (%rdi)\n"
+    "    movq %rsi, %rsp\n"
+    "    ldmxcsr (%rsp)\n"
+    "    fldcw 4(%rsp)\n"
+    "    addq $8, %rsp\n"
+    "    popq %r15\n"
+    "    popq %r14\n"
+    "    popq %r13\n"
+    "    popq %r12\n"
+    "    popq %rbx\n"
+    "    popq %rbp\n"
+    "    ret\n"
+    ".size coro_switch_asm, .-coro_switch_asm\n"
+    // New coroutine: r12 = coro, r13 = entry function
+    ".weak coro_trampoline_asm\n"
+    ".hidden coro_trampoline_asm\n"
+    ".type coro_trampoline_asm, @function\n"
+    "coro_trampoline_asm:\n"
+    "    movq %r12, %rdi\n"
+    "    callq *%r13\n"
+    "    ud2\n"
+    ".size coro_trampoline_asm, .-coro_trampoline_asm\n"
+);
+#elif defined(__aarch64__)
+__asm__(
+    ".text\n"
+    ".weak coro_switch_asm\n"
+    ".hidden coro_switch_asm\n"
+    ".type coro_switch_asm, %function\n"
+    "coro_switch_asm:\n"
+    "    sub sp, sp, #176\n"
+    "    stp x19, x20, [sp, #0]\n"
+    "    stp x21, x22, [sp, #16]\n"
+    "    stp x23, x24, [sp, #32]\n"
+    "    stp x25, x26, [sp, #48]\n"
+    "    stp x27, x28, [sp, #64]\n"
+    "    stp x29, x30, [sp, #80]\n"
+    "    stp d8, d9, [sp, #96]\n"
+    "    stp d10, d11, [sp, #112]\n"
+    "    stp d12, d13, [sp, #128]\n"
+    "    stp d14, d15, [sp, #144]\n"
+    "    mrs x9, fpcr\n"
+    "    str x9, [sp, #160]\n"
+    "    mov x9, sp\n"
+    "    str x9, [x0]\n"
+    "    mov sp, x1\n"
+    "    ldr x9, [sp, #160]\n"
+    "    msr fpcr, x9\n"
+    "    ldp x19, x20, [sp, #0]\n"
+    "    ldp x21, x22, [sp, #16]\n"
+    "    ldp x23, x24, [sp, #32]\n"
+    "    ldp x25, x26, [sp, #48]\n"
+    "    ldp x27, x28, [sp, #64]\n"
+    "    ldp x29, x30, [sp, #80]\n"
+    "    ldp d8, d9, [sp, #96]\n"
+    "    ldp d10, d11, [sp, #112]\n"
+    "    ldp d12, d13, [sp, #128]\n"
+    "    ldp d14, d15, [sp, #144]\n"
+    "    add sp, sp, #176\n"
+    "    ret\n"
+    ".size coro_switch_asm, .-coro_switch_asm\n"
+    // New coroutine: x19 = coro, x20 = entry function
+    ".weak coro_trampoline_asm\n"
+    ".hidden coro_trampoline_asm\n"
+    ".type coro_trampoline_asm, %function\n"
+    "coro_trampoline_asm:\n"
+    "    mov x0, x19\n"
+    "    blr x20\n"
+    "    brk #0\n"
+    ".size coro_trampoline_asm, .-coro_trampoline_asm\n"
+);
+#endif
+
+#if CORO_HAVE_ASM
+void coro_switch_asm(void **save_sp, void *new_sp);
+void coro_trampoline_asm(void);
+#endif
+
+// Switch from the scheduler into @c
+static inline void coro_switch_in(coro_sched_t *s, coro_t *c) {
+    s->switches++;
+#if CORO_HAVE_ASM
+    if (!s->use_ucontext) {
+        coro_switch_asm(&s->sp, c->sp);
+        return;
+    }
+#endif
+    swapcontext(&s->uc, &c->uc);
+}
+
+// Switch from @c back to its scheduler
+static inline void coro_switch_out(coro_t *c) {
+    coro_sched_t *s = c->sched;
+#if CORO_HAVE_ASM
+    if (!s->use_ucontext) {
+        coro_switch_asm(&c->sp, s->sp);
+        return;
+    }
+#endif
+    swapcontext(&c->uc, &s->uc);
+}
+
+// First code run on a new coroutine's stack
+static inline void coro_entry(coro_t *c) {
+    c->fn(c->arg);
+    c->done = 1;
+    coro_switch_out(c);
+    abort();                    // A finished coroutine is never resumed
+}
+
+static inline void coro_uc_entry(void) {
+    coro_entry(coro_this_sched->current);
+}
+
+/*
+ * Stack Pool
+ * ==========
+ */
+
+static inline int coro_slab_grow(coro_sched_t *s) {
+    if (s->num_slabs == s->max_slabs) {
+        size_t max = s->max_slabs ? 2 * s->max_slabs : 16;
+        char **slabs = realloc(s->slabs, max * sizeof(char *));
+        if (slabs == NULL) {
+            return ENOMEM;
+        }
+        s->slabs = slabs;
+        s->max_slabs = max;
+    }
+    char *slab = mmap(NULL, CORO_SLAB_STACKS * s->slot_size, PROT_READ | PROT_WRITE,
+                      MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE, -1, 0);
+    if (slab == MAP_FAILED) {
+        return ENOMEM;
+    }
+    // Guard every slot before any of them reaches the free list, so a
+    // failure leaves nothing pointing into the unmapped slab
+    for (int i = 0; s->guard && i < CORO_SLAB_STACKS; i++) {
+        if (mprotect(slab + i * s->slot_size, s->page, PROT_NONE) != 0) {
+            munmap(slab, CORO_SLAB_STACKS * s->slot_size);
+            return ENOMEM;      // Usually vm.max_map_count reached
+        }
+    }
+    for (int i = CORO_SLAB_STACKS - 1; i >= 0; i--) {
+        char *slot = slab + i * s->slot_size;
+        // The free-list link lives in the slot's last word
+        *(char **)(slot + s->slot_size - sizeof(char *)) = s->free_stacks;
+        s->free_stacks = slot;
+    }
+    s->slabs[s->num_slabs++] = slab;
+    return 0;
+}
+
+static inline char *coro_stack_get(coro_sched_t *s) {
+    if (s->free_stacks == NULL && coro_slab_grow(s) != 0) {
+        return NULL;
+    }
+    char *slot = s->free_stacks;
+    s->free_stacks = *(char **)(slot + s->slot_size - sizeof(char *));
+    return slot;
+}
+
+static inline void coro_stack_put(coro_sched_t *s, char *slot) {
+    *(char **)(slot + s->slot_size - sizeof(char *)) = s->free_stacks;
+    s->free_stacks = slot;
+}
+
+/*
+ * Build the first frame of a new coroutine so that switching to it
+ * "returns" into the trampoline with the coroutine and coro_entry() in
+ * callee-saved registers.
+ */
+static inline void coro_stack_init(coro_sched_t *s, coro_t *c) {
+    char *top = (char *)c;                      // Descriptor sits above
+#if defined(__x86_64__)
+    uint64_t *sp = (uint64_t *)((uintptr_t)top & ~(uintptr_t)15);
+    *--sp = (uint64_t)(uintptr_t)coro_trampoline_asm;  // ret target
+    *--sp = 0;                                  // rbp
+    *--sp = 0;                                  // rbx
+    *--sp = (uint64_t)(uintptr_t)c;             // r12
+    *--sp = (uint64_t)(uintptr_t)coro_entry;    // r13
+    *--sp = 0;                                  // r14
+    *--sp = 0;                                  // r15
+    *--sp = 0x037F00001F80ULL;                  // Default fpu cw | mxcsr
+    c->sp = sp;
+#elif defined(__aarch64__)
+    uint64_t *sp = (uint64_t *)(((uintptr_t)top & ~(uintptr_t)15) - 176);
+    memset(sp, 0, 176);
+    sp[0] = (uint64_t)(uintptr_t)c;             // x19
+    sp[1] = (uint64_t)(uintptr_t)coro_entry;    // x20
+    sp[11] = (uint64_t)(uintptr_t)coro_trampoline_asm;  // x30
+    c->sp = sp;
+#endif
+    if (s->use_ucontext) {
+        getcontext(&c->uc);
+        c->uc.uc_stack.ss_sp = c->stack + (s->guard ? s->page : 0);
+        c->uc.uc_stack.ss_size = (size_t)(top - (char *)c->uc.uc_stack.ss_sp);
+        c->uc.uc_link = NULL;
+        makecontext(&c->uc, coro_uc_entry, 0);
+    }
+}
+
+/*
+ * Scheduler
+ * =========
+ */
+
+static inline void coro_waitq_init(coro_waitq_t *q) {
+    q->head = q->tail = NULL;
+}
+
+static inline void coro_waitq_push(coro_waitq_t *q, coro_t *c) {
+    c->next = NULL;
+    if (q->tail != NULL) {
+        q->tail->next = c;
+    } else {
+        q->head = c;
+    }
+    q->tail = c;
+}
+
+static inline coro_t *coro_waitq_pop(coro_waitq_t *q) {
+    coro_t *c = q->head;
+    if (c != NULL) {
+        q->head = c->next;
+        if (q->head == NULL) {
+            q->tail = NULL;
+        }
+    }
+    return c;
+}
+
+/*
+ * coro_sched_init() - Set up a scheduler for the calling OS thread
+ *
+ * @stack_size: usable stack bytes per coroutine, rounded up to pages
+ * @flags:      CORO_GUARD for guard pages, CORO_UCONTEXT to use
+ *              swapcontext() even where the assembly switch exists
+ *
+ * Return: 0, or EINVAL for a stack smaller than two pages
+ */
+static inline int coro_sched_init(coro_sched_t *s, size_t stack_size, int flags) {
+    memset(s, 0, sizeof(*s));
+    s->page = (size_t)sysconf(_SC_PAGESIZE);
+    s->stack_size = (stack_size + s->page - 1) & ~(s->page - 1);
+    if (s->stack_size < 2 * s->page) {
+        return EINVAL;
+    }
+    s->guard = (flags & CORO_GUARD) != 0;
+    s->slot_size = s->stack_size + (s->guard ? s->page : 0);
+    s->use_ucontext = !CORO_HAVE_ASM || (flags & CORO_UCONTEXT);
+    coro_waitq_init(&s->run_queue);
+    return 0;
+}
+
+static inline void coro_sched_destroy(coro_sched_t *s) {
+    for (size_t i = 0; i < s->num_slabs; i++) {
+        munmap(s->slabs[i], CORO_SLAB_STACKS * s->slot_size);
+    }
+    free(s->slabs);
+    s->slabs = NULL;
+    s->num_slabs = s->max_slabs = 0;
+    s->free_stacks = NULL;
+}
+
+/*
+ * coro_spawn() - Create a coroutine running @fn(@arg) on scheduler @s
+ *
+ * It starts at the next turn of the run queue. May be called from
+ * outside the scheduler or from one of its coroutines.
+ *
+ * Return: 0, or ENOMEM when no stack can be mapped
+ */
+static inline int coro_spawn(coro_sched_t *s, coro_fn fn, void *arg) {
+    char *slot = coro_stack_get(s);
+    if (slot == NULL) {
+        return ENOMEM;
+    }
+    // Descriptor at the top of the stack, cache-line aligned
+    uintptr_t top = (uintptr_t)(slot + s->slot_size - sizeof(char *));
+    coro_t *c = (coro_t *)((top - sizeof(coro_t)) & ~(uintptr_t)63);
+    memset(c, 0, sizeof(*c));
+    c->sched = s;
+    c->fn = fn;
+    c->arg = arg;
+    c->stack = slot;
+    coro_stack_init(s, c);
+    s->live++;
+    coro_waitq_push(&s->run_queue, c);
+    return 0;
+}
+
+/*
+ * coro_sched_run_batch() - Run at most @max coroutines from the run queue
+ *
+ * For loops that have other work between batches, such as polling for
+ * wakeups from other threads (coro_sync.h).
+ *
+ * Return: how many coroutines ran
+ */
+static inline long coro_sched_run_batch(coro_sched_t *s, long max) {
+    coro_sched_t *outer = coro_this_sched;
+    coro_t *c;
+    long ran = 0;
+
+    coro_this_sched = s;
+    while (ran < max && (c = coro_waitq_pop(&s->run_queue)) != NULL) {
+        s->current = c;
+        coro_switch_in(s, c);
+        s->current = NULL;
+        if (c->done) {
+            s->live--;
+            coro_stack_put(s, c->stack);
+        }
+        ran++;
+    }
+    coro_this_sched = outer;
+    return ran;
+}
+
+/*
+ * coro_sched_run() - Run coroutines until none is runnable
+ *
+ * Return: the number of coroutines still alive; nonzero means they are
+ *         all parked and nobody is left to wake them (a deadlock)
+ */
+static inline long coro_sched_run(coro_sched_t *s) {
+    coro_sched_run_batch(s, LONG_MAX);
+    return s->live;
+}
+
+// The running coroutine (NULL outside coroutines)
+static inline coro_t *coro_self(void) {
+    return coro_this_sched != NULL ? coro_this_sched->current : NULL;
+}
+
+// Let the other runnable coroutines go first
+static inline void coro_yield(void) {
+    coro_t *c = coro_self();
+    coro_waitq_push(&c->sched->run_queue, c);
+    coro_switch_out(c);
+}
+
+// Block the running coroutine until coro_ready() is called on it
+static inline void coro_park(void) {
+    coro_switch_out(coro_self());
+}
+
+// Make a parked coroutine runnable again
+static inline void coro_ready(coro_t *c) {
+    coro_waitq_push(&c->sched->run_queue, c);
+}
+
+/*
+ * Channels
+ * ========
+ *
+ * A bounded FIFO of fixed-size elements, the coroutine counterpart of
+ * bounded_queue_t. No lock is needed: coroutines of one scheduler never
+ * run at the same time, and a switch only happens at park or yield.
+ * A sender parks while the channel is full, a receiver while it is
+ * empty; each wakes the first coroutine waiting on the other side.
+ */
+
+typedef struct {
+    char *slots;
+    size_t elem_size;
+    size_t capacity;            // Power of two
+    size_t mask;
+    size_t head, tail;
+    int closed;
+    coro_waitq_t senders;       // Waiting for space
+    coro_waitq_t receivers;     // Waiting for an element
+} coro_chan_t;
+
+static inline int coro_chan_init(coro_chan_t *ch, size_t capacity, size_t elem_size) {
+    if (capacity == 0 || elem_size == 0) {
+        return EINVAL;
+    }
+    memset(ch, 0, sizeof(*ch));
+    ch->capacity = 1;
+    while (ch->capacity < capacity) {
+        ch->capacity <<= 1;
+    }
+    ch->mask = ch->capacity - 1;
+    ch->elem_size = elem_size;
+    ch->slots = malloc(ch->capacity * elem_size);
+    if (ch->slots == NULL) {
+        return ENOMEM;
+    }
+    coro_waitq_init(&ch->senders);
+    coro_waitq_init(&ch->receivers);
+    return 0;
+}
+
+static inline void coro_chan_destroy(coro_chan_t *ch) {
+    free(ch->slots);
+    ch->slots = NULL;
+}
+
+// Wake every waiter; receivers drain what is left, then get EPIPE
+static inline void coro_chan_close(coro_chan_t *ch) {
+    coro_t *c;
+    ch->closed = 1;
+    while ((c = coro_waitq_pop(&ch->receivers)) != NULL) {
+        coro_ready(c);
+    }
+    while ((c = coro_waitq_pop(&ch->senders)) != NULL) {
+        coro_ready(c);
+    }
+}
+
+/*
+ * coro_chan_try_send() / coro_chan_try_recv() - Never park
+ *
+ * Return: 0, EAGAIN if the channel is full (send) or empty (recv), or
+ *         EPIPE if it is closed
+ */
+static inline int coro_chan_try_send(coro_chan_t *ch, const void *elem) {
+    if (ch->closed) {
+        return EPIPE;
+    }
+    if (ch->tail - ch->head == ch->capacity) {
+        return EAGAIN;
+    }
+    memcpy(ch->slots + (ch->tail & ch->mask) * ch->elem_size, elem, ch->elem_size);
+    ch->tail++;
+    coro_t *c = coro_waitq_pop(&ch->receivers);
+    if (c != NULL) {
+        coro_ready(c);
+    }
+    return 0;
+}
+
+static inline int coro_chan_try_recv(coro_chan_t *ch, void *out) {
+    if (ch->tail == ch->head) {
+        return ch->closed ? EPIPE : EAGAIN;
+    }
+    memcpy(out, ch->slots + (ch->head & ch->mask) * ch->elem_size, ch->elem_size);
+    ch->head++;
+    coro_t *c = coro_waitq_pop(&ch->senders);
+    if (c != NULL) {
+        coro_ready(c);
+    }
+    return 0;
+}
+
+/*
+ * coro_chan_send() - Append a copy of @elem, parking while full
+ *
+ * Return: 0, or EPIPE if the channel is closed
+ */
+static inline int coro_chan_send(coro_chan_t *ch, const void *elem) {
+    int rc;
+    while ((rc = coro_chan_try_send(ch, elem)) == EAGAIN) {
+        coro_waitq_push(&ch->senders, coro_self());
+        coro_park();
+    }
+    return rc;
+}
+
+/*
+ * coro_chan_recv() - Remove the oldest element into @out, parking while
+ * empty
+ *
+ * Return: 0, or EPIPE once the channel is closed and drained
+ */
+static inline int coro_chan_recv(coro_chan_t *ch, void *out) {
+    int rc;
+    while ((rc = coro_chan_try_recv(ch, out)) == EAGAIN) {
+        coro_waitq_push(&ch->receivers, coro_self());
+        coro_park();
+    }
+    return rc;
+}
+
+#endif // __coro_h__
@@ -0,0 +1,455 @@
+/*
+ * ===================================================================
+ * CP386 Operating Systems Course - Coroutine Mutex, Condvar, Semaphore
+ * ===================================================================
+ *
+ * Blocking primitives for coroutines (coro.h) that block only the
+ * coroutine. pthread_mutex_lock() or sem_wait() inside a coroutine
+ * would put the whole OS thread to sleep, and with it every other
+ * coroutine scheduled on that thread. The versions here park the
+ * calling coroutine on the primitive's wait queue and switch back to
+ * the scheduler, which runs something else.
+ *
+ * Coroutines run on a small fixed set of worker threads (M:N):
+ *
+ *   coro_worker_t w[4];
+ *   for (i = 0; i < 4; i++)
+ *       coro_worker_init(&w[i], 64 * 1024, 0);
+ *   coro_spawn(&w[i % 4].sched, producer, arg);     // before starting
+ *   for (i = 0; i < 4; i++)
+ *       coro_worker_start(&w[i]);
+ *   for (i = 0; i < 4; i++)
+ *       coro_worker_join(&w[i]);                    // all finished
+ *
+ * A coroutine stays on the worker it was spawned on, and the mutex,
+ * condvar and semaphore can be shared by coroutines on any worker.
+ * Without workers, on a plain coro_sched_t, they work too, but only
+ * within the one thread that runs the scheduler.
+ *
+ * Key Components:
+ * - Intrusive wait queues: a waiting coroutine is linked through its
+ *   own coro_t, so blocking never allocates. A short spinlock guards
+ *   each queue; it is only held to link or unlink, never across a park.
+ * - Direct handoff: unlock and post give the mutex or the semaphore
+ *   unit straight to the first waiter, so wakeups are FIFO and a woken
+ *   coroutine never has to retry.
+ * - Wakeups go back to the owning worker: coro_wake() on a coroutine of
+ *   the calling worker just makes it runnable. For another worker it
+ *   pushes the coroutine on that worker's wait-free MPSC queue
+ *   (mpsc_queue.h) and, only if the worker is asleep, writes its
+ *   eventfd. Only a worker ever switches to its own coroutines, so a
+ *   wakeup that arrives before the waiter has finished parking is
+ *   simply picked up after it has.
+ * - Kernel fds: each worker sleeps in epoll_wait() on its eventfd and
+ *   on the fds its coroutines are waiting for. coro_wait_fd() arms the
+ *   fd with EPOLLONESHOT and parks, so a coroutine can wait for a
+ *   socket, pipe or timerfd while the other coroutines keep running.
+ *
+ * A coroutine must not call a blocking system call (read() on an empty
+ * pipe, sleep()) directly; wait for the fd first, or use a timerfd.
+ * Coroutines may only be spawned on a worker from its own thread once
+ * it has started. If every coroutine is parked and nothing will wake
+ * them, coro_worker_join() never returns - the same as a deadlock of
+ * real threads.
+ *
+ * References:
+ * - OSTEP Chapter 26: Concurrency: An Introduction (thread models)
+ * - OSTEP Chapter 33: Event-based Concurrency (epoll-style loops)
+ * - R. von Behren et al., "Capriccio: Scalable Threads for Internet
+ *   Services" (SOSP 2003)
+ */
+
+#ifndef __coro_sync_h__
+#define __coro_sync_h__
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+
+#include "coro.h"
+#include "locks.h"
+#include "mpsc_queue.h"
+
+#define CORO_WORKER_BATCH 256   // Coroutines run between polls
+#define CORO_WORKER_EVENTS 64   // epoll events per epoll_wait()
+
+/*
+ * Worker Threads
+ * ==============
+ */
+
+typedef struct {
+    coro_sched_t sched;
+    mpsc_queue_t remote;        // Woken by other threads, not yet runnable
+    int sleeping;               // In (or about to enter) epoll_wait()
+    int epfd;
+    int wakefd;                 // eventfd, signalled by remote wakeups
+    long fd_waiters;            // Coroutines parked in coro_wait_fd()
+    unsigned long remote_wakes;
+    unsigned long sleeps;
+    pthread_t thread;
+} coro_worker_t;
+
+// Kept on the waiting coroutine's stack; epoll's data.ptr points here
+typedef struct {
+    coro_t *coro;
+    uint32_t revents;
+} coro_fd_wait_t;
+
+/*
+ * coro_worker_init() - Set up a worker and its scheduler
+ *
+ * @stack_size, @flags: as for coro_sched_init()
+ *
+ * Return: 0, or an errno value
+ */
+static inline int coro_worker_init(coro_worker_t *w, size_t stack_size, int flags) {
+    memset(w, 0, sizeof(*w));
+    int rc = coro_sched_init(&w->sched, stack_size, flags);
+    if (rc != 0) {
+        return rc;
+    }
+    w->sched.owner = w;
+    mpsc_queue_init(&w->remote);
+    w->epfd = epoll_create1(EPOLL_CLOEXEC);
+    w->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (w->epfd < 0 || w->wakefd < 0) {
+        rc = errno;
+        if (w->epfd >= 0) {
+            close(w->epfd);
+        }
+        if (w->wakefd >= 0) {
+            close(w->wakefd);
+        }
+        mpsc_queue_destroy(&w->remote);
+        coro_sched_destroy(&w->sched);
+        return rc;
+    }
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = NULL };
+    epoll_ctl(w->epfd, EPOLL_CTL_ADD, w->wakefd, &ev);
+    return 0;
+}
+
+// After coro_worker_join() on every worker that shares primitives
+static inline void coro_worker_destroy(coro_worker_t *w) {
+    close(w->wakefd);
+    close(w->epfd);
+    mpsc_queue_destroy(&w->remote);
+    coro_sched_destroy(&w->sched);
+}
+
+/*
+ * coro_wake() - Make a parked coroutine runnable on its own worker
+ *
+ * Safe from any thread, including non-coroutine code, when the
+ * coroutine's scheduler belongs to a coro_worker_t. A plain
+ * coro_sched_t has no queue for remote wakeups: its coroutines (and
+ * primitives they wait on) may only be woken from the thread that runs
+ * that scheduler.
+ */
+static inline void coro_wake(coro_t *c) {
+    coro_worker_t *w = (coro_worker_t *)c->sched->owner;
+
+    if (coro_this_sched == c->sched || w == NULL) {
+        coro_ready(c);              // Our own scheduler, or single-threaded use
+        return;
+    }
+    mpsc_queue_link(&w->remote, &c->wake);
+    // Order the link before the load of `sleeping` (store-load needs a
+    // full fence); pairs with the fence in coro_worker_poll()
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&w->sleeping, __ATOMIC_RELAXED) &&
+        __atomic_exchange_n(&w->sleeping, 0, __ATOMIC_ACQ_REL)) {
+        uint64_t one = 1;
+        if (write(w->wakefd, &one, sizeof(one)) < 0) {
+            // Counter full: the worker is being woken anyway
+        }
+    }
+}
+
+// Move remote wakeups to the run queue. Return: how many
+static inline long coro_worker_drain(coro_worker_t *w) {
+    mpsc_node_t *node;
+    long n = 0;
+
+    while ((node = mpsc_queue_pop(&w->remote)) != NULL) {
+        coro_ready(mpsc_entry(node, coro_t, wake));
+        n++;
+    }
+    w->remote_wakes += n;
+    return n;
+}
+
+/*
+ * coro_worker_poll() - Collect ready fds and remote wakeups
+ *
+ * @block: sleep in epoll_wait() until something arrives. The worker
+ *         announces it in `sleeping` and re-checks its queue first, so
+ *         a wakeup linked concurrently is never missed.
+ */
+static inline void coro_worker_poll(coro_worker_t *w, int block) {
+    struct epoll_event events[CORO_WORKER_EVENTS];
+
+    if (block) {
+        __atomic_store_n(&w->sleeping, 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (coro_worker_drain(w) > 0) {
+            __atomic_store_n(&w->sleeping, 0, __ATOMIC_RELAXED);
+            block = 0;
+            if (w->fd_waiters == 0) {
+                return;
+            }
+        } else {
+            w->sleeps++;
+        }
+    }
+
+    int n = epoll_wait(w->epfd, events, CORO_WORKER_EVENTS, block ? -1 : 0);
+    __atomic_store_n(&w->sleeping, 0, __ATOMIC_RELAXED);
+    for (int i = 0; i < n; i++) {
+        coro_fd_wait_t *wait = (coro_fd_wait_t *)events[i].data.ptr;
+        if (wait == NULL) {
+            uint64_t count;
+            if (read(w->wakefd, &count, sizeof(count)) < 0) {
+                // Already reset
+            }
+            continue;
+        }
+        wait->revents = events[i].events;
+        w->fd_waiters--;
+        coro_ready(wait->coro);
+    }
+    coro_worker_drain(w);
+}
+
+/*
+ * coro_worker_run() - Run the worker's coroutines until all finished
+ *
+ * Polls fds and remote wakeups every CORO_WORKER_BATCH coroutines, so
+ * coroutines that keep yielding cannot starve them, and sleeps only
+ * when nothing is runnable.
+ */
+static inline void coro_worker_run(coro_worker_t *w) {
+    coro_sched_t *s = &w->sched;
+
+    for (;;) {
+        coro_sched_run_batch(s, CORO_WORKER_BATCH);
+        if (s->live == 0) {
+            break;
+        }
+        int idle = s->run_queue.head == NULL;
+        if (idle || w->fd_waiters > 0) {
+            coro_worker_poll(w, idle);
+        } else {
+            coro_worker_drain(w);
+        }
+    }
+}
+
+static inline void *coro_worker_main(void *arg) {
+    coro_worker_run((coro_worker_t *)arg);
+    return NULL;
+}
+
+static inline int coro_worker_start(coro_worker_t *w) {
+    return pthread_create(&w->thread, NULL, coro_worker_main, w);
+}
+
+static inline void coro_worker_join(coro_worker_t *w) {
+    pthread_join(w->thread, NULL);
+}
+
+/*
+ * coro_wait_fd() - Park the running coroutine until @fd is ready
+ *
+ * @events: EPOLLIN, EPOLLOUT, ...
+ *
+ * Return: the ready events (EPOLLERR/EPOLLHUP included), or -1 with
+ *         errno set if epoll cannot watch @fd (e.g. a regular file)
+ */
+static inline int coro_wait_fd(int fd, uint32_t events) {
+    coro_t *self = coro_self();
+    coro_worker_t *w = (coro_worker_t *)self->sched->owner;
+    coro_fd_wait_t wait = { .coro = self, .revents = 0 };
+    struct epoll_event ev = { .events = events | EPOLLONESHOT, .data.ptr = &wait };
+
+    // A fired EPOLLONESHOT fd stays registered but disarmed; re-arm it
+    if (epoll_ctl(w->epfd, EPOLL_CTL_MOD, fd, &ev) != 0 &&
+        (errno != ENOENT || epoll_ctl(w->epfd, EPOLL_CTL_ADD, fd, &ev) != 0)) {
+        return -1;
+    }
+    w->fd_waiters++;
+    coro_park();
+    return (int)wait.revents;
+}
+
+/*
+ * Wait Queue
+ * ==========
+ *
+ * coro_waitq_t plus the spinlock that lets coroutines of several
+ * workers share it.
+ */
+
+typedef struct {
+    spinlock_t lock;
+    coro_waitq_t queue;
+} coro_waitlist_t;
+
+static inline void coro_waitlist_init(coro_waitlist_t *l) {
+    spinlock_init(&l->lock);
+    coro_waitq_init(&l->queue);
+}
+
+/*
+ * Mutex
+ * =====
+ */
+
+typedef struct {
+    coro_waitlist_t waiters;
+    int locked;                 // Protected by waiters.lock
+} coro_mutex_t;
+
+static inline void coro_mutex_init(coro_mutex_t *m) {
+    coro_waitlist_init(&m->waiters);
+    m->locked = 0;
+}
+
+static inline int coro_mutex_trylock(coro_mutex_t *m) {
+    int acquired = 0;
+    spinlock_lock(&m->waiters.lock);
+    if (!m->locked) {
+        m->locked = acquired = 1;
+    }
+    spinlock_unlock(&m->waiters.lock);
+    return acquired;
+}
+
+static inline void coro_mutex_lock(coro_mutex_t *m) {
+    spinlock_lock(&m->waiters.lock);
+    if (!m->locked) {
+        m->locked = 1;
+        spinlock_unlock(&m->waiters.lock);
+        return;
+    }
+    coro_waitq_push(&m->waiters.queue, coro_self());
+    spinlock_unlock(&m->waiters.lock);
+    coro_park();                // Woken as the new owner
+}
+
+// Hands the mutex to the longest waiter, if any
+static inline void coro_mutex_unlock(coro_mutex_t *m) {
+    spinlock_lock(&m->waiters.lock);
+    coro_t *next = coro_waitq_pop(&m->waiters.queue);
+    if (next == NULL) {
+        m->locked = 0;
+    }
+    spinlock_unlock(&m->waiters.lock);
+    if (next != NULL) {
+        coro_wake(next);
+    }
+}
+
+/*
+ * Condition Variable
+ * ==================
+ *
+ * The waiter queues itself before it releases the mutex, so a signal
+ * sent by the next owner of the mutex always finds it.
+ */
+
+typedef struct {
+    coro_waitlist_t waiters;
+} coro_cond_t;
+
+static inline void coro_cond_init(coro_cond_t *cv) {
+    coro_waitlist_init(&cv->waiters);
+}
+
+static inline void coro_cond_wait(coro_cond_t *cv, coro_mutex_t *m) {
+    spinlock_lock(&cv->waiters.lock);
+    coro_waitq_push(&cv->waiters.queue, coro_self());
+    spinlock_unlock(&cv->waiters.lock);
+    coro_mutex_unlock(m);
+    coro_park();
+    coro_mutex_lock(m);
+}
+
+static inline void coro_cond_signal(coro_cond_t *cv) {
+    spinlock_lock(&cv->waiters.lock);
+    coro_t *c = coro_waitq_pop(&cv->waiters.queue);
+    spinlock_unlock(&cv->waiters.lock);
+    if (c != NULL) {
+        coro_wake(c);
+    }
+}
+
+static inline void coro_cond_broadcast(coro_cond_t *cv) {
+    spinlock_lock(&cv->waiters.lock);
+    coro_t *c = cv->waiters.queue.head;
+    coro_waitq_init(&cv->waiters.queue);
+    spinlock_unlock(&cv->waiters.lock);
+    while (c != NULL) {
+        coro_t *next = c->next;     // coro_wake() may reuse the link
+        coro_wake(c);
+        c = next;
+    }
+}
+
+/*
+ * Semaphore
+ * =========
+ */
+
+typedef struct {
+    coro_waitlist_t waiters;
+    long value;                 // Protected by waiters.lock
+} coro_sem_t;
+
+static inline void coro_sem_init(coro_sem_t *sem, long value) {
+    coro_waitlist_init(&sem->waiters);
+    sem->value = value;
+}
+
+// Return: 0, or EAGAIN if the count is zero (like sem_trywait())
+static inline int coro_sem_trywait(coro_sem_t *sem) {
+    int rc = EAGAIN;
+    spinlock_lock(&sem->waiters.lock);
+    if (sem->value > 0) {
+        sem->value--;
+        rc = 0;
+    }
+    spinlock_unlock(&sem->waiters.lock);
+    return rc;
+}
+
+static inline void coro_sem_wait(coro_sem_t *sem) {
+    spinlock_lock(&sem->waiters.lock);
+    if (sem->value > 0) {
+        sem->value--;
+        spinlock_unlock(&sem->waiters.lock);
+        return;
+    }
+    coro_waitq_push(&sem->waiters.queue, coro_self());
+    spinlock_unlock(&sem->waiters.lock);
+    coro_park();                // Woken holding the posted unit
+}
+
+// Gives the unit straight to the longest waiter, if any
+static inline void coro_sem_post(coro_sem_t *sem) {
+    spinlock_lock(&sem->waiters.lock);
+    coro_t *c = coro_waitq_pop(&sem->waiters.queue);
+    if (c == NULL) {
+        sem->value++;
+    }
+    spinlock_unlock(&sem->waiters.lock);
+    if (c != NULL) {
+        coro_wake(c);
+    }
+}
+
+#endif // __coro_sync_h__
@@ -10,6 +10,7 @@ sem_t s1, s2;
 
 void *thread1(void *arg)
 {
+    (void)arg;
     printf("T1: waiting for s1\n");
     sem_wait(&s1);
     printf("T1: acquired s1\n");
@@ -24,6 +25,7 @@ void *thread1(void *arg)
 
 void *thread2(void *arg)
 {
+    (void)arg;
     /* Changed: acquire in same order as thread1 to avoid circular wait */
     printf("T2: waiting for s1\n");
     sem_wait(&s1);
@@ -1,5 +1,6 @@
 // Simple deadlock using semaphores
 
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <pthread.h>
@@ -33,6 +34,7 @@ static void acquire_two_with_preemption(sem_t *first, sem_t *second, const char
 
 void *thread1(void *arg)
 {
+    (void)arg;
     acquire_two_with_preemption(&s1, &s2, "T1");
     /* critical section */
     printf("T1: in critical section with both semaphores\n");
@@ -43,6 +45,7 @@ void *thread1(void *arg)
 
 void *thread2(void *arg)
 {
+    (void)arg;
     acquire_two_with_preemption(&s2, &s1, "T2");
     /* critical section */
     printf("T2: in critical section with both semaphores\n");
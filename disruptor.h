@@ -0,0 +1,336 @@
+/*
+ * ===================================================================
+ * CP386 Operating Systems Course - Disruptor-Style Multicast Ring
+ * ===================================================================
+ *
+ * A ring buffer where every consumer sees every entry. In a bounded
+ * queue a get() removes the item, so two consumers split the stream
+ * between them. Here consumers only advance their own read cursor, and
+ * a slot is reused once the slowest consumer has moved past it.
+ *
+ * Design (after the LMAX Disruptor):
+ *
+ *   claim             - highest sequence claimed by a producer
+ *   cursor            - highest sequence published (one producer)
+ *   available[slot]   - round in which the slot was last published
+ *                       (several producers)
+ *   consumer->seq     - highest sequence this consumer has finished
+ *   consumer->deps    - other consumers' sequences this consumer must
+ *                       not overtake (a barrier); none means it trails
+ *                       the producers
+ *
+ *   producer:  hi = disruptor_claim(d, n)         // may wait for space
+ *              fill entries hi-n+1 .. hi in place
+ *              disruptor_publish(d, hi-n+1, hi)
+ *
+ *   consumer:  avail = disruptor_wait(c, next)    // may wait
+ *              process entries next .. avail      // a whole batch
+ *              disruptor_release(c, avail)
+ *
+ * Key Components:
+ * - Preallocated entries, written and read in place: nothing is copied
+ *   or allocated per item.
+ * - Sequences are 64-bit counters that never wrap; the slot is
+ *   `seq & mask`. Each sequence sits on its own cache line.
+ * - Batching comes for free: a consumer that falls behind finds many
+ *   entries available and processes them all before touching a shared
+ *   sequence again.
+ * - Dependency barriers: consumer B can depend on consumer A (e.g.
+ *   "write to journal" before "apply"), so B sees an entry only after A
+ *   has finished with it. Entries can be annotated by A for B.
+ * - Multiple producers claim with fetch-and-add and publish by marking
+ *   their slot in `available`, without waiting for each other. A
+ *   consumer scans forward from its next sequence for the longest run
+ *   of published slots. With one producer the cursor alone does.
+ * - Wait strategy: spin briefly (multi-core only), then sleep on a
+ *   condition variable. Whoever advances a sequence wakes sleepers, and
+ *   only takes the mutex if someone is asleep.
+ *
+ * References:
+ * - M. Thompson et al., "Disruptor: High performance alternative to
+ *   bounded queues for exchanging data between concurrent threads"
+ *   (LMAX, 2011)
+ */
+
+#ifndef __disruptor_h__
+#define __disruptor_h__
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#include "locks.h"
+
+#define DISRUPTOR_MAX_CONSUMERS 32
+#define DISRUPTOR_MAX_DEPS 8
+#define DISRUPTOR_SPINS 1000            // Polls before sleeping (multi-core)
+
+typedef struct {
+    int64_t value;
+} __attribute__((aligned(64))) disruptor_seq_t;
+
+typedef struct {
+    char *entries;
+    size_t entry_size;
+    size_t size;                        // Power of two
+    size_t mask;
+    disruptor_seq_t cursor;             // Last published (one producer)
+    disruptor_seq_t claim;              // Last claimed
+    int64_t *available;                 // Per slot: round last published
+    int multi_producer;
+    int shift;                          // log2(size): seq >> shift = round
+    int64_t gating_cache;               // Producer's last seen min(consumers)
+    disruptor_seq_t *gating[DISRUPTOR_MAX_CONSUMERS];
+    int num_gating;
+    int sleepers;                       // Threads asleep (or about to be)
+    pthread_mutex_t mutex;
+    pthread_cond_t progress;
+} __attribute__((aligned(64))) disruptor_t;
+
+typedef struct {
+    disruptor_t *ring;
+    disruptor_seq_t seq;                // Last entry finished
+    disruptor_seq_t *deps[DISRUPTOR_MAX_DEPS];
+    int num_deps;
+    unsigned long batches;              // disruptor_wait() calls
+    unsigned long sleeps;
+} __attribute__((aligned(64))) disruptor_consumer_t;
+
+/*
+ * disruptor_init() - Allocate a ring of @size entries of @entry_size bytes
+ *
+ * @size is rounded up to a power of two. Sequences start at -1, so the
+ * first entry is sequence 0. Set @multi_producer if more than one
+ * thread will publish.
+ *
+ * Return: 0, EINVAL or ENOMEM
+ */
+static inline int disruptor_init(disruptor_t *d, size_t size, size_t entry_size,
+                                 int multi_producer) {
+    if (size == 0 || entry_size == 0) {
+        return EINVAL;
+    }
+    d->size = 1;
+    d->shift = 0;
+    while (d->size < size) {
+        d->size <<= 1;
+        d->shift++;
+    }
+    d->mask = d->size - 1;
+    d->entry_size = entry_size;
+    d->entries = calloc(d->size, entry_size);
+    d->available = malloc(d->size * sizeof(int64_t));
+    if (d->entries == NULL || d->available == NULL) {
+        free(d->entries);
+        free(d->available);
+        return ENOMEM;
+    }
+    for (size_t i = 0; i < d->size; i++) {
+        d->available[i] = -1;
+    }
+    d->multi_producer = multi_producer;
+    d->cursor.value = -1;
+    d->claim.value = -1;
+    d->gating_cache = -1;
+    d->num_gating = 0;
+    d->sleepers = 0;
+    pthread_mutex_init(&d->mutex, NULL);
+    pthread_cond_init(&d->progress, NULL);
+    return 0;
+}
+
+static inline void disruptor_destroy(disruptor_t *d) {
+    pthread_mutex_destroy(&d->mutex);
+    pthread_cond_destroy(&d->progress);
+    free(d->entries);
+    free(d->available);
+    d->entries = NULL;
+    d->available = NULL;
+}
+
+static inline void *disruptor_entry(disruptor_t *d, int64_t seq) {
+    return d->entries + ((size_t)seq & d->mask) * d->entry_size;
+}
+
+/*
+ * disruptor_consumer_init() - Attach a consumer before any producer runs
+ *
+ * @deps: consumers this one must trail, or NULL/0 to trail the
+ *        producers only
+ *
+ * Every consumer gates the producers: no slot is reused before all
+ * consumers are done with it.
+ */
+static inline int disruptor_consumer_init(disruptor_consumer_t *c, disruptor_t *d,
+                                          disruptor_consumer_t **deps, int num_deps) {
+    if (d->num_gating == DISRUPTOR_MAX_CONSUMERS || num_deps > DISRUPTOR_MAX_DEPS) {
+        return EINVAL;
+    }
+    c->ring = d;
+    c->seq.value = -1;
+    c->batches = 0;
+    c->sleeps = 0;
+    for (int i = 0; i < num_deps; i++) {
+        c->deps[i] = &deps[i]->seq;
+    }
+    c->num_deps = num_deps;
+    d->gating[d->num_gating++] = &c->seq;
+    return 0;
+}
+
+/*
+ * Waiting
+ * =======
+ *
+ * Spin briefly (multi-core only), then sleep on `progress`. A sleeper
+ * announces itself in `sleepers` and re-checks under the mutex after a
+ * full fence; a thread that advances a sequence fences and then checks
+ * `sleepers`. So either the notifier sees the sleeper, or the sleeper
+ * sees the new value.
+ */
+static inline int disruptor_spins(void) {
+    return locks_online_cpus() > 1 ? DISRUPTOR_SPINS : 0;
+}
+
+static inline void disruptor_sleep_begin(disruptor_t *d) {
+    pthread_mutex_lock(&d->mutex);
+    __atomic_add_fetch(&d->sleepers, 1, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+}
+
+static inline void disruptor_sleep_end(disruptor_t *d) {
+    __atomic_sub_fetch(&d->sleepers, 1, __ATOMIC_RELAXED);
+    pthread_mutex_unlock(&d->mutex);
+}
+
+// Wake sleepers after advancing a sequence
+static inline void disruptor_notify(disruptor_t *d) {
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&d->sleepers, __ATOMIC_RELAXED) > 0) {
+        pthread_mutex_lock(&d->mutex);
+        pthread_cond_broadcast(&d->progress);
+        pthread_mutex_unlock(&d->mutex);
+    }
+}
+
+// Minimum of a set of sequences
+static inline int64_t disruptor_min(disruptor_seq_t **seqs, int n) {
+    int64_t min = INT64_MAX;
+    for (int i = 0; i < n; i++) {
+        int64_t v = __atomic_load_n(&seqs[i]->value, __ATOMIC_ACQUIRE);
+        if (v < min) {
+            min = v;
+        }
+    }
+    return min;
+}
+
+/*
+ * Producers
+ * =========
+ */
+
+/*
+ * disruptor_claim() - Reserve the next @n entries (n <= ring size)
+ *
+ * Waits until the slowest consumer has freed them.
+ *
+ * Return: the highest claimed sequence; the claim is hi-n+1 .. hi
+ */
+static inline int64_t disruptor_claim(disruptor_t *d, int n) {
+    int64_t hi = __atomic_add_fetch(&d->claim.value, n, __ATOMIC_ACQ_REL);
+    int64_t wrap = hi - (int64_t)d->size;      // Must be consumed first
+    int64_t min;
+
+    // Acquire/release on the cache keeps another producer's view of the
+    // consumers (its acquire loads of their sequences) valid for us
+    if (wrap <= __atomic_load_n(&d->gating_cache, __ATOMIC_ACQUIRE)) {
+        return hi;
+    }
+    for (int i = 0; i < disruptor_spins(); i++) {
+        if ((min = disruptor_min(d->gating, d->num_gating)) >= wrap) {
+            __atomic_store_n(&d->gating_cache, min, __ATOMIC_RELEASE);
+            return hi;
+        }
+        cpu_relax();
+    }
+    disruptor_sleep_begin(d);
+    while ((min = disruptor_min(d->gating, d->num_gating)) < wrap) {
+        pthread_cond_wait(&d->progress, &d->mutex);
+    }
+    disruptor_sleep_end(d);
+    __atomic_store_n(&d->gating_cache, min, __ATOMIC_RELEASE);
+    return hi;
+}
+
+// Make entries @lo .. @hi visible to consumers
+static inline void disruptor_publish(disruptor_t *d, int64_t lo, int64_t hi) {
+    if (d->multi_producer) {
+        for (int64_t seq = lo; seq <= hi; seq++) {
+            __atomic_store_n(&d->available[seq & d->mask], seq >> d->shift, __ATOMIC_RELEASE);
+        }
+    } else {
+        __atomic_store_n(&d->cursor.value, hi, __ATOMIC_RELEASE);
+    }
+    disruptor_notify(d);
+}
+
+/*
+ * Consumers
+ * =========
+ */
+
+// Highest sequence @c may read, starting at @next (< next: none yet)
+static inline int64_t disruptor_available(disruptor_consumer_t *c, int64_t next) {
+    disruptor_t *d = c->ring;
+
+    if (c->num_deps > 0) {
+        return disruptor_min(c->deps, c->num_deps);
+    }
+    if (!d->multi_producer) {
+        return __atomic_load_n(&d->cursor.value, __ATOMIC_ACQUIRE);
+    }
+    // Longest run of published slots from `next` up to the claim
+    int64_t claimed = __atomic_load_n(&d->claim.value, __ATOMIC_ACQUIRE);
+    int64_t seq = next;
+    while (seq <= claimed &&
+           __atomic_load_n(&d->available[seq & d->mask], __ATOMIC_ACQUIRE) == seq >> d->shift) {
+        seq++;
+    }
+    return seq - 1;
+}
+
+/*
+ * disruptor_wait() - Wait until entry @next is available to @c
+ *
+ * Return: the highest available sequence (>= next); entries next .. it
+ *         can all be processed as one batch
+ */
+static inline int64_t disruptor_wait(disruptor_consumer_t *c, int64_t next) {
+    disruptor_t *d = c->ring;
+    int64_t avail;
+
+    c->batches++;
+    for (int i = 0; i < disruptor_spins(); i++) {
+        if ((avail = disruptor_available(c, next)) >= next) {
+            return avail;
+        }
+        cpu_relax();
+    }
+    disruptor_sleep_begin(d);
+    while ((avail = disruptor_available(c, next)) < next) {
+        c->sleeps++;
+        pthread_cond_wait(&d->progress, &d->mutex);
+    }
+    disruptor_sleep_end(d);
+    return avail;
+}
+
+// Mark entries up to @seq as finished by @c
+static inline void disruptor_release(disruptor_consumer_t *c, int64_t seq) {
+    __atomic_store_n(&c->seq.value, seq, __ATOMIC_RELEASE);
+    disruptor_notify(c->ring);
+}
+
+#endif // __disruptor_h__
@@ -0,0 +1,610 @@
+/*
+ * ===================================================================
+ * CP386 Operating Systems Course - Event Loop with Timer Wheel
+ * ===================================================================
+ *
+ * A single-threaded event loop: one thread sleeps in epoll_wait() until
+ * a file descriptor is ready, a timer is due, another thread posts
+ * work, or a signal arrives, and then runs the matching callbacks. It
+ * replaces `sleep(5)` "give the workers time" waits and polling loops
+ * with waiting for the event itself.
+ *
+ *   ev_loop_t loop;
+ *   ev_timer_t timeout;
+ *   ev_loop_init(&loop);
+ *   ev_timer_init(&timeout, on_timeout, NULL);
+ *   ev_timer_start(&loop, &timeout, 5000);      // ms
+ *   ev_io_start(&loop, &io, fd, EPOLLIN, on_readable, NULL);
+ *   ev_loop_run(&loop);     // until ev_loop_stop() or nothing is active
+ *
+ * Key Components:
+ * - epoll for fds (ev_io_t): level-triggered, one epoll_ctl() to start
+ *   and one to stop watching.
+ * - Hierarchical timer wheel (ev_timer_t), after Varghese & Lauck and
+ *   the classic Linux kernel timers: 4 levels of 64 slots with 1 ms
+ *   ticks. Level 0 holds timers due in the next 64 ms, one slot per
+ *   tick; level 1 timers due in the next 4 s, one slot per 64 ms; and
+ *   so on up to 4.6 hours (longer timers wait at the top level and are
+ *   re-filed). Start and stop are O(1) - link into or unlink from a
+ *   slot's list - whatever the number of timers. When level 0 wraps
+ *   around, the next level-1 slot is "cascaded": its timers are filed
+ *   again, now into level 0. A 64-bit mask per level marks non-empty
+ *   slots, so the loop finds the next due slot without scanning.
+ * - Cross-thread posts (ev_work_t): ev_post() links the work into the
+ *   loop's wait-free MPSC queue (mpsc_queue.h) and writes an eventfd,
+ *   but only if the loop is asleep. A thread pool uses this to hand
+ *   completions back to the loop thread.
+ * - signalfd (ev_signal_t): the signal is blocked and read from an fd
+ *   like any other event, so its callback runs in the loop thread and
+ *   may do anything, unlike a signal handler.
+ *
+ * Timers never fire early: with 1 ms ticks a timer may fire up to about
+ * 1 ms late, plus scheduling delay. Timer callbacks may start and stop
+ * timers freely. An fd callback may stop its own watcher; stopping
+ * *another* watcher from a callback is fine, but not freeing it until
+ * the next iteration (its event may already be waiting).
+ *
+ * Signals must be blocked in every thread, so start ev_signal_t
+ * watchers before creating other threads (they inherit the mask).
+ *
+ * Functions that can fail return 0 or an errno value.
+ *
+ * References:
+ * - G. Varghese and T. Lauck, "Hashed and Hierarchical Timing Wheels"
+ *   (SOSP 1987)
+ * - OSTEP Chapter 33: Event-based Concurrency
+ * - epoll(7), eventfd(2), signalfd(2)
+ */
+
+#ifndef __event_loop_h__
+#define __event_loop_h__
+
+#include <errno.h>
+#include <limits.h>
+#include <pthread.h>
+#include <signal.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/signalfd.h>
+
+#include "mpsc_queue.h"
+
+#define EV_LEVELS 4
+#define EV_SLOT_BITS 6
+#define EV_SLOTS (1 << EV_SLOT_BITS)
+#define EV_SLOT_MASK (EV_SLOTS - 1)
+#define EV_MAX_EVENTS 256       // epoll events per iteration
+#define EV_MAX_SIGNAL 64
+
+typedef struct ev_loop ev_loop_t;
+
+// Circular doubly-linked list; a slot head is its own sentinel
+typedef struct ev_list {
+    struct ev_list *prev, *next;
+} ev_list_t;
+
+typedef struct ev_timer ev_timer_t;
+typedef void (*ev_timer_cb)(ev_loop_t *loop, ev_timer_t *timer);
+
+struct ev_timer {
+    ev_list_t link;             // Must be first
+    uint64_t expires;           // Loop time (ms) when it is due
+    int active;
+    int level, slot;            // Where it was last filed
+    ev_timer_cb cb;
+    void *arg;
+};
+
+typedef struct ev_io ev_io_t;
+typedef void (*ev_io_cb)(ev_loop_t *loop, ev_io_t *io, uint32_t revents);
+
+struct ev_io {
+    int fd;
+    uint32_t events;
+    int active;
+    ev_io_cb cb;
+    void *arg;
+};
+
+typedef struct ev_work ev_work_t;
+typedef void (*ev_work_cb)(ev_loop_t *loop, ev_work_t *work);
+
+struct ev_work {
+    mpsc_node_t node;
+    ev_work_cb cb;
+    void *arg;
+};
+
+typedef struct ev_signal ev_signal_t;
+typedef void (*ev_signal_cb)(ev_loop_t *loop, ev_signal_t *sig,
+                             const struct signalfd_siginfo *info);
+
+struct ev_signal {
+    int signo;
+    ev_signal_cb cb;
+    void *arg;
+};
+
+struct ev_loop {
+    int epfd;
+    int wakefd;                 // eventfd for ev_post() / ev_loop_wake()
+    int sigfd;                  // signalfd, -1 until the first signal
+    sigset_t sigmask;
+    ev_signal_t *signals[EV_MAX_SIGNAL + 1];
+    uint64_t now;               // ms, CLOCK_MONOTONIC; see ev_now()
+    uint64_t wheel_time;        // Last tick the wheel has processed
+    ev_list_t wheel[EV_LEVELS][EV_SLOTS];
+    uint64_t occupied[EV_LEVELS];   // Bit per non-empty slot
+    long timers, ios, sigs, refs;   // Active handles; run() exits at 0
+    int stop;
+    mpsc_queue_t posted;
+    int sleeping;               // In (or about to enter) epoll_wait()
+    unsigned long iterations;
+    unsigned long cascaded;     // Timers re-filed to a lower level
+};
+
+static inline uint64_t ev_time_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000 + (uint64_t)ts.tv_nsec / 1000000;
+}
+
+// The loop's idea of the current time (ms): the start of this
+// iteration or the last ev_timer_start(), whichever is later
+static inline uint64_t ev_now(ev_loop_t *l) {
+    return l->now;
+}
+
+/*
+ * Timer Wheel
+ * ===========
+ */
+
+static inline void ev_list_init(ev_list_t *head) {
+    head->prev = head->next = head;
+}
+
+static inline int ev_list_empty(const ev_list_t *head) {
+    return head->next == head;
+}
+
+static inline void ev_list_add_tail(ev_list_t *head, ev_list_t *node) {
+    node->prev = head->prev;
+    node->next = head;
+    head->prev->next = node;
+    head->prev = node;
+}
+
+static inline void ev_list_del(ev_list_t *node) {
+    node->prev->next = node->next;
+    node->next->prev = node->prev;
+    node->prev = node->next = node;
+}
+
+// Move every node of @from to the (empty) @to
+static inline void ev_list_splice(ev_list_t *from, ev_list_t *to) {
+    ev_list_init(to);
+    if (!ev_list_empty(from)) {
+        to->next = from->next;
+        to->prev = from->prev;
+        to->next->prev = to;
+        to->prev->next = to;
+        ev_list_init(from);
+    }
+}
+
+// File @t into the slot for its expiry, relative to the wheel's time
+static inline void ev_timer_file(ev_loop_t *l, ev_timer_t *t) {
+    uint64_t base = l->wheel_time;
+    uint64_t expires = t->expires > base ? t->expires : base + 1;
+    uint64_t delta = expires - base;
+    int level = 0;
+
+    while (level < EV_LEVELS - 1 && delta >= (1ULL << (EV_SLOT_BITS * (level + 1)))) {
+        level++;
+    }
+    if (delta >= (1ULL << (EV_SLOT_BITS * EV_LEVELS))) {
+        // Beyond the top level: park at its far end and re-file later
+        expires = base + (1ULL << (EV_SLOT_BITS * EV_LEVELS)) - 1;
+    }
+    int slot = (int)(expires >> (EV_SLOT_BITS * level)) & EV_SLOT_MASK;
+    ev_list_add_tail(&l->wheel[level][slot], &t->link);
+    l->occupied[level] |= 1ULL << slot;
+    t->level = level;
+    t->slot = slot;
+}
+
+static inline void ev_timer_init(ev_timer_t *t, ev_timer_cb cb, void *arg) {
+    ev_list_init(&t->link);
+    t->expires = 0;
+    t->active = 0;
+    t->level = t->slot = 0;
+    t->cb = cb;
+    t->arg = arg;
+}
+
+static inline void ev_timer_unlink(ev_loop_t *l, ev_timer_t *t) {
+    ev_list_del(&t->link);
+    // If it was in the wheel (not in a list being fired) and the last
+    // timer of its slot, clear the slot's bit
+    if (ev_list_empty(&l->wheel[t->level][t->slot])) {
+        l->occupied[t->level] &= ~(1ULL << t->slot);
+    }
+}
+
+// Stop a timer; harmless if it is not running
+static inline void ev_timer_stop(ev_loop_t *l, ev_timer_t *t) {
+    if (t->active) {
+        ev_timer_unlink(l, t);
+        t->active = 0;
+        l->timers--;
+    }
+}
+
+// (Re)start @t to fire once, @delay_ms from now
+static inline void ev_timer_start(ev_loop_t *l, ev_timer_t *t, uint64_t delay_ms) {
+    ev_timer_stop(l, t);
+    // The wheel catches up with `now` in the next iteration. +1: `now`
+    // is rounded down, so never fire before delay_ms is up
+    l->now = ev_time_ms();
+    t->expires = l->now + delay_ms + 1;
+    t->active = 1;
+    l->timers++;
+    ev_timer_file(l, t);
+}
+
+static inline void ev_cascade(ev_loop_t *l, int level, int slot) {
+    ev_list_t pending;
+
+    ev_list_splice(&l->wheel[level][slot], &pending);
+    l->occupied[level] &= ~(1ULL << slot);
+    while (!ev_list_empty(&pending)) {
+        ev_timer_t *t = (ev_timer_t *)pending.next;
+        ev_list_del(&t->link);
+        ev_timer_file(l, t);
+        l->cascaded++;
+    }
+}
+
+// Advance the wheel to l->now, firing every timer that is due
+static inline void ev_timers_run(ev_loop_t *l) {
+    ev_list_t due;
+
+    while (l->wheel_time < l->now) {
+        if (l->timers == 0) {
+            l->wheel_time = l->now;     // Nothing to fire on the way
+            break;
+        }
+        uint64_t tick = ++l->wheel_time;
+        for (int level = 1; level < EV_LEVELS; level++) {
+            if (tick & ((1ULL << (EV_SLOT_BITS * level)) - 1)) {
+                break;
+            }
+            ev_cascade(l, level, (int)(tick >> (EV_SLOT_BITS * level)) & EV_SLOT_MASK);
+        }
+
+        int slot = (int)tick & EV_SLOT_MASK;
+        ev_list_splice(&l->wheel[0][slot], &due);
+        l->occupied[0] &= ~(1ULL << slot);
+        // A callback may stop timers that are still in `due`, which
+        // just unlinks them from it
+        while (!ev_list_empty(&due)) {
+            ev_timer_t *t = (ev_timer_t *)due.next;
+            ev_list_del(&t->link);
+            t->active = 0;
+            l->timers--;
+            t->cb(l, t);
+        }
+    }
+}
+
+static inline uint64_t ev_rotate_right(uint64_t bits, int n) {
+    n &= 63;
+    return n == 0 ? bits : (bits >> n) | (bits << (64 - n));
+}
+
+/*
+ * ev_next_timeout() - Milliseconds until the wheel has work to do
+ *
+ * For each level, the next non-empty slot after the current one is
+ * where the wheel must next fire (level 0) or cascade (higher levels).
+ *
+ * Return: the timeout for epoll_wait(), -1 if there are no timers
+ */
+static inline int ev_next_timeout(ev_loop_t *l) {
+    uint64_t next = UINT64_MAX;
+
+    if (l->timers == 0) {
+        return -1;
+    }
+    for (int level = 0; level < EV_LEVELS; level++) {
+        if (l->occupied[level] == 0) {
+            continue;
+        }
+        int shift = EV_SLOT_BITS * level;
+        int current = (int)(l->wheel_time >> shift) & EV_SLOT_MASK;
+        uint64_t ahead = ev_rotate_right(l->occupied[level], current + 1);
+        uint64_t k = (uint64_t)__builtin_ctzll(ahead) + 1;     // 1..64
+        uint64_t when = ((l->wheel_time >> shift) + k) << shift;
+        if (when < next) {
+            next = when;
+        }
+    }
+    if (next <= l->now) {
+        return 0;
+    }
+    return next - l->now > INT_MAX ? INT_MAX : (int)(next - l->now);
+}
+
+/*
+ * Loop
+ * ====
+ */
+
+static inline int ev_loop_init(ev_loop_t *l) {
+    memset(l, 0, sizeof(*l));
+    for (int level = 0; level < EV_LEVELS; level++) {
+        for (int slot = 0; slot < EV_SLOTS; slot++) {
+            ev_list_init(&l->wheel[level][slot]);
+        }
+    }
+    l->now = l->wheel_time = ev_time_ms();
+    l->sigfd = -1;
+    sigemptyset(&l->sigmask);
+    mpsc_queue_init(&l->posted);
+
+    l->epfd = epoll_create1(EPOLL_CLOEXEC);
+    l->wakefd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (l->epfd < 0 || l->wakefd < 0) {
+        int rc = errno;
+        if (l->epfd >= 0) {
+            close(l->epfd);
+        }
+        if (l->wakefd >= 0) {
+            close(l->wakefd);
+        }
+        mpsc_queue_destroy(&l->posted);
+        return rc;
+    }
+    struct epoll_event ev = { .events = EPOLLIN, .data.ptr = &l->wakefd };
+    epoll_ctl(l->epfd, EPOLL_CTL_ADD, l->wakefd, &ev);
+    return 0;
+}
+
+static inline void ev_loop_destroy(ev_loop_t *l) {
+    if (l->sigfd >= 0) {
+        pthread_sigmask(SIG_UNBLOCK, &l->sigmask, NULL);
+        close(l->sigfd);
+    }
+    close(l->wakefd);
+    close(l->epfd);
+    mpsc_queue_destroy(&l->posted);
+}
+
+// Keep ev_loop_run() going while work is outstanding elsewhere, e.g.
+// between submitting a job to a thread pool and its completion
+static inline void ev_loop_ref(ev_loop_t *l) {
+    l->refs++;
+}
+
+static inline void ev_loop_unref(ev_loop_t *l) {
+    l->refs--;
+}
+
+// Make ev_loop_run() return after the current iteration
+static inline void ev_loop_stop(ev_loop_t *l) {
+    l->stop = 1;
+}
+
+// Interrupt epoll_wait() from another thread (if it is sleeping)
+static inline void ev_loop_wake(ev_loop_t *l) {
+    if (__atomic_load_n(&l->sleeping, __ATOMIC_RELAXED) &&
+        __atomic_exchange_n(&l->sleeping, 0, __ATOMIC_ACQ_REL)) {
+        uint64_t one = 1;
+        if (write(l->wakefd, &one, sizeof(one)) < 0) {
+            // Counter full: a wakeup is pending anyway
+        }
+    }
+}
+
+static inline void ev_work_init(ev_work_t *w, ev_work_cb cb, void *arg) {
+    w->node.owner = NULL;
+    w->cb = cb;
+    w->arg = arg;
+}
+
+/*
+ * ev_post() - Run @w->cb in the loop thread (callable from any thread)
+ *
+ * Wait-free apart from the eventfd write, which only happens when the
+ * loop is asleep. @w must stay valid until its callback runs.
+ */
+static inline void ev_post(ev_loop_t *l, ev_work_t *w) {
+    mpsc_queue_link(&l->posted, &w->node);
+    // Order the link before the load of `sleeping`; pairs with the
+    // fence in ev_loop_run_once()
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    ev_loop_wake(l);
+}
+
+// Run posted work. Return: how many
+static inline long ev_posted_run(ev_loop_t *l) {
+    mpsc_node_t *node;
+    long n = 0;
+
+    while ((node = mpsc_queue_pop(&l->posted)) != NULL) {
+        ev_work_t *w = mpsc_entry(node, ev_work_t, node);
+        w->cb(l, w);
+        n++;
+    }
+    return n;
+}
+
+/*
+ * File Descriptors
+ * ================
+ */
+
+// Watch @fd for @events (EPOLLIN, EPOLLOUT, ...); level-triggered
+static inline int ev_io_start(ev_loop_t *l, ev_io_t *io, int fd, uint32_t events,
+                              ev_io_cb cb, void *arg) {
+    io->fd = fd;
+    io->events = events;
+    io->cb = cb;
+    io->arg = arg;
+    struct epoll_event ev = { .events = events, .data.ptr = io };
+    if (epoll_ctl(l->epfd, EPOLL_CTL_ADD, fd, &ev) != 0) {
+        return errno;
+    }
+    io->active = 1;
+    l->ios++;
+    return 0;
+}
+
+// Change the events of an active watcher
+static inline int ev_io_modify(ev_loop_t *l, ev_io_t *io, uint32_t events) {
+    struct epoll_event ev = { .events = events, .data.ptr = io };
+    if (epoll_ctl(l->epfd, EPOLL_CTL_MOD, io->fd, &ev) != 0) {
+        return errno;
+    }
+    io->events = events;
+    return 0;
+}
+
+static inline void ev_io_stop(ev_loop_t *l, ev_io_t *io) {
+    if (io->active) {
+        epoll_ctl(l->epfd, EPOLL_CTL_DEL, io->fd, NULL);
+        io->active = 0;
+        l->ios--;
+    }
+}
+
+/*
+ * Signals
+ * =======
+ */
+
+/*
+ * ev_signal_start() - Run @cb in the loop whenever @signo arrives
+ *
+ * Blocks @signo in the calling thread; threads created afterwards
+ * inherit the block. Return: 0, or an errno value
+ */
+static inline int ev_signal_start(ev_loop_t *l, ev_signal_t *s, int signo,
+                                  ev_signal_cb cb, void *arg) {
+    if (signo < 1 || signo > EV_MAX_SIGNAL || l->signals[signo] != NULL) {
+        return EINVAL;
+    }
+    sigset_t one;
+    sigemptyset(&one);
+    sigaddset(&one, signo);
+    pthread_sigmask(SIG_BLOCK, &one, NULL);
+    sigaddset(&l->sigmask, signo);
+
+    int fd = signalfd(l->sigfd, &l->sigmask, SFD_NONBLOCK | SFD_CLOEXEC);
+    if (fd < 0) {
+        return errno;
+    }
+    if (l->sigfd < 0) {
+        struct epoll_event ev = { .events = EPOLLIN, .data.ptr = &l->sigfd };
+        epoll_ctl(l->epfd, EPOLL_CTL_ADD, fd, &ev);
+        l->sigfd = fd;
+    }
+    s->signo = signo;
+    s->cb = cb;
+    s->arg = arg;
+    l->signals[signo] = s;
+    l->sigs++;
+    return 0;
+}
+
+static inline void ev_signal_stop(ev_loop_t *l, ev_signal_t *s) {
+    if (l->signals[s->signo] != s) {
+        return;
+    }
+    l->signals[s->signo] = NULL;
+    l->sigs--;
+    sigdelset(&l->sigmask, s->signo);
+    signalfd(l->sigfd, &l->sigmask, SFD_NONBLOCK | SFD_CLOEXEC);
+    sigset_t one;
+    sigemptyset(&one);
+    sigaddset(&one, s->signo);
+    pthread_sigmask(SIG_UNBLOCK, &one, NULL);
+}
+
+static inline void ev_signals_read(ev_loop_t *l) {
+    struct signalfd_siginfo info;
+
+    while (read(l->sigfd, &info, sizeof(info)) == (ssize_t)sizeof(info)) {
+        if (info.ssi_signo <= EV_MAX_SIGNAL && l->signals[info.ssi_signo] != NULL) {
+            ev_signal_t *s = l->signals[info.ssi_signo];
+            s->cb(l, s, &info);
+        }
+    }
+}
+
+/*
+ * Running
+ * =======
+ */
+
+/*
+ * ev_loop_run_once() - One iteration: wait (if @block), then dispatch
+ *
+ * Sleeps until the next timer is due or an fd, post or signal arrives.
+ * Before sleeping the loop announces it in `sleeping` and checks the
+ * post queue again, so a concurrent ev_post() either is seen here or
+ * sees the flag and writes the eventfd.
+ */
+static inline void ev_loop_run_once(ev_loop_t *l, int block) {
+    struct epoll_event events[EV_MAX_EVENTS];
+    int timeout = 0;
+
+    if (block) {
+        __atomic_store_n(&l->sleeping, 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if (ev_posted_run(l) == 0 && !l->stop) {
+            timeout = ev_next_timeout(l);
+        }
+    }
+    int n = epoll_wait(l->epfd, events, EV_MAX_EVENTS, timeout);
+    __atomic_store_n(&l->sleeping, 0, __ATOMIC_RELAXED);
+    l->iterations++;
+
+    l->now = ev_time_ms();
+    for (int i = 0; i < n; i++) {
+        void *ptr = events[i].data.ptr;
+        if (ptr == &l->wakefd) {
+            uint64_t count;
+            if (read(l->wakefd, &count, sizeof(count)) < 0) {
+                // Already reset
+            }
+        } else if (ptr == &l->sigfd) {
+            ev_signals_read(l);
+        } else {
+            ev_io_t *io = (ev_io_t *)ptr;
+            if (io->active) {
+                io->cb(l, io, events[i].events);
+            }
+        }
+    }
+    ev_timers_run(l);
+    ev_posted_run(l);
+}
+
+/*
+ * ev_loop_run() - Run until ev_loop_stop() or nothing is left to wait
+ * for: no active timers, fd or signal watchers, and no references
+ */
+static inline void ev_loop_run(ev_loop_t *l) {
+    l->stop = 0;
+    while (!l->stop && (l->timers > 0 || l->ios > 0 || l->sigs > 0 || l->refs > 0)) {
+        ev_loop_run_once(l, 1);
+    }
+}
+
+#endif // __event_loop_h__
@@ -0,0 +1,294 @@
+/*
+ * ===================================================================
+ * CP386 Operating Systems Course - Backpressure / Flow-Control Metrics
+ * ===================================================================
+ *
+ * Instrumentation for producer/consumer buffers: how full the buffer
+ * usually is, how long producers wait for space, how long consumers
+ * wait for work, and hooks that fire when the buffer fills up so the
+ * application can shed load before queues grow without bound.
+ *
+ * Key Components:
+ * - flow_counters_t: one per thread, a slot in a stats.h registry. Only
+ *   its owner writes it, so recording an event costs a few stores and
+ *   never bounces a shared cache line between cores.
+ * - Occupancy histogram: FLOW_HIST_BUCKETS buckets. Bucket 0 is "empty"
+ *   and the last bucket is "full"; the ones in between split the rest
+ *   evenly. A buffer that lives in the last bucket means producers are
+ *   outrunning consumers, one that lives in bucket 0 the opposite.
+ * - Blocked / starved time: producers report how long they waited for
+ *   a free slot, consumers how long they waited for an item.
+ * - Watermarks with hysteresis: on_high fires once when occupancy
+ *   reaches `high`, on_low once when it falls back to `low`. Exactly
+ *   one thread sees each transition (CAS on the state flag).
+ * - flow_metrics_snapshot(): sums every thread's counters into one
+ *   flow_snapshot_t. It can run at any time from any thread. Each put
+ *   or get is one stats.h update group, so a snapshot never counts a
+ *   put without its histogram entry; threads are still read one after
+ *   another, not at one instant.
+ *
+ * Usage:
+ *
+ *     flow_metrics_init(&m, capacity, high, low);
+ *     flow_counters_t *c = flow_metrics_register(&m);   // per thread
+ *     ... with the buffer locked:
+ *     flow_record_put(&m, c, occupancy_after_put, blocked_ns);
+ *     flow_record_get(&m, c, occupancy_after_get, starved_ns);
+ *
+ * Pass the occupancy seen while holding the buffer's lock, so the
+ * watermark transitions happen in the order the buffer changed.
+ *
+ * flow_now_ns() needs _GNU_SOURCE (or POSIX 2001).
+ *
+ * References:
+ * - OSTEP Chapter 30: Condition Variables (the producer/consumer problem)
+ * - OSTEP Chapter 31: Semaphores
+ */
+
+#ifndef __flow_metrics_h__
+#define __flow_metrics_h__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <time.h>
+
+#include "stats.h"
+
+#define FLOW_HIST_BUCKETS 10
+
+// Counters in each thread's stats.h slot; the histogram comes last
+enum {
+    FLOW_PUTS,
+    FLOW_GETS,
+    FLOW_PRODUCER_BLOCKS,               // Puts that had to wait for space
+    FLOW_PRODUCER_BLOCKED_NS,
+    FLOW_CONSUMER_STARVES,              // Gets that had to wait for an item
+    FLOW_CONSUMER_STARVED_NS,
+    FLOW_HIST,                          // Occupancy after each put/get
+};
+#define FLOW_NUM_COUNTERS (6 + FLOW_HIST_BUCKETS)
+
+#if FLOW_NUM_COUNTERS > STATS_MAX_COUNTERS
+#error "FLOW_HIST_BUCKETS does not fit in a stats.h slot"
+#endif
+
+typedef struct flow_metrics flow_metrics_t;
+typedef stats_slot_t flow_counters_t;
+
+// Watermark callback: runs in the thread that crossed the watermark
+typedef void (*flow_watermark_fn)(flow_metrics_t *m, size_t occupancy, void *arg);
+
+struct flow_metrics {
+    size_t capacity;
+    size_t high, low;               // Watermarks, in items
+    flow_watermark_fn on_high, on_low;
+    void *arg;
+    int above_high;                 // Between an on_high and its on_low
+    uint64_t high_events;           // on_high transitions so far
+    stats_registry_t counters;
+};
+
+typedef struct {
+    size_t capacity;
+    int threads;
+    uint64_t puts, gets;
+    uint64_t producer_blocks, producer_blocked_ns;
+    uint64_t consumer_starves, consumer_starved_ns;
+    uint64_t high_events;
+    uint64_t hist[FLOW_HIST_BUCKETS];
+} flow_snapshot_t;
+
+static inline uint64_t flow_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ULL + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * flow_metrics_init() - Set up metrics for a buffer of @capacity items
+ *
+ * @high and @low are occupancy watermarks (low < high <= capacity).
+ * Pass high = 0 to disable the watermark callbacks.
+ */
+static inline void flow_metrics_init(flow_metrics_t *m, size_t capacity,
+                                     size_t high, size_t low) {
+    static const char *const names[] = {
+        "puts", "gets", "producer blocks", "producer blocked ns",
+        "consumer starves", "consumer starved ns",
+        "hist 0", "hist 1", "hist 2", "hist 3", "hist 4",
+        "hist 5", "hist 6", "hist 7", "hist 8", "hist 9",
+    };
+
+    memset(m, 0, sizeof(*m));
+    m->capacity = capacity;
+    m->high = high;
+    m->low = low;
+    stats_init(&m->counters, names, FLOW_NUM_COUNTERS);
+}
+
+static inline void flow_metrics_destroy(flow_metrics_t *m) {
+    stats_destroy(&m->counters);
+}
+
+// Install the watermark callbacks (either may be NULL)
+static inline void flow_metrics_on_watermark(flow_metrics_t *m, flow_watermark_fn on_high,
+                                             flow_watermark_fn on_low, void *arg) {
+    m->on_high = on_high;
+    m->on_low = on_low;
+    m->arg = arg;
+}
+
+/*
+ * flow_metrics_register() - Claim a counter block for the calling thread
+ *
+ * Return: the thread's counters, or NULL once STATS_MAX_THREADS threads
+ *         hold one
+ */
+static inline flow_counters_t *flow_metrics_register(flow_metrics_t *m) {
+    return stats_register(&m->counters);
+}
+
+// Occupancy histogram bucket: 0 = empty, last = full, the rest evenly
+static inline int flow_bucket(size_t capacity, size_t occupancy) {
+    if (occupancy == 0) {
+        return 0;
+    }
+    if (occupancy >= capacity) {
+        return FLOW_HIST_BUCKETS - 1;
+    }
+    return 1 + (int)((occupancy - 1) * (FLOW_HIST_BUCKETS - 2) / (capacity - 1));
+}
+
+static inline void flow_check_watermarks(flow_metrics_t *m, size_t occupancy) {
+    if (m->high == 0) {
+        return;
+    }
+    int above = __atomic_load_n(&m->above_high, __ATOMIC_RELAXED);
+    if (!above && occupancy >= m->high) {
+        if (__atomic_compare_exchange_n(&m->above_high, &above, 1, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            __atomic_fetch_add(&m->high_events, 1, __ATOMIC_RELAXED);
+            if (m->on_high != NULL) {
+                m->on_high(m, occupancy, m->arg);
+            }
+        }
+    } else if (above && occupancy <= m->low) {
+        if (__atomic_compare_exchange_n(&m->above_high, &above, 0, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            if (m->on_low != NULL) {
+                m->on_low(m, occupancy, m->arg);
+            }
+        }
+    }
+}
+
+/*
+ * flow_record_put() - Record one put by the thread owning @c
+ *
+ * @occupancy:  items in the buffer right after the put
+ * @blocked_ns: time spent waiting for a free slot (0 if none)
+ */
+static inline void flow_record_put(flow_metrics_t *m, flow_counters_t *c,
+                                   size_t occupancy, uint64_t blocked_ns) {
+    stats_update_begin(c);
+    stats_add(c, FLOW_PUTS, 1);
+    if (blocked_ns > 0) {
+        stats_add(c, FLOW_PRODUCER_BLOCKS, 1);
+        stats_add(c, FLOW_PRODUCER_BLOCKED_NS, blocked_ns);
+    }
+    stats_add(c, FLOW_HIST + flow_bucket(m->capacity, occupancy), 1);
+    stats_update_end(c);
+    flow_check_watermarks(m, occupancy);
+}
+
+/*
+ * flow_record_get() - Record one get by the thread owning @c
+ *
+ * @occupancy:  items left in the buffer right after the get
+ * @starved_ns: time spent waiting for an item (0 if none)
+ */
+static inline void flow_record_get(flow_metrics_t *m, flow_counters_t *c,
+                                   size_t occupancy, uint64_t starved_ns) {
+    stats_update_begin(c);
+    stats_add(c, FLOW_GETS, 1);
+    if (starved_ns > 0) {
+        stats_add(c, FLOW_CONSUMER_STARVES, 1);
+        stats_add(c, FLOW_CONSUMER_STARVED_NS, starved_ns);
+    }
+    stats_add(c, FLOW_HIST + flow_bucket(m->capacity, occupancy), 1);
+    stats_update_end(c);
+    flow_check_watermarks(m, occupancy);
+}
+
+// Sum all per-thread counters (any thread, any time)
+static inline void flow_metrics_snapshot(flow_metrics_t *m, flow_snapshot_t *s) {
+    uint64_t totals[FLOW_NUM_COUNTERS];
+
+    memset(s, 0, sizeof(*s));
+    s->capacity = m->capacity;
+    s->threads = stats_snapshot(&m->counters, totals);
+    s->high_events = __atomic_load_n(&m->high_events, __ATOMIC_RELAXED);
+    s->puts = totals[FLOW_PUTS];
+    s->gets = totals[FLOW_GETS];
+    s->producer_blocks = totals[FLOW_PRODUCER_BLOCKS];
+    s->producer_blocked_ns = totals[FLOW_PRODUCER_BLOCKED_NS];
+    s->consumer_starves = totals[FLOW_CONSUMER_STARVES];
+    s->consumer_starved_ns = totals[FLOW_CONSUMER_STARVED_NS];
+    memcpy(s->hist, &totals[FLOW_HIST], sizeof(s->hist));
+}
+
+// Print a snapshot as a short report with an occupancy bar chart
+static inline void flow_snapshot_print(const flow_snapshot_t *s) {
+    uint64_t samples = 0;
+    for (int b = 0; b < FLOW_HIST_BUCKETS; b++) {
+        samples += s->hist[b];
+    }
+
+    printf("Flow metrics (%d threads, capacity %zu)\n", s->threads, s->capacity);
+    printf("  puts %llu, gets %llu, high-watermark events %llu\n",
+           (unsigned long long)s->puts, (unsigned long long)s->gets,
+           (unsigned long long)s->high_events);
+    printf("  producers blocked: %llu times, %.1f ms total, %.2f ms avg\n",
+           (unsigned long long)s->producer_blocks, s->producer_blocked_ns / 1e6,
+           s->producer_blocks ? s->producer_blocked_ns / 1e6 / s->producer_blocks : 0.0);
+    printf("  consumers starved: %llu times, %.1f ms total, %.2f ms avg\n",
+           (unsigned long long)s->consumer_starves, s->consumer_starved_ns / 1e6,
+           s->consumer_starves ? s->consumer_starved_ns / 1e6 / s->consumer_starves : 0.0);
+    printf("  occupancy after each put/get:\n");
+    for (int b = 0; b < FLOW_HIST_BUCKETS; b++) {
+        char label[48];
+        if (b == 0) {
+            snprintf(label, sizeof(label), "empty");
+        } else if (b == FLOW_HIST_BUCKETS - 1) {
+            snprintf(label, sizeof(label), "full");
+        } else {
+            // Occupancies that map to this bucket; none if capacity is small
+            size_t lo = 0, hi = 0;
+            for (size_t o = 1; o < s->capacity; o++) {
+                if (flow_bucket(s->capacity, o) == b) {
+                    if (lo == 0) {
+                        lo = o;
+                    }
+                    hi = o;
+                }
+            }
+            if (lo == 0) {
+                continue;
+            }
+            if (lo == hi) {
+                snprintf(label, sizeof(label), "%zu", lo);
+            } else {
+                snprintf(label, sizeof(label), "%zu-%zu", lo, hi);
+            }
+        }
+        double pct = samples ? 100.0 * s->hist[b] / samples : 0.0;
+        printf("    %-11s %5.1f%% ", label, pct);
+        for (int i = 0; i < (int)(pct / 2); i++) {
+            putchar('#');
+        }
+        putchar('\n');
+    }
+}
+
+#endif // __flow_metrics_h__
@@ -0,0 +1,508 @@
+/*
+ * ===================================================================
+ * CP386 Operating Systems Course - Shared Lock Implementations
+ * ===================================================================
+ *
+ * One header-only copy of the locks used by the note7 and note8 demos,
+ * so every demo and benchmark exercises exactly the same code and a
+ * performance fix only has to be made once.
+ *
+ * Key Components:
+ * - spinlock_t:    test-and-test-and-set spinlock (TTAS) with optional
+ *                  exponential backoff
+ * - ticket_lock_t: FIFO ticket lock built on fetch-and-add
+ * - adaptive_mutex_t: spins or sleeps depending on how long the lock is
+ *                  usually held and whether the owner is running
+ *                  (Linux; needs _GNU_SOURCE)
+ * - priority_mutex_init(): pthread mutex with priority inheritance or
+ *                  priority ceiling (needs _GNU_SOURCE)
+ * - lock_t:        a generic lock whose implementation is chosen at
+ *                  compile time with -DLOCK_IMPL=LOCK_IMPL_<KIND>
+ *
+ * Compile-Time Selection:
+ *
+ *     gcc -DLOCK_IMPL=LOCK_IMPL_TICKET demo.c      (or `make LOCK_IMPL=TICKET`)
+ *
+ * LOCK_IMPL_MUTEX (the default) maps lock_t onto pthread_mutex_t.
+ * LOCK_IMPL_ADAPTIVE needs _GNU_SOURCE defined before any #include.
+ *
+ * All atomics use GCC __sync/__atomic builtins so the header compiles
+ * with -std=c99.
+ *
+ * References:
+ * - OSTEP Chapter 28: Locks
+ * - Mellor-Crummey & Scott, "Algorithms for Scalable Synchronization on
+ *   Shared-Memory Multiprocessors" (1991)
+ */
+
+#ifndef __locks_h__
+#define __locks_h__
+
+#include <pthread.h>
+#include <sched.h>
+
+/*
+ * cpu_relax() - Spin-wait hint
+ *
+ * PAUSE on x86 (YIELD on ARM) tells the core we are busy-waiting: it
+ * saves power, gives the sibling hyperthread more resources and avoids
+ * a memory-order mis-speculation penalty when the lock is released.
+ */
+#if defined(__x86_64__) || defined(__i386__)
+#define cpu_relax() __builtin_ia32_pause()
+#elif defined(__aarch64__) || defined(__arm__)
+#define cpu_relax() __asm__ __volatile__("yield" ::: "memory")
+#else
+#define cpu_relax() __asm__ __volatile__("" ::: "memory")
+#endif
+
+#define SPIN_BACKOFF_MIN 4        // Initial backoff, in cpu_relax() calls
+#define SPIN_BACKOFF_MAX 1024     // Backoff cap
+#define SPIN_YIELD_THRESHOLD 256  // Spins before a waiter yields the CPU
+
+/*
+ * spin_wait_step() - One iteration of a busy-wait loop
+ *
+ * Spins with cpu_relax(), but every SPIN_YIELD_THRESHOLD iterations
+ * yields the CPU. When there are more runnable threads than cores the
+ * lock holder (or, for a ticket lock, the next thread in line) may be
+ * preempted; without the yield a waiter would burn its whole time slice
+ * before the holder gets to run again.
+ */
+static inline void spin_wait_step(unsigned int *spins) {
+    if (++*spins % SPIN_YIELD_THRESHOLD == 0) {
+        sched_yield();
+    } else {
+        cpu_relax();
+    }
+}
+
+/*
+ * Spinlock (Test-and-Test-and-Set)
+ * ================================
+ *
+ * Waiters spin on a plain read, which stays in their own cache, and
+ * only retry the atomic exchange once the lock looks free. A plain
+ * test-and-set loop would instead bounce the cache line on every spin.
+ */
+typedef struct {
+    volatile int flag;   // 0: unlocked, 1: locked
+} spinlock_t;
+
+#define SPINLOCK_INITIALIZER { 0 }
+
+static inline void spinlock_init(spinlock_t *lock) {
+    lock->flag = 0;
+}
+
+static inline int spinlock_trylock(spinlock_t *lock) {
+    return lock->flag == 0 && __sync_lock_test_and_set(&lock->flag, 1) == 0;
+}
+
+static inline void spinlock_lock(spinlock_t *lock) {
+    unsigned int spins = 0;
+
+    while (__sync_lock_test_and_set(&lock->flag, 1)) {
+        while (lock->flag) {
+            spin_wait_step(&spins);
+        }
+    }
+}
+
+// Spinlock acquisition with randomized exponential backoff: after each
+// failed attempt wait twice as long (up to a cap) before retrying,
+// which spreads out waiters when many threads contend for the lock.
+static inline void spinlock_lock_backoff(spinlock_t *lock) {
+    unsigned int backoff = SPIN_BACKOFF_MIN;
+
+    while (!spinlock_trylock(lock)) {
+        for (unsigned int i = 0; i < backoff; i++) {
+            cpu_relax();
+        }
+        if (backoff < SPIN_BACKOFF_MAX) {
+            backoff *= 2;
+        } else {
+            sched_yield();
+        }
+    }
+}
+
+static inline void spinlock_unlock(spinlock_t *lock) {
+    __sync_lock_release(&lock->flag);
+}
+
+static inline int spinlock_is_locked(spinlock_t *lock) {
+    return lock->flag != 0;
+}
+
+/*
+ * Ticket Lock
+ * ===========
+ *
+ * Each thread takes a ticket with fetch-and-add and waits until
+ * now_serving reaches it. Threads enter in the order they arrived, so
+ * no thread can starve.
+ */
+typedef struct {
+    volatile unsigned int next_ticket;   // Next ticket to be issued
+    volatile unsigned int now_serving;   // Ticket currently allowed in
+} ticket_lock_t;
+
+#define TICKET_LOCK_INITIALIZER { 0, 0 }
+
+static inline void ticket_lock_init(ticket_lock_t *lock) {
+    lock->next_ticket = 0;
+    lock->now_serving = 0;
+}
+
+static inline void ticket_lock_lock(ticket_lock_t *lock) {
+    unsigned int my_ticket = __sync_fetch_and_add(&lock->next_ticket, 1);
+    unsigned int spins = 0;
+
+    while (__atomic_load_n(&lock->now_serving, __ATOMIC_ACQUIRE) != my_ticket) {
+        spin_wait_step(&spins);
+    }
+}
+
+// Only take a ticket if it would be served immediately
+static inline int ticket_lock_trylock(ticket_lock_t *lock) {
+    unsigned int serving = __atomic_load_n(&lock->now_serving, __ATOMIC_ACQUIRE);
+    return __sync_bool_compare_and_swap(&lock->next_ticket, serving, serving + 1);
+}
+
+static inline void ticket_lock_unlock(ticket_lock_t *lock) {
+    // Only the holder writes now_serving, so a plain increment is enough
+    __atomic_store_n(&lock->now_serving, lock->now_serving + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * Adaptive Mutex
+ * ==============
+ *
+ * Spinning wins when the lock will be free sooner than a sleep/wakeup
+ * round trip (a futex wait plus two context switches, several
+ * microseconds). Sleeping wins when the wait is long, or when the owner
+ * is not running at all - spinning then only delays the owner.
+ *
+ * The adaptive mutex decides per acquisition:
+ *
+ * - The owner records when it took the lock, and on release folds the
+ *   hold time into an exponentially weighted moving average (EWMA,
+ *   weight 1/8). Only contended acquires and every
+ *   ADAPTIVE_SAMPLE_INTERVAL-th uncontended one are timed, so an
+ *   uncontended lock/unlock pair is a CAS and an exchange. When a
+ *   waiter finds an untimed owner, it starts the clock itself.
+ * - A waiter estimates the remaining wait as (EWMA - time held so far)
+ *   and spins only while that is below ADAPTIVE_CSW_COST_NS and its own
+ *   spin time stays within the same budget.
+ * - User space cannot ask the kernel whether another thread is on a
+ *   CPU, so "owner running" is inferred: the owner cannot be running if
+ *   we are on the CPU it acquired on, or if the machine has one CPU, and
+ *   it is probably preempted or blocked if it has held the lock for more
+ *   than ADAPTIVE_OVERDUE_FACTOR times its usual hold time.
+ * - Otherwise the waiter parks on a futex (Drepper's "Futexes Are
+ *   Tricky" mutex: state 0 = free, 1 = locked, 2 = locked with sleepers).
+ */
+#if defined(__linux__) && defined(_GNU_SOURCE)
+#define LOCKS_HAVE_ADAPTIVE 1
+
+#include <stdint.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#ifndef ADAPTIVE_CSW_COST_NS
+#define ADAPTIVE_CSW_COST_NS 5000      // Estimated cost of sleeping + wakeup
+#endif
+#define ADAPTIVE_OVERDUE_FACTOR 4
+#define ADAPTIVE_CLOCK_CHECK 64        // Spins between clock reads
+#define ADAPTIVE_SAMPLE_INTERVAL 64    // Uncontended acquires per timed one (power of 2)
+
+typedef struct {
+    volatile int state;                // 0 free, 1 locked, 2 locked + sleepers
+    volatile int owner_cpu;            // CPU the current owner acquired on
+    volatile uint64_t hold_start_ns;   // When the current owner acquired, 0 if untimed
+    volatile uint64_t hold_ewma_ns;    // Smoothed hold time
+    int timed;                         // Owner-only: this hold updates the EWMA
+    unsigned long spin_acquires;       // Acquired without sleeping (incl. uncontended)
+    unsigned long sleep_acquires;      // Acquired after parking
+} adaptive_mutex_t;
+
+#define ADAPTIVE_MUTEX_INITIALIZER { 0, -1, 0, 0, 0, 0, 0 }
+
+static inline uint64_t locks_clock_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * locks_now_ns() - Cheap timestamp for the lock fast path
+ *
+ * The adaptive mutex timestamps contended acquires and spinning
+ * waiters, and clock_gettime() can cost ~50 ns under virtualization. On
+ * x86 we read the TSC instead and scale it by a ratio measured once
+ * against CLOCK_MONOTONIC; the result only needs to be roughly
+ * nanoseconds.
+ *
+ * The 1 ms calibration runs from a constructor, before main(), so it
+ * never lands in a lock path - not even for locks set up with
+ * ADAPTIVE_MUTEX_INITIALIZER, which skip adaptive_mutex_init().
+ */
+#if defined(__x86_64__) || defined(__i386__)
+static double locks_ns_per_tick;        // 0 until calibrated
+static pthread_once_t locks_tsc_once = PTHREAD_ONCE_INIT;
+
+static void locks_tsc_calibrate(void) {
+    uint64_t ns0 = locks_clock_ns();
+    uint64_t t0 = __builtin_ia32_rdtsc();
+    while (locks_clock_ns() - ns0 < 1000000) {
+        // Calibrate over 1 ms
+    }
+    uint64_t ns1 = locks_clock_ns();
+    uint64_t t1 = __builtin_ia32_rdtsc();
+    double ratio = (double)(ns1 - ns0) / (double)(t1 - t0);
+    __atomic_store(&locks_ns_per_tick, &ratio, __ATOMIC_RELEASE);
+}
+
+__attribute__((constructor)) static void locks_tsc_init(void) {
+    pthread_once(&locks_tsc_once, locks_tsc_calibrate);
+}
+#endif
+
+static inline uint64_t locks_now_ns(void) {
+#if defined(__x86_64__) || defined(__i386__)
+    double ratio;
+    __atomic_load(&locks_ns_per_tick, &ratio, __ATOMIC_ACQUIRE);
+    if (ratio != 0.0) {
+        return (uint64_t)(__builtin_ia32_rdtsc() * ratio);
+    }
+    // Only reachable from another constructor that ran before ours
+    return locks_clock_ns();
+#else
+    return locks_clock_ns();
+#endif
+}
+
+static inline void adaptive_mutex_init(adaptive_mutex_t *lock) {
+    adaptive_mutex_t initial = ADAPTIVE_MUTEX_INITIALIZER;
+    *lock = initial;
+}
+
+static inline int locks_online_cpus(void) {
+    static int cpus = 0;
+    if (cpus == 0) {
+        cpus = (int)sysconf(_SC_NPROCESSORS_ONLN);
+    }
+    return cpus;
+}
+
+// Should a waiter that has already spun for `spun_ns` keep spinning?
+static inline int adaptive_should_spin(adaptive_mutex_t *lock, uint64_t now,
+                                       uint64_t spun_ns) {
+    if (locks_online_cpus() < 2 || spun_ns >= ADAPTIVE_CSW_COST_NS) {
+        return 0;
+    }
+
+    uint64_t ewma = lock->hold_ewma_ns;
+    uint64_t start = lock->hold_start_ns;
+    if (start == 0) {
+        // Untimed owner: it has held the lock at least since now
+        __sync_bool_compare_and_swap(&lock->hold_start_ns, 0, now);
+        start = now;
+    }
+    uint64_t held = now > start ? now - start : 0;
+
+    // Owner running? Not if we share its CPU, probably not if overdue
+    if (lock->owner_cpu == sched_getcpu() ||
+        held > ADAPTIVE_OVERDUE_FACTOR * ewma + ADAPTIVE_CSW_COST_NS) {
+        return 0;
+    }
+
+    uint64_t remaining = ewma > held ? ewma - held : 0;
+    return remaining < ADAPTIVE_CSW_COST_NS;
+}
+
+// Record the new owner; @contended acquires are always timed
+static inline void adaptive_mutex_acquired(adaptive_mutex_t *lock, int contended,
+                                           int slept) {
+    if (slept) {
+        lock->sleep_acquires++;
+    } else {
+        lock->spin_acquires++;
+    }
+    if (contended || (lock->spin_acquires & (ADAPTIVE_SAMPLE_INTERVAL - 1)) == 0) {
+        lock->owner_cpu = sched_getcpu();
+        lock->hold_start_ns = locks_now_ns();
+        lock->timed = 1;
+    }
+}
+
+static inline int adaptive_mutex_trylock(adaptive_mutex_t *lock) {
+    if (__sync_bool_compare_and_swap(&lock->state, 0, 1)) {
+        adaptive_mutex_acquired(lock, 0, 0);
+        return 1;
+    }
+    return 0;
+}
+
+static inline void adaptive_mutex_lock(adaptive_mutex_t *lock) {
+    if (adaptive_mutex_trylock(lock)) {
+        return;
+    }
+
+    // Phase 1: spin while the heuristics say the lock is about to free up
+    uint64_t spin_start = locks_now_ns();
+    uint64_t now = spin_start;
+    unsigned int spins = 0;
+    while (adaptive_should_spin(lock, now, now - spin_start)) {
+        for (int i = 0; i < ADAPTIVE_CLOCK_CHECK; i++) {
+            if (lock->state == 0 && __sync_bool_compare_and_swap(&lock->state, 0, 1)) {
+                adaptive_mutex_acquired(lock, 1, 0);
+                return;
+            }
+            spin_wait_step(&spins);
+        }
+        now = locks_now_ns();
+    }
+
+    // Phase 2: sleep. Mark the lock contended (2) so unlock wakes us.
+    int c = __sync_lock_test_and_set(&lock->state, 2);
+    while (c != 0) {
+        syscall(SYS_futex, &lock->state, FUTEX_WAIT_PRIVATE, 2, NULL, NULL, 0);
+        c = __sync_lock_test_and_set(&lock->state, 2);
+    }
+    adaptive_mutex_acquired(lock, 1, 1);
+}
+
+static inline void adaptive_mutex_unlock(adaptive_mutex_t *lock) {
+    // Fold a timed hold into the EWMA (only the owner writes it)
+    if (lock->timed) {
+        uint64_t held = locks_now_ns() - lock->hold_start_ns;
+        int64_t delta = (int64_t)held - (int64_t)lock->hold_ewma_ns;
+        lock->hold_ewma_ns = (uint64_t)((int64_t)lock->hold_ewma_ns + delta / 8);
+        lock->owner_cpu = -1;
+        lock->timed = 0;
+    }
+    lock->hold_start_ns = 0;
+
+    if (__sync_lock_test_and_set(&lock->state, 0) == 2) {
+        syscall(SYS_futex, &lock->state, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+    }
+}
+
+#endif // __linux__ && _GNU_SOURCE
+
+/*
+ * Priority-Aware Mutexes
+ * ======================
+ *
+ * Priority inversion: a low-priority thread L holds a lock that a
+ * high-priority thread H needs, and medium-priority threads (which do
+ * not need the lock at all) keep L off the CPU - so H effectively runs
+ * at L's priority, for an unbounded time.
+ *
+ * POSIX offers two protocols that bound the inversion to one critical
+ * section:
+ *
+ * - PTHREAD_PRIO_INHERIT: while H waits, L runs at H's priority.
+ * - PTHREAD_PRIO_PROTECT: whoever holds the lock runs at a fixed
+ *   "ceiling" priority (the highest priority of any thread that uses it).
+ *
+ * Both only matter for real-time policies (SCHED_FIFO / SCHED_RR).
+ */
+#ifdef _GNU_SOURCE
+
+typedef enum {
+    PRIORITY_MUTEX_NONE = PTHREAD_PRIO_NONE,
+    PRIORITY_MUTEX_INHERIT = PTHREAD_PRIO_INHERIT,
+    PRIORITY_MUTEX_PROTECT = PTHREAD_PRIO_PROTECT
+} priority_protocol_t;
+
+/*
+ * priority_mutex_init() - Initialize a mutex with a priority protocol
+ *
+ * @ceiling: priority ceiling for PRIORITY_MUTEX_PROTECT (ignored otherwise)
+ *
+ * Return: 0 on success, or an error number from pthread (e.g. ENOTSUP)
+ */
+static inline int priority_mutex_init(pthread_mutex_t *mutex,
+                                      priority_protocol_t protocol, int ceiling) {
+    pthread_mutexattr_t attr;
+    int rc = pthread_mutexattr_init(&attr);
+    if (rc != 0) {
+        return rc;
+    }
+
+    rc = pthread_mutexattr_setprotocol(&attr, (int)protocol);
+    if (rc == 0 && protocol == PRIORITY_MUTEX_PROTECT) {
+        rc = pthread_mutexattr_setprioceiling(&attr, ceiling);
+    }
+    if (rc == 0) {
+        rc = pthread_mutex_init(mutex, &attr);
+    }
+
+    pthread_mutexattr_destroy(&attr);
+    return rc;
+}
+
+#endif // _GNU_SOURCE
+
+/*
+ * Generic Lock (compile-time selection)
+ * =====================================
+ */
+#define LOCK_IMPL_MUTEX    1
+#define LOCK_IMPL_SPINLOCK 2
+#define LOCK_IMPL_TICKET   3
+#define LOCK_IMPL_ADAPTIVE 4
+
+#ifndef LOCK_IMPL
+#define LOCK_IMPL LOCK_IMPL_MUTEX
+#endif
+
+#if LOCK_IMPL == LOCK_IMPL_MUTEX
+typedef pthread_mutex_t lock_t;
+#define LOCK_INITIALIZER      PTHREAD_MUTEX_INITIALIZER
+#define LOCK_IMPL_NAME        "mutex"
+#define lock_init(l)          pthread_mutex_init((l), NULL)
+#define lock_acquire(l)       pthread_mutex_lock(l)
+#define lock_tryacquire(l)    (pthread_mutex_trylock(l) == 0)
+#define lock_release(l)       pthread_mutex_unlock(l)
+#define lock_destroy(l)       pthread_mutex_destroy(l)
+#elif LOCK_IMPL == LOCK_IMPL_SPINLOCK
+typedef spinlock_t lock_t;
+#define LOCK_INITIALIZER      SPINLOCK_INITIALIZER
+#define LOCK_IMPL_NAME        "spinlock"
+#define lock_init(l)          spinlock_init(l)
+#define lock_acquire(l)       spinlock_lock(l)
+#define lock_tryacquire(l)    spinlock_trylock(l)
+#define lock_release(l)       spinlock_unlock(l)
+#define lock_destroy(l)       ((void)(l))
+#elif LOCK_IMPL == LOCK_IMPL_TICKET
+typedef ticket_lock_t lock_t;
+#define LOCK_INITIALIZER      TICKET_LOCK_INITIALIZER
+#define LOCK_IMPL_NAME        "ticket"
+#define lock_init(l)          ticket_lock_init(l)
+#define lock_acquire(l)       ticket_lock_lock(l)
+#define lock_tryacquire(l)    ticket_lock_trylock(l)
+#define lock_release(l)       ticket_lock_unlock(l)
+#define lock_destroy(l)       ((void)(l))
+#elif LOCK_IMPL == LOCK_IMPL_ADAPTIVE
+#ifndef LOCKS_HAVE_ADAPTIVE
+#error "LOCK_IMPL_ADAPTIVE needs Linux and _GNU_SOURCE defined before including locks.h"
+#endif
+typedef adaptive_mutex_t lock_t;
+#define LOCK_INITIALIZER      ADAPTIVE_MUTEX_INITIALIZER
+#define LOCK_IMPL_NAME        "adaptive"
+#define lock_init(l)          adaptive_mutex_init(l)
+#define lock_acquire(l)       adaptive_mutex_lock(l)
+#define lock_tryacquire(l)    adaptive_mutex_trylock(l)
+#define lock_release(l)       adaptive_mutex_unlock(l)
+#define lock_destroy(l)       ((void)(l))
+#else
+#error "Unknown LOCK_IMPL (use LOCK_IMPL_MUTEX, LOCK_IMPL_SPINLOCK, LOCK_IMPL_TICKET or LOCK_IMPL_ADAPTIVE)"
+#endif
+
+#endif // __locks_h__
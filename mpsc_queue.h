@@ -0,0 +1,261 @@
+/*
+ * ===================================================================
+ * CP386 Operating Systems Course - Intrusive MPSC Queue
+ * ===================================================================
+ *
+ * An unbounded multi-producer / single-consumer FIFO for fan-in paths:
+ * many threads hand work to one consumer and must never block doing it.
+ *
+ * Algorithm (Dmitry Vyukov's node-based MPSC queue):
+ *
+ *   push: node->next = NULL
+ *         prev = atomic_exchange(&q->head, node)     // one atomic op
+ *         prev->next = node                          // link it in
+ *
+ *   pop:  walk q->tail->next; only the consumer touches q->tail
+ *
+ * A push is wait-free: one exchange and one store, no loop, no lock, no
+ * matter how many producers there are. Between the exchange and the
+ * store the list is briefly disconnected, so pop() may report "empty"
+ * while a push is in flight; the element shows up on the next pop.
+ *
+ * Intrusive: the queue links mpsc_node_t members embedded in the
+ * caller's own structs, so it never allocates. mpsc_entry() gets back
+ * from the node to the containing struct.
+ *
+ * Node recycling: mpsc_pool_t is a per-producer free list. The producer
+ * takes nodes from its private list; the consumer gives used nodes back
+ * to the node's owner with one CAS, and the owner grabs all returned
+ * nodes at once with an exchange, so there is no ABA problem. In steady
+ * state a producer allocates nothing.
+ *
+ * Blocking consumer: mpsc_queue_pop_wait() sleeps on a condition
+ * variable when the queue is empty. Producers only touch the mutex if
+ * the consumer has announced that it is going to sleep.
+ *
+ * References:
+ * - D. Vyukov, "Intrusive MPSC node-based queue", 1024cores.net
+ */
+
+#ifndef __mpsc_queue_h__
+#define __mpsc_queue_h__
+
+#include <pthread.h>
+#include <stddef.h>
+#include <stdlib.h>
+
+struct mpsc_pool;
+
+typedef struct mpsc_node {
+    struct mpsc_node *next;
+    struct mpsc_pool *owner;    // Pool the node returns to (NULL: none)
+} mpsc_node_t;
+
+// Containing struct of an embedded mpsc_node_t
+#define mpsc_entry(node, type, member) \
+    ((type *)((char *)(node) - offsetof(type, member)))
+
+typedef struct {
+    mpsc_node_t *head;          // Newest node; producers exchange here
+    char pad[64 - sizeof(mpsc_node_t *)];
+    mpsc_node_t *tail;          // Oldest node; consumer only
+    mpsc_node_t stub;           // Keeps the list non-empty
+    int sleeping;               // Consumer is (about to be) asleep
+    pthread_mutex_t mutex;
+    pthread_cond_t wakeup;
+} mpsc_queue_t;
+
+static inline void mpsc_queue_init(mpsc_queue_t *q) {
+    q->stub.next = NULL;
+    q->stub.owner = NULL;
+    q->head = &q->stub;
+    q->tail = &q->stub;
+    q->sleeping = 0;
+    pthread_mutex_init(&q->mutex, NULL);
+    pthread_cond_init(&q->wakeup, NULL);
+}
+
+static inline void mpsc_queue_destroy(mpsc_queue_t *q) {
+    pthread_mutex_destroy(&q->mutex);
+    pthread_cond_destroy(&q->wakeup);
+}
+
+// Link a node in without waking anyone. Wait-free.
+static inline void mpsc_queue_link(mpsc_queue_t *q, mpsc_node_t *node) {
+    __atomic_store_n(&node->next, NULL, __ATOMIC_RELAXED);
+    mpsc_node_t *prev = __atomic_exchange_n(&q->head, node, __ATOMIC_SEQ_CST);
+    __atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+}
+
+/*
+ * mpsc_queue_push() - Append a node (any thread)
+ *
+ * Never blocks on the queue; only takes the mutex if the consumer is
+ * asleep and needs a wakeup.
+ */
+static inline void mpsc_queue_push(mpsc_queue_t *q, mpsc_node_t *node) {
+    mpsc_queue_link(q, node);
+    // Order the link before the load of `sleeping` (store-load needs a
+    // full fence); pairs with the fence in mpsc_queue_pop_wait()
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    if (__atomic_load_n(&q->sleeping, __ATOMIC_RELAXED)) {
+        pthread_mutex_lock(&q->mutex);
+        q->sleeping = 0;
+        pthread_cond_signal(&q->wakeup);
+        pthread_mutex_unlock(&q->mutex);
+    }
+}
+
+/*
+ * mpsc_queue_pop() - Remove the oldest node (consumer thread only)
+ *
+ * Return: the node, or NULL if the queue is empty or a push is still
+ *         linking its node in
+ */
+static inline mpsc_node_t *mpsc_queue_pop(mpsc_queue_t *q) {
+    mpsc_node_t *tail = q->tail;
+    mpsc_node_t *next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+
+    // Skip over the stub
+    if (tail == &q->stub) {
+        if (next == NULL) {
+            return NULL;
+        }
+        q->tail = next;
+        tail = next;
+        next = __atomic_load_n(&next->next, __ATOMIC_ACQUIRE);
+    }
+
+    if (next != NULL) {
+        q->tail = next;
+        return tail;
+    }
+
+    // tail is the last linked node. If it is not also the head, a
+    // producer has exchanged the head but not linked its node yet.
+    if (tail != __atomic_load_n(&q->head, __ATOMIC_ACQUIRE)) {
+        return NULL;
+    }
+
+    // Re-insert the stub behind tail so tail can be handed out
+    mpsc_queue_link(q, &q->stub);
+    next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+    if (next != NULL) {
+        q->tail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+/*
+ * mpsc_queue_pop_wait() - Pop, sleeping while the queue is empty
+ *
+ * The consumer sets `sleeping` and re-checks the queue before it waits;
+ * a producer links its node and then checks `sleeping`. A full fence
+ * sits between the store and the load on both sides, so at least one of
+ * them sees the other and no wakeup is lost.
+ */
+static inline mpsc_node_t *mpsc_queue_pop_wait(mpsc_queue_t *q) {
+    mpsc_node_t *node;
+
+    for (int spins = 0; spins < 64; spins++) {
+        if ((node = mpsc_queue_pop(q)) != NULL) {
+            return node;
+        }
+    }
+
+    for (;;) {
+        __atomic_store_n(&q->sleeping, 1, __ATOMIC_RELAXED);
+        __atomic_thread_fence(__ATOMIC_SEQ_CST);
+        if ((node = mpsc_queue_pop(q)) != NULL) {
+            __atomic_store_n(&q->sleeping, 0, __ATOMIC_RELAXED);
+            return node;
+        }
+        pthread_mutex_lock(&q->mutex);
+        while (q->sleeping) {
+            pthread_cond_wait(&q->wakeup, &q->mutex);
+        }
+        pthread_mutex_unlock(&q->mutex);
+        if ((node = mpsc_queue_pop(q)) != NULL) {
+            return node;
+        }
+    }
+}
+
+/*
+ * Per-Producer Node Pool
+ * ======================
+ *
+ * `local` belongs to the producer alone. `returned` is a stack the
+ * consumer pushes onto; the producer empties it in one exchange when
+ * `local` runs dry. Only whole-list removal is allowed, which is what
+ * keeps the CAS push ABA-free.
+ */
+typedef struct mpsc_pool {
+    mpsc_node_t *local;         // Producer-private free list
+    mpsc_node_t *returned;      // Nodes given back by the consumer
+    size_t node_size;           // Size of the struct that embeds the node
+    size_t node_offset;         // offsetof(struct, node member)
+    unsigned long allocated;    // Nodes obtained from malloc()
+} mpsc_pool_t;
+
+static inline void mpsc_pool_init(mpsc_pool_t *pool, size_t node_size,
+                                  size_t node_offset) {
+    pool->local = NULL;
+    pool->returned = NULL;
+    pool->node_size = node_size;
+    pool->node_offset = node_offset;
+    pool->allocated = 0;
+}
+
+/*
+ * mpsc_pool_get() - Take a node (owning producer only)
+ *
+ * Return: a node whose owner is @pool, or NULL if malloc() fails
+ */
+static inline mpsc_node_t *mpsc_pool_get(mpsc_pool_t *pool) {
+    mpsc_node_t *node = pool->local;
+
+    if (node == NULL) {
+        node = __atomic_exchange_n(&pool->returned, NULL, __ATOMIC_ACQUIRE);
+    }
+    if (node != NULL) {
+        pool->local = node->next;
+        return node;
+    }
+
+    char *mem = malloc(pool->node_size);
+    if (mem == NULL) {
+        return NULL;
+    }
+    pool->allocated++;
+    node = (mpsc_node_t *)(mem + pool->node_offset);
+    node->owner = pool;
+    return node;
+}
+
+// Give a node back to its owner's pool (any thread, typically the consumer)
+static inline void mpsc_pool_put(mpsc_node_t *node) {
+    mpsc_pool_t *pool = node->owner;
+    mpsc_node_t *top = __atomic_load_n(&pool->returned, __ATOMIC_RELAXED);
+    do {
+        node->next = top;
+    } while (!__atomic_compare_exchange_n(&pool->returned, &top, node, 1,
+                                          __ATOMIC_RELEASE, __ATOMIC_RELAXED));
+}
+
+// Free every node held by the pool (all its nodes must be back)
+static inline void mpsc_pool_destroy(mpsc_pool_t *pool) {
+    mpsc_node_t *lists[2] = { pool->local, pool->returned };
+    for (int i = 0; i < 2; i++) {
+        mpsc_node_t *node = lists[i];
+        while (node != NULL) {
+            mpsc_node_t *next = node->next;
+            free((char *)node - pool->node_offset);
+            node = next;
+        }
+    }
+    pool->local = pool->returned = NULL;
+}
+
+#endif // __mpsc_queue_h__
@@ -0,0 +1,472 @@
+/*
+ * ===================================================================
+ * CP386 Operating Systems Course - Michael-Scott Lock-Free Queue
+ * ===================================================================
+ *
+ * An unbounded multi-producer / multi-consumer FIFO of `void *` values
+ * with no locks at all. Threads enqueue and dequeue with compare-and-swap
+ * on the head and tail pointers of a singly linked list, and help each
+ * other: a thread that finds the tail lagging swings it forward before
+ * retrying.
+ *
+ * The hard part is freeing nodes. A dequeuer that read `head` may be
+ * preempted, and by the time it dereferences `head->next` another
+ * thread may have dequeued and freed that node. Worse, malloc() may
+ * have handed the same address out again for a new node, so a CAS on
+ * `head` succeeds against a *different* node that happens to live at
+ * the same address: the ABA problem. Both are solved by never freeing
+ * a node while any thread might still hold a pointer to it. Two schemes
+ * are provided, chosen per queue:
+ *
+ * - Hazard pointers (MS_RECLAIM_HAZARD): before dereferencing a shared
+ *   node a thread publishes its address in one of its hazard slots and
+ *   re-checks that the node is still reachable. Removed nodes go on a
+ *   per-thread retired list; when the list fills up the thread scans
+ *   all hazard slots and frees every retired node nobody protects.
+ *   Memory waiting to be freed is bounded, even if a thread stalls.
+ *
+ * - Epoch-based reclamation (MS_RECLAIM_EPOCH): a thread announces the
+ *   global epoch when it starts an operation and clears the
+ *   announcement when it finishes. The epoch only advances once every
+ *   active thread has seen the current one, so nodes retired two epochs
+ *   ago cannot be referenced and are freed in bulk. Cheaper per
+ *   operation (no per-pointer publish), but one stalled thread holds
+ *   back all reclamation.
+ *
+ * Each thread calls ms_queue_register() once to get its ms_thread_t
+ * handle and passes it to every operation.
+ *
+ * References:
+ * - M. Michael & M. Scott, "Simple, Fast, and Practical Non-Blocking and
+ *   Blocking Concurrent Queue Algorithms" (PODC 1996)
+ * - M. Michael, "Hazard Pointers: Safe Memory Reclamation for Lock-Free
+ *   Objects" (IEEE TPDS 2004)
+ * - K. Fraser, "Practical Lock-Freedom" (PhD thesis, 2004), epochs
+ */
+
+#ifndef __ms_queue_h__
+#define __ms_queue_h__
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+
+#define MS_MAX_THREADS 128
+#define MS_HAZARDS_PER_THREAD 2
+#define MS_HP_RETIRE_MAX (4 * MS_MAX_THREADS * MS_HAZARDS_PER_THREAD)
+#define MS_EPOCH_RETIRE_BATCH 128   // Retired nodes between advance attempts
+#define MS_CACHE_LINE 64
+
+typedef enum {
+    MS_RECLAIM_HAZARD,
+    MS_RECLAIM_EPOCH
+} ms_reclaim_t;
+
+typedef struct ms_node {
+    void *value;
+    struct ms_node *next;
+} ms_node_t;
+
+// Per-thread state shared with other threads, one cache line each
+typedef struct {
+    ms_node_t *hazard[MS_HAZARDS_PER_THREAD];
+    unsigned long epoch;        // (epoch << 1) | 1 while active, 0 when idle
+    int in_use;                 // Slot claimed by a registered thread
+    char pad[MS_CACHE_LINE - MS_HAZARDS_PER_THREAD * sizeof(ms_node_t *)
+             - sizeof(unsigned long) - sizeof(int)];
+} ms_slot_t;
+
+// Nodes retired during one epoch
+typedef struct {
+    ms_node_t **nodes;
+    size_t count, size;
+    unsigned long epoch;
+} ms_limbo_t;
+
+// Per-thread handle, private to its thread
+typedef struct {
+    int id;                             // Index into the queue's slots
+    ms_node_t *retired[MS_HP_RETIRE_MAX];
+    size_t num_retired;
+    ms_limbo_t limbo[3];                // Epoch lists, indexed epoch % 3
+    unsigned long since_advance;
+    unsigned long freed;                // Nodes this thread has freed
+} ms_thread_t;
+
+typedef struct {
+    ms_node_t *head;
+    char pad1[MS_CACHE_LINE - sizeof(ms_node_t *)];
+    ms_node_t *tail;
+    char pad2[MS_CACHE_LINE - sizeof(ms_node_t *)];
+    unsigned long global_epoch;
+    char pad3[MS_CACHE_LINE - sizeof(unsigned long)];
+    ms_slot_t slots[MS_MAX_THREADS];
+    ms_reclaim_t reclaim;
+    pthread_mutex_t orphan_lock;        // Leftovers of unregistered threads
+    ms_node_t **orphans;
+    size_t num_orphans;
+} ms_queue_t;
+
+static inline int ms_queue_init(ms_queue_t *q, ms_reclaim_t reclaim) {
+    ms_node_t *dummy = malloc(sizeof(ms_node_t));
+    if (dummy == NULL) {
+        return -1;
+    }
+    dummy->value = NULL;
+    dummy->next = NULL;
+    q->head = q->tail = dummy;
+    q->global_epoch = 1;
+    for (int i = 0; i < MS_MAX_THREADS; i++) {
+        for (int h = 0; h < MS_HAZARDS_PER_THREAD; h++) {
+            q->slots[i].hazard[h] = NULL;
+        }
+        q->slots[i].epoch = 0;
+        q->slots[i].in_use = 0;
+    }
+    q->reclaim = reclaim;
+    pthread_mutex_init(&q->orphan_lock, NULL);
+    q->orphans = NULL;
+    q->num_orphans = 0;
+    return 0;
+}
+
+/*
+ * Hazard Pointers
+ * ===============
+ */
+
+// Publish `node` in hazard slot h. The store must be visible before the
+// caller re-reads the shared pointer, so it is sequentially consistent.
+static inline void ms_hazard_set(ms_queue_t *q, ms_thread_t *t, int h, ms_node_t *node) {
+    __atomic_store_n(&q->slots[t->id].hazard[h], node, __ATOMIC_SEQ_CST);
+}
+
+static inline void ms_hazard_clear(ms_queue_t *q, ms_thread_t *t) {
+    for (int h = 0; h < MS_HAZARDS_PER_THREAD; h++) {
+        __atomic_store_n(&q->slots[t->id].hazard[h], NULL, __ATOMIC_RELEASE);
+    }
+}
+
+static inline int ms_pointer_compare(const void *a, const void *b) {
+    uintptr_t x = (uintptr_t)*(ms_node_t *const *)a;
+    uintptr_t y = (uintptr_t)*(ms_node_t *const *)b;
+    return x < y ? -1 : x > y;
+}
+
+/*
+ * Free every retired node that no hazard slot points at.
+ *
+ * The hazard slots are copied and sorted once, so each retired node
+ * costs a binary search rather than a pass over all slots.
+ */
+static inline void ms_hazard_scan(ms_queue_t *q, ms_thread_t *t) {
+    ms_node_t *hazards[MS_MAX_THREADS * MS_HAZARDS_PER_THREAD];
+    size_t num_hazards = 0, kept = 0;
+
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    for (int i = 0; i < MS_MAX_THREADS; i++) {
+        for (int h = 0; h < MS_HAZARDS_PER_THREAD; h++) {
+            ms_node_t *node = __atomic_load_n(&q->slots[i].hazard[h], __ATOMIC_ACQUIRE);
+            if (node != NULL) {
+                hazards[num_hazards++] = node;
+            }
+        }
+    }
+    qsort(hazards, num_hazards, sizeof(ms_node_t *), ms_pointer_compare);
+
+    for (size_t i = 0; i < t->num_retired; i++) {
+        if (bsearch(&t->retired[i], hazards, num_hazards, sizeof(ms_node_t *),
+                    ms_pointer_compare) != NULL) {
+            t->retired[kept++] = t->retired[i];
+        } else {
+            free(t->retired[i]);
+            t->freed++;
+        }
+    }
+    t->num_retired = kept;
+}
+
+/*
+ * Epoch-Based Reclamation
+ * =======================
+ */
+static inline void ms_limbo_push(ms_limbo_t *limbo, ms_node_t *node) {
+    if (limbo->count == limbo->size) {
+        size_t size = limbo->size ? 2 * limbo->size : MS_EPOCH_RETIRE_BATCH;
+        ms_node_t **nodes = realloc(limbo->nodes, size * sizeof(ms_node_t *));
+        if (nodes == NULL) {
+            return;     // Out of memory: leak the node rather than free it early
+        }
+        limbo->nodes = nodes;
+        limbo->size = size;
+    }
+    limbo->nodes[limbo->count++] = node;
+}
+
+static inline void ms_limbo_free(ms_thread_t *t, ms_limbo_t *limbo) {
+    for (size_t i = 0; i < limbo->count; i++) {
+        free(limbo->nodes[i]);
+    }
+    t->freed += limbo->count;
+    limbo->count = 0;
+}
+
+// Free the lists of epochs every thread has left behind
+static inline void ms_epoch_collect(ms_thread_t *t, unsigned long global) {
+    for (int i = 0; i < 3; i++) {
+        if (t->limbo[i].count > 0 && t->limbo[i].epoch + 2 <= global) {
+            ms_limbo_free(t, &t->limbo[i]);
+        }
+    }
+}
+
+static inline void ms_epoch_enter(ms_queue_t *q, ms_thread_t *t) {
+    unsigned long global = __atomic_load_n(&q->global_epoch, __ATOMIC_ACQUIRE);
+    __atomic_store_n(&q->slots[t->id].epoch, (global << 1) | 1, __ATOMIC_RELAXED);
+    // The announcement must be visible before we read any node
+    __atomic_thread_fence(__ATOMIC_SEQ_CST);
+    ms_epoch_collect(t, global);
+}
+
+static inline void ms_epoch_exit(ms_queue_t *q, ms_thread_t *t) {
+    __atomic_store_n(&q->slots[t->id].epoch, 0, __ATOMIC_RELEASE);
+}
+
+// Advance the global epoch if every active thread has caught up with it
+static inline void ms_epoch_try_advance(ms_queue_t *q) {
+    unsigned long global = __atomic_load_n(&q->global_epoch, __ATOMIC_ACQUIRE);
+    for (int i = 0; i < MS_MAX_THREADS; i++) {
+        unsigned long e = __atomic_load_n(&q->slots[i].epoch, __ATOMIC_ACQUIRE);
+        if ((e & 1) && (e >> 1) != global) {
+            return;
+        }
+    }
+    __atomic_compare_exchange_n(&q->global_epoch, &global, global + 1, 0,
+                                __ATOMIC_ACQ_REL, __ATOMIC_RELAXED);
+}
+
+/*
+ * Registration and Retirement
+ * ===========================
+ */
+
+/*
+ * ms_queue_register() - Claim a thread slot
+ *
+ * Return: a handle for this thread, or NULL if all MS_MAX_THREADS slots
+ *         are taken or malloc() fails
+ */
+static inline ms_thread_t *ms_queue_register(ms_queue_t *q) {
+    ms_thread_t *t = calloc(1, sizeof(ms_thread_t));
+    if (t == NULL) {
+        return NULL;
+    }
+    for (int i = 0; i < MS_MAX_THREADS; i++) {
+        int expected = 0;
+        if (__atomic_compare_exchange_n(&q->slots[i].in_use, &expected, 1, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            t->id = i;
+            return t;
+        }
+    }
+    free(t);
+    return NULL;
+}
+
+// Hand a node that is no longer reachable from the queue to the reclaimer
+static inline void ms_retire(ms_queue_t *q, ms_thread_t *t, ms_node_t *node) {
+    if (q->reclaim == MS_RECLAIM_HAZARD) {
+        t->retired[t->num_retired++] = node;
+        if (t->num_retired == MS_HP_RETIRE_MAX) {
+            ms_hazard_scan(q, t);
+        }
+    } else {
+        // Tag with the epoch *now*, after the unlink: only threads that
+        // entered in this epoch or earlier can still see the node
+        unsigned long epoch = __atomic_load_n(&q->global_epoch, __ATOMIC_ACQUIRE);
+        ms_limbo_t *limbo = &t->limbo[epoch % 3];
+        if (limbo->count > 0 && limbo->epoch != epoch) {
+            ms_limbo_free(t, limbo);    // epoch - 3 or older: safe
+        }
+        limbo->epoch = epoch;
+        ms_limbo_push(limbo, node);
+        if (++t->since_advance >= MS_EPOCH_RETIRE_BATCH) {
+            t->since_advance = 0;
+            ms_epoch_try_advance(q);
+        }
+    }
+}
+
+static inline void ms_orphan(ms_queue_t *q, ms_node_t **nodes, size_t count) {
+    if (count == 0) {
+        return;
+    }
+    pthread_mutex_lock(&q->orphan_lock);
+    ms_node_t **grown = realloc(q->orphans, (q->num_orphans + count) * sizeof(ms_node_t *));
+    if (grown != NULL) {
+        q->orphans = grown;
+        for (size_t i = 0; i < count; i++) {
+            q->orphans[q->num_orphans++] = nodes[i];
+        }
+    }
+    pthread_mutex_unlock(&q->orphan_lock);
+}
+
+/*
+ * ms_queue_unregister() - Release a thread slot
+ *
+ * Nodes that may still be in use are handed to the queue and freed by
+ * ms_queue_destroy().
+ */
+static inline void ms_queue_unregister(ms_queue_t *q, ms_thread_t *t) {
+    ms_hazard_clear(q, t);
+    ms_epoch_exit(q, t);
+    if (q->reclaim == MS_RECLAIM_HAZARD) {
+        ms_hazard_scan(q, t);
+        ms_orphan(q, t->retired, t->num_retired);
+    }
+    for (int i = 0; i < 3; i++) {
+        ms_orphan(q, t->limbo[i].nodes, t->limbo[i].count);
+        free(t->limbo[i].nodes);
+    }
+    __atomic_store_n(&q->slots[t->id].in_use, 0, __ATOMIC_RELEASE);
+    free(t);
+}
+
+// Free the queue's nodes. No thread may use the queue any more.
+static inline void ms_queue_destroy(ms_queue_t *q) {
+    ms_node_t *node = q->head;
+    while (node != NULL) {
+        ms_node_t *next = node->next;
+        free(node);
+        node = next;
+    }
+    for (size_t i = 0; i < q->num_orphans; i++) {
+        free(q->orphans[i]);
+    }
+    free(q->orphans);
+    pthread_mutex_destroy(&q->orphan_lock);
+}
+
+/*
+ * Queue Operations
+ * ================
+ */
+
+/*
+ * ms_queue_enqueue() - Append a value (lock-free)
+ *
+ * Return: 0, or -1 if no node could be allocated
+ */
+static inline int ms_queue_enqueue(ms_queue_t *q, ms_thread_t *t, void *value) {
+    ms_node_t *node = malloc(sizeof(ms_node_t));
+    if (node == NULL) {
+        return -1;
+    }
+    node->value = value;
+    node->next = NULL;
+
+    int hazard = q->reclaim == MS_RECLAIM_HAZARD;
+    if (!hazard) {
+        ms_epoch_enter(q, t);
+    }
+
+    for (;;) {
+        ms_node_t *tail = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+        if (hazard) {
+            ms_hazard_set(q, t, 0, tail);
+            if (tail != __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE)) {
+                continue;
+            }
+        }
+        ms_node_t *next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+        if (tail != __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+        if (next != NULL) {
+            // Tail is lagging: help swing it forward, then retry
+            __atomic_compare_exchange_n(&q->tail, &tail, next, 0,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+            continue;
+        }
+        ms_node_t *expected = NULL;
+        if (__atomic_compare_exchange_n(&tail->next, &expected, node, 0,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED)) {
+            // Linked in; moving the tail is optional (others will help)
+            __atomic_compare_exchange_n(&q->tail, &tail, node, 0,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+            break;
+        }
+    }
+
+    if (hazard) {
+        ms_hazard_clear(q, t);
+    } else {
+        ms_epoch_exit(q, t);
+    }
+    return 0;
+}
+
+/*
+ * ms_queue_dequeue() - Remove the oldest value (lock-free)
+ *
+ * Return: 1 and the value in *value, or 0 if the queue was empty
+ */
+static inline int ms_queue_dequeue(ms_queue_t *q, ms_thread_t *t, void **value) {
+    int hazard = q->reclaim == MS_RECLAIM_HAZARD;
+    ms_node_t *head;
+    int found = 0;
+
+    if (!hazard) {
+        ms_epoch_enter(q, t);
+    }
+
+    for (;;) {
+        head = __atomic_load_n(&q->head, __ATOMIC_ACQUIRE);
+        if (hazard) {
+            ms_hazard_set(q, t, 0, head);
+            if (head != __atomic_load_n(&q->head, __ATOMIC_ACQUIRE)) {
+                continue;
+            }
+        }
+        ms_node_t *tail = __atomic_load_n(&q->tail, __ATOMIC_ACQUIRE);
+        ms_node_t *next = __atomic_load_n(&head->next, __ATOMIC_ACQUIRE);
+        if (hazard) {
+            ms_hazard_set(q, t, 1, next);
+        }
+        if (head != __atomic_load_n(&q->head, __ATOMIC_ACQUIRE)) {
+            continue;
+        }
+        if (next == NULL) {
+            break;                      // Empty
+        }
+        if (head == tail) {
+            // Tail is lagging behind a linked node: help it along
+            __atomic_compare_exchange_n(&q->tail, &tail, next, 0,
+                                        __ATOMIC_RELEASE, __ATOMIC_RELAXED);
+            continue;
+        }
+        // Read the value before the CAS: afterwards `next` is the new
+        // dummy and another dequeuer may retire it
+        void *v = next->value;
+        if (__atomic_compare_exchange_n(&q->head, &head, next, 0,
+                                        __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+            *value = v;
+            found = 1;
+            break;
+        }
+    }
+
+    if (hazard) {
+        ms_hazard_clear(q, t);
+    }
+    if (found) {
+        ms_retire(q, t, head);          // The old dummy
+    }
+    if (!hazard) {
+        ms_epoch_exit(q, t);
+    }
+    return found;
+}
+
+#endif // __ms_queue_h__
@@ -0,0 +1,150 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/prctl.h>
+
+#include "../../common.h"
+#include "../../precise_wait.h"
+
+/*
+ * wait_accuracy.c - How close each way of waiting gets to the request
+ *
+ * For each requested duration, every method waits REPS times and the
+ * achieved duration is compared with the request:
+ *
+ *   usleep         relative sleep, default 50 us timer slack
+ *   usleep-slack1  the same with the timer slack set to 1 ns
+ *   nanosleep      relative nanosleep(), default slack
+ *   abstime        clock_nanosleep(TIMER_ABSTIME), default slack
+ *   hybrid         precise_sleep_ns(): abstime sleep, then spin the tail
+ *   spin           precise_spin_until(): busy-wait on the clock
+ *   busy_work      busy_work_ns(): calibrated computation, no clock
+ *
+ * Errors are in microseconds (positive: late). "cpu%" is the thread's
+ * CPU time over the wall time it waited: sleeping costs ~0, spinning
+ * 100. The check column verifies that no clock-based wait returned
+ * early and that busy_work's median is within 20% of the request.
+ *
+ * Usage: ./wait_accuracy [reps]
+ */
+
+#define METHODS 7
+
+static const char *method_names[METHODS] = {
+    "usleep", "usleep-slack1", "nanosleep", "abstime", "hybrid", "spin", "busy_work"
+};
+
+static const uint64_t durations_ns[] = { 10000, 100000, 1000000, 10000000 };
+#define NUM_DURATIONS (int)(sizeof(durations_ns) / sizeof(durations_ns[0]))
+
+static volatile uint64_t sink;   // Keeps busy_work's result alive
+
+static uint64_t thread_cpu_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+static void wait_with(int method, uint64_t ns) {
+    struct timespec ts;
+    switch (method) {
+    case 0:
+    case 1:
+        usleep((useconds_t)(ns / 1000));
+        break;
+    case 2:
+        ts.tv_sec = (time_t)(ns / 1000000000ull);
+        ts.tv_nsec = (long)(ns % 1000000000ull);
+        nanosleep(&ts, NULL);
+        break;
+    case 3: {
+        uint64_t deadline = precise_now_ns() + ns;
+        ts.tv_sec = (time_t)(deadline / 1000000000ull);
+        ts.tv_nsec = (long)(deadline % 1000000000ull);
+        clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+        break;
+    }
+    case 4:
+        precise_sleep_ns(ns);
+        break;
+    case 5:
+        precise_spin_until(precise_now_ns() + ns);
+        break;
+    case 6:
+        sink = busy_work_ns(ns);
+        break;
+    }
+}
+
+static int cmp_i64(const void *a, const void *b) {
+    int64_t x = *(const int64_t *)a, y = *(const int64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static double us(int64_t ns) {
+    return ns / 1000.0;
+}
+
+// Wait reps times; print the error distribution. Return: 1 if the check passed
+static int measure(int method, uint64_t ns, int reps, int64_t *errors) {
+    // usleep-slack1 is the only method that runs with the slack lowered
+    prctl(PR_SET_TIMERSLACK, method == 1 ? 1 : 0, 0, 0, 0);
+
+    uint64_t cpu_start = thread_cpu_ns(), wall = 0;
+    for (int i = 0; i < reps; i++) {
+        uint64_t start = precise_now_ns();
+        wait_with(method, ns);
+        uint64_t took = precise_now_ns() - start;
+        errors[i] = (int64_t)took - (int64_t)ns;
+        wall += took;
+    }
+    double cpu_pct = 100.0 * (thread_cpu_ns() - cpu_start) / wall;
+    prctl(PR_SET_TIMERSLACK, 0, 0, 0, 0);
+
+    qsort(errors, reps, sizeof(int64_t), cmp_i64);
+    int64_t p50 = errors[reps / 2];
+    int ok;
+    if (method == 6) {
+        int64_t tolerance = (int64_t)ns / 5 > 2000 ? (int64_t)ns / 5 : 2000;
+        ok = llabs(p50) <= tolerance;
+    } else {
+        ok = errors[0] >= 0;
+    }
+    printf("%8.0f  %-14s %9.1f %9.1f %9.1f %9.1f %9.1f %6.0f  %s\n", us(ns),
+           method_names[method], us(errors[0]), us(p50), us(errors[reps * 9 / 10]),
+           us(errors[reps * 99 / 100]), us(errors[reps - 1]), cpu_pct, ok ? "ok" : "MISMATCH");
+    fflush(stdout);
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    int reps = argc > 1 ? atoi(argv[1]) : 200;
+    if (reps < 10) {
+        fprintf(stderr, "Usage: %s [reps >= 10]\n", argv[0]);
+        return 1;
+    }
+
+    const precise_calibration_t *cal = precise_calibrate();
+    printf("Wait accuracy: %d waits per row; hybrid spins the last %.1f us, "
+           "busy_work runs %.3f iterations/ns\n\n",
+           reps, us((int64_t)cal->margin_ns), cal->work_per_ns);
+    printf("%8s  %-14s %9s %9s %9s %9s %9s %6s  %s\n", "req us", "method",
+           "min", "p50", "p90", "p99", "max", "cpu%", "check");
+
+    int64_t *errors = malloc(reps * sizeof(int64_t));
+    int ok = 1;
+    for (int d = 0; d < NUM_DURATIONS; d++) {
+        // Long waits: fewer reps so the whole run stays near ten seconds
+        int n = durations_ns[d] >= 10000000 ? reps / 4 : reps;
+        for (int m = 0; m < METHODS; m++) {
+            ok &= measure(m, durations_ns[d], n, errors);
+        }
+        printf("\n");
+    }
+    free(errors);
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,265 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <unistd.h>
+#include <sys/timerfd.h>
+
+#include "../../common.h"
+#include "../../coro_sync.h"
+
+/**
+ * coro_producer_consumer_semaphores.c
+ *
+ * producer_consumer_semaphores.c with coroutines instead of threads:
+ * the same three semaphores (empty, full, mutex), the same count mutex
+ * and the same shutdown, but with 10,000 producers and 10,000 consumers
+ * spread over 4 worker threads (coro_sync.h). A coroutine that blocks
+ * in coro_sem_wait() parks only itself; its worker runs the next one.
+ * Wakeups from a coroutine on another worker are queued to the waiter's
+ * own worker.
+ *
+ * The random production and consumption delays are a random number of
+ * coro_yield() calls (usleep() would stop a whole worker). A monitor
+ * coroutine prints progress every 100 ms, waiting on a timerfd with
+ * coro_wait_fd() so its worker keeps running the others meanwhile.
+ *
+ * Check: every item is consumed exactly once (count and sum) and every
+ * coroutine finishes.
+ *
+ * Usage: ./coro_producer_consumer_semaphores [producers] [consumers]
+ *        [items per producer] [workers]
+ */
+
+#define BUFFER_SIZE 5
+#define NUM_PRODUCERS 10000
+#define NUM_CONSUMERS 10000
+#define ITEMS_PER_PRODUCER 20
+#define NUM_WORKERS 4
+#define MAX_WORKERS 64
+#define STACK_SIZE (32 * 1024)
+#define MONITOR_MS 100
+
+// Shared buffer and indices
+long buffer[BUFFER_SIZE];
+int buffer_index = 0;
+int count = 0;   // Items in the buffer (buffer_index wraps when full)
+
+// Semaphores for synchronization
+coro_sem_t empty;    // Count of empty buffer slots (initially BUFFER_SIZE)
+coro_sem_t full;     // Count of filled buffer slots (initially 0)
+coro_sem_t mutex;    // Binary semaphore for mutual exclusion (initially 1)
+
+// Track the total number of items consumed for program termination
+long total_consumed = 0;
+unsigned long long consumed_sum = 0;
+int done = 0;        // Set once all items are consumed
+double done_time;    // GetTime() when done was set
+coro_mutex_t count_mutex;
+
+int num_producers = NUM_PRODUCERS;
+int num_consumers = NUM_CONSUMERS;
+long items_per_producer = ITEMS_PER_PRODUCER;
+
+// Per-thread random state; rand() takes a lock
+static __thread unsigned int seed;
+
+static void pause_randomly(int max) {
+    for (int i = rand_r(&seed) % max; i > 0; i--) {
+        coro_yield();
+    }
+}
+
+// Producer coroutine
+void producer(void *arg) {
+    long id = (long)(intptr_t)arg;
+
+    for (long i = 0; i < items_per_producer; i++) {
+        // Create an item
+        long item = id * items_per_producer + i;
+
+        // Wait for an empty slot
+        coro_sem_wait(&empty);
+
+        // Wait for exclusive access to the buffer
+        coro_sem_wait(&mutex);
+
+        // Add the item to the buffer
+        buffer[buffer_index] = item;
+        buffer_index = (buffer_index + 1) % BUFFER_SIZE;
+        count++;
+
+        // Release exclusive access
+        coro_sem_post(&mutex);
+
+        // Signal that a new item is available
+        coro_sem_post(&full);
+
+        // Random production delay
+        pause_randomly(4);
+    }
+}
+
+// Consumer coroutine
+void consumer(void *arg) {
+    (void)arg;
+    int should_continue = 1;
+
+    while (should_continue) {
+        // Wait for an item to be available
+        coro_sem_wait(&full);
+
+        // Woken up by the last consumer rather than by a new item?
+        coro_mutex_lock(&count_mutex);
+        should_continue = !done;
+        coro_mutex_unlock(&count_mutex);
+        if (!should_continue) {
+            break;
+        }
+
+        // Wait for exclusive access to the buffer
+        coro_sem_wait(&mutex);
+
+        // Consume the item
+        long item = buffer[(buffer_index - 1 + BUFFER_SIZE) % BUFFER_SIZE];
+        buffer_index = (buffer_index - 1 + BUFFER_SIZE) % BUFFER_SIZE;
+        count--;
+
+        // Release exclusive access
+        coro_sem_post(&mutex);
+
+        // Signal that an empty slot is available
+        coro_sem_post(&empty);
+
+        // Update total count safely
+        coro_mutex_lock(&count_mutex);
+        total_consumed++;
+        consumed_sum += (unsigned long long)item;
+
+        // Check if we've consumed all expected items. If so, wake the
+        // other consumers, which are parked in coro_sem_wait(&full)
+        // waiting for items that will never come.
+        if (total_consumed >= (long)num_producers * items_per_producer) {
+            should_continue = 0;
+            done = 1;
+            done_time = GetTime();
+            for (int i = 0; i < num_consumers - 1; i++) {
+                coro_sem_post(&full);
+            }
+        }
+        coro_mutex_unlock(&count_mutex);
+
+        // Random consumption delay
+        if (should_continue) {
+            pause_randomly(8);
+        }
+    }
+}
+
+// Progress report every MONITOR_MS, sleeping on a timerfd
+void monitor(void *arg) {
+    double start = *(double *)arg;
+    int tfd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    struct itimerspec period = {
+        .it_interval = { 0, MONITOR_MS * 1000000L },
+        .it_value = { 0, MONITOR_MS * 1000000L },
+    };
+    timerfd_settime(tfd, 0, &period, NULL);
+
+    for (;;) {
+        coro_mutex_lock(&count_mutex);
+        long consumed = total_consumed;
+        int finished = done;
+        coro_mutex_unlock(&count_mutex);
+        if (finished) {
+            break;
+        }
+        printf("  %6.2f s: %ld items consumed\n", GetTime() - start, consumed);
+        fflush(stdout);
+
+        uint64_t ticks;
+        coro_wait_fd(tfd, EPOLLIN);
+        if (read(tfd, &ticks, sizeof(ticks)) < 0) {
+            // Spurious wakeup; wait again
+        }
+    }
+    close(tfd);
+}
+
+int main(int argc, char *argv[]) {
+    coro_worker_t workers[MAX_WORKERS];
+    int num_workers = argc > 4 ? atoi(argv[4]) : NUM_WORKERS;
+
+    num_producers = argc > 1 ? atoi(argv[1]) : NUM_PRODUCERS;
+    num_consumers = argc > 2 ? atoi(argv[2]) : NUM_CONSUMERS;
+    items_per_producer = argc > 3 ? atol(argv[3]) : ITEMS_PER_PRODUCER;
+    if (num_producers < 1 || num_consumers < 1 || items_per_producer < 1 ||
+        num_workers < 1 || num_workers > MAX_WORKERS) {
+        fprintf(stderr, "Usage: %s [producers] [consumers] [items per producer] "
+                "[workers 1-%d]\n", argv[0], MAX_WORKERS);
+        return 1;
+    }
+    long total_items = (long)num_producers * items_per_producer;
+
+    printf("Producer-Consumer Problem Using Coroutine Semaphores\n");
+    printf("-----------------------------------------\n");
+    printf("Buffer size: %d\n", BUFFER_SIZE);
+    printf("Producers: %d, Items per producer: %ld\n", num_producers, items_per_producer);
+    printf("Consumers: %d, Total items: %ld\n", num_consumers, total_items);
+    printf("Worker threads: %d\n", num_workers);
+    printf("-----------------------------------------\n\n");
+
+    // Initialize semaphores
+    coro_sem_init(&empty, BUFFER_SIZE);  // Initially all slots are empty
+    coro_sem_init(&full, 0);             // Initially no items are available
+    coro_sem_init(&mutex, 1);            // Binary semaphore for mutual exclusion
+    coro_mutex_init(&count_mutex);
+
+    // Spread the coroutines round-robin over the workers
+    double start = GetTime();
+    for (int i = 0; i < num_workers; i++) {
+        if (coro_worker_init(&workers[i], STACK_SIZE, 0) != 0) {
+            fprintf(stderr, "Failed to set up worker %d\n", i);
+            return 1;
+        }
+    }
+    int actors = 0;
+    for (int i = 0; i < num_producers; i++) {
+        actors |= coro_spawn(&workers[i % num_workers].sched, producer, (void *)(intptr_t)i);
+    }
+    for (int i = 0; i < num_consumers; i++) {
+        actors |= coro_spawn(&workers[i % num_workers].sched, consumer, NULL);
+    }
+    actors |= coro_spawn(&workers[0].sched, monitor, &start);
+    if (actors != 0) {
+        fprintf(stderr, "Out of memory for coroutine stacks\n");
+        return 1;
+    }
+
+    for (int i = 0; i < num_workers; i++) {
+        coro_worker_start(&workers[i]);
+    }
+    for (int i = 0; i < num_workers; i++) {
+        coro_worker_join(&workers[i]);
+    }
+    // The monitor may still sleep up to MONITOR_MS after the last item
+    double elapsed = done_time - start;
+
+    // Items are 0 .. total_items - 1, each produced once
+    int ok = total_consumed == total_items &&
+             consumed_sum == (unsigned long long)total_items * (total_items - 1) / 2;
+
+    printf("\n-----------------------------------------\n");
+    printf("All coroutines completed. Total items produced/consumed: %ld (%s)\n\n",
+           total_consumed, ok ? "ok" : "MISMATCH");
+    printf("%.3f s, %.0f items/s\n\n", elapsed, total_consumed / elapsed);
+    printf("%-7s %12s %14s %10s\n", "worker", "switches", "remote wakes", "sleeps");
+    for (int i = 0; i < num_workers; i++) {
+        printf("%-7d %12lu %14lu %10lu\n", i, workers[i].sched.switches,
+               workers[i].remote_wakes, workers[i].sleeps);
+        ok &= workers[i].sched.live == 0;
+        coro_worker_destroy(&workers[i]);
+    }
+
+    return ok ? 0 : 1;
+}
@@ -1,9 +1,14 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <stdarg.h>
+#include <time.h>
 #include <pthread.h>
 #include <semaphore.h>
 #include <unistd.h>
 
+#include "../../stats.h"
+
 /**
  * counting_semaphore.c
  *
@@ -22,6 +27,20 @@ sem_t resource_pool;
 // Mutex for protecting console output
 pthread_mutex_t print_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+// Per-thread statistics (see stats.h). sem_getvalue() only tells how
+// many resources are free right now; these say how the pool was used.
+enum { STAT_ACQUIRED, STAT_WAITED, STAT_WAIT_MS, STAT_HELD_S, STAT_RELEASED, NUM_STATS };
+static const char *stat_names[NUM_STATS] = {
+    "acquisitions", "had to wait", "total wait (ms)", "total held (s)", "releases"
+};
+stats_registry_t stats;
+
+static double now_ms(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000.0 + ts.tv_nsec / 1e6;
+}
+
 // Function to print thread-safe messages
 void safe_print(const char* format, ...) {
     va_list args;
@@ -37,11 +56,28 @@ void safe_print(const char* format, ...) {
 // Worker thread function
 void* worker(void* arg) {
     int id = *((int*)arg);
+    stats_slot_t *st = stats_register(&stats);
+    if (st == NULL) {
+        safe_print("Thread %d: statistics registry full, not starting\n", id);
+        return NULL;
+    }
     
     safe_print("Thread %d: Trying to acquire resource...\n", id);
     
     // Attempt to acquire a resource (blocks if none available)
-    sem_wait(&resource_pool);
+    double start = now_ms();
+    int waited = sem_trywait(&resource_pool) != 0;
+    if (waited) {
+        sem_wait(&resource_pool);
+    }
+    
+    // Count the acquisition and its wait as one update, so a snapshot
+    // never shows a wait without the acquisition it belongs to
+    stats_update_begin(st);
+    stats_add(st, STAT_ACQUIRED, 1);
+    stats_add(st, STAT_WAITED, waited);
+    stats_add(st, STAT_WAIT_MS, (uint64_t)(now_ms() - start));
+    stats_update_end(st);
     
     // Resource acquired, get current count
     int value;
@@ -56,6 +92,10 @@ void* worker(void* arg) {
     sleep(work_time);
     
     // Release the resource
+    stats_update_begin(st);
+    stats_add(st, STAT_HELD_S, work_time);
+    stats_add(st, STAT_RELEASED, 1);
+    stats_update_end(st);
     sem_post(&resource_pool);
     
     // Get updated count
@@ -63,6 +103,7 @@ void* worker(void* arg) {
     safe_print("Thread %d: Resource released. Resources now available: %d\n", 
                id, value);
     
+    stats_unregister(&stats, st);
     return NULL;
 }
 
@@ -79,6 +120,8 @@ int main() {
     printf("Resource limit: %d\n", RESOURCE_LIMIT);
     printf("-----------------------------------------------\n\n");
     
+    stats_init(&stats, stat_names, NUM_STATS);
+    
     // Initialize the semaphore with RESOURCE_LIMIT (counting semaphore)
     if (sem_init(&resource_pool, 0, RESOURCE_LIMIT) != 0) {
         perror("sem_init");
@@ -97,6 +140,14 @@ int main() {
         usleep(100000);  // 100ms
     }
     
+    // A snapshot while the threads run: no thread is stopped for it
+    uint64_t totals[NUM_STATS];
+    int running = stats_snapshot(&stats, totals);
+    safe_print("\nSnapshot with %d threads running: %llu acquired, %llu released, "
+               "%llu in use\n\n", running, (unsigned long long)totals[STAT_ACQUIRED],
+               (unsigned long long)totals[STAT_RELEASED],
+               (unsigned long long)(totals[STAT_ACQUIRED] - totals[STAT_RELEASED]));
+    
     // Wait for all threads to complete
     for (int i = 0; i < NUM_THREADS; i++) {
         pthread_join(threads[i], NULL);
@@ -104,9 +155,14 @@ int main() {
     
     printf("\nAll threads have completed.\n");
     
+    stats_snapshot(&stats, totals);
+    printf("Resource pool statistics:\n");
+    stats_print(&stats, totals);
+    
     // Destroy the semaphore
     sem_destroy(&resource_pool);
     pthread_mutex_destroy(&print_mutex);
+    stats_destroy(&stats);
     
     return 0;
 }
\ No newline at end of file
@@ -1,15 +1,28 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <errno.h>
 #include <pthread.h>
 #include <semaphore.h>
+#include <time.h>
 #include <unistd.h>
 
+#include "../../flow_metrics.h"
+
 /**
  * producer_consumer_semaphores.c
  *
  * This program implements the classic producer-consumer problem using
  * semaphores rather than condition variables. It demonstrates how
  * three semaphores can effectively coordinate access to a bounded buffer.
+ *
+ * Each thread records flow metrics (flow_metrics.h): the buffer's
+ * occupancy after every put/get, how long producers waited in
+ * sem_wait(&empty) and how long consumers waited in sem_wait(&full).
+ * A wait only counts if sem_trywait() fails first. The summary at the
+ * end shows whether the buffer was the bottleneck (mostly full,
+ * producers blocked) or the producers were (mostly empty, consumers
+ * starved).
  */
 
 #define BUFFER_SIZE 5
@@ -21,6 +34,7 @@
 // Shared buffer and indices
 int buffer[BUFFER_SIZE];
 int buffer_index = 0;
+int count = 0;   // Items in the buffer (buffer_index wraps when full)
 
 // Semaphores for synchronization
 sem_t empty;     // Count of empty buffer slots (initially BUFFER_SIZE)
@@ -29,18 +43,36 @@ sem_t mutex;     // Binary semaphore for mutual exclusion (initially 1)
 
 // Track the total number of items consumed for program termination
 int total_consumed = 0;
+int done = 0;    // Set once all items are consumed
 pthread_mutex_t count_mutex = PTHREAD_MUTEX_INITIALIZER;
 
+// Backpressure metrics for the buffer
+flow_metrics_t flow;
+
+// sem_wait() that reports how long it blocked (0 if it did not)
+uint64_t timed_sem_wait(sem_t *sem) {
+    if (sem_trywait(sem) == 0) {
+        return 0;
+    }
+    uint64_t start = flow_now_ns();
+    while (sem_wait(sem) != 0 && errno == EINTR) {
+        // Retry if interrupted by a signal
+    }
+    uint64_t waited = flow_now_ns() - start;
+    return waited > 0 ? waited : 1;
+}
+
 // Producer function
 void* producer(void* arg) {
     int id = *((int*)arg);
+    flow_counters_t *stats = flow_metrics_register(&flow);
     
     for (int i = 0; i < ITEMS_PER_PRODUCER; i++) {
         // Create an item
         int item = (id * 100) + i;
         
         // Wait for an empty slot
-        sem_wait(&empty);
+        uint64_t blocked_ns = timed_sem_wait(&empty);
         
         // Wait for exclusive access to the buffer
         sem_wait(&mutex);
@@ -50,6 +82,8 @@ void* producer(void* arg) {
         printf("Producer %d: Produced item %d at position %d\n", 
                id, item, buffer_index);
         buffer_index = (buffer_index + 1) % BUFFER_SIZE;
+        count++;
+        flow_record_put(&flow, stats, (size_t)count, blocked_ns);
         
         // Release exclusive access
         sem_post(&mutex);
@@ -70,10 +104,19 @@ void* consumer(void* arg) {
     int id = *((int*)arg);
     int items_consumed = 0;
     int should_continue = 1;
+    flow_counters_t *stats = flow_metrics_register(&flow);
     
     while (should_continue) {
         // Wait for an item to be available
-        sem_wait(&full);
+        uint64_t starved_ns = timed_sem_wait(&full);
+        
+        // Woken up by the last consumer rather than by a new item?
+        pthread_mutex_lock(&count_mutex);
+        should_continue = !done;
+        pthread_mutex_unlock(&count_mutex);
+        if (!should_continue) {
+            break;
+        }
         
         // Wait for exclusive access to the buffer
         sem_wait(&mutex);
@@ -83,6 +126,8 @@ void* consumer(void* arg) {
         buffer_index = (buffer_index - 1 + BUFFER_SIZE) % BUFFER_SIZE;
         printf("Consumer %d: Consumed item %d from position %d\n", 
                id, item, buffer_index);
+        count--;
+        flow_record_get(&flow, stats, (size_t)count, starved_ns);
         
         // Release exclusive access
         sem_post(&mutex);
@@ -97,14 +142,22 @@ void* consumer(void* arg) {
         pthread_mutex_lock(&count_mutex);
         total_consumed++;
         
-        // Check if we've consumed all expected items
+        // Check if we've consumed all expected items. If so, wake the
+        // other consumers, which are blocked in sem_wait(&full) waiting
+        // for items that will never come.
         if (total_consumed >= TOTAL_ITEMS) {
             should_continue = 0;
+            done = 1;
+            for (int i = 0; i < NUM_CONSUMERS - 1; i++) {
+                sem_post(&full);
+            }
         }
         pthread_mutex_unlock(&count_mutex);
         
         // Random consumption delay
-        usleep((rand() % 800) * 1000);
+        if (should_continue) {
+            usleep((rand() % 800) * 1000);
+        }
     }
     
     printf("Consumer %d: Consumed %d items\n", id, items_consumed);
@@ -131,6 +184,7 @@ int main() {
     sem_init(&empty, 0, BUFFER_SIZE);  // Initially all slots are empty
     sem_init(&full, 0, 0);             // Initially no items are available
     sem_init(&mutex, 0, 1);            // Binary semaphore for mutual exclusion
+    flow_metrics_init(&flow, BUFFER_SIZE, 0, 0);   // Metrics only, no watermarks
     
     // Create producer threads
     for (int i = 0; i < NUM_PRODUCERS; i++) {
@@ -155,7 +209,12 @@ int main() {
     }
     
     printf("\n-----------------------------------------\n");
-    printf("All threads completed. Total items produced/consumed: %d\n", TOTAL_ITEMS);
+    printf("All threads completed. Total items produced/consumed: %d\n\n", TOTAL_ITEMS);
+    
+    flow_snapshot_t snap;
+    flow_metrics_snapshot(&flow, &snap);
+    flow_snapshot_print(&snap);
+    flow_metrics_destroy(&flow);
     
     // Cleanup
     sem_destroy(&empty);
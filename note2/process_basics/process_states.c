@@ -1,9 +1,14 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <unistd.h>
 #include <sys/types.h>
 #include <stdlib.h>
 #include <sys/wait.h>
 
+#include "../../workload.h"
+
+#define CPU_WORK_UNITS 2000000      // Child 1's job: ~2 s (1 unit = 1 us)
+
 /*
  * This program demonstrates process states and transitions
  * It creates multiple child processes that transition through different states
@@ -13,6 +18,9 @@ int main() {
     printf("Process States Demonstration\n");
     printf("Parent PID: %d\n\n", getpid());
     
+    // Calibrate once, before fork(), so the child inherits the result
+    workload_init();
+    
     // Create first child process
     pid_t pid1 = fork();
     
@@ -25,11 +33,10 @@ int main() {
         printf("Child 1 (PID: %d) created - CPU-bound process\n", getpid());
         printf("Child 1 entering RUNNING state\n");
         
-        // CPU-intensive work
-        volatile unsigned long i;
-        for (i = 0; i < 1000000000; i++) {
-            // Just burn CPU cycles
-        }
+        // CPU-intensive work of a known length; an empty loop would
+        // take a different time on every machine and compiler
+        volatile uint64_t result = workload_run(WORK_ALU, CPU_WORK_UNITS);
+        (void)result;
         
         printf("Child 1 completed CPU work, entering TERMINATED state\n");
         exit(0);
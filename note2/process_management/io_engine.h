@@ -0,0 +1,516 @@
+/*
+ * ===================================================================
+ * io_engine.h - Asynchronous File I/O: io_uring with an epoll Fallback
+ * ===================================================================
+ *
+ * A small engine for keeping `depth` block reads and writes in flight
+ * against one file, used by process_scheduling.c to give its I/O-bound
+ * processes real I/O instead of usleep().
+ *
+ * Each in-flight request owns a slot: a block_size buffer plus the
+ * request's state. The caller submits slots and reaps completions:
+ *
+ *     io_engine_init(&e, fd, IO_ENGINE_AUTO, depth, block_size, fixed);
+ *     for each free slot:
+ *         fill io_engine_buffer(&e, slot) (writes)
+ *         io_engine_submit(&e, slot, IO_READ or IO_WRITE, offset);
+ *     n = io_engine_wait(&e, done, depth, 1);      // blocks for >= 1
+ *     for each done[i]: done[i].slot is free again, done[i].result is
+ *                       bytes transferred or -errno
+ *
+ * Two back ends:
+ *
+ * - IO_ENGINE_URING: Linux io_uring through the raw system calls (no
+ *   liburing). Submissions are written into the shared submission ring
+ *   and handed to the kernel in one io_uring_enter() call, which also
+ *   waits for completions. With `fixed_buffers` the slot buffers are
+ *   registered once (IORING_REGISTER_BUFFERS) and requests use
+ *   READ_FIXED/WRITE_FIXED, so the kernel does not pin and unpin the
+ *   pages on every request.
+ * - IO_ENGINE_EPOLL: for kernels without io_uring (or with it disabled).
+ *   Regular files are always "ready" to epoll, so the blocking pread()/
+ *   pwrite() calls run on `depth` helper threads, and each completion
+ *   bumps an eventfd that the caller waits on with epoll_wait(). This is
+ *   how event loops such as libuv do file I/O.
+ *
+ * IO_ENGINE_AUTO tries io_uring first and falls back to epoll.
+ *
+ * Functions that can fail return 0 or an error number, like pthreads.
+ * Needs _GNU_SOURCE and Linux 5.6 or later for io_uring (IORING_OP_READ).
+ *
+ * References:
+ * - J. Axboe, "Efficient IO with io_uring" (2019)
+ * - OSTEP Chapter 36: I/O Devices
+ */
+
+#ifndef __io_engine_h__
+#define __io_engine_h__
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <linux/io_uring.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+
+typedef enum { IO_ENGINE_AUTO, IO_ENGINE_URING, IO_ENGINE_EPOLL } io_engine_kind_t;
+typedef enum { IO_READ, IO_WRITE } io_op_t;
+
+typedef struct {
+    unsigned slot;
+    int result;                 // Bytes transferred, or -errno
+} io_completion_t;
+
+// One request per slot (epoll back end)
+typedef struct {
+    io_op_t op;
+    off_t offset;
+} io_request_t;
+
+typedef struct {
+    io_engine_kind_t kind;      // URING or EPOLL after init
+    int fd;
+    unsigned depth;
+    size_t block_size;
+    int fixed_buffers;          // io_uring only
+    char *buffers;              // depth * block_size, page aligned
+
+    // io_uring: the three shared mappings and pointers into them
+    int ring_fd;
+    void *sq_ring, *cq_ring;
+    size_t sq_ring_len, cq_ring_len;
+    struct io_uring_sqe *sqes;
+    size_t sqes_len;
+    unsigned *sq_head, *sq_tail, *sq_mask, *sq_array;
+    unsigned *cq_head, *cq_tail, *cq_mask;
+    struct io_uring_cqe *cqes;
+    unsigned to_submit;         // SQEs written but not yet entered
+
+    // epoll fallback: helper threads, a request FIFO and a done FIFO
+    int epoll_fd, event_fd;
+    pthread_t *helpers;
+    unsigned num_helpers;
+    pthread_mutex_t mutex;
+    pthread_cond_t work;
+    io_request_t *requests;
+    unsigned *pending;          // Slots waiting for a helper (ring of depth)
+    unsigned pending_head, pending_tail;
+    io_completion_t *done;      // Completions not yet reaped (ring of depth)
+    unsigned done_head, done_tail;
+    int stopping;
+} io_engine_t;
+
+static inline const char *io_engine_name(io_engine_kind_t kind) {
+    return kind == IO_ENGINE_URING ? "io_uring" : kind == IO_ENGINE_EPOLL ? "epoll" : "auto";
+}
+
+static inline char *io_engine_buffer(io_engine_t *e, unsigned slot) {
+    return e->buffers + (size_t)slot * e->block_size;
+}
+
+/*
+ * io_uring Back End
+ * =================
+ *
+ * The kernel and the process share a submission ring (indices into the
+ * SQE array), the SQE array itself and a completion ring. The process
+ * owns sq_tail and cq_head; the kernel owns sq_head and cq_tail. Each
+ * side publishes its index with a release store and reads the other's
+ * with an acquire load.
+ */
+
+static inline int io_uring_setup_raw(unsigned entries, struct io_uring_params *p) {
+    return (int)syscall(__NR_io_uring_setup, entries, p);
+}
+
+static inline int io_uring_enter_raw(int fd, unsigned to_submit, unsigned min_complete,
+                                     unsigned flags) {
+    return (int)syscall(__NR_io_uring_enter, fd, to_submit, min_complete, flags, NULL, 0);
+}
+
+static inline int io_uring_register_raw(int fd, unsigned opcode, void *arg, unsigned n) {
+    return (int)syscall(__NR_io_uring_register, fd, opcode, arg, n);
+}
+
+static inline void io_engine_uring_unmap(io_engine_t *e) {
+    if (e->sqes != NULL) {
+        munmap(e->sqes, e->sqes_len);
+    }
+    if (e->cq_ring != NULL && e->cq_ring != e->sq_ring) {
+        munmap(e->cq_ring, e->cq_ring_len);
+    }
+    if (e->sq_ring != NULL) {
+        munmap(e->sq_ring, e->sq_ring_len);
+    }
+    close(e->ring_fd);
+}
+
+static inline int io_engine_uring_init(io_engine_t *e) {
+    struct io_uring_params p;
+
+    memset(&p, 0, sizeof(p));
+    e->ring_fd = io_uring_setup_raw(e->depth, &p);
+    if (e->ring_fd < 0) {
+        return errno;
+    }
+
+    e->sq_ring_len = p.sq_off.array + p.sq_entries * sizeof(unsigned);
+    e->cq_ring_len = p.cq_off.cqes + p.cq_entries * sizeof(struct io_uring_cqe);
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        // One mapping holds both rings
+        if (e->cq_ring_len > e->sq_ring_len) {
+            e->sq_ring_len = e->cq_ring_len;
+        }
+    }
+    e->sq_ring = mmap(NULL, e->sq_ring_len, PROT_READ | PROT_WRITE,
+                      MAP_SHARED | MAP_POPULATE, e->ring_fd, IORING_OFF_SQ_RING);
+    if (e->sq_ring == MAP_FAILED) {
+        e->sq_ring = NULL;
+        io_engine_uring_unmap(e);
+        return ENOMEM;
+    }
+    if (p.features & IORING_FEAT_SINGLE_MMAP) {
+        e->cq_ring = e->sq_ring;
+    } else {
+        e->cq_ring = mmap(NULL, e->cq_ring_len, PROT_READ | PROT_WRITE,
+                          MAP_SHARED | MAP_POPULATE, e->ring_fd, IORING_OFF_CQ_RING);
+        if (e->cq_ring == MAP_FAILED) {
+            e->cq_ring = NULL;
+            io_engine_uring_unmap(e);
+            return ENOMEM;
+        }
+    }
+    e->sqes_len = p.sq_entries * sizeof(struct io_uring_sqe);
+    e->sqes = mmap(NULL, e->sqes_len, PROT_READ | PROT_WRITE,
+                   MAP_SHARED | MAP_POPULATE, e->ring_fd, IORING_OFF_SQES);
+    if (e->sqes == MAP_FAILED) {
+        e->sqes = NULL;
+        io_engine_uring_unmap(e);
+        return ENOMEM;
+    }
+
+    char *sq = e->sq_ring, *cq = e->cq_ring;
+    e->sq_head = (unsigned *)(sq + p.sq_off.head);
+    e->sq_tail = (unsigned *)(sq + p.sq_off.tail);
+    e->sq_mask = (unsigned *)(sq + p.sq_off.ring_mask);
+    e->sq_array = (unsigned *)(sq + p.sq_off.array);
+    e->cq_head = (unsigned *)(cq + p.cq_off.head);
+    e->cq_tail = (unsigned *)(cq + p.cq_off.tail);
+    e->cq_mask = (unsigned *)(cq + p.cq_off.ring_mask);
+    e->cqes = (struct io_uring_cqe *)(cq + p.cq_off.cqes);
+    e->to_submit = 0;
+
+    if (e->fixed_buffers) {
+        struct iovec *iov = malloc(e->depth * sizeof(struct iovec));
+        if (iov == NULL) {
+            io_engine_uring_unmap(e);
+            return ENOMEM;
+        }
+        for (unsigned i = 0; i < e->depth; i++) {
+            iov[i].iov_base = io_engine_buffer(e, i);
+            iov[i].iov_len = e->block_size;
+        }
+        int rc = io_uring_register_raw(e->ring_fd, IORING_REGISTER_BUFFERS, iov, e->depth);
+        free(iov);
+        if (rc < 0) {
+            e->fixed_buffers = 0;   // Usually RLIMIT_MEMLOCK; plain READ/WRITE still work
+        }
+    }
+    return 0;
+}
+
+static inline void io_engine_uring_submit(io_engine_t *e, unsigned slot, io_op_t op,
+                                          off_t offset) {
+    unsigned tail = *e->sq_tail;                    // Only we write it
+    unsigned index = tail & *e->sq_mask;
+    struct io_uring_sqe *sqe = &e->sqes[index];
+
+    memset(sqe, 0, sizeof(*sqe));
+    if (e->fixed_buffers) {
+        sqe->opcode = op == IO_READ ? IORING_OP_READ_FIXED : IORING_OP_WRITE_FIXED;
+        sqe->buf_index = (uint16_t)slot;
+    } else {
+        sqe->opcode = op == IO_READ ? IORING_OP_READ : IORING_OP_WRITE;
+    }
+    sqe->fd = e->fd;
+    sqe->off = (uint64_t)offset;
+    sqe->addr = (uint64_t)(uintptr_t)io_engine_buffer(e, slot);
+    sqe->len = (uint32_t)e->block_size;
+    sqe->user_data = slot;
+    e->sq_array[index] = index;
+    // Publish the SQE before the new tail
+    __atomic_store_n(e->sq_tail, tail + 1, __ATOMIC_RELEASE);
+    e->to_submit++;
+}
+
+static inline int io_engine_uring_wait(io_engine_t *e, io_completion_t *out,
+                                       unsigned max, unsigned min) {
+    unsigned head = *e->cq_head;                    // Only we write it
+    unsigned ready = __atomic_load_n(e->cq_tail, __ATOMIC_ACQUIRE) - head;
+
+    // Submit everything queued, and sleep in the same call if needed.
+    // min_complete counts the CQEs in the ring, not new arrivals, so it
+    // is @min itself rather than what is still missing.
+    if (e->to_submit > 0 || ready < min) {
+        unsigned want = ready < min ? min : 0;
+        int rc;
+        do {
+            rc = io_uring_enter_raw(e->ring_fd, e->to_submit, want,
+                                    want > 0 ? IORING_ENTER_GETEVENTS : 0);
+        } while (rc < 0 && errno == EINTR);
+        if (rc < 0) {
+            return -errno;
+        }
+        e->to_submit -= (unsigned)rc;
+    }
+
+    unsigned tail = __atomic_load_n(e->cq_tail, __ATOMIC_ACQUIRE);
+    unsigned n = 0;
+    while (head != tail && n < max) {
+        struct io_uring_cqe *cqe = &e->cqes[head & *e->cq_mask];
+        out[n].slot = (unsigned)cqe->user_data;
+        out[n].result = cqe->res;
+        n++;
+        head++;
+    }
+    // Hand the CQEs back to the kernel
+    __atomic_store_n(e->cq_head, head, __ATOMIC_RELEASE);
+    return (int)n;
+}
+
+/*
+ * epoll Back End
+ * ==============
+ *
+ * Helper threads take slots from `pending`, run pread()/pwrite(), put
+ * the result on `done` and add 1 to the eventfd. The caller sleeps in
+ * epoll_wait() on the eventfd until enough completions are queued.
+ */
+
+static inline void *io_engine_helper(void *arg) {
+    io_engine_t *e = (io_engine_t *)arg;
+
+    pthread_mutex_lock(&e->mutex);
+    for (;;) {
+        while (e->pending_head == e->pending_tail && !e->stopping) {
+            pthread_cond_wait(&e->work, &e->mutex);
+        }
+        if (e->stopping) {
+            break;
+        }
+        unsigned slot = e->pending[e->pending_head++ % e->depth];
+        io_request_t req = e->requests[slot];
+        pthread_mutex_unlock(&e->mutex);
+
+        ssize_t rc = req.op == IO_READ
+                   ? pread(e->fd, io_engine_buffer(e, slot), e->block_size, req.offset)
+                   : pwrite(e->fd, io_engine_buffer(e, slot), e->block_size, req.offset);
+
+        pthread_mutex_lock(&e->mutex);
+        io_completion_t *c = &e->done[e->done_tail++ % e->depth];
+        c->slot = slot;
+        c->result = rc < 0 ? -errno : (int)rc;
+        uint64_t one = 1;
+        if (write(e->event_fd, &one, sizeof(one)) < 0) {
+            // Cannot fail: the counter is far from overflowing
+        }
+    }
+    pthread_mutex_unlock(&e->mutex);
+    return NULL;
+}
+
+static inline void io_engine_epoll_stop(io_engine_t *e) {
+    pthread_mutex_lock(&e->mutex);
+    e->stopping = 1;
+    pthread_cond_broadcast(&e->work);
+    pthread_mutex_unlock(&e->mutex);
+    for (unsigned i = 0; i < e->num_helpers; i++) {
+        pthread_join(e->helpers[i], NULL);
+    }
+    pthread_mutex_destroy(&e->mutex);
+    pthread_cond_destroy(&e->work);
+    free(e->helpers);
+    free(e->requests);
+    free(e->pending);
+    free(e->done);
+    if (e->event_fd >= 0) {
+        close(e->event_fd);
+    }
+    if (e->epoll_fd >= 0) {
+        close(e->epoll_fd);
+    }
+}
+
+static inline int io_engine_epoll_init(io_engine_t *e) {
+    struct epoll_event ev = { .events = EPOLLIN };
+
+    pthread_mutex_init(&e->mutex, NULL);
+    pthread_cond_init(&e->work, NULL);
+    e->stopping = 0;
+    e->pending_head = e->pending_tail = 0;
+    e->done_head = e->done_tail = 0;
+    e->num_helpers = 0;
+    e->helpers = malloc(e->depth * sizeof(pthread_t));
+    e->requests = malloc(e->depth * sizeof(io_request_t));
+    e->pending = malloc(e->depth * sizeof(unsigned));
+    e->done = malloc(e->depth * sizeof(io_completion_t));
+    e->event_fd = eventfd(0, EFD_CLOEXEC);
+    e->epoll_fd = epoll_create1(EPOLL_CLOEXEC);
+    if (e->helpers == NULL || e->requests == NULL || e->pending == NULL ||
+        e->done == NULL || e->event_fd < 0 || e->epoll_fd < 0 ||
+        epoll_ctl(e->epoll_fd, EPOLL_CTL_ADD, e->event_fd, &ev) != 0) {
+        io_engine_epoll_stop(e);
+        return ENOMEM;
+    }
+    for (unsigned i = 0; i < e->depth; i++) {
+        if (pthread_create(&e->helpers[i], NULL, io_engine_helper, e) != 0) {
+            break;
+        }
+        e->num_helpers++;
+    }
+    if (e->num_helpers == 0) {
+        io_engine_epoll_stop(e);
+        return EAGAIN;
+    }
+    return 0;
+}
+
+static inline void io_engine_epoll_submit(io_engine_t *e, unsigned slot, io_op_t op,
+                                          off_t offset) {
+    pthread_mutex_lock(&e->mutex);
+    e->requests[slot].op = op;
+    e->requests[slot].offset = offset;
+    e->pending[e->pending_tail++ % e->depth] = slot;
+    pthread_cond_signal(&e->work);
+    pthread_mutex_unlock(&e->mutex);
+}
+
+static inline int io_engine_epoll_wait(io_engine_t *e, io_completion_t *out,
+                                       unsigned max, unsigned min) {
+    unsigned n = 0;
+
+    for (;;) {
+        pthread_mutex_lock(&e->mutex);
+        while (e->done_head != e->done_tail && n < max) {
+            out[n++] = e->done[e->done_head++ % e->depth];
+        }
+        pthread_mutex_unlock(&e->mutex);
+        if (n >= min) {
+            return (int)n;
+        }
+
+        struct epoll_event ev;
+        int rc = epoll_wait(e->epoll_fd, &ev, 1, -1);
+        if (rc < 0 && errno != EINTR) {
+            return -errno;
+        }
+        uint64_t count;
+        if (rc > 0 && read(e->event_fd, &count, sizeof(count)) < 0 && errno != EAGAIN) {
+            return -errno;
+        }
+    }
+}
+
+/*
+ * Public Interface
+ * ================
+ */
+
+/*
+ * io_engine_init() - Set up @depth slots of @block_size bytes on @fd
+ *
+ * @kind:          IO_ENGINE_AUTO, IO_ENGINE_URING or IO_ENGINE_EPOLL
+ * @fixed_buffers: register the slot buffers with io_uring; cleared if
+ *                 registration fails (e.g. RLIMIT_MEMLOCK too low), and
+ *                 the ring is used without them
+ *
+ * Buffers are page aligned, so @fd may be opened with O_DIRECT if
+ * @block_size is a multiple of the device's block size.
+ *
+ * Return: 0, EINVAL, ENOMEM, or the io_uring_setup() error when
+ *         IO_ENGINE_URING was requested and is not available
+ */
+static inline int io_engine_init(io_engine_t *e, int fd, io_engine_kind_t kind,
+                                 unsigned depth, size_t block_size, int fixed_buffers) {
+    if (depth == 0 || depth > 4096 || block_size == 0) {
+        return EINVAL;
+    }
+    memset(e, 0, sizeof(*e));
+    e->fd = fd;
+    e->depth = depth;
+    e->block_size = block_size;
+    e->fixed_buffers = fixed_buffers;
+    e->ring_fd = e->epoll_fd = e->event_fd = -1;
+    if (posix_memalign((void **)&e->buffers, 4096, depth * block_size) != 0) {
+        return ENOMEM;
+    }
+    memset(e->buffers, 0, depth * block_size);
+
+    int rc = ENOSYS;
+    if (kind != IO_ENGINE_EPOLL) {
+        rc = io_engine_uring_init(e);
+        if (rc == 0) {
+            e->kind = IO_ENGINE_URING;
+            return 0;
+        }
+        if (kind == IO_ENGINE_URING) {
+            free(e->buffers);
+            return rc;
+        }
+    }
+    e->fixed_buffers = 0;
+    rc = io_engine_epoll_init(e);
+    if (rc != 0) {
+        free(e->buffers);
+        return rc;
+    }
+    e->kind = IO_ENGINE_EPOLL;
+    return 0;
+}
+
+static inline void io_engine_destroy(io_engine_t *e) {
+    if (e->kind == IO_ENGINE_URING) {
+        io_engine_uring_unmap(e);
+    } else {
+        io_engine_epoll_stop(e);
+    }
+    free(e->buffers);
+    e->buffers = NULL;
+}
+
+/*
+ * io_engine_submit() - Start a read or write of one block at @offset
+ *
+ * The slot's buffer must not be touched until the slot comes back from
+ * io_engine_wait(). With io_uring the request reaches the kernel at the
+ * next io_engine_wait(), together with any others queued before it.
+ */
+static inline void io_engine_submit(io_engine_t *e, unsigned slot, io_op_t op, off_t offset) {
+    if (e->kind == IO_ENGINE_URING) {
+        io_engine_uring_submit(e, slot, op, offset);
+    } else {
+        io_engine_epoll_submit(e, slot, op, offset);
+    }
+}
+
+/*
+ * io_engine_wait() - Reap completions, sleeping until at least @min
+ *
+ * Return: the number of completions stored in @out (up to @max), or
+ *         -errno
+ */
+static inline int io_engine_wait(io_engine_t *e, io_completion_t *out, unsigned max,
+                                 unsigned min) {
+    if (e->kind == IO_ENGINE_URING) {
+        return io_engine_uring_wait(e, out, max, min);
+    }
+    return io_engine_epoll_wait(e, out, max, min);
+}
+
+#endif // __io_engine_h__
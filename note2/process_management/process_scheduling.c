@@ -1,32 +1,229 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <signal.h>
 #include <sys/types.h>
+#include <sys/resource.h>
+#include <sys/stat.h>
+#include <sys/sysmacros.h>
 #include <sys/wait.h>
 #include <time.h>
 
+#include "io_engine.h"
+#include "../../workload.h"
+
 /*
  * This program demonstrates process scheduling concepts
  * It creates CPU-bound and I/O-bound processes and shows their behavior
+ *
+ * The I/O-bound processes do real block I/O on a scratch file through
+ * io_engine.h (io_uring, or helper threads + epoll where io_uring is
+ * unavailable). The file is opened with O_DIRECT when the file system
+ * allows it, so reads go to the device instead of the page cache.
+ *
+ * I/O latency benchmark:
+ *
+ *   ./process_scheduling io [auto|uring|epoll] [depth] [block_size] [fixed] [ops]
+ *
+ * keeps `depth` random 1-in-4-write requests in flight and measures each
+ * request's completion latency (submit to reaped) - once on an idle
+ * machine, then with 2 CPU-bound processes per CPU running under
+ * different scheduling policies. A completion only counts once the
+ * I/O process is back on a CPU to reap it, so the tail grows with how
+ * long the scheduler keeps it waiting behind the CPU hogs.
+ */
+
+#define DATA_FILE "io_engine.dat"
+#define DATA_BLOCKS 16384       // Scratch file size in 4 KB blocks (64 MB)
+#define IO_BURST 32             // Requests per "I/O operation" in the demo
+#define IO_DEPTH 8
+#define IO_BLOCK_SIZE 4096
+
+// One row of the benchmark: how the CPU hogs (and the I/O process) run
+typedef struct {
+    const char *name;
+    int hogs;                   // CPU-bound processes per CPU
+    int hog_policy;
+    int hog_nice;
+    int io_fifo;                // Run the I/O process as SCHED_FIFO
+} policy_t;
+
+static const policy_t policies[] = {
+    { "no-load",    0, SCHED_OTHER, 0,  0 },
+    { "other",      2, SCHED_OTHER, 0,  0 },
+    { "nice19",     2, SCHED_OTHER, 19, 0 },
+    { "batch",      2, SCHED_BATCH, 0,  0 },
+    { "idle",       2, SCHED_IDLE,  0,  0 },
+    { "fifo-io",    2, SCHED_OTHER, 0,  1 },
+};
+
+static double now_us(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e6 + ts.tv_nsec / 1e3;
+}
+
+// Cheap per-process xorshift for random block numbers
+static inline unsigned next_random(unsigned *state) {
+    unsigned x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+/*
+ * Create the scratch file: block b starts with the 64-bit number b, so
+ * every read can check it got the right block.
  */
+static int create_data_file(size_t block_size, long blocks) {
+    int fd = open(DATA_FILE, O_RDWR | O_CREAT | O_TRUNC, 0644);
+    if (fd < 0) {
+        perror("open " DATA_FILE);
+        return -1;
+    }
+    char *block = calloc(1, block_size);
+    for (long b = 0; b < blocks; b++) {
+        memcpy(block, &b, sizeof(b));
+        if (write(fd, block, block_size) != (ssize_t)block_size) {
+            perror("write " DATA_FILE);
+            free(block);
+            close(fd);
+            return -1;
+        }
+    }
+    free(block);
+    fsync(fd);
+    close(fd);
+    return 0;
+}
+
+// Open the scratch file, bypassing the page cache if possible
+static int open_data_file(int *direct) {
+    int fd = open(DATA_FILE, O_RDWR | O_DIRECT);
+    *direct = fd >= 0;
+    if (fd < 0) {
+        fd = open(DATA_FILE, O_RDWR);
+    }
+    if (fd >= 0 && !*direct) {
+        // Buffered fallback: at least start from a cold cache
+        posix_fadvise(fd, 0, 0, POSIX_FADV_DONTNEED);
+    }
+    return fd;
+}
+
+/*
+ * Logical block size of the device holding @fd: O_DIRECT offsets and
+ * lengths must be multiples of it. Read from sysfs (a partition has no
+ * queue/ of its own, so try its parent disk too); 512 if unknown.
+ */
+static unsigned logical_block_size(int fd) {
+    static const char *const paths[] = {
+        "/sys/dev/block/%u:%u/queue/logical_block_size",
+        "/sys/dev/block/%u:%u/../queue/logical_block_size",
+    };
+    struct stat st;
+    unsigned size = 0;
+
+    if (fstat(fd, &st) != 0) {
+        return 512;
+    }
+    for (size_t i = 0; i < sizeof(paths) / sizeof(paths[0]) && size == 0; i++) {
+        char path[96];
+        snprintf(path, sizeof(path), paths[i], major(st.st_dev), minor(st.st_dev));
+        FILE *f = fopen(path, "r");
+        if (f != NULL) {
+            if (fscanf(f, "%u", &size) != 1) {
+                size = 0;
+            }
+            fclose(f);
+        }
+    }
+    return size > 0 ? size : 512;
+}
+
+typedef struct {
+    long ops;
+    long errors;                // Short transfers or wrong block contents
+    double elapsed_us;
+    double *latency_us;         // ops entries
+} io_result_t;
+
+/*
+ * run_io() - Issue @ops random block requests, @depth at a time
+ *
+ * One request in four is a write; writes rewrite a block's number, so
+ * the file stays checkable.
+ */
+static void run_io(io_engine_t *e, long ops, long blocks, unsigned seed, io_result_t *r) {
+    io_completion_t done[4096];
+    double *started = malloc(e->depth * sizeof(double));
+    long *block_of = malloc(e->depth * sizeof(long));
+    io_op_t *op_of = malloc(e->depth * sizeof(io_op_t));
+    long issued = 0, completed = 0;
+
+    r->ops = ops;
+    r->errors = 0;
+    double start = now_us();
+    for (unsigned slot = 0; slot < e->depth && issued < ops; slot++, issued++) {
+        block_of[slot] = next_random(&seed) % blocks;
+        op_of[slot] = next_random(&seed) % 4 == 0 ? IO_WRITE : IO_READ;
+        if (op_of[slot] == IO_WRITE) {
+            memcpy(io_engine_buffer(e, slot), &block_of[slot], sizeof(long));
+        }
+        started[slot] = now_us();
+        io_engine_submit(e, slot, op_of[slot], (off_t)block_of[slot] * e->block_size);
+    }
+    while (completed < ops) {
+        int n = io_engine_wait(e, done, e->depth, 1);
+        if (n < 0) {
+            fprintf(stderr, "io_engine_wait: %s\n", strerror(-n));
+            exit(1);
+        }
+        double now = now_us();
+        for (int i = 0; i < n; i++) {
+            unsigned slot = done[i].slot;
+            r->latency_us[completed++] = now - started[slot];
+            if (done[i].result != (int)e->block_size ||
+                (op_of[slot] == IO_READ &&
+                 memcmp(io_engine_buffer(e, slot), &block_of[slot], sizeof(long)) != 0)) {
+                r->errors++;
+            }
+            if (issued < ops) {
+                block_of[slot] = next_random(&seed) % blocks;
+                op_of[slot] = next_random(&seed) % 4 == 0 ? IO_WRITE : IO_READ;
+                if (op_of[slot] == IO_WRITE) {
+                    memcpy(io_engine_buffer(e, slot), &block_of[slot], sizeof(long));
+                }
+                started[slot] = now_us();
+                io_engine_submit(e, slot, op_of[slot], (off_t)block_of[slot] * e->block_size);
+                issued++;
+            }
+        }
+    }
+    r->elapsed_us = now_us() - start;
+    free(started);
+    free(block_of);
+    free(op_of);
+}
 
 // Simulates a CPU-bound process that does computation
-void cpu_bound_process(int process_id, int iterations) {
+void cpu_bound_process(int process_id, uint64_t units) {
     printf("CPU-bound process %d started (PID: %d)\n", process_id, getpid());
     
     clock_t start_time = clock();
     
-    // Perform CPU-intensive computation
-    volatile double result = 0;
-    for (int i = 0; i < iterations; i++) {
-        result += i / 2.0;
-        result *= 1.1;
-        
-        // Occasionally report progress
-        if (i % (iterations / 10) == 0) {
-            printf("CPU-bound process %d: %d%% complete\n", 
-                   process_id, (i * 100) / iterations);
-        }
+    // Perform CPU-intensive computation in ten equal steps: a calibrated
+    // floating-point job (workload.h) costs the same on any machine
+    volatile uint64_t result = 0;
+    for (int step = 0; step < 10; step++) {
+        printf("CPU-bound process %d: %d%% complete\n", process_id, step * 10);
+        result += workload_run(WORK_FP, units / 10);
     }
     
     clock_t end_time = clock();
@@ -43,12 +240,22 @@ void io_bound_process(int process_id, int operations) {
     
     time_t start_time = time(NULL);
     
+    int direct;
+    int fd = open_data_file(&direct);
+    io_engine_t engine;
+    double latency[IO_BURST];
+    io_result_t result = { .latency_us = latency };
+    if (fd < 0 || io_engine_init(&engine, fd, IO_ENGINE_AUTO, IO_DEPTH, IO_BLOCK_SIZE, 0) != 0) {
+        fprintf(stderr, "I/O-bound process %d: cannot set up I/O\n", process_id);
+        exit(1);
+    }
+    
     for (int i = 0; i < operations; i++) {
-        printf("I/O-bound process %d: performing I/O operation %d\n", 
-               process_id, i + 1);
-        
-        // Simulate I/O operation by sleeping
-        usleep(200000);  // 200ms
+        // One I/O operation: a burst of random block reads and writes
+        run_io(&engine, IO_BURST, DATA_BLOCKS, (unsigned)(getpid() * 31 + i), &result);
+        printf("I/O-bound process %d: I/O operation %d, %d blocks via %s in %.1f ms%s\n", 
+               process_id, i + 1, IO_BURST, io_engine_name(engine.kind),
+               result.elapsed_us / 1000, result.errors ? " (ERRORS)" : "");
         
         // Small amount of computation between I/O
         volatile int calc = 0;
@@ -57,6 +264,9 @@ void io_bound_process(int process_id, int operations) {
         }
     }
     
+    io_engine_destroy(&engine);
+    close(fd);
+    
     time_t end_time = time(NULL);
     double elapsed = difftime(end_time, start_time);
     
@@ -65,19 +275,153 @@ void io_bound_process(int process_id, int operations) {
     exit(0);
 }
 
-int main() {
+static int compare_double(const void *a, const void *b) {
+    double x = *(const double *)a, y = *(const double *)b;
+    return x < y ? -1 : x > y;
+}
+
+// Start CPU hogs for one benchmark row; they spin until killed.
+// Returns how many started; only those are in @pids.
+static int start_hogs(const policy_t *p, pid_t *pids) {
+    int want = p->hogs * (int)sysconf(_SC_NPROCESSORS_ONLN), n = 0;
+    for (int i = 0; i < want; i++) {
+        pid_t pid = fork();
+        if (pid < 0) {
+            perror("fork");
+            break;
+        }
+        if (pid == 0) {
+            // Always set the policy: a SCHED_FIFO parent's children
+            // would otherwise inherit it and never let anyone else run
+            struct sched_param param = { .sched_priority = 0 };
+            sched_setscheduler(0, p->hog_policy, &param);
+            if (p->hog_nice != 0) {
+                setpriority(PRIO_PROCESS, 0, p->hog_nice);
+            }
+            volatile unsigned long spin = 0;
+            for (;;) {
+                spin++;
+            }
+        }
+        pids[n++] = pid;
+    }
+    usleep(100000);             // Let them get going
+    return n;
+}
+
+static void stop_hogs(pid_t *pids, int n) {
+    for (int i = 0; i < n; i++) {
+        kill(pids[i], SIGKILL);
+    }
+    for (int i = 0; i < n; i++) {
+        waitpid(pids[i], NULL, 0);
+    }
+}
+
+static int io_benchmark(int argc, char *argv[]) {
+    io_engine_kind_t kind = IO_ENGINE_AUTO;
+    if (argc > 2) {
+        kind = strcmp(argv[2], "uring") == 0 ? IO_ENGINE_URING
+             : strcmp(argv[2], "epoll") == 0 ? IO_ENGINE_EPOLL : IO_ENGINE_AUTO;
+    }
+    unsigned depth = argc > 3 ? (unsigned)atoi(argv[3]) : 16;
+    size_t block_size = argc > 4 ? (size_t)atol(argv[4]) : IO_BLOCK_SIZE;
+    int fixed = argc > 5 ? atoi(argv[5]) : 0;
+    long ops = argc > 6 ? atol(argv[6]) : 20000;
+    int ok = 1;
+
+    if (depth < 1 || depth > 4096 || block_size < sizeof(long) || ops < 1) {
+        fprintf(stderr, "Usage: %s io [auto|uring|epoll] [depth 1-4096] [block_size] "
+                "[fixed 0|1] [ops]\n", argv[0]);
+        return 1;
+    }
+    long blocks = (long)DATA_BLOCKS * IO_BLOCK_SIZE / (long)block_size;
+    if (create_data_file(block_size, blocks) != 0) {
+        return 1;
+    }
+    int direct;
+    int fd = open_data_file(&direct);
+    if (fd >= 0 && direct && block_size % logical_block_size(fd) != 0) {
+        fprintf(stderr, "With O_DIRECT, block_size must be a multiple of the device's "
+                "%u-byte logical block size\n", logical_block_size(fd));
+        close(fd);
+        unlink(DATA_FILE);
+        return 1;
+    }
+    io_engine_t engine;
+    int rc = fd < 0 ? errno : io_engine_init(&engine, fd, kind, depth, block_size, fixed);
+    if (rc != 0) {
+        fprintf(stderr, "Cannot start the %s engine: %s\n", io_engine_name(kind), strerror(rc));
+        unlink(DATA_FILE);
+        return 1;
+    }
+
+    printf("I/O latency under CPU contention: %s, depth %u, %zu-byte blocks%s, %s, "
+           "%ld ops, %ld CPUs\n\n", io_engine_name(engine.kind), depth, block_size,
+           engine.fixed_buffers ? " (fixed buffers)" : "",
+           direct ? "O_DIRECT" : "buffered", ops, sysconf(_SC_NPROCESSORS_ONLN));
+    printf("%-9s %5s %10s %10s %10s %10s  %s\n",
+           "policy", "hogs", "ops/s", "p50 us", "p99 us", "max us", "check");
+
+    io_result_t result = { .latency_us = malloc(ops * sizeof(double)) };
+    pid_t *hogs = malloc(2 * sysconf(_SC_NPROCESSORS_ONLN) * sizeof(pid_t));
+    for (size_t i = 0; i < sizeof(policies) / sizeof(policies[0]); i++) {
+        const policy_t *p = &policies[i];
+        struct sched_param fifo = { .sched_priority = 1 }, normal = { .sched_priority = 0 };
+
+        if (p->io_fifo && sched_setscheduler(0, SCHED_FIFO, &fifo) != 0) {
+            printf("%-9s %5s  skipped: %s\n", p->name, "-", strerror(errno));
+            continue;
+        }
+        fflush(stdout);         // Before fork(), or the hogs inherit the buffer
+        int n = start_hogs(p, hogs);
+        run_io(&engine, ops, blocks, 12345 + (unsigned)i, &result);
+        stop_hogs(hogs, n);
+        if (p->io_fifo) {
+            sched_setscheduler(0, SCHED_OTHER, &normal);
+        }
+
+        qsort(result.latency_us, ops, sizeof(double), compare_double);
+        printf("%-9s %5d %10.0f %10.1f %10.1f %10.1f  %s\n", p->name, n,
+               ops / (result.elapsed_us / 1e6), result.latency_us[ops / 2],
+               result.latency_us[ops * 99 / 100], result.latency_us[ops - 1],
+               result.errors == 0 ? "ok" : "MISMATCH");
+        ok &= result.errors == 0;
+    }
+
+    free(hogs);
+    free(result.latency_us);
+    io_engine_destroy(&engine);
+    close(fd);
+    unlink(DATA_FILE);
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "io") == 0) {
+        return io_benchmark(argc, argv);
+    }
+    
     printf("Process Scheduling Demonstration\n");
     printf("Parent PID: %d\n\n", getpid());
     
+    // Scratch file for the I/O-bound processes
+    if (create_data_file(IO_BLOCK_SIZE, DATA_BLOCKS) != 0) {
+        return 1;
+    }
+    
+    // Calibrate the CPU-bound jobs once, before the children are forked
+    workload_init();
+    
     // Create two CPU-bound processes
     pid_t cpu_pid1 = fork();
     if (cpu_pid1 == 0) {
-        cpu_bound_process(1, 100000000);  // 100 million iterations
+        cpu_bound_process(1, 1000000);  // 1 million units: ~1 s of CPU
     }
     
     pid_t cpu_pid2 = fork();
     if (cpu_pid2 == 0) {
-        cpu_bound_process(2, 100000000);  // 100 million iterations
+        cpu_bound_process(2, 1000000);  // 1 million units: ~1 s of CPU
     }
     
     // Create two I/O-bound processes
@@ -101,6 +445,8 @@ int main() {
                terminated_pid, WEXITSTATUS(status));
     }
     
+    unlink(DATA_FILE);
+    
     printf("\nObservation: Notice how I/O-bound processes finish faster in wall-clock time\n");
     printf("despite their frequent blocking, while CPU-bound processes consume more CPU time.\n");
     printf("This demonstrates why schedulers prioritize I/O-bound processes to maintain\n");
@@ -0,0 +1,113 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "../../common.h"
+#include "../../workload.h"
+
+/*
+ * workload_benchmark.c - Do workload.h's units cost what they promise?
+ *
+ * Runs every kernel for job sizes of 10 to 10,000 units (1 unit = 1 us)
+ * and reports the achieved time per job against the request: median,
+ * 99th percentile and the spread (p10 to p90, relative to the median).
+ * The check column passes when the median job is within TOLERANCE of
+ * its nominal length (SHORT_TOLERANCE for jobs under 100 units, where
+ * a cold cache or one interrupt is a large share of the job).
+ *
+ * Usage: ./workload_benchmark [kind] [reps]
+ *        kind: alu, fp, chase, stream or branch (default: all)
+ */
+
+#define TOLERANCE 0.25
+#define SHORT_TOLERANCE 0.5
+#define MAX_TOTAL_US 1000000    // Cap per row, so big jobs get fewer reps
+
+static const uint64_t job_units[] = { 10, 100, 1000, 10000 };
+#define NUM_JOBS (int)(sizeof(job_units) / sizeof(job_units[0]))
+
+static volatile uint64_t sink;
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static int measure(work_kind_t kind, uint64_t units, int reps, uint64_t *took) {
+    if ((uint64_t)reps * units > MAX_TOTAL_US) {
+        reps = (int)(MAX_TOTAL_US / units);
+    }
+    for (int i = 0; i < 3; i++) {
+        sink = workload_run(kind, units);   // Warm up caches and TLB
+    }
+    pmu_t pmu;
+    pmu_sample_t counters;
+    char counter_text[160];
+    pmu_begin(&pmu, 0);
+    for (int i = 0; i < reps; i++) {
+        uint64_t start = precise_now_ns();
+        sink = workload_run(kind, units);
+        took[i] = precise_now_ns() - start;
+    }
+    pmu_end(&pmu, &counters);
+    qsort(took, reps, sizeof(uint64_t), compare_u64);
+
+    // Spread: p10..p90 as a share of the median
+    double spread = 100.0 * (took[reps * 9 / 10] - took[reps / 10]) / took[reps / 2];
+    double want_us = units * WORK_UNIT_NS / 1000.0;
+    double p50_us = took[reps / 2] / 1000.0;
+    double err = (p50_us - want_us) / want_us;
+    double tolerance = units < 100 ? SHORT_TOLERANCE : TOLERANCE;
+    int ok = err <= tolerance && err >= -tolerance;
+    printf("%-7s %7lu %5d %10.1f %10.1f %+7.1f%% %6.1f%%  %-8s  %s\n", workload_names[kind],
+           (unsigned long)units, reps, p50_us, took[reps * 99 / 100] / 1000.0,
+           100.0 * err, spread, ok ? "ok" : "MISMATCH",
+           pmu_format(&counters, counter_text, sizeof(counter_text)));
+    fflush(stdout);
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    work_kind_t only = WORK_KINDS;
+    int reps = argc > 2 ? atoi(argv[2]) : 200;
+
+    if (argc > 1 && strcmp(argv[1], "all") != 0) {
+        only = workload_parse(argv[1]);
+        if (only == WORK_KINDS) {
+            fprintf(stderr, "Usage: %s [alu|fp|chase|stream|branch|all] [reps]\n", argv[0]);
+            return 1;
+        }
+    }
+    if (reps < 1) {
+        reps = 1;
+    }
+
+    double start = GetTime();
+    if (workload_init() != 0) {
+        fprintf(stderr, "workload_init: out of memory\n");
+        return 1;
+    }
+    printf("Workloads: 1 unit = %d ns, calibrated in %.2f s; iterations per unit:\n",
+           WORK_UNIT_NS, GetTime() - start);
+    for (int kind = 0; kind < WORK_KINDS; kind++) {
+        printf("  %-7s %8.1f\n", workload_names[kind], workload_per_unit((work_kind_t)kind));
+    }
+    pmu_describe(stdout);
+    printf("\n%-7s %7s %5s %10s %10s %8s %7s  %-8s  %s\n", "kind", "units", "reps",
+           "p50 us", "p99 us", "p50 err", "spread", "check", "counters (all reps)");
+
+    uint64_t *took = malloc(reps * sizeof(uint64_t));
+    int ok = 1;
+    for (int kind = 0; kind < WORK_KINDS; kind++) {
+        if (only != WORK_KINDS && kind != (int)only) {
+            continue;
+        }
+        for (int j = 0; j < NUM_JOBS; j++) {
+            ok &= measure((work_kind_t)kind, job_units[j], reps, took);
+        }
+    }
+    free(took);
+    return ok ? 0 : 1;
+}
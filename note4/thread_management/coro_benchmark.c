@@ -0,0 +1,328 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "../../common.h"
+#include "../../coro.h"
+
+/*
+ * coro_benchmark.c - Coroutines (coro.h) vs OS threads
+ *
+ * Part 1, switch cost: two actors hand control back and forth.
+ *
+ *   asm-yield        two coroutines calling coro_yield()
+ *   ucontext-yield   the same with swapcontext() (CORO_UCONTEXT)
+ *   asm-channel      ping-pong over two coro_chan_t of capacity 1
+ *   pthread-condvar  two threads passing a turn flag under a mutex
+ *
+ * `ns/handoff` is per one-way handoff from one actor to the other. A
+ * coroutine handoff goes through the scheduler, so it is two register
+ * switches.
+ *
+ * Part 2, memory per actor: start N actors that all block, then read
+ * the process size from /proc/self/statm. Coroutines and threads get
+ * the same STACK_KB stacks and touch about 1 KB of them. Guarded
+ * coroutine stacks are capped by vm.max_map_count (two mappings per
+ * stack), threads by MAX_THREADS.
+ *
+ * Check: every actor ran to completion the expected number of times.
+ *
+ * Usage: ./coro_benchmark [handoffs] [actors]
+ */
+
+#define STACK_KB 64
+#define MAX_THREADS 10000
+
+/*
+ * Part 1: Switch Cost
+ * ===================
+ */
+
+typedef struct {
+    long rounds;
+    long done;
+    coro_chan_t *in, *out;
+} pinger_t;
+
+static void yielder(void *arg) {
+    pinger_t *p = (pinger_t *)arg;
+    for (long i = 0; i < p->rounds; i++) {
+        coro_yield();
+        p->done++;
+    }
+}
+
+// First actor sends then receives; the second receives then sends
+static void channel_first(void *arg) {
+    pinger_t *p = (pinger_t *)arg;
+    for (long i = 0; i < p->rounds; i++) {
+        coro_chan_send(p->out, &i);
+        long v;
+        coro_chan_recv(p->in, &v);
+        p->done += v == i;
+    }
+}
+
+static void channel_second(void *arg) {
+    pinger_t *p = (pinger_t *)arg;
+    for (long i = 0; i < p->rounds; i++) {
+        long v;
+        coro_chan_recv(p->in, &v);
+        coro_chan_send(p->out, &v);
+        p->done += v == i;
+    }
+}
+
+static pthread_mutex_t turn_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t turn_changed = PTHREAD_COND_INITIALIZER;
+static int turn;
+
+typedef struct {
+    int id;
+    pinger_t p;
+} thread_pinger_t;
+
+static void *thread_pinger(void *arg) {
+    thread_pinger_t *t = (thread_pinger_t *)arg;
+    for (long i = 0; i < t->p.rounds; i++) {
+        pthread_mutex_lock(&turn_mutex);
+        while (turn != t->id) {
+            pthread_cond_wait(&turn_changed, &turn_mutex);
+        }
+        turn = 1 - t->id;
+        pthread_cond_signal(&turn_changed);
+        pthread_mutex_unlock(&turn_mutex);
+        t->p.done++;
+    }
+    return NULL;
+}
+
+typedef enum { ASM_YIELD, UCONTEXT_YIELD, ASM_CHANNEL, PTHREAD_CONDVAR } switch_mode_t;
+
+static const char *switch_names[] = {
+    "asm-yield", "ucontext-yield", "asm-channel", "pthread-condvar"
+};
+
+static int switch_run(switch_mode_t mode, long handoffs) {
+    long rounds = handoffs / 2;
+    pinger_t a = { .rounds = rounds }, b = { .rounds = rounds };
+    double start = GetTime();
+
+    if (mode == PTHREAD_CONDVAR) {
+        thread_pinger_t t[2] = { { .id = 0, .p = a }, { .id = 1, .p = b } };
+        pthread_t threads[2];
+        turn = 0;
+        start = GetTime();
+        for (int i = 0; i < 2; i++) {
+            pthread_create(&threads[i], NULL, thread_pinger, &t[i]);
+        }
+        for (int i = 0; i < 2; i++) {
+            pthread_join(threads[i], NULL);
+        }
+        a.done = t[0].p.done;
+        b.done = t[1].p.done;
+    } else {
+        coro_sched_t s;
+        coro_chan_t ab, ba;
+        coro_sched_init(&s, STACK_KB * 1024, mode == UCONTEXT_YIELD ? CORO_UCONTEXT : 0);
+        if (mode == ASM_CHANNEL) {
+            coro_chan_init(&ab, 1, sizeof(long));
+            coro_chan_init(&ba, 1, sizeof(long));
+            a.out = &ab;
+            a.in = &ba;
+            b.in = &ab;
+            b.out = &ba;
+            coro_spawn(&s, channel_first, &a);
+            coro_spawn(&s, channel_second, &b);
+        } else {
+            coro_spawn(&s, yielder, &a);
+            coro_spawn(&s, yielder, &b);
+        }
+        coro_sched_run(&s);
+        if (mode == ASM_CHANNEL) {
+            coro_chan_destroy(&ab);
+            coro_chan_destroy(&ba);
+        }
+        coro_sched_destroy(&s);
+    }
+    double elapsed = GetTime() - start;
+
+    int ok = a.done == rounds && b.done == rounds;
+    printf("%-16s %12ld %12.1f %14.0f  %s\n", switch_names[mode], 2 * rounds,
+           1e9 * elapsed / (2 * rounds), 2 * rounds / elapsed, ok ? "ok" : "MISMATCH");
+    return ok;
+}
+
+/*
+ * Part 2: Memory per Actor
+ * ========================
+ */
+
+static long started, finished;
+static pthread_mutex_t gate_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t gate_open = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t all_started = PTHREAD_COND_INITIALIZER;
+static int released;
+
+// Stand-in for an actor's own state: about 1 KB of stack in use
+static __attribute__((noinline)) void touch_stack(void) {
+    volatile char frame[1024];
+    memset((char *)frame, 1, sizeof(frame));
+}
+
+static void coro_actor(void *arg) {
+    coro_t **self = (coro_t **)arg;
+    touch_stack();
+    *self = coro_self();
+    started++;
+    coro_park();                // Until main() readies it
+    finished++;
+}
+
+static void *thread_actor(void *arg) {
+    (void)arg;
+    touch_stack();
+    pthread_mutex_lock(&gate_mutex);
+    if (++started == finished) {        // `finished` holds the target here
+        pthread_cond_signal(&all_started);
+    }
+    while (!released) {
+        pthread_cond_wait(&gate_open, &gate_mutex);
+    }
+    pthread_mutex_unlock(&gate_mutex);
+    return NULL;
+}
+
+// Virtual and resident size in bytes
+static void process_size(long *vsz, long *rss) {
+    FILE *f = fopen("/proc/self/statm", "r");
+    long pages_v = 0, pages_r = 0;
+    if (f != NULL) {
+        if (fscanf(f, "%ld %ld", &pages_v, &pages_r) != 2) {
+            pages_v = pages_r = 0;
+        }
+        fclose(f);
+    }
+    *vsz = pages_v * sysconf(_SC_PAGESIZE);
+    *rss = pages_r * sysconf(_SC_PAGESIZE);
+}
+
+static void memory_row(const char *name, long n, double spawn_s, long vsz0, long rss0,
+                       long vsz, long rss, int ok) {
+    printf("%-16s %9ld %12.2f %12.1f %12.1f  %s\n", name, n, 1e6 * spawn_s / n,
+           (double)(vsz - vsz0) / n / 1024, (double)(rss - rss0) / n / 1024,
+           ok ? "ok" : "MISMATCH");
+}
+
+static int coro_memory(const char *name, long n, int flags) {
+    coro_sched_t s;
+    coro_t **actors = calloc(n, sizeof(coro_t *));
+    long vsz0, rss0;
+    int ok = 1;
+
+    process_size(&vsz0, &rss0);
+    coro_sched_init(&s, STACK_KB * 1024, flags);
+    started = finished = 0;
+    double start = GetTime();
+    long spawned = 0;
+    while (spawned < n && coro_spawn(&s, coro_actor, &actors[spawned]) == 0) {
+        spawned++;
+    }
+    coro_sched_run(&s);         // Every actor runs once, then parks
+    double spawn_s = GetTime() - start;
+    ok = spawned == n && started == n;
+
+    long vsz, rss;
+    process_size(&vsz, &rss);
+    for (long i = 0; i < spawned; i++) {
+        coro_ready(actors[i]);
+    }
+    long left = coro_sched_run(&s);
+    ok &= left == 0 && finished == spawned;
+    memory_row(name, spawned, spawn_s, vsz0, rss0, vsz, rss, ok);
+    coro_sched_destroy(&s);
+    free(actors);
+    return ok;
+}
+
+static int thread_memory(long n) {
+    pthread_t *threads = calloc(n, sizeof(pthread_t));
+    pthread_attr_t attr;
+    long vsz0, rss0, created = 0;
+
+    process_size(&vsz0, &rss0);
+    pthread_attr_init(&attr);
+    pthread_attr_setstacksize(&attr, STACK_KB * 1024);
+    started = 0;
+    finished = n;
+    released = 0;
+    double start = GetTime();
+    while (created < n && pthread_create(&threads[created], &attr, thread_actor, NULL) == 0) {
+        created++;
+    }
+    pthread_mutex_lock(&gate_mutex);
+    finished = created;
+    while (started < created) {
+        pthread_cond_wait(&all_started, &gate_mutex);
+    }
+    pthread_mutex_unlock(&gate_mutex);
+    double spawn_s = GetTime() - start;
+
+    long vsz, rss;
+    process_size(&vsz, &rss);
+    memory_row("pthread", created, spawn_s, vsz0, rss0, vsz, rss, created == n);
+
+    pthread_mutex_lock(&gate_mutex);
+    released = 1;
+    pthread_cond_broadcast(&gate_open);
+    pthread_mutex_unlock(&gate_mutex);
+    for (long i = 0; i < created; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    pthread_attr_destroy(&attr);
+    free(threads);
+    return created == n;
+}
+
+static long max_map_count(void) {
+    FILE *f = fopen("/proc/sys/vm/max_map_count", "r");
+    long n = 65530;
+    if (f != NULL) {
+        if (fscanf(f, "%ld", &n) != 1) {
+            n = 65530;
+        }
+        fclose(f);
+    }
+    return n;
+}
+
+int main(int argc, char *argv[]) {
+    long handoffs = argc > 1 ? atol(argv[1]) : 2000000;
+    long actors = argc > 2 ? atol(argv[2]) : 100000;
+    int ok = 1;
+
+    if (handoffs < 2 || actors < 1) {
+        fprintf(stderr, "Usage: %s [handoffs] [actors]\n", argv[0]);
+        return 1;
+    }
+
+    printf("Context switch cost: %ld handoffs between two actors%s\n\n", handoffs,
+           CORO_HAVE_ASM ? "" : " (no assembly switch on this CPU: asm rows use ucontext)");
+    printf("%-16s %12s %12s %14s  %s\n", "mode", "handoffs", "ns/handoff", "handoffs/s", "check");
+    for (int m = ASM_YIELD; m <= PTHREAD_CONDVAR; m++) {
+        // The condvar ping-pong is ~100x slower; keep its run short
+        ok &= switch_run((switch_mode_t)m, m == PTHREAD_CONDVAR ? handoffs / 20 : handoffs);
+    }
+
+    long guarded = (max_map_count() - 1000) / 2;
+    printf("\nMemory per actor: %d KB stacks, every actor blocked\n\n", STACK_KB);
+    printf("%-16s %9s %12s %12s %12s  %s\n",
+           "actor", "count", "spawn us", "virt KB", "rss KB", "check");
+    ok &= coro_memory("coro", actors, 0);
+    ok &= coro_memory("coro-guarded", actors < guarded ? actors : guarded, CORO_GUARD);
+    ok &= thread_memory(actors < MAX_THREADS ? actors : MAX_THREADS);
+    return ok ? 0 : 1;
+}
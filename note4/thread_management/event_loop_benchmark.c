@@ -0,0 +1,310 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdint.h>
+#include <string.h>
+#include <fcntl.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "../../common.h"
+#include "../../event_loop.h"
+
+/*
+ * event_loop_benchmark.c - What event_loop.h can sustain
+ *
+ *   timers   start N one-shot timers with random delays up to
+ *            MAX_DELAY_MS, stop every fourth one, and run the loop
+ *            until the rest have fired. Reports start/stop cost, how
+ *            late timers fired (those due after the loop started
+ *            running), and checks that none fired early,
+ *            twice, or after being stopped.
+ *   fd       a ring of RING_PIPES pipes with TOKENS bytes circulating:
+ *            each readable callback reads a byte and writes it to the
+ *            next pipe. Runs for FD_SECONDS; checks no byte was lost.
+ *   post     POSTERS threads ev_post() N work items each; the loop
+ *            counts them. Shows how many eventfd wakeups were needed.
+ *   signal   the loop raises SIGUSR1 from its own callback, one at a
+ *            time, through signalfd.
+ *
+ * Usage: ./event_loop_benchmark [timers] [posts per thread]
+ */
+
+#define MAX_DELAY_MS 2000
+#define RING_PIPES 1000
+#define TOKENS 100
+#define FD_SECONDS 1.0
+#define POSTERS 4
+#define SIGNALS 20000
+
+static void row(const char *name, long events, double seconds, const char *unit,
+                double per_unit, int ok) {
+    printf("%-8s %10ld %9.3f %14.0f %14.1f %-14s %s\n", name, events, seconds,
+           events / seconds, per_unit, unit, ok ? "ok" : "MISMATCH");
+    fflush(stdout);
+}
+
+/*
+ * Timers
+ * ======
+ */
+
+typedef struct {
+    ev_timer_t timer;
+    double due;                 // GetTime() deadline
+    int fired;
+} bench_timer_t;
+
+static double run_start, max_late, sum_late;
+static long early, measured;
+
+static void on_timer(ev_loop_t *loop, ev_timer_t *t) {
+    (void)loop;
+    bench_timer_t *b = (bench_timer_t *)t->arg;
+    double late = GetTime() - b->due;
+    b->fired++;
+    if (late < -1e-4) {         // gettimeofday vs CLOCK_MONOTONIC skew
+        early++;
+    }
+    // Timers due while the start loop was still running are late by
+    // design; only time the ones due once the loop runs
+    if (b->due >= run_start) {
+        max_late = late > max_late ? late : max_late;
+        sum_late += late;
+        measured++;
+    }
+}
+
+static int timer_test(long n) {
+    bench_timer_t *timers = calloc(n, sizeof(bench_timer_t));
+    ev_loop_t loop;
+    unsigned int seed = 1;
+
+    ev_loop_init(&loop);
+    double start = GetTime();
+    for (long i = 0; i < n; i++) {
+        long delay = 1 + rand_r(&seed) % MAX_DELAY_MS;
+        ev_timer_init(&timers[i].timer, on_timer, &timers[i]);
+        timers[i].due = GetTime() + delay / 1000.0;
+        ev_timer_start(&loop, &timers[i].timer, delay);
+    }
+    double started = GetTime() - start;
+
+    start = GetTime();
+    long stopped = 0;
+    for (long i = 0; i < n; i += 4) {
+        ev_timer_stop(&loop, &timers[i].timer);
+        stopped++;
+    }
+    double stop_s = GetTime() - start;
+
+    start = run_start = GetTime();
+    ev_loop_run(&loop);
+    double run_s = GetTime() - start;
+
+    int ok = early == 0;
+    for (long i = 0; i < n; i++) {
+        ok &= timers[i].fired == (i % 4 == 0 ? 0 : 1);
+    }
+    long fired = n - stopped;
+    row("start", n, started, "ns/start", 1e9 * started / n, ok);
+    row("stop", stopped, stop_s, "ns/stop", 1e9 * stop_s / stopped, ok);
+    row("fire", fired, run_s, "ms late (avg)", 1e3 * sum_late / measured, ok);
+    printf("%-8s %10s %9s %14s %14.1f %-14s\n", "", "", "", "", 1e3 * max_late,
+           "ms late (max)");
+    printf("%-8s %10s %9s %14s %14lu %-14s\n", "", "", "", "", loop.iterations,
+           "loop wakeups");
+    ev_loop_destroy(&loop);
+    free(timers);
+    return ok;
+}
+
+/*
+ * File Descriptors
+ * ================
+ */
+
+typedef struct {
+    ev_io_t io;
+    int read_fd;
+    int next_write_fd;
+} ring_pipe_t;
+
+static long fd_events;
+static int fd_lost;
+
+static void on_readable(ev_loop_t *loop, ev_io_t *io, uint32_t revents) {
+    (void)loop;
+    (void)revents;
+    ring_pipe_t *p = (ring_pipe_t *)io->arg;
+    char token;
+    if (read(p->read_fd, &token, 1) != 1 || write(p->next_write_fd, &token, 1) != 1) {
+        fd_lost = 1;
+    }
+    fd_events++;
+}
+
+static void on_fd_deadline(ev_loop_t *loop, ev_timer_t *t) {
+    (void)t;
+    ev_loop_stop(loop);
+}
+
+static int fd_test(void) {
+    ring_pipe_t *ring = calloc(RING_PIPES, sizeof(ring_pipe_t));
+    int (*fds)[2] = calloc(RING_PIPES, sizeof(*fds));
+    ev_loop_t loop;
+    ev_timer_t deadline;
+
+    ev_loop_init(&loop);
+    for (int i = 0; i < RING_PIPES; i++) {
+        if (pipe2(fds[i], O_NONBLOCK | O_CLOEXEC) != 0) {
+            printf("%-8s (pipe2 failed: raise the open file limit)\n", "fd");
+            return 0;
+        }
+    }
+    for (int i = 0; i < RING_PIPES; i++) {
+        ring[i].read_fd = fds[i][0];
+        ring[i].next_write_fd = fds[(i + 1) % RING_PIPES][1];
+        ev_io_start(&loop, &ring[i].io, fds[i][0], EPOLLIN, on_readable, &ring[i]);
+    }
+    // Tokens spread evenly around the ring
+    for (int t = 0; t < TOKENS; t++) {
+        if (write(fds[t * (RING_PIPES / TOKENS)][1], "x", 1) != 1) {
+            fd_lost = 1;
+        }
+    }
+
+    ev_timer_init(&deadline, on_fd_deadline, NULL);
+    ev_timer_start(&loop, &deadline, (uint64_t)(FD_SECONDS * 1000));
+    double start = GetTime();
+    ev_loop_run(&loop);
+    double elapsed = GetTime() - start;
+
+    // Every token must still be somewhere in the ring
+    int tokens = 0;
+    char buf[64];
+    ssize_t got;
+    for (int i = 0; i < RING_PIPES; i++) {
+        ev_io_stop(&loop, &ring[i].io);
+        while ((got = read(fds[i][0], buf, sizeof(buf))) > 0) {
+            tokens += (int)got;
+        }
+    }
+    int ok = !fd_lost && tokens == TOKENS;
+    row("fd", fd_events, elapsed, "events/wakeup",
+        (double)fd_events / loop.iterations, ok);
+
+    for (int i = 0; i < RING_PIPES; i++) {
+        close(fds[i][0]);
+        close(fds[i][1]);
+    }
+    ev_loop_destroy(&loop);
+    free(fds);
+    free(ring);
+    return ok;
+}
+
+/*
+ * Cross-Thread Posts
+ * ==================
+ */
+
+typedef struct {
+    ev_loop_t *loop;
+    long posts;
+    ev_work_t *work;
+} poster_t;
+
+static long posts_done;
+
+static void on_post(ev_loop_t *loop, ev_work_t *w) {
+    (void)w;
+    posts_done++;
+    ev_loop_unref(loop);
+}
+
+static void *poster(void *arg) {
+    poster_t *p = (poster_t *)arg;
+    for (long i = 0; i < p->posts; i++) {
+        ev_work_init(&p->work[i], on_post, NULL);
+        ev_post(p->loop, &p->work[i]);
+    }
+    return NULL;
+}
+
+static int post_test(long posts) {
+    ev_loop_t loop;
+    pthread_t threads[POSTERS];
+    poster_t p[POSTERS];
+
+    ev_loop_init(&loop);
+    loop.refs = POSTERS * posts;     // One reference per expected post
+    double start = GetTime();
+    for (int i = 0; i < POSTERS; i++) {
+        p[i] = (poster_t){ &loop, posts, malloc(posts * sizeof(ev_work_t)) };
+        pthread_create(&threads[i], NULL, poster, &p[i]);
+    }
+    ev_loop_run(&loop);
+    double elapsed = GetTime() - start;
+    for (int i = 0; i < POSTERS; i++) {
+        pthread_join(threads[i], NULL);
+        free(p[i].work);
+    }
+    row("post", posts_done, elapsed, "posts/wakeup", (double)posts_done / loop.iterations,
+        posts_done == POSTERS * posts);
+    ev_loop_destroy(&loop);
+    return posts_done == POSTERS * posts;
+}
+
+/*
+ * Signals
+ * =======
+ */
+
+static long signals_seen;
+
+static void on_signal(ev_loop_t *loop, ev_signal_t *s, const struct signalfd_siginfo *info) {
+    (void)info;
+    if (++signals_seen == SIGNALS) {
+        ev_signal_stop(loop, s);
+    } else {
+        kill(getpid(), SIGUSR1);
+    }
+}
+
+static int signal_test(void) {
+    ev_loop_t loop;
+    ev_signal_t usr1;
+
+    ev_loop_init(&loop);
+    ev_signal_start(&loop, &usr1, SIGUSR1, on_signal, NULL);
+    double start = GetTime();
+    kill(getpid(), SIGUSR1);
+    ev_loop_run(&loop);
+    double elapsed = GetTime() - start;
+    row("signal", signals_seen, elapsed, "us/signal", 1e6 * elapsed / signals_seen,
+        signals_seen == SIGNALS);
+    ev_loop_destroy(&loop);
+    return signals_seen == SIGNALS;
+}
+
+int main(int argc, char *argv[]) {
+    long timers = argc > 1 ? atol(argv[1]) : 1000000;
+    long posts = argc > 2 ? atol(argv[2]) : 250000;
+    int ok = 1;
+
+    if (timers < 4 || posts < 1) {
+        fprintf(stderr, "Usage: %s [timers] [posts per thread]\n", argv[0]);
+        return 1;
+    }
+
+    printf("Event loop: %ld timers (1-%d ms), %d-pipe ring with %d tokens, "
+           "%d posting threads\n\n", timers, MAX_DELAY_MS, RING_PIPES, TOKENS, POSTERS);
+    printf("%-8s %10s %9s %14s %14s %-14s %s\n",
+           "test", "events", "seconds", "events/s", "", "", "check");
+    ok &= timer_test(timers);
+    ok &= fd_test();
+    ok &= post_test(posts);
+    ok &= signal_test();
+    return ok ? 0 : 1;
+}
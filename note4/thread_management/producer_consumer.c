@@ -1,42 +1,60 @@
+#define _GNU_SOURCE
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <time.h>
 #include <unistd.h>
+#include <sys/resource.h>
 
-#define BUFFER_SIZE 5
+#include "../../common.h"
+#include "../../bounded_queue.h"
+
+#define BUFFER_SIZE 5       // Rounded up to 8 by bounded_queue_init()
 #define NUM_ITEMS 10
 
-// Shared buffer
+/*
+ * Object handoff benchmark: ./producer_consumer handoff [items] [object_size]
+ *
+ * Producers pass heap objects (a header plus payload) to consumers:
+ *
+ *   malloc    producer malloc()s each object, consumer free()s it - a
+ *             cross-thread free for every item
+ *   recycled  bounded_handoff_t: objects come from a preallocated pool
+ *             and consumers return them through the recycle queue
+ *
+ * The producer writes the whole object and the consumer reads one word
+ * per cache line, so both modes touch the same memory. `mallocs/item`
+ * counts the benchmark's own malloc() calls; `faults/kitem` is minor
+ * page faults (getrusage) per 1000 items, which shows whether freed
+ * memory is being handed back to the kernel and faulted in again.
+ */
+#define HANDOFF_QUEUE 256
+#define MAX_PAIRS 4
+
 typedef struct {
-    int buffer[BUFFER_SIZE];
-    int count;
-    int in;
-    int out;
-    pthread_mutex_t mutex;
-    pthread_cond_t not_full;
-    pthread_cond_t not_empty;
-} buffer_t;
-
-// Initialize buffer
-void buffer_init(buffer_t *buffer) {
-    buffer->count = 0;
-    buffer->in = 0;
-    buffer->out = 0;
-    pthread_mutex_init(&buffer->mutex, NULL);
-    pthread_cond_init(&buffer->not_full, NULL);
-    pthread_cond_init(&buffer->not_empty, NULL);
-}
+    long seq;
+    size_t size;
+    unsigned char payload[];
+} object_t;
 
-// Clean up buffer resources
-void buffer_destroy(buffer_t *buffer) {
-    pthread_mutex_destroy(&buffer->mutex);
-    pthread_cond_destroy(&buffer->not_full);
-    pthread_cond_destroy(&buffer->not_empty);
-}
+typedef enum { HANDOFF_MALLOC, HANDOFF_RECYCLED } handoff_mode_t;
+
+static const char *handoff_names[] = { "malloc", "recycled" };
+
+typedef struct {
+    handoff_mode_t mode;
+    bounded_handoff_t *handoff;
+    long items;                 // Items this thread sends or receives
+    size_t payload;
+    unsigned long mallocs;
+    unsigned long sum;          // Consumers: sum of sequence numbers
+    int errors;
+} handoff_thread_t;
 
 // Producer thread function
 void *producer(void *arg) {
-    buffer_t *buffer = (buffer_t*)arg;
+    bounded_queue_t *buffer = (bounded_queue_t*)arg;
     
     for (int i = 0; i < NUM_ITEMS; i++) {
         // Simulate production time
@@ -45,27 +63,13 @@ void *producer(void *arg) {
         // Produce item
         int item = i + 1;
         
-        // Acquire lock
-        pthread_mutex_lock(&buffer->mutex);
-        
-        // Wait if buffer is full
-        while (buffer->count == BUFFER_SIZE) {
+        // Add item to buffer, waiting if it is full
+        if (bounded_queue_try_put(buffer, &item) == EAGAIN) {
             printf("Producer: Buffer full, waiting...\n");
-            pthread_cond_wait(&buffer->not_full, &buffer->mutex);
+            bounded_queue_put(buffer, &item);
         }
         
-        // Add item to buffer
-        buffer->buffer[buffer->in] = item;
-        buffer->in = (buffer->in + 1) % BUFFER_SIZE;
-        buffer->count++;
-        
         printf("Producer: Inserted item %d into buffer\n", item);
-        
-        // Signal that buffer is not empty
-        pthread_cond_signal(&buffer->not_empty);
-        
-        // Release lock
-        pthread_mutex_unlock(&buffer->mutex);
     }
     
     printf("Producer: Finished producing all items\n");
@@ -74,31 +78,19 @@ void *producer(void *arg) {
 
 // Consumer thread function
 void *consumer(void *arg) {
-    buffer_t *buffer = (buffer_t*)arg;
+    bounded_queue_t *buffer = (bounded_queue_t*)arg;
     
     for (int i = 0; i < NUM_ITEMS; i++) {
-        // Acquire lock
-        pthread_mutex_lock(&buffer->mutex);
+        int item;
         
-        // Wait if buffer is empty
-        while (buffer->count == 0) {
+        // Remove item from buffer, waiting if it is empty
+        if (bounded_queue_try_get(buffer, &item) == EAGAIN) {
             printf("Consumer: Buffer empty, waiting...\n");
-            pthread_cond_wait(&buffer->not_empty, &buffer->mutex);
+            bounded_queue_get(buffer, &item);
         }
         
-        // Remove item from buffer
-        int item = buffer->buffer[buffer->out];
-        buffer->out = (buffer->out + 1) % BUFFER_SIZE;
-        buffer->count--;
-        
         printf("Consumer: Removed item %d from buffer\n", item);
         
-        // Signal that buffer is not full
-        pthread_cond_signal(&buffer->not_full);
-        
-        // Release lock
-        pthread_mutex_unlock(&buffer->mutex);
-        
         // Simulate consumption time
         usleep(rand() % 200000);
     }
@@ -107,15 +99,146 @@ void *consumer(void *arg) {
     return NULL;
 }
 
-int main() {
-    buffer_t buffer;
+static void *handoff_producer(void *arg) {
+    handoff_thread_t *t = (handoff_thread_t *)arg;
+    bounded_handoff_t *h = t->handoff;
+
+    for (long i = 0; i < t->items; i++) {
+        object_t *obj;
+        if (t->mode == HANDOFF_MALLOC) {
+            obj = malloc(sizeof(object_t) + t->payload);
+            t->mallocs++;
+        } else {
+            obj = bounded_handoff_acquire(h);
+        }
+        obj->seq = i;
+        obj->size = t->payload;
+        memset(obj->payload, (unsigned char)i, t->payload);
+        bounded_handoff_send(h, obj);
+    }
+    return NULL;
+}
+
+static void *handoff_consumer(void *arg) {
+    handoff_thread_t *t = (handoff_thread_t *)arg;
+    bounded_handoff_t *h = t->handoff;
+
+    for (long i = 0; i < t->items; i++) {
+        object_t *obj = bounded_handoff_receive(h);
+        t->sum += (unsigned long)obj->seq;
+        for (size_t off = 0; off < obj->size; off += 64) {
+            if (obj->payload[off] != (unsigned char)obj->seq) {
+                t->errors++;
+            }
+        }
+        if (t->mode == HANDOFF_MALLOC) {
+            free(obj);
+        } else {
+            bounded_handoff_release(h, obj);
+        }
+    }
+    return NULL;
+}
+
+static int handoff_run(handoff_mode_t mode, int pairs, long items, size_t object_size) {
+    bounded_handoff_t h;
+    pthread_t threads[2 * MAX_PAIRS];
+    handoff_thread_t workers[2 * MAX_PAIRS];
+    long per_thread = items / pairs;
+    struct rusage before, after;
+
+    // malloc mode only uses the work queue; one pooled object suffices
+    size_t count = mode == HANDOFF_RECYCLED ? HANDOFF_QUEUE + 2 * pairs : 1;
+    if (bounded_handoff_init(&h, HANDOFF_QUEUE, count, object_size) != 0) {
+        fprintf(stderr, "Failed to allocate the object pool\n");
+        exit(1);
+    }
+    // Fault the pool in now: the table is about steady state
+    memset(h.pool, 0, h.count * h.stride);
+
+    getrusage(RUSAGE_SELF, &before);
+    double start = GetTime();
+    for (int i = 0; i < 2 * pairs; i++) {
+        workers[i] = (handoff_thread_t){ .mode = mode, .handoff = &h, .items = per_thread,
+                                         .payload = object_size - sizeof(object_t) };
+        pthread_create(&threads[i], NULL, i < pairs ? handoff_producer : handoff_consumer,
+                       &workers[i]);
+    }
+    for (int i = 0; i < 2 * pairs; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double elapsed = GetTime() - start;
+    getrusage(RUSAGE_SELF, &after);
+
+    long total = per_thread * pairs;
+    unsigned long sum = 0, mallocs = 0;
+    int errors = 0;
+    for (int i = 0; i < 2 * pairs; i++) {
+        sum += workers[i].sum;
+        mallocs += workers[i].mallocs;
+        errors += workers[i].errors;
+    }
+    // Every producer sends 0 .. per_thread-1
+    int ok = errors == 0 && sum == (unsigned long)pairs * per_thread * (per_thread - 1) / 2;
+
+    printf("%-9s %7zu %5d %12.0f %9.1f %12.2f %12.2f  %s\n", handoff_names[mode],
+           object_size, pairs, total / elapsed, 1e9 * elapsed / total,
+           (double)mallocs / total, 1000.0 * (after.ru_minflt - before.ru_minflt) / total,
+           ok ? "ok" : "MISMATCH");
+
+    bounded_handoff_destroy(&h);
+    return ok;
+}
+
+static int handoff_benchmark(int argc, char *argv[]) {
+    static const size_t sizes[] = { 64, 1024, 16384, 262144 };
+    long items = argc > 2 ? atol(argv[2]) : 1000000;
+    size_t only = argc > 3 ? (size_t)atol(argv[3]) : 0;
+    int ok = 1;
+
+    if (items < MAX_PAIRS || (argc > 3 && only < sizeof(object_t))) {
+        fprintf(stderr, "Usage: %s handoff [items] [object_size >= %zu]\n",
+                argv[0], sizeof(object_t));
+        return 1;
+    }
+
+    printf("Object handoff benchmark: %ld items, queue %d\n\n", items, HANDOFF_QUEUE);
+    printf("%-9s %7s %5s %12s %9s %12s %12s  %s\n", "mode", "size", "pairs",
+           "items/s", "ns/item", "mallocs/item", "faults/kitem", "check");
+    for (size_t s = 0; s < sizeof(sizes) / sizeof(sizes[0]); s++) {
+        size_t size = only ? only : sizes[s];
+        // Fewer items for big objects, so each row takes similar time
+        long n = size > 4096 ? items / (long)(size / 4096) : items;
+        if (n < MAX_PAIRS) {
+            n = MAX_PAIRS;
+        }
+        for (int pairs = 1; pairs <= MAX_PAIRS; pairs *= 2) {
+            ok &= handoff_run(HANDOFF_MALLOC, pairs, n, size);
+            ok &= handoff_run(HANDOFF_RECYCLED, pairs, n, size);
+        }
+        if (only) {
+            break;
+        }
+    }
+    return ok ? 0 : 1;
+}
+
+int main(int argc, char *argv[]) {
+    bounded_queue_t buffer;
     pthread_t producer_thread, consumer_thread;
     
+    if (argc > 1 && strcmp(argv[1], "handoff") == 0) {
+        return handoff_benchmark(argc, argv);
+    }
+    
     // Seed random number generator
     srand(time(NULL));
     
     // Initialize buffer
-    buffer_init(&buffer);
+    if (bounded_queue_init(&buffer, BUFFER_SIZE, sizeof(int)) != 0) {
+        fprintf(stderr, "Failed to allocate buffer\n");
+        return 1;
+    }
     
     printf("Starting producer-consumer demonstration\n");
     
@@ -128,7 +251,7 @@ int main() {
     pthread_join(consumer_thread, NULL);
     
     // Clean up
-    buffer_destroy(&buffer);
+    bounded_queue_destroy(&buffer);
     
     printf("Producer-consumer demonstration completed\n");
     return 0;
@@ -1,7 +1,367 @@
+#define _GNU_SOURCE
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
 #include <unistd.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+#include <linux/sched.h>
+
+#include "../../common.h"
+#include "../../spawner.h"
+
+/*
+ * Thread creation benchmark: ./thread_creation bench [threads]
+ *
+ * Part 1 creates and joins `threads` threads that do nothing but count
+ * themselves, in two patterns:
+ *
+ *   create+join us   one at a time: create, join, repeat (latency)
+ *   threads/s        batches of BATCH: create all, then join all
+ *                    (throughput)
+ *
+ * for several pthread attributes - stack size, guard size, detached -
+ * plus clone3() called directly with a preallocated stack and no TLS
+ * (x86-64 only), which is the kernel's part of the cost alone, and
+ * spawner.h, which reuses threads whose function has returned.
+ *
+ * Part 2 is the short-lived thread pattern: tasks of a given length,
+ * each on its own thread, BATCH at a time, with pthread_create() vs
+ * the spawner.
+ *
+ * Check: every thread ran exactly once and returned its argument + 1.
+ */
+
+#define BATCH 64
+#define DEFAULT_THREADS 5000
+#define KB 1024
+
+static long ran;                    // Threads that have run
+
+static void *count_thread(void *arg) {
+    __atomic_fetch_add(&ran, 1, __ATOMIC_RELAXED);
+    return (void *)((intptr_t)arg + 1);
+}
+
+// Detached threads signal completion through a counter and a futex
+static void *count_detached(void *arg) {
+    (void)arg;
+    __atomic_fetch_add(&ran, 1, __ATOMIC_RELEASE);
+    syscall(SYS_futex, &ran, FUTEX_WAKE_PRIVATE, 1, NULL, NULL, 0);
+    return NULL;
+}
+
+static void wait_ran(long target) {
+    long seen;
+    while ((seen = __atomic_load_n(&ran, __ATOMIC_ACQUIRE)) < target) {
+        // The futex word is the low 32 bits of `ran` (little-endian)
+        syscall(SYS_futex, &ran, FUTEX_WAIT_PRIVATE, (int)seen, NULL, NULL, 0);
+    }
+}
+
+typedef enum { SPAWN_PTHREAD, SPAWN_DETACHED, SPAWN_CLONE3, SPAWN_CACHED } spawn_kind_t;
+
+typedef struct {
+    const char *name;
+    spawn_kind_t kind;
+    size_t stack;                   // 0: default attributes
+    size_t guard;
+} spawn_config_t;
+
+/*
+ * Raw clone3()
+ * ============
+ *
+ * A thread with none of the libc setup: the child shares the parent's
+ * TLS pointer, so it may only touch plain memory and make raw system
+ * calls. CLONE_CHILD_CLEARTID makes the kernel zero `tid` and wake the
+ * futex on it when the child exits - the same mechanism pthread_join()
+ * uses.
+ */
+
+#if defined(__x86_64__) && defined(SYS_clone3)
+#define HAVE_RAW_CLONE3 1
+
+typedef struct {
+    char *stack;
+    volatile int tid;               // Cleared by the kernel at exit
+} raw_thread_t;
+
+static void raw_child(void) {
+    __atomic_fetch_add(&ran, 1, __ATOMIC_RELAXED);
+}
+
+static int raw_clone3(raw_thread_t *t, size_t stack_size) {
+    struct clone_args args;
+    memset(&args, 0, sizeof(args));
+    args.flags = CLONE_VM | CLONE_FS | CLONE_FILES | CLONE_SIGHAND | CLONE_THREAD |
+                 CLONE_SYSVSEM | CLONE_PARENT_SETTID | CLONE_CHILD_CLEARTID;
+    args.parent_tid = (uint64_t)(uintptr_t)&t->tid;
+    args.child_tid = (uint64_t)(uintptr_t)&t->tid;
+    args.stack = (uint64_t)(uintptr_t)t->stack;
+    args.stack_size = stack_size;
+
+    // The child starts on the new stack right after the syscall, so it
+    // must never return into C code: call raw_child, then exit
+    register long rax __asm__("rax") = SYS_clone3;
+    register long rdi __asm__("rdi") = (long)&args;
+    register long rsi __asm__("rsi") = sizeof(args);
+    register long r12 __asm__("r12") = (long)raw_child;
+    __asm__ volatile(
+        "syscall\n"
+        "testq %%rax, %%rax\n"
+        "jnz 1f\n"
+        "callq *%%r12\n"
+        "movl $60, %%eax\n"        // SYS_exit (this thread only)
+        "xorl %%edi, %%edi\n"
+        "syscall\n"
+        "1:\n"
+        : "+r"(rax)
+        : "r"(rdi), "r"(rsi), "r"(r12)
+        : "rcx", "r11", "memory");
+    return rax < 0 ? (int)-rax : 0;
+}
+
+static void raw_join(raw_thread_t *t) {
+    int tid;
+    while ((tid = t->tid) != 0) {
+        syscall(SYS_futex, &t->tid, FUTEX_WAIT, tid, NULL, NULL, 0);
+    }
+}
+#else
+#define HAVE_RAW_CLONE3 0
+#endif
+
+/*
+ * Part 1: Create and Join
+ * =======================
+ */
+
+typedef struct {
+    spawn_config_t *cfg;
+    pthread_attr_t attr;
+    spawner_t spawner;
+    pthread_t threads[BATCH];
+    spawner_job_t jobs[BATCH];
+#if HAVE_RAW_CLONE3
+    raw_thread_t raw[BATCH];
+#endif
+} spawn_state_t;
+
+static int spawn_setup(spawn_state_t *st, spawn_config_t *cfg) {
+    st->cfg = cfg;
+    pthread_attr_init(&st->attr);
+    if (cfg->stack != 0) {
+        pthread_attr_setstacksize(&st->attr, cfg->stack);
+        pthread_attr_setguardsize(&st->attr, cfg->guard);
+    }
+    if (cfg->kind == SPAWN_DETACHED) {
+        pthread_attr_setdetachstate(&st->attr, PTHREAD_CREATE_DETACHED);
+    }
+    if (cfg->kind == SPAWN_CACHED) {
+        return spawner_init(&st->spawner, cfg->stack, BATCH);
+    }
+#if HAVE_RAW_CLONE3
+    if (cfg->kind == SPAWN_CLONE3) {
+        for (int i = 0; i < BATCH; i++) {
+            st->raw[i].stack = mmap(NULL, cfg->stack, PROT_READ | PROT_WRITE,
+                                    MAP_PRIVATE | MAP_ANONYMOUS | MAP_STACK, -1, 0);
+            if (st->raw[i].stack == MAP_FAILED) {
+                return ENOMEM;
+            }
+        }
+    }
+#endif
+    return 0;
+}
+
+static void spawn_teardown(spawn_state_t *st) {
+    pthread_attr_destroy(&st->attr);
+    if (st->cfg->kind == SPAWN_CACHED) {
+        spawner_destroy(&st->spawner);
+    }
+#if HAVE_RAW_CLONE3
+    if (st->cfg->kind == SPAWN_CLONE3) {
+        for (int i = 0; i < BATCH; i++) {
+            munmap(st->raw[i].stack, st->cfg->stack);
+        }
+    }
+#endif
+}
+
+// Start thread @i of the batch running fn(@arg). Return: 0 or an errno
+static int spawn_one(spawn_state_t *st, int i, spawner_fn fn, intptr_t arg) {
+    switch (st->cfg->kind) {
+    case SPAWN_PTHREAD:
+        return pthread_create(&st->threads[i], &st->attr, fn, (void *)arg);
+    case SPAWN_DETACHED:
+        return pthread_create(&st->threads[i], &st->attr, count_detached, NULL);
+    case SPAWN_CACHED:
+        return spawner_spawn(&st->spawner, &st->jobs[i], fn, (void *)arg);
+    case SPAWN_CLONE3:
+#if HAVE_RAW_CLONE3
+        return raw_clone3(&st->raw[i], st->cfg->stack);
+#else
+        return ENOSYS;
+#endif
+    }
+    return EINVAL;
+}
+
+// Wait for thread @i. Return: 1 if it returned what was expected
+static int join_one(spawn_state_t *st, int i, intptr_t arg, long target) {
+    switch (st->cfg->kind) {
+    case SPAWN_PTHREAD: {
+        void *result;
+        pthread_join(st->threads[i], &result);
+        return (intptr_t)result == arg + 1;
+    }
+    case SPAWN_DETACHED:
+        wait_ran(target);
+        return 1;
+    case SPAWN_CACHED:
+        return (intptr_t)spawner_join(&st->spawner, &st->jobs[i]) == arg + 1;
+    case SPAWN_CLONE3:
+#if HAVE_RAW_CLONE3
+        raw_join(&st->raw[i]);
+#endif
+        return 1;
+    }
+    return 0;
+}
+
+static int create_run(spawn_config_t *cfg, long threads) {
+    spawn_state_t *st = calloc(1, sizeof(*st));
+    int ok = spawn_setup(st, cfg) == 0;
+
+    // One at a time
+    ran = 0;
+    double start = GetTime();
+    for (long i = 0; ok && i < threads; i++) {
+        ok = spawn_one(st, 0, count_thread, i) == 0 && join_one(st, 0, i, i + 1);
+    }
+    double latency = GetTime() - start;
+    ok &= ran == threads;
+
+    // Batches
+    ran = 0;
+    start = GetTime();
+    for (long done = 0; ok && done < threads; done += BATCH) {
+        int n = threads - done < BATCH ? (int)(threads - done) : BATCH;
+        int started = 0;
+        while (started < n && spawn_one(st, started, count_thread, done + started) == 0) {
+            started++;
+        }
+        for (int i = 0; i < started; i++) {
+            ok &= join_one(st, i, done + i, done + started);
+        }
+        ok &= started == n;
+    }
+    double batch = GetTime() - start;
+    ok &= ran == threads;
+
+    char stack[16], guard[16];
+    snprintf(stack, sizeof(stack), cfg->stack ? "%zu" : "default", cfg->stack / KB);
+    snprintf(guard, sizeof(guard), cfg->stack && cfg->kind != SPAWN_CLONE3 ? "%zu" : "-",
+             cfg->guard / KB);
+    printf("%-14s %9s %9s %15.2f %12.0f  %s\n", cfg->name, stack, guard,
+           1e6 * latency / threads, threads / batch, ok ? "ok" : "MISMATCH");
+    fflush(stdout);
+    spawn_teardown(st);
+    free(st);
+    return ok;
+}
+
+/*
+ * Part 2: Short-Lived Tasks
+ * =========================
+ */
+
+static void *timed_task(void *arg) {
+    double end = GetTime() + (double)(intptr_t)arg * 1e-9;
+    while (GetTime() < end) {
+        // Simulated work
+    }
+    __atomic_fetch_add(&ran, 1, __ATOMIC_RELAXED);
+    return (void *)((intptr_t)arg + 1);
+}
+
+// Run @tasks tasks of @work_ns each, BATCH at a time. Return: tasks/s
+static double task_run(spawn_kind_t kind, long tasks, long work_ns, int *ok) {
+    spawn_config_t cfg = { "", kind, 64 * KB, 4 * KB };
+    spawn_state_t *st = calloc(1, sizeof(*st));
+    *ok &= spawn_setup(st, &cfg) == 0;
+
+    ran = 0;
+    double start = GetTime();
+    for (long done = 0; *ok && done < tasks; done += BATCH) {
+        int n = tasks - done < BATCH ? (int)(tasks - done) : BATCH;
+        for (int i = 0; i < n; i++) {
+            *ok &= spawn_one(st, i, timed_task, work_ns) == 0;
+        }
+        for (int i = 0; i < n; i++) {
+            *ok &= join_one(st, i, work_ns, 0);
+        }
+    }
+    double elapsed = GetTime() - start;
+    *ok &= ran == tasks;
+    spawn_teardown(st);
+    free(st);
+    return tasks / elapsed;
+}
+
+static int create_benchmark(int argc, char *argv[]) {
+    long threads = argc > 2 ? atol(argv[2]) : DEFAULT_THREADS;
+    int ok = 1;
+
+    if (threads < 1) {
+        fprintf(stderr, "Usage: %s bench [threads]\n", argv[0]);
+        return 1;
+    }
+
+    spawn_config_t configs[] = {
+        { "pthread",  SPAWN_PTHREAD,  0,          0 },
+        { "pthread",  SPAWN_PTHREAD,  16 * KB,    4 * KB },
+        { "pthread",  SPAWN_PTHREAD,  64 * KB,    4 * KB },
+        { "pthread",  SPAWN_PTHREAD,  1024 * KB,  4 * KB },
+        { "pthread",  SPAWN_PTHREAD,  8192 * KB,  4 * KB },
+        { "pthread",  SPAWN_PTHREAD,  64 * KB,    0 },
+        { "pthread",  SPAWN_PTHREAD,  64 * KB,    64 * KB },
+        { "detached", SPAWN_DETACHED, 64 * KB,    4 * KB },
+        { "clone3",   SPAWN_CLONE3,   64 * KB,    0 },
+        { "spawner",  SPAWN_CACHED,   64 * KB,    4 * KB },
+    };
+
+    printf("Thread creation: %ld threads, batches of %d\n\n", threads, BATCH);
+    printf("%-14s %9s %9s %15s %12s  %s\n",
+           "mode", "stack KB", "guard KB", "create+join us", "threads/s", "check");
+    for (size_t i = 0; i < sizeof(configs) / sizeof(configs[0]); i++) {
+        if (configs[i].kind == SPAWN_CLONE3 && !HAVE_RAW_CLONE3) {
+            printf("%-14s (raw clone3 needs x86-64)\n", configs[i].name);
+            continue;
+        }
+        ok &= create_run(&configs[i], threads);
+    }
+
+    long work[] = { 0, 1000, 10000, 100000 };
+    printf("\nShort-lived tasks: %ld tasks per row, 64 KB stacks\n\n", threads);
+    printf("%-10s %16s %16s %9s  %s\n", "task us", "pthread tasks/s", "spawner tasks/s",
+           "speedup", "check");
+    for (size_t i = 0; i < sizeof(work) / sizeof(work[0]); i++) {
+        // Keep the longest tasks to about a second per row
+        long tasks = work[i] >= 100000 && threads > 5000 ? 5000 : threads;
+        int row_ok = 1;
+        double created = task_run(SPAWN_PTHREAD, tasks, work[i], &row_ok);
+        double cached = task_run(SPAWN_CACHED, tasks, work[i], &row_ok);
+        printf("%-10.0f %16.0f %16.0f %8.1fx  %s\n", work[i] / 1000.0, created, cached,
+               cached / created, row_ok ? "ok" : "MISMATCH");
+        ok &= row_ok;
+    }
+    return ok ? 0 : 1;
+}
 
 // Thread function to demonstrate basic thread creation
 void *thread_function(void *arg) {
@@ -12,10 +372,14 @@ void *thread_function(void *arg) {
     return NULL;
 }
 
-int main() {
+int main(int argc, char *argv[]) {
     pthread_t thread1, thread2;
     int id1 = 1, id2 = 2;
     
+    if (argc > 1 && strcmp(argv[1], "bench") == 0) {
+        return create_benchmark(argc, argv);
+    }
+    
     printf("Main thread: Creating threads\n");
     
     // Create two threads
@@ -1,15 +1,22 @@
+#define _GNU_SOURCE
 #include <pthread.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <unistd.h>
 
+#include "../../event_loop.h"
+#include "../../stats.h"
+
 #define NUM_THREADS 3
 #define NUM_TASKS 10
+#define TIMEOUT_MS 10000          // Give up waiting after this long
 
 // Task structure
 typedef struct {
     int task_id;
     void (*function)(int);
+    ev_loop_t *loop;              // Loop to post completion to (or NULL)
+    ev_work_t *completion;        // Posted to loop when function returns
 } task_t;
 
 // Thread pool structure
@@ -23,8 +30,14 @@ typedef struct {
     pthread_t *threads;           // Worker threads
     int num_threads;              // Number of threads
     int shutdown;                 // Shutdown flag
+    stats_registry_t stats;       // Per-worker counters (see stats.h)
 } thread_pool_t;
 
+enum { STAT_TASKS, STAT_BUSY_MS, STAT_IDLE_WAITS, NUM_STATS };
+static const char *stat_names[NUM_STATS] = { "tasks run", "busy (ms)", "waited for work" };
+
+void thread_pool_destroy(thread_pool_t *pool);
+
 // Function to be executed by the tasks
 void task_function(int id) {
     printf("Task %d started\n", id);
@@ -37,6 +50,12 @@ void task_function(int id) {
 void *worker(void *arg) {
     thread_pool_t *pool = (thread_pool_t *)arg;
     task_t task;
+    stats_slot_t *st = stats_register(&pool->stats);
+    
+    if (st == NULL) {
+        printf("Thread %lu: statistics registry full, not counting\n",
+               (unsigned long)pthread_self());
+    }
     
     while (1) {
         // Lock the queue
@@ -45,6 +64,9 @@ void *worker(void *arg) {
         // Wait if queue is empty and pool is not shutting down
         while (pool->count == 0 && !pool->shutdown) {
             printf("Thread %lu waiting for work\n", (unsigned long)pthread_self());
+            if (st != NULL) {
+                stats_add(st, STAT_IDLE_WAITS, 1);
+            }
             pthread_cond_wait(&pool->queue_not_empty, &pool->queue_lock);
         }
         
@@ -52,6 +74,9 @@ void *worker(void *arg) {
         if (pool->shutdown && pool->count == 0) {
             pthread_mutex_unlock(&pool->queue_lock);
             printf("Thread %lu exiting\n", (unsigned long)pthread_self());
+            if (st != NULL) {
+                stats_unregister(&pool->stats, st);
+            }
             pthread_exit(NULL);
         }
         
@@ -68,7 +93,20 @@ void *worker(void *arg) {
         
         // Execute the task
         printf("Thread %lu executing task %d\n", (unsigned long)pthread_self(), task.task_id);
+        uint64_t start = ev_time_ms();
         task.function(task.task_id);
+        if (st != NULL) {
+            // One group, so a snapshot never sees the task without its time
+            stats_update_begin(st);
+            stats_add(st, STAT_TASKS, 1);
+            stats_add(st, STAT_BUSY_MS, ev_time_ms() - start);
+            stats_update_end(st);
+        }
+
+        // Hand the completion back to the loop thread
+        if (task.loop != NULL) {
+            ev_post(task.loop, task.completion);
+        }
     }
     
     return NULL;
@@ -103,6 +141,7 @@ thread_pool_t *thread_pool_init(int num_threads, int queue_size) {
     pthread_mutex_init(&pool->queue_lock, NULL);
     pthread_cond_init(&pool->queue_not_empty, NULL);
     pthread_cond_init(&pool->queue_not_full, NULL);
+    stats_init(&pool->stats, stat_names, NUM_STATS);
     
     // Create worker threads
     pool->threads = (pthread_t *)malloc(sizeof(pthread_t) * num_threads);
@@ -123,8 +162,9 @@ thread_pool_t *thread_pool_init(int num_threads, int queue_size) {
     return pool;
 }
 
-// Add a task to the thread pool
-int thread_pool_add_task(thread_pool_t *pool, int task_id, void (*function)(int)) {
+// Add a task whose completion is posted to an event loop when it finishes
+int thread_pool_add_task_notify(thread_pool_t *pool, int task_id, void (*function)(int),
+                                ev_loop_t *loop, ev_work_t *completion) {
     // Lock the queue
     pthread_mutex_lock(&pool->queue_lock);
     
@@ -142,6 +182,8 @@ int thread_pool_add_task(thread_pool_t *pool, int task_id, void (*function)(int)
     // Add task to queue
     pool->task_queue[pool->tail].task_id = task_id;
     pool->task_queue[pool->tail].function = function;
+    pool->task_queue[pool->tail].loop = loop;
+    pool->task_queue[pool->tail].completion = completion;
     pool->tail = (pool->tail + 1) % pool->queue_size;
     pool->count++;
     
@@ -154,6 +196,11 @@ int thread_pool_add_task(thread_pool_t *pool, int task_id, void (*function)(int)
     return 0;
 }
 
+// Add a task to the thread pool
+int thread_pool_add_task(thread_pool_t *pool, int task_id, void (*function)(int)) {
+    return thread_pool_add_task_notify(pool, task_id, function, NULL, NULL);
+}
+
 // Destroy the thread pool
 void thread_pool_destroy(thread_pool_t *pool) {
     if (pool == NULL) {
@@ -184,13 +231,67 @@ void thread_pool_destroy(thread_pool_t *pool) {
     pthread_mutex_destroy(&pool->queue_lock);
     pthread_cond_destroy(&pool->queue_not_empty);
     pthread_cond_destroy(&pool->queue_not_full);
+    stats_destroy(&pool->stats);
     free(pool);
 }
 
+/*
+ * Completions
+ * ===========
+ * Instead of sleeping for a fixed time and hoping the tasks are done,
+ * the main thread waits in an event loop: each finished task posts its
+ * completion, a timer bounds the wait, and Ctrl-C ends it early.
+ */
+
+static int tasks_added, tasks_done;
+static ev_timer_t timeout;
+static ev_signal_t interrupt;
+
+static void finish_waiting(ev_loop_t *loop) {
+    ev_timer_stop(loop, &timeout);
+    ev_signal_stop(loop, &interrupt);
+    ev_loop_stop(loop);
+}
+
+static void on_task_done(ev_loop_t *loop, ev_work_t *work) {
+    int id = (int)(intptr_t)work->arg;
+    printf("Main thread notified: task %d done (%d/%d)\n", id, ++tasks_done, tasks_added);
+    ev_loop_unref(loop);
+    if (tasks_done == tasks_added) {
+        finish_waiting(loop);
+    }
+}
+
+static void on_timeout(ev_loop_t *loop, ev_timer_t *t) {
+    (void)t;
+    printf("Timed out with %d/%d tasks done\n", tasks_done, tasks_added);
+    finish_waiting(loop);
+}
+
+static void on_interrupt(ev_loop_t *loop, ev_signal_t *s, const struct signalfd_siginfo *info) {
+    (void)s;
+    (void)info;
+    printf("Interrupted with %d/%d tasks done\n", tasks_done, tasks_added);
+    finish_waiting(loop);
+}
+
 int main() {
+    ev_loop_t loop;
+    ev_work_t completions[NUM_TASKS];
+
     // Seed random number generator
     srand(time(NULL));
-    
+
+    // The loop blocks SIGINT; set it up before the workers exist so
+    // they inherit the mask and the signal is delivered to the signalfd
+    if (ev_loop_init(&loop) != 0) {
+        printf("Failed to initialize event loop\n");
+        return 1;
+    }
+    ev_signal_start(&loop, &interrupt, SIGINT, on_interrupt, NULL);
+    ev_timer_init(&timeout, on_timeout, NULL);
+    ev_timer_start(&loop, &timeout, TIMEOUT_MS);
+
     printf("Initializing thread pool with %d threads\n", NUM_THREADS);
     
     // Initialize thread pool
@@ -204,17 +305,34 @@ int main() {
     
     // Add tasks to the pool
     for (int i = 0; i < NUM_TASKS; i++) {
-        thread_pool_add_task(pool, i, task_function);
+        ev_work_init(&completions[i], on_task_done, (void *)(intptr_t)i);
+        ev_loop_ref(&loop);
+        if (thread_pool_add_task_notify(pool, i, task_function, &loop, &completions[i]) != 0) {
+            // No completion will come for this task
+            ev_loop_unref(&loop);
+            printf("Failed to add task %d\n", i);
+            break;
+        }
+        tasks_added++;
         printf("Added task %d to queue\n", i);
     }
     
-    // Sleep to allow tasks to be processed
-    printf("Main thread sleeping while tasks are processed\n");
-    sleep(5);
+    // Wait for the completions rather than a fixed time
+    if (tasks_added > 0) {
+        printf("Main thread waiting for task completions\n");
+        ev_loop_run(&loop);
+    }
+    
+    // The workers keep running; a snapshot does not stop them
+    uint64_t totals[NUM_STATS];
+    int workers = stats_snapshot(&pool->stats, totals);
+    printf("Thread pool statistics (%d workers):\n", workers);
+    stats_print(&pool->stats, totals);
     
     // Shutdown thread pool
     printf("Shutting down thread pool\n");
     thread_pool_destroy(pool);
+    ev_loop_destroy(&loop);
     
     printf("Thread pool demonstration completed\n");
     return 0;
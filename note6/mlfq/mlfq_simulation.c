@@ -8,6 +8,9 @@
  * 
  * This program demonstrates the MLFQ scheduling algorithm with a simulation
  * of process execution, showing how the scheduler adapts to different process types.
+ *
+ * A second scenario adds a shared resource (think: a lock) to show priority
+ * inversion in MLFQ and how priority inheritance bounds it.
  */
 
 #define MAX_PROCESSES 10
@@ -25,8 +28,19 @@ typedef struct {
     int waiting_time;       // Turnaround time - burst time
     int first_run_time;     // Time of first execution (for response time)
     int is_io_bound;        // 1 if IO bound, 0 if CPU bound
+    int uses_resource;      // 1 if the job locks the shared resource
+    int resource_at;        // CPU time used when it requests the resource
+    int resource_hold;      // CPU time it keeps the resource once acquired
+    int resource_state;     // RESOURCE_NONE / HOLDING / WAITING / DONE
+    int blocked_since;      // When it started waiting for the resource
+    int blocked_time;       // Total time spent waiting for the resource
+    int inherited_queue;    // Queue borrowed from a waiter (-1 = none)
+    int queued_level;       // Queue it currently sits in (-1 = not queued)
+    int pending_arrival;    // 1 until it (re-)arrives at arrival_time
 } Process;
 
+enum { RESOURCE_NONE, RESOURCE_HOLDING, RESOURCE_WAITING, RESOURCE_DONE };
+
 typedef struct {
     Process *processes[MAX_PROCESSES];
     int count;
@@ -38,6 +52,12 @@ int current_time = 0;
 int boost_interval = 50;    // Priority boost interval
 int last_boost_time = 0;
 
+// Shared resource (a simulated lock)
+Process *resource_owner = NULL;
+Process *resource_waiters[MAX_PROCESSES];
+int num_resource_waiters = 0;
+int priority_inheritance = 0;   // 1: holder runs at its best waiter's level
+
 void init_queues() {
     for (int i = 0; i < NUM_QUEUES; i++) {
         queues[i].count = 0;
@@ -47,11 +67,121 @@ void init_queues() {
 }
 
 void add_process_to_queue(Process *p, int queue_level) {
-    if (queues[queue_level].count < MAX_PROCESSES) {
-        queues[queue_level].processes[queues[queue_level].count++] = p;
+    // A resource holder that inherited a higher priority is queued at
+    // that level; current_queue keeps its own MLFQ level
+    int effective = queue_level;
+    if (p->inherited_queue >= 0 && p->inherited_queue < effective) {
+        effective = p->inherited_queue;
+    }
+
+    if (queues[effective].count < MAX_PROCESSES) {
+        queues[effective].processes[queues[effective].count++] = p;
         p->current_queue = queue_level;
         p->time_in_current_quantum = 0;
+        p->queued_level = effective;
+    }
+}
+
+void remove_process_from_queue(Process *p) {
+    Queue *queue = &queues[p->queued_level];
+    for (int i = 0; i < queue->count; i++) {
+        if (queue->processes[i] == p) {
+            for (int j = i; j < queue->count - 1; j++) {
+                queue->processes[j] = queue->processes[j + 1];
+            }
+            queue->count--;
+            break;
+        }
+    }
+    p->queued_level = -1;
+}
+
+// Priority inheritance: the holder borrows the best level of its waiters
+void update_inherited_priority(Process *owner) {
+    int best = -1;
+    for (int i = 0; i < num_resource_waiters; i++) {
+        int level = resource_waiters[i]->current_queue;
+        if (best == -1 || level < best) {
+            best = level;
+        }
+    }
+    if (best >= owner->current_queue) {
+        best = -1;   // Waiters are no more important than the holder
+    }
+    if (best == owner->inherited_queue) {
+        return;
+    }
+
+    owner->inherited_queue = best;
+    if (best >= 0) {
+        printf("Time %d: Process %d inherits priority=%d from a waiter\n",
+               current_time, owner->id, best);
+    }
+
+    // Re-queue a waiting holder at its new effective level
+    if (owner->queued_level >= 0) {
+        int quantum_used = owner->time_in_current_quantum;
+        remove_process_from_queue(owner);
+        add_process_to_queue(owner, owner->current_queue);
+        owner->time_in_current_quantum = quantum_used;
+    }
+}
+
+// Called when a job reaches its resource request point. Returns 1 if the
+// job blocked (the caller must pick another job), 0 if it got the resource.
+int request_resource(Process *p) {
+    if (resource_owner == NULL) {
+        resource_owner = p;
+        p->resource_state = RESOURCE_HOLDING;
+        printf("Time %d: Process %d acquires the resource\n", current_time, p->id);
+        return 0;
+    }
+
+    printf("Time %d: Process %d blocks on the resource (held by Process %d)\n",
+           current_time, p->id, resource_owner->id);
+    p->resource_state = RESOURCE_WAITING;
+    p->blocked_since = current_time;
+    resource_waiters[num_resource_waiters++] = p;
+
+    if (priority_inheritance) {
+        update_inherited_priority(resource_owner);
+    }
+    return 1;
+}
+
+// Release the resource and hand it to the highest-priority waiter
+void release_resource(Process *p) {
+    printf("Time %d: Process %d releases the resource\n", current_time, p->id);
+    p->resource_state = RESOURCE_DONE;
+    p->inherited_queue = -1;
+    resource_owner = NULL;
+
+    if (num_resource_waiters == 0) {
+        return;
+    }
+
+    int best = 0;
+    for (int i = 1; i < num_resource_waiters; i++) {
+        if (resource_waiters[i]->current_queue < resource_waiters[best]->current_queue) {
+            best = i;
+        }
+    }
+    Process *next = resource_waiters[best];
+    for (int i = best; i < num_resource_waiters - 1; i++) {
+        resource_waiters[i] = resource_waiters[i + 1];
+    }
+    num_resource_waiters--;
+
+    next->blocked_time += current_time - next->blocked_since;
+    next->resource_state = RESOURCE_HOLDING;
+    resource_owner = next;
+    printf("Time %d: Process %d acquires the resource (waited %d)\n",
+           current_time, next->id, current_time - next->blocked_since);
+
+    if (priority_inheritance) {
+        update_inherited_priority(next);
     }
+    add_process_to_queue(next, next->current_queue);
 }
 
 Process* get_next_process() {
@@ -80,6 +210,7 @@ Process* get_next_process() {
             }
             
             queues[q].count--;
+            p->queued_level = -1;
             return p;
         }
     }
@@ -99,6 +230,11 @@ void run_mlfq_simulation(Process *processes, int n) {
         processes[i].current_queue = 0;
         processes[i].time_in_current_quantum = 0;
         processes[i].first_run_time = -1;
+        processes[i].resource_state = RESOURCE_NONE;
+        processes[i].blocked_time = 0;
+        processes[i].inherited_queue = -1;
+        processes[i].queued_level = -1;
+        processes[i].pending_arrival = 1;
     }
     
     printf("\nMLFQ Simulation Start\n");
@@ -107,7 +243,10 @@ void run_mlfq_simulation(Process *processes, int n) {
     while (completed < n) {
         // Check for new arrivals
         for (int i = 0; i < n; i++) {
-            if (processes[i].arrival_time == current_time) {
+            // Time advances a whole slice at a time, so admit every job
+            // whose arrival time has passed, not just exact matches
+            if (processes[i].pending_arrival && processes[i].arrival_time <= current_time) {
+                processes[i].pending_arrival = 0;
                 printf("Time %d: Process %d arrives (burst=%d, type=%s)\n", 
                        current_time, processes[i].id, processes[i].burst_time, 
                        processes[i].is_io_bound ? "I/O-bound" : "CPU-bound");
@@ -116,8 +255,15 @@ void run_mlfq_simulation(Process *processes, int n) {
             }
         }
         
-        // Get next process to run
+        // Get next process to run, skipping jobs that block on the resource
         Process *current_proc = get_next_process();
+        while (current_proc != NULL && current_proc->uses_resource &&
+               current_proc->resource_state == RESOURCE_NONE &&
+               current_proc->burst_time - current_proc->remaining_time ==
+                   current_proc->resource_at &&
+               request_resource(current_proc)) {
+            current_proc = get_next_process();
+        }
         
         if (current_proc != NULL) {
             // Record first run time if not set
@@ -143,6 +289,20 @@ void run_mlfq_simulation(Process *processes, int n) {
                            time_slice - current_proc->time_in_current_quantum;
             }
             
+            // Stop at the points where the job requests or releases the resource
+            if (current_proc->uses_resource) {
+                int used = current_proc->burst_time - current_proc->remaining_time;
+                int event = -1;
+                if (current_proc->resource_state == RESOURCE_NONE) {
+                    event = current_proc->resource_at;
+                } else if (current_proc->resource_state == RESOURCE_HOLDING) {
+                    event = current_proc->resource_at + current_proc->resource_hold;
+                }
+                if (event > used && run_time > event - used) {
+                    run_time = event - used;
+                }
+            }
+            
             // Run the process
             printf("Time %d: Running Process %d (priority=%d, remaining=%d, quantum=%d)\n",
                    current_time, current_proc->id, q, current_proc->remaining_time, time_slice);
@@ -151,8 +311,28 @@ void run_mlfq_simulation(Process *processes, int n) {
             current_proc->remaining_time -= run_time;
             current_proc->time_in_current_quantum += run_time;
             
+            if (current_proc->resource_state == RESOURCE_HOLDING &&
+                current_proc->burst_time - current_proc->remaining_time ==
+                    current_proc->resource_at + current_proc->resource_hold) {
+                release_resource(current_proc);
+            }
+            
+            // Reached the request point: take the resource or block on it
+            int blocked = 0;
+            if (current_proc->uses_resource &&
+                current_proc->resource_state == RESOURCE_NONE &&
+                current_proc->remaining_time > 0 &&
+                current_proc->burst_time - current_proc->remaining_time ==
+                    current_proc->resource_at) {
+                blocked = request_resource(current_proc);
+            }
+            
+            // Blocked jobs wait on the resource, not in a queue
+            if (blocked) {
+                current_proc->time_in_current_quantum = 0;
+            }
             // Process completed
-            if (current_proc->remaining_time == 0) {
+            else if (current_proc->remaining_time == 0) {
                 printf("Time %d: Process %d completed\n", current_time, current_proc->id);
                 current_proc->completion_time = current_time;
                 current_proc->turnaround_time = current_proc->completion_time - 
@@ -171,6 +351,7 @@ void run_mlfq_simulation(Process *processes, int n) {
                 int io_time = 10; // Fixed I/O time for simulation
                 current_proc->time_in_current_quantum = 0; // Reset time in quantum
                 current_proc->arrival_time = current_time + io_time; // Will "re-arrive" after I/O
+                current_proc->pending_arrival = 1;
                 
             }
             // Process used its full quantum (Rule 4a)
@@ -188,7 +369,9 @@ void run_mlfq_simulation(Process *processes, int n) {
             else {
                 printf("Time %d: Process %d returned to queue (priority=%d)\n", 
                        current_time, current_proc->id, q);
+                int quantum_used = current_proc->time_in_current_quantum;
                 add_process_to_queue(current_proc, q);
+                current_proc->time_in_current_quantum = quantum_used;
             }
         }
         // No process available to run
@@ -198,7 +381,7 @@ void run_mlfq_simulation(Process *processes, int n) {
             // Find next arrival time
             int next_arrival = -1;
             for (int i = 0; i < n; i++) {
-                if (processes[i].remaining_time > 0 && 
+                if (processes[i].remaining_time > 0 && processes[i].pending_arrival &&
                     processes[i].arrival_time > current_time) {
                     if (next_arrival == -1 || processes[i].arrival_time < next_arrival) {
                         next_arrival = processes[i].arrival_time;
@@ -281,15 +464,60 @@ void print_results(Process *processes, int n) {
     printf("CPU-bound Average Response Time: %.2f\n", avg_response_cpu);
 }
 
+void reset_simulation() {
+    current_time = 0;
+    last_boost_time = 0;
+    resource_owner = NULL;
+    num_resource_waiters = 0;
+}
+
+/*
+ * Priority inversion scenario
+ *
+ * P1 is a long CPU-bound job that takes the resource after 15 units of CPU
+ * and holds it for 30 more, during which it is demoted. P2 is a short,
+ * high-priority job that needs the resource almost immediately. P3-P5
+ * are CPU-bound jobs that never touch the resource but, being newer, sit
+ * in higher queues than P1 - so without inheritance they run while P2
+ * waits for P1.
+ */
+int run_inversion_scenario(int inheritance) {
+    Process processes[] = {
+        // Fields not listed start at zero; run_mlfq_simulation() sets the rest
+        {.id = 1, .arrival_time = 0, .burst_time = 60, .first_run_time = -1,
+         .uses_resource = 1, .resource_at = 15, .resource_hold = 30},   // Low: holds the resource
+        {.id = 2, .arrival_time = 20, .burst_time = 10, .first_run_time = -1,
+         .uses_resource = 1, .resource_at = 2, .resource_hold = 3},     // High: needs it briefly
+        {.id = 3, .arrival_time = 20, .burst_time = 80, .first_run_time = -1},  // Medium: CPU-bound
+        {.id = 4, .arrival_time = 20, .burst_time = 80, .first_run_time = -1},  // Medium: CPU-bound
+        {.id = 5, .arrival_time = 20, .burst_time = 80, .first_run_time = -1},  // Medium: CPU-bound
+    };
+    int n = sizeof(processes) / sizeof(processes[0]);
+
+    printf("\n\nPriority Inversion Scenario (priority inheritance %s)\n",
+           inheritance ? "ON" : "OFF");
+    printf("=========================================================\n");
+
+    reset_simulation();
+    priority_inheritance = inheritance;
+    run_mlfq_simulation(processes, n);
+
+    Process *high = &processes[1];
+    printf("\nHigh-priority job P2: blocked %d, turnaround %d (burst %d)\n",
+           high->blocked_time, high->turnaround_time, high->burst_time);
+    return high->turnaround_time;
+}
+
 int main() {
     // Sample processes for MLFQ demonstration
     Process processes[] = {
-        // id, arrival, burst, remaining, queue, quantum_time, completion, turnaround, waiting, first_run, io_bound
-        {1, 0, 100, 0, 0, 0, 0, 0, 0, -1, 0},  // Long CPU-bound process
-        {2, 0, 5, 0, 0, 0, 0, 0, 0, -1, 1},    // Short I/O-bound process
-        {3, 0, 5, 0, 0, 0, 0, 0, 0, -1, 1},    // Short I/O-bound process
-        {4, 10, 80, 0, 0, 0, 0, 0, 0, -1, 0},  // Another CPU-bound process
-        {5, 20, 15, 0, 0, 0, 0, 0, 0, -1, 1}   // Medium I/O-bound process
+        // Fields not listed start at zero (the resource fields are only used by
+        // the priority inversion scenario below)
+        {.id = 1, .arrival_time = 0, .burst_time = 100, .first_run_time = -1},  // Long CPU-bound process
+        {.id = 2, .arrival_time = 0, .burst_time = 5, .first_run_time = -1, .is_io_bound = 1},   // Short I/O-bound process
+        {.id = 3, .arrival_time = 0, .burst_time = 5, .first_run_time = -1, .is_io_bound = 1},   // Short I/O-bound process
+        {.id = 4, .arrival_time = 10, .burst_time = 80, .first_run_time = -1},  // Another CPU-bound process
+        {.id = 5, .arrival_time = 20, .burst_time = 15, .first_run_time = -1, .is_io_bound = 1}  // Medium I/O-bound process
     };
     
     int n = sizeof(processes) / sizeof(processes[0]);
@@ -320,5 +548,14 @@ int main() {
     printf("3. Priority boost prevents starvation of lower-priority processes\n");
     printf("4. I/O-bound processes have better response time than CPU-bound processes\n");
     
+    int without_pi = run_inversion_scenario(0);
+    int with_pi = run_inversion_scenario(1);
+    
+    printf("\nPriority inversion summary:\n");
+    printf("High-priority turnaround without inheritance: %d\n", without_pi);
+    printf("High-priority turnaround with inheritance:    %d\n", with_pi);
+    printf("Inheritance lets the holder run at the waiter's priority, so medium\n");
+    printf("jobs can no longer delay the high-priority job indefinitely.\n");
+    
     return 0;
 }
\ No newline at end of file
@@ -1,3 +1,4 @@
+# define _GNU_SOURCE
 # include <stdio.h>
 # include <stdlib.h>
 # include <pthread.h>
@@ -20,6 +21,7 @@ int resource_B = 200;
 
 // Thread function that acquires locks in order A->B (can deadlock)
 void *thread_1_function(void *arg) {
+    (void)arg;
     printf("Thread 1: Trying to acquire mutex A\n");
     pthread_mutex_lock(&mutex_A);
     printf("Thread 1: Acquired mutex A\n");
@@ -50,6 +52,7 @@ void *thread_1_function(void *arg) {
 
 // Thread function that acquires locks in order B->A (can deadlock)
 void *thread_2_function(void *arg) {
+    (void)arg;
     printf("Thread 2: Trying to acquire mutex B\n");
     pthread_mutex_lock(&mutex_B);
     printf("Thread 2: Acquired mutex B\n");
@@ -80,6 +83,7 @@ void *thread_2_function(void *arg) {
 
 // Thread function that acquires locks in consistent order A->B (no deadlock)
 void *thread_2_safe_function(void *arg) {
+    (void)arg;
     printf("Thread 2 (safe): Trying to acquire mutex A\n");
     pthread_mutex_lock(&mutex_A);
     printf("Thread 2 (safe): Acquired mutex A\n");
@@ -110,6 +114,7 @@ void *thread_2_safe_function(void *arg) {
 
 // Thread function using trylock to avoid deadlock
 void *thread_2_trylock_function(void *arg) {
+    (void)arg;
     int got_both_locks = 0;
     
     while (!got_both_locks) {
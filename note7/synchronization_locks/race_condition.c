@@ -3,6 +3,8 @@
 # include <pthread.h>
 # include <unistd.h>
 
+# include "../../locks.h"
+
 /*
  * race_condition.c - Demonstrates race conditions and mutex-based solutions
  * 
@@ -49,27 +51,9 @@ void *increment_with_lock(void *arg) {
     return NULL;
 }
 
-// Function to demonstrate the spinlock implementation
-typedef struct {
-    volatile int flag;
-} spinlock_t;
-
-void spinlock_init(spinlock_t *lock) {
-    lock->flag = 0;
-}
-
-void spinlock_lock(spinlock_t *lock) {
-    while (__sync_lock_test_and_set(&lock->flag, 1)) {
-        // Spin waiting for the lock
-        while (lock->flag) {
-            // CPU hint to reduce contention (would be PAUSE instruction on x86)
-        }
-    }
-}
-
-void spinlock_unlock(spinlock_t *lock) {
-    __sync_lock_release(&lock->flag);
-}
+// Spinlock and ticket lock implementations are shared with the note8
+// demos through locks.h (spinlock_t: test-and-test-and-set with a PAUSE
+// hint; ticket_lock_t: FIFO fetch-and-add ticket lock)
 
 // Global spinlock
 spinlock_t spin_lock;
@@ -89,29 +73,6 @@ void *increment_with_spinlock(void *arg) {
     return NULL;
 }
 
-// Function to demonstrate the ticket lock implementation
-typedef struct {
-    volatile unsigned int ticket;
-    volatile unsigned int serving;
-} ticket_lock_t;
-
-void ticket_lock_init(ticket_lock_t *lock) {
-    lock->ticket = 0;
-    lock->serving = 0;
-}
-
-void ticket_lock_lock(ticket_lock_t *lock) {
-    unsigned int my_ticket = __sync_fetch_and_add(&lock->ticket, 1);
-    
-    while (lock->serving != my_ticket) {
-        // Spin waiting for my turn
-    }
-}
-
-void ticket_lock_unlock(ticket_lock_t *lock) {
-    __sync_fetch_and_add(&lock->serving, 1);
-}
-
 // Global ticket lock
 ticket_lock_t ticket_lock;
 
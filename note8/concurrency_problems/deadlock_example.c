@@ -3,114 +3,155 @@
 #include <pthread.h>
 #include <unistd.h>
 
+#include "../../locks.h"
+#include "../../stats.h"
+
 /*
  * This example demonstrates how deadlocks can occur and how to prevent them
  * by using a consistent lock ordering strategy.
+ *
+ * The two locks are the generic lock_t from locks.h (a pthread mutex
+ * unless built with `make LOCK_IMPL=SPINLOCK` or `make LOCK_IMPL=TICKET`).
  */
 
-// Two mutex locks
-pthread_mutex_t mutex_A = PTHREAD_MUTEX_INITIALIZER;
-pthread_mutex_t mutex_B = PTHREAD_MUTEX_INITIALIZER;
+// Two locks
+lock_t mutex_A = LOCK_INITIALIZER;
+lock_t mutex_B = LOCK_INITIALIZER;
 
 // Global counters
 int counter1 = 0;
 int counter2 = 0;
 
+// Per-thread statistics, summed in main() (see stats.h)
+enum { STAT_CRITICAL, STAT_RETRIES, NUM_STATS };
+static const char *stat_names[NUM_STATS] = { "critical sections", "trylock retries" };
+stats_registry_t stats;
+
 // Thread that acquires locks in order A->B
 void* thread_function_1(void* arg) {
+    (void)arg;
     int iterations = 10000;
+    stats_slot_t *st = stats_register(&stats);
+    if (st == NULL) {
+        fprintf(stderr, "Thread 1: statistics registry full, not starting\n");
+        return NULL;
+    }
     
     printf("Thread 1 starting: will acquire locks in order A->B\n");
     
     for (int i = 0; i < iterations; i++) {
         // Acquire locks in order: mutex_A first, then mutex_B
-        pthread_mutex_lock(&mutex_A);
+        lock_acquire(&mutex_A);
         printf("Thread 1 acquired mutex A\n");
         
         // Simulate some work
         usleep(10);
         
-        pthread_mutex_lock(&mutex_B);
+        lock_acquire(&mutex_B);
         printf("Thread 1 acquired mutex B\n");
         
         // Critical section protected by both locks
         counter1++;
         counter2++;
+        stats_add(st, STAT_CRITICAL, 1);
         
         // Release locks in reverse order (best practice)
-        pthread_mutex_unlock(&mutex_B);
-        pthread_mutex_unlock(&mutex_A);
+        lock_release(&mutex_B);
+        lock_release(&mutex_A);
     }
     
+    stats_unregister(&stats, st);
     printf("Thread 1 completed\n");
     return NULL;
 }
 
 // Thread that acquires locks in order B->A (can cause deadlock)
 void* thread_function_2_deadlock(void* arg) {
+    (void)arg;
     int iterations = 10000;
+    stats_slot_t *st = stats_register(&stats);
+    if (st == NULL) {
+        fprintf(stderr, "Thread 2: statistics registry full, not starting\n");
+        return NULL;
+    }
     
     printf("Thread 2 starting: will acquire locks in order B->A (potential deadlock)\n");
     
     for (int i = 0; i < iterations; i++) {
         // Acquire locks in different order: mutex_B first, then mutex_A
-        pthread_mutex_lock(&mutex_B);
+        lock_acquire(&mutex_B);
         printf("Thread 2 acquired mutex B\n");
         
         // Simulate some work
         usleep(10);
         
-        pthread_mutex_lock(&mutex_A);
+        lock_acquire(&mutex_A);
         printf("Thread 2 acquired mutex A\n");
         
         // Critical section protected by both locks
         counter1++;
         counter2++;
+        stats_add(st, STAT_CRITICAL, 1);
         
         // Release locks in reverse order (best practice)
-        pthread_mutex_unlock(&mutex_A);
-        pthread_mutex_unlock(&mutex_B);
+        lock_release(&mutex_A);
+        lock_release(&mutex_B);
     }
     
+    stats_unregister(&stats, st);
     printf("Thread 2 completed\n");
     return NULL;
 }
 
 // Thread that acquires locks in the same order as thread_function_1 (no deadlock)
 void* thread_function_2_safe(void* arg) {
+    (void)arg;
     int iterations = 10000;
+    stats_slot_t *st = stats_register(&stats);
+    if (st == NULL) {
+        fprintf(stderr, "Thread 2: statistics registry full, not starting\n");
+        return NULL;
+    }
     
     printf("Thread 2 starting: will acquire locks in order A->B (consistent ordering)\n");
     
     for (int i = 0; i < iterations; i++) {
         // Acquire locks in the SAME order as thread_function_1: mutex_A first, then mutex_B
-        pthread_mutex_lock(&mutex_A);
+        lock_acquire(&mutex_A);
         printf("Thread 2 acquired mutex A\n");
         
         // Simulate some work
         usleep(10);
         
-        pthread_mutex_lock(&mutex_B);
+        lock_acquire(&mutex_B);
         printf("Thread 2 acquired mutex B\n");
         
         // Critical section protected by both locks
         counter1++;
         counter2++;
+        stats_add(st, STAT_CRITICAL, 1);
         
         // Release locks in reverse order (best practice)
-        pthread_mutex_unlock(&mutex_B);
-        pthread_mutex_unlock(&mutex_A);
+        lock_release(&mutex_B);
+        lock_release(&mutex_A);
     }
     
+    stats_unregister(&stats, st);
     printf("Thread 2 completed\n");
     return NULL;
 }
 
 // Demonstrate deadlock prevention using trylock with timeout and backoff
 void* thread_function_2_trylock(void* arg) {
+    (void)arg;
     int iterations = 10000;
     int success = 0;
     int failures = 0;
+    stats_slot_t *st = stats_register(&stats);
+    if (st == NULL) {
+        fprintf(stderr, "Thread 2: statistics registry full, not starting\n");
+        return NULL;
+    }
     
     printf("Thread 2 starting: will use trylock with backoff strategy\n");
     
@@ -119,9 +160,9 @@ void* thread_function_2_trylock(void* arg) {
         
         while (!acquired_all) {
             // Try to acquire mutex_B first
-            if (pthread_mutex_trylock(&mutex_B) == 0) {
+            if (lock_tryacquire(&mutex_B)) {
                 // Got mutex_B, now try mutex_A
-                if (pthread_mutex_trylock(&mutex_A) == 0) {
+                if (lock_tryacquire(&mutex_A)) {
                     // Success - we have both locks
                     acquired_all = 1;
                     success++;
@@ -129,14 +170,16 @@ void* thread_function_2_trylock(void* arg) {
                     // Critical section protected by both locks
                     counter1++;
                     counter2++;
+                    stats_add(st, STAT_CRITICAL, 1);
                     
                     // Release locks
-                    pthread_mutex_unlock(&mutex_A);
-                    pthread_mutex_unlock(&mutex_B);
+                    lock_release(&mutex_A);
+                    lock_release(&mutex_B);
                 } else {
                     // Failed to get mutex_A, release mutex_B and retry
-                    pthread_mutex_unlock(&mutex_B);
+                    lock_release(&mutex_B);
                     failures++;
+                    stats_add(st, STAT_RETRIES, 1);
                     
                     // Random backoff to reduce contention
                     usleep(rand() % 1000);
@@ -144,6 +187,7 @@ void* thread_function_2_trylock(void* arg) {
             } else {
                 // Failed to get mutex_B, try again
                 failures++;
+                stats_add(st, STAT_RETRIES, 1);
                 
                 // Random backoff to reduce contention
                 usleep(rand() % 1000);
@@ -151,6 +195,7 @@ void* thread_function_2_trylock(void* arg) {
         }
     }
     
+    stats_unregister(&stats, st);
     printf("Thread 2 completed: %d successes, %d failures/retries\n", 
            success, failures);
     return NULL;
@@ -170,6 +215,7 @@ int main() {
     // Reset counters
     counter1 = 0;
     counter2 = 0;
+    stats_init(&stats, stat_names, NUM_STATS);
     
     // Create thread 1
     pthread_create(&thread1, NULL, thread_function_1, NULL);
@@ -198,9 +244,15 @@ int main() {
     
     printf("\nFinal counter values: counter1=%d, counter2=%d\n", counter1, counter2);
     
+    uint64_t totals[NUM_STATS];
+    stats_snapshot(&stats, totals);
+    printf("Statistics from both threads:\n");
+    stats_print(&stats, totals);
+    
     // Cleanup
-    pthread_mutex_destroy(&mutex_A);
-    pthread_mutex_destroy(&mutex_B);
+    lock_destroy(&mutex_A);
+    lock_destroy(&mutex_B);
+    stats_destroy(&stats);
     
     return 0;
 }
\ No newline at end of file
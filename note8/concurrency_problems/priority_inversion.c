@@ -0,0 +1,222 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <time.h>
+
+#include "../../common.h"
+#include "../../locks.h"
+#include "../../precise_wait.h"
+
+/*
+ * priority_inversion.c - High-priority latency with and without inheritance
+ *
+ * Three SCHED_FIFO threads share one CPU:
+ *
+ *   L (low)    takes the mutex and computes for HOLD_MS inside it
+ *   H (high)   wakes up shortly after and needs the same mutex
+ *   M (medium) wakes up after H has blocked and computes for MEDIUM_MS,
+ *              never touching the mutex
+ *
+ * With a plain mutex M preempts L, so H waits for L's critical section
+ * *and* all of M's work: unbounded priority inversion. With
+ * PTHREAD_PRIO_INHERIT (L borrows H's priority) or PTHREAD_PRIO_PROTECT
+ * (L runs at the ceiling priority) H waits for one critical section.
+ *
+ * Real-time scheduling needs CAP_SYS_NICE (or root); without it the
+ * program says so and exits.
+ *
+ * Usage: ./priority_inversion [rounds]
+ */
+
+#define PRIO_LOW    10
+#define PRIO_MEDIUM 20
+#define PRIO_HIGH   30
+
+#define HOLD_MS     20      // L's critical section
+#define MEDIUM_MS   100     // M's CPU burst
+#define H_DELAY_MS  2       // H wakes this long after L takes the lock
+#define M_DELAY_MS  4       // M wakes this long after L takes the lock
+
+static pthread_mutex_t resource;
+static volatile int go;                  // Set once all three threads exist
+static volatile double l_acquired_at;    // When L got the mutex
+static double h_latency;                 // H: intended request -> acquire, seconds
+
+static double thread_cpu_time(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+// Burn `ms` milliseconds of this thread's CPU time without blocking.
+// CPU time, not wall time: a preempted thread still owes its work.
+static void compute_for(int ms) {
+    double end = thread_cpu_time() + ms / 1000.0;
+    while (thread_cpu_time() < end) {
+    }
+}
+
+// H and M are only 2 ms apart: usleep()'s ~60 us oversleep would
+// blur that, so sleep precisely
+static void sleep_until(double t) {
+    double delay = t - GetTime();
+    if (delay > 0) {
+        precise_sleep_ns((uint64_t)(delay * 1e9));
+    }
+}
+
+static void *low_task(void *arg) {
+    (void)arg;
+    // Sleep-wait so the (non-RT) main thread can create H and M even
+    // on a single CPU
+    while (!go) {
+        usleep(100);
+    }
+    pthread_mutex_lock(&resource);
+    l_acquired_at = GetTime();
+    compute_for(HOLD_MS);
+    pthread_mutex_unlock(&resource);
+    return NULL;
+}
+
+static void *high_task(void *arg) {
+    (void)arg;
+    while (l_acquired_at == 0.0) {
+        usleep(100);
+    }
+    // Measure from when H *wanted* the lock: under PTHREAD_PRIO_PROTECT
+    // L runs at H's priority, so H is only scheduled once L unlocks
+    double requested = l_acquired_at + H_DELAY_MS / 1000.0;
+    sleep_until(requested);
+
+    pthread_mutex_lock(&resource);
+    h_latency = GetTime() - requested;
+    pthread_mutex_unlock(&resource);
+    return NULL;
+}
+
+static void *medium_task(void *arg) {
+    (void)arg;
+    while (l_acquired_at == 0.0) {
+        usleep(100);
+    }
+    sleep_until(l_acquired_at + M_DELAY_MS / 1000.0);
+    compute_for(MEDIUM_MS);
+    return NULL;
+}
+
+// Start a SCHED_FIFO thread pinned to CPU 0
+static int start_rt_thread(pthread_t *thread, int priority, void *(*fn)(void *)) {
+    pthread_attr_t attr;
+    struct sched_param param;
+    cpu_set_t cpus;
+
+    pthread_attr_init(&attr);
+    pthread_attr_setinheritsched(&attr, PTHREAD_EXPLICIT_SCHED);
+    pthread_attr_setschedpolicy(&attr, SCHED_FIFO);
+    param.sched_priority = priority;
+    pthread_attr_setschedparam(&attr, &param);
+    CPU_ZERO(&cpus);
+    CPU_SET(0, &cpus);
+    pthread_attr_setaffinity_np(&attr, sizeof(cpus), &cpus);
+
+    int rc = pthread_create(thread, &attr, fn, NULL);
+    pthread_attr_destroy(&attr);
+    return rc;
+}
+
+// One inversion round; returns H's latency in ms, or -1 on failure
+static double run_round(priority_protocol_t protocol) {
+    pthread_t low, medium, high;
+    int rc;
+
+    rc = priority_mutex_init(&resource, protocol, PRIO_HIGH);
+    if (rc != 0) {
+        fprintf(stderr, "priority_mutex_init: %s\n", strerror(rc));
+        return -1;
+    }
+
+    l_acquired_at = 0.0;
+    h_latency = -1;
+    go = 0;
+
+    rc = start_rt_thread(&low, PRIO_LOW, low_task);
+    if (rc != 0) {
+        fprintf(stderr, "Cannot create SCHED_FIFO threads: %s\n", strerror(rc));
+        if (rc == EPERM) {
+            fprintf(stderr, "Run as root or grant CAP_SYS_NICE to measure priority inversion.\n");
+        }
+        pthread_mutex_destroy(&resource);
+        return -1;
+    }
+    int started = 1;
+    rc = start_rt_thread(&high, PRIO_HIGH, high_task);
+    if (rc == 0) {
+        started++;
+        rc = start_rt_thread(&medium, PRIO_MEDIUM, medium_task);
+        if (rc == 0) {
+            started++;
+        }
+    }
+    if (rc != 0) {
+        fprintf(stderr, "Cannot create SCHED_FIFO threads: %s\n", strerror(rc));
+    }
+    go = 1;         // Lets L (and H) finish even if the round is cut short
+
+    pthread_join(low, NULL);
+    if (started > 1) {
+        pthread_join(high, NULL);
+    }
+    if (started > 2) {
+        pthread_join(medium, NULL);
+    }
+    pthread_mutex_destroy(&resource);
+
+    return rc == 0 ? h_latency * 1000.0 : -1;
+}
+
+int main(int argc, char *argv[]) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 5;
+    struct {
+        const char *name;
+        priority_protocol_t protocol;
+    } modes[] = {
+        { "none",    PRIORITY_MUTEX_NONE },
+        { "inherit", PRIORITY_MUTEX_INHERIT },
+        { "protect", PRIORITY_MUTEX_PROTECT },
+    };
+
+    if (rounds < 1) {
+        fprintf(stderr, "Usage: %s [rounds]\n", argv[0]);
+        return 1;
+    }
+
+    printf("Priority inversion: L holds the lock %d ms, M computes %d ms, all on CPU 0\n",
+           HOLD_MS, MEDIUM_MS);
+    printf("Expected H latency: ~%d ms with a bounded protocol, ~%d ms without\n\n",
+           HOLD_MS - H_DELAY_MS, HOLD_MS - H_DELAY_MS + MEDIUM_MS);
+    printf("%-8s %10s %10s %10s\n", "protocol", "avg(ms)", "min(ms)", "max(ms)");
+
+    for (size_t m = 0; m < sizeof(modes) / sizeof(modes[0]); m++) {
+        double sum = 0, min = 1e9, max = 0;
+
+        for (int r = 0; r < rounds; r++) {
+            double latency = run_round(modes[m].protocol);
+            if (latency < 0) {
+                return 1;
+            }
+            sum += latency;
+            if (latency < min) min = latency;
+            if (latency > max) max = latency;
+        }
+
+        printf("%-8s %10.2f %10.2f %10.2f\n", modes[m].name, sum / rounds, min, max);
+    }
+
+    return 0;
+}
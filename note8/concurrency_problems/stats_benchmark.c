@@ -0,0 +1,185 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <unistd.h>
+
+#include "../../common.h"
+#include "../../stats.h"
+
+/*
+ * stats_benchmark.c - Shared counters vs the per-thread stats registry
+ *
+ * Each of T threads runs a loop that counts "requests" and the "bytes"
+ * they carried (REQUEST_BYTES per request), while a reader thread takes
+ * snapshots every SNAPSHOT_US microseconds. Counting with:
+ *
+ *   mutex       two shared counters behind one pthread mutex
+ *   atomic      two shared counters, __atomic_fetch_add each
+ *   per-thread  stats.h slots, one stats_add() per counter
+ *   grouped     stats.h slots, both adds in one update group
+ *
+ * `torn` counts snapshots where bytes != REQUEST_BYTES * requests, i.e.
+ * the reader saw a request without its bytes. Only the mutex and the
+ * grouped registry promise none. Check: final totals are exact, and
+ * mutex/grouped never tore.
+ *
+ * Usage: ./stats_benchmark [threads] [iterations per thread]
+ */
+
+#define MAX_THREADS 128
+#define REQUEST_BYTES 64
+#define SNAPSHOT_US 200
+
+enum { STAT_REQUESTS, STAT_BYTES, NUM_STATS };
+
+static const char *stat_names[NUM_STATS] = { "requests", "bytes" };
+
+typedef enum { MODE_MUTEX, MODE_ATOMIC, MODE_PER_THREAD, MODE_GROUPED } count_mode_t;
+
+static const char *mode_names[] = { "mutex", "atomic", "per-thread", "grouped" };
+
+static stats_registry_t registry;
+static pthread_mutex_t shared_mutex = PTHREAD_MUTEX_INITIALIZER;
+static uint64_t shared[NUM_STATS];
+static int running;
+
+typedef struct {
+    count_mode_t mode;
+    long iterations;
+} worker_t;
+
+typedef struct {
+    count_mode_t mode;
+    unsigned long snapshots;
+    unsigned long torn;
+} reader_t;
+
+static void *worker(void *arg) {
+    worker_t *w = (worker_t *)arg;
+    stats_slot_t *s = stats_register(&registry);
+    volatile unsigned work = 0;
+
+    for (long i = 0; i < w->iterations; i++) {
+        work += (unsigned)i;            // Stand-in for handling the request
+        switch (w->mode) {
+        case MODE_MUTEX:
+            pthread_mutex_lock(&shared_mutex);
+            shared[STAT_REQUESTS]++;
+            shared[STAT_BYTES] += REQUEST_BYTES;
+            pthread_mutex_unlock(&shared_mutex);
+            break;
+        case MODE_ATOMIC:
+            __atomic_fetch_add(&shared[STAT_REQUESTS], 1, __ATOMIC_RELAXED);
+            __atomic_fetch_add(&shared[STAT_BYTES], REQUEST_BYTES, __ATOMIC_RELAXED);
+            break;
+        case MODE_PER_THREAD:
+            stats_add(s, STAT_REQUESTS, 1);
+            stats_add(s, STAT_BYTES, REQUEST_BYTES);
+            break;
+        case MODE_GROUPED:
+            stats_update_begin(s);
+            stats_add(s, STAT_REQUESTS, 1);
+            stats_add(s, STAT_BYTES, REQUEST_BYTES);
+            stats_update_end(s);
+            break;
+        }
+    }
+    stats_unregister(&registry, s);
+    return NULL;
+}
+
+// Read the totals the way the mode's users would
+static void read_totals(count_mode_t mode, uint64_t *out) {
+    if (mode == MODE_MUTEX) {
+        pthread_mutex_lock(&shared_mutex);
+        memcpy(out, shared, sizeof(shared));
+        pthread_mutex_unlock(&shared_mutex);
+    } else if (mode == MODE_ATOMIC) {
+        out[STAT_REQUESTS] = __atomic_load_n(&shared[STAT_REQUESTS], __ATOMIC_RELAXED);
+        out[STAT_BYTES] = __atomic_load_n(&shared[STAT_BYTES], __ATOMIC_RELAXED);
+    } else {
+        stats_snapshot(&registry, out);
+    }
+}
+
+static void *reader(void *arg) {
+    reader_t *r = (reader_t *)arg;
+    uint64_t totals[NUM_STATS];
+
+    while (__atomic_load_n(&running, __ATOMIC_ACQUIRE)) {
+        read_totals(r->mode, totals);
+        r->snapshots++;
+        if (totals[STAT_BYTES] != REQUEST_BYTES * totals[STAT_REQUESTS]) {
+            r->torn++;
+        }
+        usleep(SNAPSHOT_US);
+    }
+    return NULL;
+}
+
+static int run(count_mode_t mode, int num_threads, long iterations) {
+    pthread_t threads[MAX_THREADS], reader_thread;
+    worker_t workers[MAX_THREADS];
+    reader_t r = { .mode = mode };
+    uint64_t totals[NUM_STATS];
+
+    stats_init(&registry, stat_names, NUM_STATS);
+    memset(shared, 0, sizeof(shared));
+    __atomic_store_n(&running, 1, __ATOMIC_RELEASE);
+    pthread_create(&reader_thread, NULL, reader, &r);
+
+    double start = GetTime();
+    for (int i = 0; i < num_threads; i++) {
+        workers[i] = (worker_t){ .mode = mode, .iterations = iterations };
+        pthread_create(&threads[i], NULL, worker, &workers[i]);
+    }
+    for (int i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double elapsed = GetTime() - start;
+    __atomic_store_n(&running, 0, __ATOMIC_RELEASE);
+    pthread_join(reader_thread, NULL);
+
+    read_totals(mode, totals);
+    uint64_t ops = (uint64_t)num_threads * iterations;
+    int ok = totals[STAT_REQUESTS] == ops && totals[STAT_BYTES] == ops * REQUEST_BYTES &&
+             (r.torn == 0 || mode == MODE_ATOMIC || mode == MODE_PER_THREAD);
+
+    printf("%-11s %7d %10.1f %9.2f %10lu %8lu  %s\n", mode_names[mode], num_threads,
+           ops / elapsed / 1e6, 1e9 * elapsed / ops, r.snapshots, r.torn,
+           ok ? "ok" : "MISMATCH");
+    stats_destroy(&registry);
+    return ok;
+}
+
+int main(int argc, char *argv[]) {
+    int max_threads = argc > 1 ? atoi(argv[1]) : 32;
+    long iterations = argc > 2 ? atol(argv[2]) : 1000000;
+    int ok = 1;
+
+    if (max_threads < 1 || max_threads > MAX_THREADS || iterations < 1) {
+        fprintf(stderr, "Usage: %s [threads 1-%d] [iterations per thread]\n",
+                argv[0], MAX_THREADS);
+        return 1;
+    }
+
+    printf("Statistics counters: %ld iterations per thread, snapshot every %d us\n\n",
+           iterations, SNAPSHOT_US);
+    printf("%-11s %7s %10s %9s %10s %8s  %s\n",
+           "mode", "threads", "Mops/s", "ns/op", "snapshots", "torn", "check");
+    for (int t = 1; ; t *= 2) {
+        if (t > max_threads) {
+            t = max_threads;
+        }
+        for (int m = MODE_MUTEX; m <= MODE_GROUPED; m++) {
+            ok &= run((count_mode_t)m, t, iterations);
+        }
+        if (t == max_threads) {
+            break;
+        }
+    }
+    return ok ? 0 : 1;
+}
@@ -0,0 +1,270 @@
+/*
+ * ===================================================================
+ * stm.h - A Small Word-Based Software Transactional Memory (TL2-style)
+ * ===================================================================
+ *
+ * deadlock_example.c protects `counter1++; counter2++;` with two mutexes
+ * and has to worry about lock ordering. A transactional memory lets a
+ * thread update several locations "all at once" without holding any
+ * lock while it computes: reads and writes are logged, and the whole
+ * set is validated and published at commit time.
+ *
+ * This header follows the TL2 design (Dice, Shalev, Shavit 2006):
+ *
+ * - A global version clock, advanced once per writing commit.
+ * - A table of versioned stripe locks. Every word address hashes to a
+ *   stripe; the stripe word holds (version << 1) | locked_bit.
+ * - Reads are validated on the spot against the clock value sampled at
+ *   begin, so a transaction never observes an inconsistent snapshot.
+ * - Writes are buffered in a redo log and only written back at commit,
+ *   after the write-set stripes are locked and the read set re-checked.
+ *
+ * Commit only ever *tries* stripe locks and aborts on failure, so two
+ * transactions can never wait on each other: there is no lock order to
+ * get wrong and no deadlock.
+ *
+ * Usage:
+ *
+ *     stm_tx_t tx;
+ *     stm_tx_init(&tx);               // once per descriptor
+ *     do {
+ *         stm_begin(&tx);
+ *         long a = stm_read(&tx, &counter1);
+ *         long b = stm_read(&tx, &counter2);
+ *         stm_write(&tx, &counter1, a + 1);
+ *         stm_write(&tx, &counter2, b + 1);
+ *     } while (!stm_commit(&tx));
+ *
+ * Once a read fails validation the transaction is marked aborted and
+ * every later stm_read() returns 0 without touching memory; the body
+ * keeps running to the commit call, which returns 0 so the loop retries.
+ * Values read in an aborted transaction are meaningless - never use
+ * them as pointers or array indices.
+ *
+ * Shared words must only be accessed through stm_read()/stm_write()
+ * while transactions are running. A transaction that touches more than
+ * STM_MAX_READS or STM_MAX_WRITES words can never commit, so overflowing
+ * either set is reported and the program aborted instead of retried.
+ */
+
+#ifndef __stm_h__
+#define __stm_h__
+
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <sched.h>
+
+#define STM_NUM_STRIPES   4096    // Must be a power of two
+#define STM_MAX_READS     64      // Read-set capacity per transaction
+#define STM_MAX_WRITES    32      // Write-set capacity per transaction
+
+// Global version clock and stripe lock table
+static uint64_t stm_global_clock = 0;
+static uint64_t stm_stripes[STM_NUM_STRIPES];
+
+typedef struct {
+    long *addr;          // Location being written
+    long value;          // Value to publish at commit
+    uint64_t *stripe;    // Stripe that covers addr
+    int owns_lock;       // Set while commit holds the stripe lock
+} stm_write_entry_t;
+
+typedef struct {
+    uint64_t read_version;                      // Clock sampled at begin
+    int aborted;                                // Set on failed validation
+    int num_reads;
+    int num_writes;
+    uint64_t *reads[STM_MAX_READS];             // Stripes read
+    stm_write_entry_t writes[STM_MAX_WRITES];   // Redo log
+
+    // Statistics (kept across transactions on the same descriptor)
+    unsigned long commits;
+    unsigned long aborts;
+} stm_tx_t;
+
+// Map a word address onto its stripe lock
+static inline uint64_t *stm_stripe_for(const long *addr) {
+    uintptr_t a = (uintptr_t)addr;
+    return &stm_stripes[(a >> 3) & (STM_NUM_STRIPES - 1)];
+}
+
+static inline void stm_tx_init(stm_tx_t *tx) {
+    tx->commits = 0;
+    tx->aborts = 0;
+    tx->num_reads = 0;
+    tx->num_writes = 0;
+    tx->aborted = 0;
+}
+
+// Start (or restart) a transaction
+static inline void stm_begin(stm_tx_t *tx) {
+    tx->num_reads = 0;
+    tx->num_writes = 0;
+    tx->aborted = 0;
+    tx->read_version = __atomic_load_n(&stm_global_clock, __ATOMIC_ACQUIRE);
+}
+
+// A set is full: retrying would overflow it again, forever
+static inline void stm_overflow(const char *set, int capacity) {
+    fprintf(stderr, "stm: transaction exceeds its %s set (%d entries)\n", set, capacity);
+    abort();
+}
+
+static inline void stm_abort(stm_tx_t *tx) {
+    if (!tx->aborted) {
+        tx->aborted = 1;
+        tx->aborts++;
+    }
+}
+
+// Transactional read of one word
+static inline long stm_read(stm_tx_t *tx, long *addr) {
+    if (tx->aborted) {
+        return 0;
+    }
+
+    // Read-after-write: return our own buffered value
+    for (int i = tx->num_writes - 1; i >= 0; i--) {
+        if (tx->writes[i].addr == addr) {
+            return tx->writes[i].value;
+        }
+    }
+
+    uint64_t *stripe = stm_stripe_for(addr);
+
+    // Sample stripe version, read the word, sample again. The read is
+    // consistent if the stripe was unlocked, unchanged, and not newer
+    // than our snapshot.
+    uint64_t v1 = __atomic_load_n(stripe, __ATOMIC_ACQUIRE);
+    long value = __atomic_load_n(addr, __ATOMIC_RELAXED);
+    __atomic_thread_fence(__ATOMIC_ACQUIRE);
+    uint64_t v2 = __atomic_load_n(stripe, __ATOMIC_RELAXED);
+
+    if ((v1 & 1) || v1 != v2 || (v1 >> 1) > tx->read_version) {
+        stm_abort(tx);
+        return 0;
+    }
+    if (tx->num_reads == STM_MAX_READS) {
+        stm_overflow("read", STM_MAX_READS);
+    }
+
+    tx->reads[tx->num_reads++] = stripe;
+    return value;
+}
+
+// Transactional write of one word (buffered until commit)
+static inline void stm_write(stm_tx_t *tx, long *addr, long value) {
+    if (tx->aborted) {
+        return;
+    }
+
+    for (int i = 0; i < tx->num_writes; i++) {
+        if (tx->writes[i].addr == addr) {
+            tx->writes[i].value = value;
+            return;
+        }
+    }
+
+    if (tx->num_writes == STM_MAX_WRITES) {
+        stm_overflow("write", STM_MAX_WRITES);
+    }
+
+    stm_write_entry_t *w = &tx->writes[tx->num_writes++];
+    w->addr = addr;
+    w->value = value;
+    w->stripe = stm_stripe_for(addr);
+    w->owns_lock = 0;
+}
+
+// Release every stripe lock commit acquired; restore or bump versions
+static inline void stm_release_locks(stm_tx_t *tx, int publish,
+                                     uint64_t write_version) {
+    for (int i = 0; i < tx->num_writes; i++) {
+        stm_write_entry_t *w = &tx->writes[i];
+        if (!w->owns_lock) {
+            continue;
+        }
+        uint64_t unlocked = publish
+            ? (write_version << 1)
+            : (__atomic_load_n(w->stripe, __ATOMIC_RELAXED) & ~(uint64_t)1);
+        __atomic_store_n(w->stripe, unlocked, __ATOMIC_RELEASE);
+        w->owns_lock = 0;
+    }
+}
+
+// Is this stripe locked by our own commit?
+static inline int stm_owns_stripe(stm_tx_t *tx, uint64_t *stripe) {
+    for (int i = 0; i < tx->num_writes; i++) {
+        if (tx->writes[i].stripe == stripe && tx->writes[i].owns_lock) {
+            return 1;
+        }
+    }
+    return 0;
+}
+
+/*
+ * stm_commit() - Validate and publish the transaction
+ *
+ * Return: 1 if the transaction committed, 0 if it aborted and the
+ *         caller must retry from stm_begin().
+ */
+static inline int stm_commit(stm_tx_t *tx) {
+    if (tx->aborted) {
+        sched_yield();   // Give the conflicting writer a chance to finish
+        return 0;
+    }
+
+    // Read-only transactions were validated read by read
+    if (tx->num_writes == 0) {
+        tx->commits++;
+        return 1;
+    }
+
+    // Phase 1: lock the write set. Never wait - a busy stripe aborts us.
+    for (int i = 0; i < tx->num_writes; i++) {
+        stm_write_entry_t *w = &tx->writes[i];
+        if (stm_owns_stripe(tx, w->stripe)) {
+            continue;    // Two words in the same stripe
+        }
+        uint64_t v = __atomic_load_n(w->stripe, __ATOMIC_RELAXED);
+        if ((v & 1) ||
+            !__atomic_compare_exchange_n(w->stripe, &v, v | 1, 0,
+                                         __ATOMIC_ACQUIRE, __ATOMIC_RELAXED)) {
+            stm_release_locks(tx, 0, 0);
+            stm_abort(tx);
+            sched_yield();
+            return 0;
+        }
+        w->owns_lock = 1;
+    }
+
+    // Phase 2: take a write version from the global clock
+    uint64_t write_version =
+        __atomic_add_fetch(&stm_global_clock, 1, __ATOMIC_ACQ_REL);
+
+    // Phase 3: re-validate the read set, unless nobody committed since begin
+    if (write_version != tx->read_version + 1) {
+        for (int i = 0; i < tx->num_reads; i++) {
+            uint64_t v = __atomic_load_n(tx->reads[i], __ATOMIC_ACQUIRE);
+            if ((v >> 1) > tx->read_version ||
+                ((v & 1) && !stm_owns_stripe(tx, tx->reads[i]))) {
+                stm_release_locks(tx, 0, 0);
+                stm_abort(tx);
+                return 0;
+            }
+        }
+    }
+
+    // Phase 4: write back the redo log, then release with the new version
+    for (int i = 0; i < tx->num_writes; i++) {
+        __atomic_store_n(tx->writes[i].addr, tx->writes[i].value,
+                         __ATOMIC_RELAXED);
+    }
+    stm_release_locks(tx, 1, write_version);
+
+    tx->commits++;
+    return 1;
+}
+
+#endif // __stm_h__
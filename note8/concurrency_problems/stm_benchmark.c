@@ -0,0 +1,223 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+#include <sched.h>
+
+#include "../../common.h"
+#include "stm.h"
+
+/*
+ * stm_benchmark.c - Two-location updates: ordered locks vs trylock vs STM
+ *
+ * Every operation performs the deadlock_example.c critical section
+ * (`counter1++; counter2++;`) on one pair of counters, using one of:
+ *
+ *   ordered  - lock mutex_A then mutex_B (the "safe mode" of the demo)
+ *   trylock  - odd threads go B->A with trylock and back off on failure
+ *   stm      - one TL2 transaction per update, no locks held while running
+ *
+ * Contention is controlled by the number of counter pairs:
+ *
+ *   high - every thread updates the same pair (the original demo)
+ *   low  - each update picks one of NUM_PAIRS pairs at random
+ *
+ * Usage: ./stm_benchmark [threads] [iterations per thread]
+ */
+
+#define NUM_PAIRS 1024
+#define MAX_THREADS 64
+
+typedef struct {
+    pthread_mutex_t mutex_A;
+    pthread_mutex_t mutex_B;
+    long counter1;
+    long counter2;
+} counter_pair_t;
+
+typedef enum { MODE_ORDERED, MODE_TRYLOCK, MODE_STM } sync_mode_t;
+
+static const char *mode_names[] = { "ordered", "trylock", "stm" };
+
+static counter_pair_t pairs[NUM_PAIRS];
+
+typedef struct {
+    int id;
+    int iterations;
+    int num_pairs;
+    sync_mode_t mode;
+    unsigned long retries;     // trylock failures or STM aborts
+} worker_t;
+
+// Cheap per-thread xorshift so rand()'s lock doesn't dominate
+static inline unsigned int next_random(unsigned int *state) {
+    unsigned int x = *state;
+    x ^= x << 13;
+    x ^= x >> 17;
+    x ^= x << 5;
+    *state = x;
+    return x;
+}
+
+static void update_ordered(counter_pair_t *p) {
+    pthread_mutex_lock(&p->mutex_A);
+    pthread_mutex_lock(&p->mutex_B);
+    p->counter1++;
+    p->counter2++;
+    pthread_mutex_unlock(&p->mutex_B);
+    pthread_mutex_unlock(&p->mutex_A);
+}
+
+// Same shape as thread_function_2_trylock(), but odd threads take the
+// locks in the opposite order so the backoff path actually matters.
+// The demo's usleep(rand() % 1000) backoff is replaced by a short
+// bounded spin so the benchmark measures the locking, not the sleeps.
+static unsigned long update_trylock(counter_pair_t *p, int reversed,
+                                    unsigned int *seed) {
+    pthread_mutex_t *first = reversed ? &p->mutex_B : &p->mutex_A;
+    pthread_mutex_t *second = reversed ? &p->mutex_A : &p->mutex_B;
+    unsigned long failures = 0;
+    unsigned int backoff = 16;
+
+    for (;;) {
+        if (pthread_mutex_trylock(first) == 0) {
+            if (pthread_mutex_trylock(second) == 0) {
+                p->counter1++;
+                p->counter2++;
+                pthread_mutex_unlock(second);
+                pthread_mutex_unlock(first);
+                return failures;
+            }
+            pthread_mutex_unlock(first);
+        }
+        failures++;
+
+        // Randomized exponential backoff
+        for (volatile unsigned int spin = next_random(seed) % backoff; spin > 0; spin--) {
+        }
+        if (backoff < 4096) {
+            backoff *= 2;
+        } else {
+            sched_yield();
+        }
+    }
+}
+
+static void update_stm(stm_tx_t *tx, counter_pair_t *p) {
+    do {
+        stm_begin(tx);
+        long a = stm_read(tx, &p->counter1);
+        long b = stm_read(tx, &p->counter2);
+        stm_write(tx, &p->counter1, a + 1);
+        stm_write(tx, &p->counter2, b + 1);
+    } while (!stm_commit(tx));
+}
+
+static void *worker(void *arg) {
+    worker_t *w = (worker_t *)arg;
+    unsigned int seed = 2463534242u + (unsigned int)w->id * 7919u;
+    stm_tx_t tx;
+
+    stm_tx_init(&tx);
+
+    for (int i = 0; i < w->iterations; i++) {
+        counter_pair_t *p = &pairs[next_random(&seed) % w->num_pairs];
+
+        switch (w->mode) {
+            case MODE_ORDERED:
+                update_ordered(p);
+                break;
+            case MODE_TRYLOCK:
+                w->retries += update_trylock(p, w->id & 1, &seed);
+                break;
+            case MODE_STM:
+                update_stm(&tx, p);
+                break;
+        }
+    }
+
+    if (w->mode == MODE_STM) {
+        w->retries = tx.aborts;
+    }
+    return NULL;
+}
+
+static void reset_pairs(void) {
+    for (int i = 0; i < NUM_PAIRS; i++) {
+        pthread_mutex_init(&pairs[i].mutex_A, NULL);
+        pthread_mutex_init(&pairs[i].mutex_B, NULL);
+        pairs[i].counter1 = 0;
+        pairs[i].counter2 = 0;
+    }
+}
+
+static void destroy_pairs(void) {
+    for (int i = 0; i < NUM_PAIRS; i++) {
+        pthread_mutex_destroy(&pairs[i].mutex_A);
+        pthread_mutex_destroy(&pairs[i].mutex_B);
+    }
+}
+
+static void run(sync_mode_t mode, int num_pairs, int num_threads, int iterations) {
+    pthread_t threads[MAX_THREADS];
+    worker_t workers[MAX_THREADS];
+
+    reset_pairs();
+
+    double start = GetTime();
+    for (int i = 0; i < num_threads; i++) {
+        workers[i].id = i;
+        workers[i].iterations = iterations;
+        workers[i].num_pairs = num_pairs;
+        workers[i].mode = mode;
+        workers[i].retries = 0;
+        pthread_create(&threads[i], NULL, worker, &workers[i]);
+    }
+    for (int i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double elapsed = GetTime() - start;
+
+    // Every update must land in both counters of its pair
+    long total1 = 0, total2 = 0;
+    unsigned long retries = 0;
+    for (int i = 0; i < num_pairs; i++) {
+        total1 += pairs[i].counter1;
+        total2 += pairs[i].counter2;
+    }
+    for (int i = 0; i < num_threads; i++) {
+        retries += workers[i].retries;
+    }
+    long expected = (long)num_threads * iterations;
+
+    printf("%-8s %-5s %8.3f %12.0f %10.3f  %s\n",
+           mode_names[mode], num_pairs == 1 ? "high" : "low",
+           elapsed, expected / elapsed, (double)retries / expected,
+           (total1 == expected && total2 == expected) ? "ok" : "MISMATCH");
+
+    destroy_pairs();
+}
+
+int main(int argc, char *argv[]) {
+    int num_threads = argc > 1 ? atoi(argv[1]) : 4;
+    int iterations = argc > 2 ? atoi(argv[2]) : 200000;
+
+    if (num_threads < 1 || num_threads > MAX_THREADS || iterations < 1) {
+        fprintf(stderr, "Usage: %s [threads 1-%d] [iterations]\n", argv[0], MAX_THREADS);
+        return 1;
+    }
+
+    printf("Two-location update benchmark: %d threads x %d updates\n\n",
+           num_threads, iterations);
+    printf("%-8s %-5s %8s %12s %10s  %s\n",
+           "mode", "cont", "time(s)", "updates/s", "retry/op", "check");
+
+    int contention[] = { 1, NUM_PAIRS };
+    for (int c = 0; c < 2; c++) {
+        run(MODE_ORDERED, contention[c], num_threads, iterations);
+        run(MODE_TRYLOCK, contention[c], num_threads, iterations);
+        run(MODE_STM, contention[c], num_threads, iterations);
+    }
+
+    return 0;
+}
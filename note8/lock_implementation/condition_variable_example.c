@@ -1,26 +1,25 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
 #include <pthread.h>
+#include <time.h>
 #include <unistd.h>
 
+#include "../../bounded_queue.h"
+
 /*
  * This program demonstrates condition variables for thread synchronization.
  * It implements a bounded buffer (producer-consumer) pattern using pthread 
  * condition variables to coordinate between producer and consumer threads.
+ *
+ * The buffer is a bounded_queue_t (bounded_queue.h), which owns the
+ * mutex and the not_full / not_empty condition variables.
  */
 
-#define BUFFER_SIZE 5
-
-// Shared buffer and associated tracking variables
-int buffer[BUFFER_SIZE];
-int buffer_count = 0;
-int buffer_in = 0;
-int buffer_out = 0;
+#define BUFFER_SIZE 5   // Rounded up to 8 by bounded_queue_init()
 
-// Synchronization primitives
-pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
-pthread_cond_t buffer_not_full = PTHREAD_COND_INITIALIZER;
-pthread_cond_t buffer_not_empty = PTHREAD_COND_INITIALIZER;
+// Shared buffer of ints
+bounded_queue_t buffer;
 
 // Producer function: produces items and adds them to the buffer
 void* producer(void* arg) {
@@ -31,28 +30,15 @@ void* producer(void* arg) {
         // Generate a random item
         item = rand() % 100;
         
-        // Acquire the mutex
-        pthread_mutex_lock(&mutex);
-        
-        // Wait while the buffer is full
-        while (buffer_count == BUFFER_SIZE) {
+        // Add item to buffer, waiting while it is full. The queue
+        // signals not_empty for us.
+        if (bounded_queue_try_put(&buffer, &item) == EAGAIN) {
             printf("Producer %d: Buffer full, waiting...\n", producer_id);
-            pthread_cond_wait(&buffer_not_full, &mutex);
+            bounded_queue_put(&buffer, &item);
         }
         
-        // Add item to buffer
-        buffer[buffer_in] = item;
-        buffer_in = (buffer_in + 1) % BUFFER_SIZE;
-        buffer_count++;
-        
-        printf("Producer %d: Produced item %d, buffer count: %d\n", 
-               producer_id, item, buffer_count);
-        
-        // Signal that buffer is not empty anymore
-        pthread_cond_signal(&buffer_not_empty);
-        
-        // Release the mutex
-        pthread_mutex_unlock(&mutex);
+        printf("Producer %d: Produced item %d, buffer count: %zu\n", 
+               producer_id, item, bounded_queue_count(&buffer));
         
         // Sleep for a short while to simulate varying production rates
         usleep(rand() % 100000);
@@ -68,28 +54,15 @@ void* consumer(void* arg) {
     int item;
     
     for (int i = 0; i < 20; i++) {
-        // Acquire the mutex
-        pthread_mutex_lock(&mutex);
-        
-        // Wait while the buffer is empty
-        while (buffer_count == 0) {
+        // Take item from buffer, waiting while it is empty. The queue
+        // signals not_full for us.
+        if (bounded_queue_try_get(&buffer, &item) == EAGAIN) {
             printf("Consumer %d: Buffer empty, waiting...\n", consumer_id);
-            pthread_cond_wait(&buffer_not_empty, &mutex);
+            bounded_queue_get(&buffer, &item);
         }
         
-        // Take item from buffer
-        item = buffer[buffer_out];
-        buffer_out = (buffer_out + 1) % BUFFER_SIZE;
-        buffer_count--;
-        
-        printf("Consumer %d: Consumed item %d, buffer count: %d\n", 
-               consumer_id, item, buffer_count);
-        
-        // Signal that buffer is not full anymore
-        pthread_cond_signal(&buffer_not_full);
-        
-        // Release the mutex
-        pthread_mutex_unlock(&mutex);
+        printf("Consumer %d: Consumed item %d, buffer count: %zu\n", 
+               consumer_id, item, bounded_queue_count(&buffer));
         
         // Sleep for a short while to simulate varying consumption rates
         usleep(rand() % 100000);
@@ -107,8 +80,13 @@ int main() {
     // Seed the random number generator
     srand(time(NULL));
     
+    if (bounded_queue_init(&buffer, BUFFER_SIZE, sizeof(int)) != 0) {
+        fprintf(stderr, "Failed to allocate the buffer\n");
+        return 1;
+    }
+    
     printf("Starting producer-consumer demonstration using condition variables\n");
-    printf("Buffer size: %d\n", BUFFER_SIZE);
+    printf("Buffer size: %zu\n", buffer.capacity);
     printf("Each producer and consumer will process 20 items\n\n");
     
     // Create producer threads
@@ -133,10 +111,8 @@ int main() {
     
     printf("\nAll threads have completed\n");
     
-    // Cleanup synchronization primitives
-    pthread_mutex_destroy(&mutex);
-    pthread_cond_destroy(&buffer_not_full);
-    pthread_cond_destroy(&buffer_not_empty);
+    // Free the buffer and its synchronization primitives
+    bounded_queue_destroy(&buffer);
     
     return 0;
 }
\ No newline at end of file
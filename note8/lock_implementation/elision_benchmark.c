@@ -0,0 +1,169 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "../../common.h"
+#include "lock_elision.h"
+
+/*
+ * elision_benchmark.c - Is hardware lock elision worth enabling?
+ *
+ * Runs the tiny critical sections from the lock demos under a plain
+ * lock and under the same lock with RTM elision, and reports throughput
+ * together with the transaction abort breakdown.
+ *
+ * Workloads:
+ *   counter  - `counter++` on one shared counter (spinlock_example.c)
+ *   pair     - `counter1++; counter2++;` (deadlock_example.c)
+ *   disjoint - each thread bumps its own cache line under the shared
+ *              lock; the best case for elision, since nothing conflicts
+ *
+ * On CPUs without TSX the elided rows take the fallback path every
+ * time (fallback = 100%) and should match the plain rows.
+ *
+ * Usage: ./elision_benchmark [threads] [iterations per thread] [retries]
+ */
+
+#define MAX_THREADS 64
+#define CACHE_LINE 64
+
+typedef enum { WORK_COUNTER, WORK_PAIR, WORK_DISJOINT } workload_t;
+static const char *workload_names[] = { "counter", "pair", "disjoint" };
+
+typedef struct {
+    volatile long value;
+    char pad[CACHE_LINE - sizeof(long)];
+} padded_counter_t;
+
+static volatile long counter;
+static volatile long counter1;
+static volatile long counter2;
+static padded_counter_t slots[MAX_THREADS];
+
+static elided_lock_t lock;
+
+typedef struct {
+    int id;
+    int iterations;
+    workload_t workload;
+    elision_stats_t stats;
+} worker_t;
+
+static inline void critical_section(workload_t workload, int id) {
+    switch (workload) {
+        case WORK_COUNTER:
+            counter++;
+            break;
+        case WORK_PAIR:
+            counter1++;
+            counter2++;
+            break;
+        case WORK_DISJOINT:
+            slots[id].value++;
+            break;
+    }
+}
+
+static void *worker(void *arg) {
+    worker_t *w = (worker_t *)arg;
+
+    for (int i = 0; i < w->iterations; i++) {
+        elided_lock(&lock, &w->stats);
+        critical_section(w->workload, w->id);
+        elided_unlock(&lock, &w->stats);
+    }
+    return NULL;
+}
+
+static long workload_total(workload_t workload, int num_threads) {
+    long total = 0;
+    switch (workload) {
+        case WORK_COUNTER:
+            return counter;
+        case WORK_PAIR:
+            return counter1 == counter2 ? counter1 : -1;
+        case WORK_DISJOINT:
+            for (int i = 0; i < num_threads; i++) {
+                total += slots[i].value;
+            }
+            return total;
+    }
+    return -1;
+}
+
+static void run(workload_t workload, elision_fallback_t kind, int elide,
+                int num_threads, int iterations, int retries) {
+    pthread_t threads[MAX_THREADS];
+    worker_t workers[MAX_THREADS];
+    elision_stats_t total;
+
+    counter = counter1 = counter2 = 0;
+    memset(slots, 0, sizeof(slots));
+    memset(&total, 0, sizeof(total));
+
+    elided_lock_init(&lock, kind, retries);
+    if (!elide) {
+        lock.enabled = 0;
+    }
+
+    double start = GetTime();
+    for (int i = 0; i < num_threads; i++) {
+        memset(&workers[i], 0, sizeof(workers[i]));
+        workers[i].id = i;
+        workers[i].iterations = iterations;
+        workers[i].workload = workload;
+        pthread_create(&threads[i], NULL, worker, &workers[i]);
+    }
+    for (int i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+        elision_stats_add(&total, &workers[i].stats);
+    }
+    double elapsed = GetTime() - start;
+
+    elided_lock_destroy(&lock);
+
+    long expected = (long)num_threads * iterations;
+    unsigned long aborts = total.abort_conflict + total.abort_capacity +
+                           total.abort_lock_busy + total.abort_other;
+
+    printf("%-9s %-8s %-5s %12.0f %7.1f%% %7.1f%%  %lu/%lu/%lu/%lu  %s\n",
+           workload_names[workload],
+           kind == ELISION_FALLBACK_MUTEX ? "mutex" : "spin",
+           elide ? "yes" : "no",
+           expected / elapsed,
+           total.attempts ? 100.0 * aborts / total.attempts : 0.0,
+           100.0 * total.fallbacks / total.acquisitions,
+           total.abort_conflict, total.abort_capacity,
+           total.abort_lock_busy, total.abort_other,
+           workload_total(workload, num_threads) == expected ? "ok" : "MISMATCH");
+}
+
+int main(int argc, char *argv[]) {
+    int num_threads = argc > 1 ? atoi(argv[1]) : 4;
+    int iterations = argc > 2 ? atoi(argv[2]) : 1000000;
+    int retries = argc > 3 ? atoi(argv[3]) : ELISION_DEFAULT_RETRIES;
+
+    if (num_threads < 1 || num_threads > MAX_THREADS || iterations < 1 || retries < 1) {
+        fprintf(stderr, "Usage: %s [threads 1-%d] [iterations] [retries]\n",
+                argv[0], MAX_THREADS);
+        return 1;
+    }
+
+    printf("Lock elision benchmark: %d threads x %d sections, %d attempts before fallback\n",
+           num_threads, iterations, retries);
+    printf("RTM support detected: %s\n\n", elision_supported() ? "yes" : "no");
+    printf("%-9s %-8s %-5s %12s %8s %8s  %s  %s\n",
+           "workload", "lock", "elide", "sections/s", "abort", "fallback",
+           "conflict/capacity/busy/other", "check");
+
+    for (int w = WORK_COUNTER; w <= WORK_DISJOINT; w++) {
+        for (int k = ELISION_FALLBACK_MUTEX; k <= ELISION_FALLBACK_SPINLOCK; k++) {
+            run(w, k, 0, num_threads, iterations, retries);
+            run(w, k, 1, num_threads, iterations, retries);
+        }
+    }
+
+    return 0;
+}
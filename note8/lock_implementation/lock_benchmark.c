@@ -0,0 +1,202 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include "../../common.h"
+#include "../../locks.h"
+#include "lock_elision.h"
+
+/*
+ * lock_benchmark.c - One driver for every lock in locks.h
+ *
+ * Each thread repeatedly acquires the lock, runs a critical section of
+ * roughly `cs_ns` nanoseconds that updates a shared counter, and
+ * releases it. Every lock implementation runs the same worker loop
+ * (generated by DEFINE_LOCK_WORKER below), so differences in the results
+ * come from the locks alone.
+ *
+ * Without a cs_ns argument the benchmark sweeps critical sections from
+ * 10 ns to 100 us, which is where the fixed strategies trade places:
+ * spinning wins for short sections, sleeping for long ones, and the
+ * adaptive mutex should track the better of the two.
+ *
+ * Usage: ./lock_benchmark [threads] [iterations per thread] [cs_ns]
+ */
+
+#define MAX_THREADS 64
+#define RUN_BUDGET_NS 200000000.0   // Cap on critical-section time per run
+
+static volatile long counter;
+static long cs_loops;               // Busy-loop iterations per critical section
+static double loops_per_ns;
+
+static pthread_mutex_t bench_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_mutex_t bench_mutex_np;
+static adaptive_mutex_t bench_adaptive = ADAPTIVE_MUTEX_INITIALIZER;
+static spinlock_t bench_spinlock = SPINLOCK_INITIALIZER;
+static ticket_lock_t bench_ticket = TICKET_LOCK_INITIALIZER;
+static elided_lock_t bench_elided;
+
+typedef struct {
+    int iterations;
+    elision_stats_t elision;
+} worker_t;
+
+static inline void critical_section(void) {
+    for (volatile long i = 0; i < cs_loops; i++) {
+    }
+    counter++;
+}
+
+// Measure how many busy-loop iterations fit in a nanosecond
+static void calibrate_cs_loop(void) {
+    long loops = 1000000;
+    double elapsed;
+
+    do {
+        loops *= 2;
+        double start = GetTime();
+        for (volatile long i = 0; i < loops; i++) {
+        }
+        elapsed = GetTime() - start;
+    } while (elapsed < 0.05);
+
+    loops_per_ns = loops / (elapsed * 1e9);
+}
+
+// Generate one worker function per lock so the lock calls are inlined
+#define DEFINE_LOCK_WORKER(name, acquire, release)          \
+    static void *name##_worker(void *arg) {                  \
+        worker_t *w = (worker_t *)arg;                       \
+        for (int i = 0; i < w->iterations; i++) {            \
+            acquire;                                         \
+            critical_section();                              \
+            release;                                         \
+        }                                                    \
+        return NULL;                                         \
+    }
+
+DEFINE_LOCK_WORKER(mutex, pthread_mutex_lock(&bench_mutex),
+                   pthread_mutex_unlock(&bench_mutex))
+DEFINE_LOCK_WORKER(mutex_np, pthread_mutex_lock(&bench_mutex_np),
+                   pthread_mutex_unlock(&bench_mutex_np))
+DEFINE_LOCK_WORKER(spinlock, spinlock_lock(&bench_spinlock),
+                   spinlock_unlock(&bench_spinlock))
+DEFINE_LOCK_WORKER(spin_backoff, spinlock_lock_backoff(&bench_spinlock),
+                   spinlock_unlock(&bench_spinlock))
+DEFINE_LOCK_WORKER(ticket, ticket_lock_lock(&bench_ticket),
+                   ticket_lock_unlock(&bench_ticket))
+DEFINE_LOCK_WORKER(adaptive, adaptive_mutex_lock(&bench_adaptive),
+                   adaptive_mutex_unlock(&bench_adaptive))
+DEFINE_LOCK_WORKER(elided, elided_lock(&bench_elided, &w->elision),
+                   elided_unlock(&bench_elided, &w->elision))
+
+typedef struct {
+    const char *name;
+    void *(*worker)(void *);
+} lock_entry_t;
+
+static const lock_entry_t locks[] = {
+    { "mutex",        mutex_worker },
+    { "mutex-adapt",  mutex_np_worker },   // glibc PTHREAD_MUTEX_ADAPTIVE_NP
+    { "spinlock",     spinlock_worker },
+    { "spin+backoff", spin_backoff_worker },
+    { "ticket",       ticket_worker },
+    { "adaptive",     adaptive_worker },
+    { "elided-spin",  elided_worker },
+};
+
+static void run(const lock_entry_t *entry, int num_threads, int iterations) {
+    pthread_t threads[MAX_THREADS];
+    worker_t workers[MAX_THREADS];
+    elision_stats_t total = {0};
+
+    counter = 0;
+    adaptive_mutex_init(&bench_adaptive);
+    elided_lock_init(&bench_elided, ELISION_FALLBACK_SPINLOCK, ELISION_DEFAULT_RETRIES);
+
+    pmu_t pmu;
+    pmu_sample_t counters;
+    char counter_text[160];
+    pmu_begin(&pmu, PMU_INHERIT);       // Counts the worker threads too
+    double start = GetTime();
+    for (int i = 0; i < num_threads; i++) {
+        workers[i].iterations = iterations;
+        workers[i].elision = total;
+        pthread_create(&threads[i], NULL, entry->worker, &workers[i]);
+    }
+    for (int i = 0; i < num_threads; i++) {
+        pthread_join(threads[i], NULL);
+        elision_stats_add(&total, &workers[i].elision);
+    }
+    double elapsed = GetTime() - start;
+    pmu_end(&pmu, &counters);
+
+    elided_lock_destroy(&bench_elided);
+
+    long expected = (long)num_threads * iterations;
+    printf("%-13s %9.3f %12.0f %9.1f  %-8s",
+           entry->name, elapsed, expected / elapsed,
+           1e9 * elapsed / expected,
+           counter == expected ? "ok" : "MISMATCH");
+    if (entry->worker == adaptive_worker) {
+        printf("  no-sleep %lu / slept %lu, ewma %lu ns",
+               bench_adaptive.spin_acquires, bench_adaptive.sleep_acquires,
+               (unsigned long)bench_adaptive.hold_ewma_ns);
+    }
+    printf("  %s\n", pmu_format(&counters, counter_text, sizeof(counter_text)));
+}
+
+static void run_all(int num_threads, int iterations, long cs_ns) {
+    cs_loops = (long)(cs_ns * loops_per_ns);
+
+    // Keep long critical sections from running for minutes
+    double budget = RUN_BUDGET_NS / ((double)cs_ns * num_threads);
+    if (budget < iterations) {
+        iterations = budget < 100 ? 100 : (int)budget;
+    }
+
+    printf("\nCritical section ~%ld ns (%ld loops), %d threads x %d acquisitions\n",
+           cs_ns, cs_loops, num_threads, iterations);
+    printf("%-13s %9s %12s %9s  %s\n", "lock", "time(s)", "acq/s", "ns/acq", "check");
+
+    for (size_t i = 0; i < sizeof(locks) / sizeof(locks[0]); i++) {
+        run(&locks[i], num_threads, iterations);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    int num_threads = argc > 1 ? atoi(argv[1]) : 4;
+    int iterations = argc > 2 ? atoi(argv[2]) : 500000;
+    long cs_ns = argc > 3 ? atol(argv[3]) : -1;
+
+    if (num_threads < 1 || num_threads > MAX_THREADS || iterations < 1) {
+        fprintf(stderr, "Usage: %s [threads 1-%d] [iterations] [cs_ns]\n",
+                argv[0], MAX_THREADS);
+        return 1;
+    }
+
+    pthread_mutexattr_t attr;
+    pthread_mutexattr_init(&attr);
+    pthread_mutexattr_settype(&attr, PTHREAD_MUTEX_ADAPTIVE_NP);
+    pthread_mutex_init(&bench_mutex_np, &attr);
+    pthread_mutexattr_destroy(&attr);
+
+    calibrate_cs_loop();
+    printf("Lock benchmark: %d threads, %.2f busy-loop iterations per ns\n",
+           num_threads, loops_per_ns);
+    pmu_describe(stdout);
+
+    if (cs_ns >= 0) {
+        run_all(num_threads, iterations, cs_ns);
+    } else {
+        long sweep[] = { 10, 100, 1000, 10000, 100000 };
+        for (size_t i = 0; i < sizeof(sweep) / sizeof(sweep[0]); i++) {
+            run_all(num_threads, iterations, sweep[i]);
+        }
+    }
+
+    pthread_mutex_destroy(&bench_mutex_np);
+    return 0;
+}
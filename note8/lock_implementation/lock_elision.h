@@ -0,0 +1,241 @@
+/*
+ * ===================================================================
+ * lock_elision.h - Hardware Lock Elision (Intel RTM) With Fallback
+ * ===================================================================
+ *
+ * The critical sections in the lock demos are tiny (`counter++`, or
+ * `counter1++; counter2++;`). Most of the cost of such a section is the
+ * lock itself: the cache line holding the lock bounces between cores
+ * even when the threads touch different data.
+ *
+ * Lock elision runs the critical section as a hardware transaction
+ * (Intel TSX / RTM) *without* writing the lock. The transaction only
+ * reads the lock word, so if another thread really acquires the lock
+ * the hardware aborts us. Two threads whose sections touch different
+ * cache lines commit in parallel.
+ *
+ * Transactions can abort for many reasons (conflicts, capacity,
+ * interrupts, system calls), so after `max_retries` aborts - or on an
+ * abort the hardware says will not succeed on retry - we take the real
+ * lock. The underlying lock is either a pthread mutex or the locks.h
+ * spinlock.
+ *
+ * RTM support is detected at run time with CPUID leaf 7: EBX bit 11
+ * (RTM) set and EDX bit 11 (RTM_ALWAYS_ABORT) clear. Microcode that
+ * disables TSX may leave RTM advertised but set RTM_ALWAYS_ABORT, so
+ * every transaction aborts. On CPUs without TSX (or with it disabled),
+ * and on non-x86 builds, elided_lock() simply acquires the fallback
+ * lock, so callers never need two code paths.
+ *
+ * Statistics are accumulated in a caller-owned elision_stats_t, one per
+ * thread, so reporting costs no shared cache-line traffic.
+ */
+
+#ifndef __lock_elision_h__
+#define __lock_elision_h__
+
+#include <pthread.h>
+
+#include "../../locks.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <cpuid.h>
+#include <immintrin.h>
+#define ELISION_X86 1
+#else
+#define ELISION_X86 0
+#endif
+
+#define ELISION_DEFAULT_RETRIES 5
+#define ELISION_ABORT_LOCK_BUSY 0xff   // Explicit abort code: lock was held
+
+typedef enum {
+    ELISION_FALLBACK_MUTEX,
+    ELISION_FALLBACK_SPINLOCK
+} elision_fallback_t;
+
+typedef struct {
+    volatile int held;          // 1 while a thread holds the fallback mutex
+    pthread_mutex_t mutex;      // Fallback for ELISION_FALLBACK_MUTEX
+    spinlock_t spin;            // Fallback for ELISION_FALLBACK_SPINLOCK
+    elision_fallback_t kind;
+    int max_retries;            // Transaction attempts before falling back
+    int enabled;                // 0 forces the fallback path
+} elided_lock_t;
+
+// Per-thread counters; add them up after the threads are joined
+typedef struct {
+    unsigned long acquisitions;
+    unsigned long attempts;          // _xbegin() calls
+    unsigned long commits;           // Sections completed transactionally
+    unsigned long fallbacks;         // Sections run under the real lock
+    unsigned long abort_conflict;
+    unsigned long abort_capacity;
+    unsigned long abort_lock_busy;   // We saw the lock held and bailed
+    unsigned long abort_other;       // Interrupts, syscalls, unknown
+} elision_stats_t;
+
+/*
+ * elision_supported() - Does this CPU execute RTM transactions?
+ *
+ * Not if RTM is missing, or if microcode forces every transaction to
+ * abort (RTM_ALWAYS_ABORT). The CPUID result is cached after the first
+ * call.
+ */
+static inline int elision_supported(void) {
+#if ELISION_X86
+    static int supported = -1;
+    if (supported < 0) {
+        unsigned int eax, ebx, ecx, edx;
+        supported = 0;
+        if (__get_cpuid_max(0, NULL) >= 7) {
+            __cpuid_count(7, 0, eax, ebx, ecx, edx);
+            int rtm = (ebx >> 11) & 1;
+            int always_abort = (edx >> 11) & 1;
+            supported = rtm && !always_abort;
+        }
+    }
+    return supported;
+#else
+    return 0;
+#endif
+}
+
+static inline void elided_lock_init(elided_lock_t *lock, elision_fallback_t kind,
+                                    int max_retries) {
+    lock->held = 0;
+    spinlock_init(&lock->spin);
+    lock->kind = kind;
+    lock->max_retries = max_retries;
+    lock->enabled = elision_supported();
+    pthread_mutex_init(&lock->mutex, NULL);
+}
+
+static inline void elided_lock_destroy(elided_lock_t *lock) {
+    pthread_mutex_destroy(&lock->mutex);
+}
+
+// Is the real lock currently held by some thread?
+static inline int elision_lock_is_held(elided_lock_t *lock) {
+    return lock->kind == ELISION_FALLBACK_MUTEX ? lock->held
+                                                : spinlock_is_locked(&lock->spin);
+}
+
+// Acquire the real lock
+static inline void elision_fallback_lock(elided_lock_t *lock) {
+    if (lock->kind == ELISION_FALLBACK_MUTEX) {
+        pthread_mutex_lock(&lock->mutex);
+        lock->held = 1;
+    } else {
+        spinlock_lock(&lock->spin);
+    }
+}
+
+static inline void elision_fallback_unlock(elided_lock_t *lock) {
+    if (lock->kind == ELISION_FALLBACK_MUTEX) {
+        lock->held = 0;
+        pthread_mutex_unlock(&lock->mutex);
+    } else {
+        spinlock_unlock(&lock->spin);
+    }
+}
+
+#if ELISION_X86
+
+// Classify an _xbegin() status word into the stats buckets
+static inline void elision_count_abort(elision_stats_t *stats, unsigned int status) {
+    if ((status & _XABORT_EXPLICIT) &&
+        _XABORT_CODE(status) == ELISION_ABORT_LOCK_BUSY) {
+        stats->abort_lock_busy++;
+    } else if (status & _XABORT_CONFLICT) {
+        stats->abort_conflict++;
+    } else if (status & _XABORT_CAPACITY) {
+        stats->abort_capacity++;
+    } else {
+        stats->abort_other++;
+    }
+}
+
+__attribute__((target("rtm")))
+static inline int elision_try_transaction(elided_lock_t *lock, elision_stats_t *stats) {
+    for (int attempt = 0; attempt < lock->max_retries; attempt++) {
+        // Don't start a transaction that is certain to abort
+        while (elision_lock_is_held(lock)) {
+            cpu_relax();
+        }
+
+        stats->attempts++;
+        unsigned int status = _xbegin();
+        if (status == _XBEGIN_STARTED) {
+            // Reading the lock word adds it to our read set: if anyone
+            // takes the real lock from now on, we abort.
+            if (elision_lock_is_held(lock)) {
+                _xabort(ELISION_ABORT_LOCK_BUSY);
+            }
+            return 1;
+        }
+
+        elision_count_abort(stats, status);
+
+        // Capacity aborts and most "other" aborts will just repeat
+        if (!(status & (_XABORT_RETRY | _XABORT_EXPLICIT))) {
+            break;
+        }
+    }
+    return 0;
+}
+
+__attribute__((target("rtm")))
+static inline int elision_in_transaction(void) {
+    return _xtest();
+}
+
+__attribute__((target("rtm")))
+static inline void elision_commit(void) {
+    _xend();
+}
+
+#endif // ELISION_X86
+
+/*
+ * elided_lock() - Enter the critical section
+ *
+ * Returns with either a running transaction or the real lock held.
+ */
+static inline void elided_lock(elided_lock_t *lock, elision_stats_t *stats) {
+    stats->acquisitions++;
+#if ELISION_X86
+    if (lock->enabled && elision_try_transaction(lock, stats)) {
+        return;
+    }
+#endif
+    stats->fallbacks++;
+    elision_fallback_lock(lock);
+}
+
+// Leave the critical section entered by elided_lock()
+static inline void elided_unlock(elided_lock_t *lock, elision_stats_t *stats) {
+#if ELISION_X86
+    if (lock->enabled && elision_in_transaction()) {
+        elision_commit();
+        stats->commits++;
+        return;
+    }
+#endif
+    (void)stats;
+    elision_fallback_unlock(lock);
+}
+
+// Sum per-thread statistics into *total
+static inline void elision_stats_add(elision_stats_t *total, const elision_stats_t *s) {
+    total->acquisitions += s->acquisitions;
+    total->attempts += s->attempts;
+    total->commits += s->commits;
+    total->fallbacks += s->fallbacks;
+    total->abort_conflict += s->abort_conflict;
+    total->abort_capacity += s->abort_capacity;
+    total->abort_lock_busy += s->abort_lock_busy;
+    total->abort_other += s->abort_other;
+}
+
+#endif // __lock_elision_h__
@@ -1,11 +1,17 @@
 #include <stdio.h>
 #include <pthread.h>
 
+#include "../../locks.h"
+
 // Simple mutex example demonstrating race condition resolution
+//
+// The lock is the generic lock_t from locks.h: a pthread mutex by
+// default, or a spinlock / ticket lock when built with
+// `make LOCK_IMPL=SPINLOCK` or `make LOCK_IMPL=TICKET`.
 
 // Shared global variable
 int counter = 0;
-pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
+lock_t mutex = LOCK_INITIALIZER;
 
 // Unsafe increment function - susceptible to race conditions
 void* unsafe_increment(void* arg) {
@@ -27,13 +33,13 @@ void* safe_increment(void* arg) {
     
     for (i = 0; i < iterations; i++) {
         // Enter critical section
-        pthread_mutex_lock(&mutex);
+        lock_acquire(&mutex);
         
         // Safely increment counter
         counter = counter + 1;
         
         // Exit critical section
-        pthread_mutex_unlock(&mutex);
+        lock_release(&mutex);
     }
     
     return NULL;
@@ -62,7 +68,7 @@ int main() {
     
     // Part 2: Demonstrate proper synchronization with mutex
     counter = 0;
-    printf("\nStarting safe increment test...\n");
+    printf("\nStarting safe increment test (%s lock)...\n", LOCK_IMPL_NAME);
     
     // Create two threads that both call safe_increment
     pthread_create(&thread1, NULL, safe_increment, &iterations);
@@ -76,6 +82,6 @@ int main() {
     printf("Safe increment: Expected value: %d, Actual value: %d\n", 
            2 * iterations, counter);
     
-    pthread_mutex_destroy(&mutex);
+    lock_destroy(&mutex);
     return 0;
 }
\ No newline at end of file
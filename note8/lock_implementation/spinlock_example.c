@@ -4,38 +4,15 @@
 #include <unistd.h>
 #include <stdbool.h>
 
-// Implementation of a spinlock
+#include "../../locks.h"
 
-// Spinlock structure
-typedef struct {
-    int flag;  // 0: unlocked, 1: locked
-} spinlock_t;
-
-// Initialize the spinlock
-void spinlock_init(spinlock_t *lock) {
-    lock->flag = 0;
-}
-
-// Test-and-Set atomic operation (simulated in user space)
-// In a real implementation, this would use CPU's atomic instructions
-int test_and_set(int *target, int value) {
-    int old = *target;
-    *target = value;
-    return old;
-}
-
-// Acquire the spinlock
-void spinlock_lock(spinlock_t *lock) {
-    // Keep trying until we get the lock
-    while (test_and_set(&lock->flag, 1) == 1) {
-        // Spin - do nothing
-    }
-}
-
-// Release the spinlock
-void spinlock_unlock(spinlock_t *lock) {
-    lock->flag = 0;
-}
+// Spinlock demonstration
+//
+// spinlock_t, spinlock_lock() and spinlock_lock_backoff() live in locks.h.
+// spinlock_lock() is a test-and-test-and-set loop built on the CPU's
+// atomic exchange instruction (__sync_lock_test_and_set); a plain
+// "read old value, write 1" in C would let two threads both see 0 and
+// enter the critical section together.
 
 // Shared counter variable
 int counter = 0;
@@ -61,29 +38,17 @@ void* increment_counter(void* arg) {
 void* increment_with_backoff(void* arg) {
     int i;
     int iterations = *((int*)arg);
-    int backoff_time = 1; // microseconds
     
     for (i = 0; i < iterations; i++) {
-        // Try to acquire lock
-        while (test_and_set(&counter_lock.flag, 1) == 1) {
-            // If lock acquisition failed, back off
-            usleep(backoff_time);
-            
-            // Exponential backoff - double the wait time
-            // with a maximum cap to prevent excessive waiting
-            backoff_time = backoff_time * 2;
-            if (backoff_time > 1000) // cap at 1ms
-                backoff_time = 1000;
-        }
+        // Try to acquire lock; after each failed attempt wait twice as
+        // long (capped) before trying again
+        spinlock_lock_backoff(&counter_lock);
         
         // We got the lock - increment counter
         counter++;
         
         // Release lock
         spinlock_unlock(&counter_lock);
-        
-        // Reset backoff time for next iteration
-        backoff_time = 1;
     }
     
     return NULL;
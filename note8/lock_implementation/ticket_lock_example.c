@@ -3,46 +3,13 @@
 #include <pthread.h>
 #include <stdbool.h>
 
-// Implementation of a ticket lock
+#include "../../locks.h"
 
-// Ticket lock structure
-typedef struct {
-    int next_ticket;   // Next ticket to be issued
-    int now_serving;   // Currently serving ticket
-} ticket_lock_t;
-
-// Initialize the ticket lock
-void ticket_lock_init(ticket_lock_t *lock) {
-    lock->next_ticket = 0;
-    lock->now_serving = 0;
-}
-
-// Fetch-and-Add atomic operation (simulated)
-// In a real implementation, this would use CPU's atomic instructions
-int fetch_and_add(int *ptr, int increment) {
-    int old = *ptr;
-    *ptr = old + increment;
-    return old;
-}
-
-// Acquire the ticket lock
-void ticket_lock_acquire(ticket_lock_t *lock) {
-    // Take a ticket
-    int my_ticket = fetch_and_add(&lock->next_ticket, 1);
-    
-    // Wait until our ticket is called
-    while (lock->now_serving != my_ticket) {
-        // Busy-wait/spin
-    }
-    
-    // We have the lock when our ticket is being served
-}
-
-// Release the ticket lock
-void ticket_lock_release(ticket_lock_t *lock) {
-    // Serve the next ticket
-    lock->now_serving++;
-}
+// Ticket lock demonstration
+//
+// ticket_lock_t lives in locks.h: ticket_lock_lock() takes a ticket with
+// an atomic fetch-and-add and waits until now_serving reaches it, and
+// ticket_lock_unlock() serves the next ticket.
 
 // Shared resource
 int shared_counter = 0;
@@ -59,13 +26,13 @@ void* increment_counter(void* arg) {
     
     for (int i = 0; i < iterations; i++) {
         // Enter critical section
-        ticket_lock_acquire(&counter_lock);
+        ticket_lock_lock(&counter_lock);
         
         // Increment counter (critical section)
         shared_counter++;
         
         // Exit critical section
-        ticket_lock_release(&counter_lock);
+        ticket_lock_unlock(&counter_lock);
     }
     
     printf("Thread %d completed\n", thread_id);
@@ -1,7 +1,17 @@
+#define _GNU_SOURCE
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <pthread.h>
+#include <time.h>
 #include <unistd.h>
+#include <sys/resource.h>
+
+#include "../../common.h"
+#include "../../bounded_queue.h"
+#include "../../flow_metrics.h"
+#include "../../locks.h"
+#include "../../mpsc_queue.h"
 
 /**
  * bounded_buffer.c
@@ -10,53 +20,96 @@
  * a bounded buffer with multiple producer and consumer threads.
  * The program shows the proper use of condition variables to solve
  * the classic producer-consumer problem with a circular buffer.
+ *
+ * The buffer is a bounded_queue_t (bounded_queue.h). Items are written
+ * and read in place with the emplace/consume API. The queue's mutex is
+ * held from bounded_queue_emplace() until the commit, so the count
+ * printed in between is exact.
+ *
+ * The demo also records flow metrics (flow_metrics.h): an occupancy
+ * histogram, how long producers blocked on a full buffer and consumers
+ * on an empty one. When the buffer reaches HIGH_WATERMARK items the
+ * producers start shedding load - here they back off for SHED_DELAY_MS
+ * before each item - until it drains to LOW_WATERMARK. A snapshot is
+ * printed at the end.
+ *
+ * Fan-in mode (`./bounded_buffer mpsc [max_producers] [items]`) drops the
+ * demo and measures how long producers spend handing an item to a single
+ * consumer, through the bounded queue (producers block when it is full)
+ * and through the unbounded MPSC queue in mpsc_queue.h (producers never
+ * block), at 1, 2, 4, ... max_producers producers.
+ *
+ * Batch mode (`./bounded_buffer batch [producers] [items]`) compares
+ * consumers that take one item per lock/wakeup with consumers that
+ * drain up to BATCH_MAX items per lock hold (bounded_queue_get_batch),
+ * with and without adaptive spinning before they sleep, and reports
+ * throughput and CPU time.
  */
 
-#define BUFFER_SIZE 5
+#define BUFFER_SIZE 5   // Rounded up to 8 by bounded_queue_init()
 #define NUM_PRODUCERS 3
 #define NUM_CONSUMERS 2
 #define ITEMS_PER_PRODUCER 6
 #define ITEMS_PER_CONSUMER 9  // 3 producers * 6 items / 2 consumers
+#define HIGH_WATERMARK 6      // Start shedding load at this many items
+#define LOW_WATERMARK 2       // Stop shedding once drained to this
+#define SHED_DELAY_MS 400     // Producer back-off while shedding
+
+// Shared buffer: one queue holding ints. Its mutex and condition
+// variables replace the global ones.
+bounded_queue_t buffer;
 
-// Shared buffer and associated variables
-int buffer[BUFFER_SIZE];
-int count = 0;      // Number of items in the buffer
-int in = 0;         // Index for next producer to add
-int out = 0;        // Index for next consumer to remove
+// Backpressure metrics for the buffer, and the load-shedding switch the
+// watermark callbacks flip
+flow_metrics_t flow;
+int shedding = 0;
 
-// Synchronization primitives
-pthread_mutex_t mutex = PTHREAD_MUTEX_INITIALIZER;
-pthread_cond_t not_full = PTHREAD_COND_INITIALIZER;
-pthread_cond_t not_empty = PTHREAD_COND_INITIALIZER;
+void on_high_watermark(flow_metrics_t *m, size_t occupancy, void *arg) {
+    (void)m;
+    (void)arg;
+    printf("*** High watermark: %zu items buffered, producers shed load ***\n", occupancy);
+    __atomic_store_n(&shedding, 1, __ATOMIC_RELAXED);
+}
+
+void on_low_watermark(flow_metrics_t *m, size_t occupancy, void *arg) {
+    (void)m;
+    (void)arg;
+    printf("*** Low watermark: %zu items buffered, producers resume ***\n", occupancy);
+    __atomic_store_n(&shedding, 0, __ATOMIC_RELAXED);
+}
 
 // Producer function
 void* producer(void* arg) {
     int id = *((int*)arg);
+    flow_counters_t *stats = flow_metrics_register(&flow);
     
     for (int i = 0; i < ITEMS_PER_PRODUCER; i++) {
         int item = (id * 100) + i;  // Create unique item based on producer id
         
-        // Acquire lock before checking/modifying shared data
-        pthread_mutex_lock(&mutex);
+        // Back off while the consumers are overloaded
+        if (__atomic_load_n(&shedding, __ATOMIC_RELAXED)) {
+            usleep(SHED_DELAY_MS * 1000);
+        }
         
-        // Wait while the buffer is full
-        while (count == BUFFER_SIZE) {
+        // Reserve a slot (locks the buffer), waiting while it is full
+        uint64_t blocked_ns = 0;
+        int *slot = bounded_queue_emplace_timed(&buffer, 0);
+        if (slot == NULL) {
             printf("Producer %d: Buffer full, waiting...\n", id);
-            pthread_cond_wait(&not_full, &mutex);
+            uint64_t start = flow_now_ns();
+            slot = bounded_queue_emplace(&buffer);
+            blocked_ns = flow_now_ns() - start;
         }
         
-        // Add the item to the buffer
-        buffer[in] = item;
-        in = (in + 1) % BUFFER_SIZE;
-        count++;
+        // Write the item straight into the buffer
+        *slot = item;
+        int count = (int)(buffer.tail - buffer.head) + 1;
         
         printf("Producer %d: Produced item %d (count=%d)\n", id, item, count);
+        flow_record_put(&flow, stats, (size_t)count, blocked_ns);
         
-        // Signal that the buffer is not empty
-        pthread_cond_signal(&not_empty);
-        
-        // Release the mutex
-        pthread_mutex_unlock(&mutex);
+        // Publish the item, signal not_empty and release the mutex
+        bounded_queue_emplace_commit(&buffer);
         
         // Simulate variable production time
         usleep((rand() % 300) * 1000);
@@ -69,29 +122,28 @@ void* producer(void* arg) {
 // Consumer function
 void* consumer(void* arg) {
     int id = *((int*)arg);
+    flow_counters_t *stats = flow_metrics_register(&flow);
     
     for (int i = 0; i < ITEMS_PER_CONSUMER; i++) {
-        // Acquire lock before checking/modifying shared data
-        pthread_mutex_lock(&mutex);
-        
-        // Wait while the buffer is empty
-        while (count == 0) {
+        // Lock the oldest item, waiting while the buffer is empty
+        uint64_t starved_ns = 0;
+        int *slot = bounded_queue_consume_timed(&buffer, 0);
+        if (slot == NULL) {
             printf("Consumer %d: Buffer empty, waiting...\n", id);
-            pthread_cond_wait(&not_empty, &mutex);
+            uint64_t start = flow_now_ns();
+            slot = bounded_queue_consume(&buffer);
+            starved_ns = flow_now_ns() - start;
         }
         
-        // Remove an item from the buffer
-        int item = buffer[out];
-        out = (out + 1) % BUFFER_SIZE;
-        count--;
+        // Read the item in place
+        int item = *slot;
+        int count = (int)(buffer.tail - buffer.head) - 1;
         
         printf("Consumer %d: Consumed item %d (count=%d)\n", id, item, count);
+        flow_record_get(&flow, stats, (size_t)count, starved_ns);
         
-        // Signal that the buffer is not full
-        pthread_cond_signal(&not_full);
-        
-        // Release the mutex
-        pthread_mutex_unlock(&mutex);
+        // Free the slot, signal not_full and release the mutex
+        bounded_queue_consume_commit(&buffer);
         
         // Simulate variable consumption time
         usleep((rand() % 500) * 1000);
@@ -101,7 +153,334 @@ void* consumer(void* arg) {
     return NULL;
 }
 
-int main() {
+/*
+ * Fan-In Mode
+ * ===========
+ */
+#define FANIN_CAPACITY 1024         // Bounded queue capacity in fan-in mode
+#define FANIN_MAX_PRODUCERS 64
+
+typedef struct {
+    long seq;
+    long missing;                   // End-of-stream marker: items never sent
+    mpsc_node_t node;
+} work_item_t;
+
+typedef struct {
+    int id;
+    long items;
+    int use_mpsc;
+    uint64_t *latency_ns;           // One sample per handoff
+    mpsc_pool_t pool;
+    mpsc_node_t *marker;            // Reserved to report an early stop
+} fanin_producer_t;
+
+static mpsc_queue_t fanin_mpsc;
+static bounded_queue_t fanin_bounded;
+
+static void *fanin_producer(void *arg) {
+    fanin_producer_t *p = (fanin_producer_t *)arg;
+
+    for (long i = 0; i < p->items; i++) {
+        long seq = p->id * p->items + i;
+        uint64_t start = locks_now_ns();
+        if (p->use_mpsc) {
+            mpsc_node_t *node = mpsc_pool_get(&p->pool);
+            if (node == NULL) {
+                // Tell the consumer how many items will never come
+                fprintf(stderr, "Producer %d: out of memory after %ld items\n", p->id, i);
+                mpsc_entry(p->marker, work_item_t, node)->missing = p->items - i;
+                mpsc_queue_push(&fanin_mpsc, p->marker);
+                p->marker = NULL;
+                return NULL;
+            }
+            work_item_t *item = mpsc_entry(node, work_item_t, node);
+            item->seq = seq;
+            item->missing = 0;
+            mpsc_queue_push(&fanin_mpsc, node);
+        } else {
+            bounded_queue_put(&fanin_bounded, &seq);
+        }
+        p->latency_ns[i] = locks_now_ns() - start;
+    }
+    return NULL;
+}
+
+// Single consumer: drains `total` items (fewer if a producer stops
+// early) and returns their checksum
+static long fanin_consume(int use_mpsc, long total) {
+    long sum = 0;
+    for (long i = 0; i < total; i++) {
+        if (use_mpsc) {
+            mpsc_node_t *node = mpsc_queue_pop_wait(&fanin_mpsc);
+            work_item_t *item = mpsc_entry(node, work_item_t, node);
+            if (item->missing > 0) {
+                total -= item->missing;
+                i--;
+            } else {
+                sum += item->seq;
+            }
+            mpsc_pool_put(node);
+        } else {
+            long seq;
+            bounded_queue_get(&fanin_bounded, &seq);
+            sum += seq;
+        }
+    }
+    return sum;
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void fanin_run(int use_mpsc, int num_producers, long items) {
+    pthread_t threads[FANIN_MAX_PRODUCERS];
+    fanin_producer_t producers[FANIN_MAX_PRODUCERS];
+    long total = num_producers * items;
+    uint64_t *samples = malloc(total * sizeof(uint64_t));
+    unsigned long allocated = 0;
+
+    if (samples == NULL) {
+        fprintf(stderr, "Out of memory for %ld latency samples\n", total);
+        exit(1);
+    }
+    mpsc_queue_init(&fanin_mpsc);
+    bounded_queue_init(&fanin_bounded, FANIN_CAPACITY, sizeof(long));
+
+    double start = GetTime();
+    for (int i = 0; i < num_producers; i++) {
+        producers[i].id = i;
+        producers[i].items = items;
+        producers[i].use_mpsc = use_mpsc;
+        producers[i].latency_ns = samples + i * items;
+        mpsc_pool_init(&producers[i].pool, sizeof(work_item_t),
+                       offsetof(work_item_t, node));
+        producers[i].marker = use_mpsc ? mpsc_pool_get(&producers[i].pool) : NULL;
+        if (use_mpsc && producers[i].marker == NULL) {
+            fprintf(stderr, "Out of memory for producer %d\n", i);
+            exit(1);
+        }
+        pthread_create(&threads[i], NULL, fanin_producer, &producers[i]);
+    }
+    long sum = fanin_consume(use_mpsc, total);
+    for (int i = 0; i < num_producers; i++) {
+        pthread_join(threads[i], NULL);
+        if (producers[i].marker != NULL) {
+            mpsc_pool_put(producers[i].marker);
+        }
+        allocated += producers[i].pool.allocated;
+        mpsc_pool_destroy(&producers[i].pool);
+    }
+    double elapsed = GetTime() - start;
+
+    mpsc_queue_destroy(&fanin_mpsc);
+    bounded_queue_destroy(&fanin_bounded);
+
+    qsort(samples, total, sizeof(uint64_t), compare_u64);
+    printf("%-8s %9d %12.0f %9lu %9lu %10lu %10lu  %s\n",
+           use_mpsc ? "mpsc" : "bounded", num_producers, total / elapsed,
+           (unsigned long)samples[total / 2],
+           (unsigned long)samples[(long)(total * 0.99)],
+           (unsigned long)samples[total - 1], allocated,
+           sum == total * (total - 1) / 2 ? "ok" : "MISMATCH");
+    free(samples);
+}
+
+static int fanin_benchmark(int argc, char *argv[]) {
+    int max_producers = argc > 0 ? atoi(argv[0]) : FANIN_MAX_PRODUCERS;
+    long items = argc > 1 ? atol(argv[1]) : 20000;
+
+    if (max_producers < 1 || max_producers > FANIN_MAX_PRODUCERS || items < 1) {
+        fprintf(stderr, "Usage: bounded_buffer mpsc [max_producers 1-%d] [items per producer]\n",
+                FANIN_MAX_PRODUCERS);
+        return 1;
+    }
+
+    printf("Fan-in: N producers x %ld items -> 1 consumer (bounded capacity %d)\n",
+           items, FANIN_CAPACITY);
+    printf("Producer latency = time spent in put/push, in ns\n\n");
+    printf("%-8s %9s %12s %9s %9s %10s %10s  %s\n", "queue", "producers",
+           "items/s", "p50(ns)", "p99(ns)", "max(ns)", "nodes", "check");
+
+    for (int n = 1; n <= max_producers; n *= 2) {
+        fanin_run(0, n, items);
+        fanin_run(1, n, items);
+    }
+    return 0;
+}
+
+/*
+ * Batch Mode
+ * ==========
+ */
+#define BATCH_MAX 64
+#define BATCH_CAPACITY 256
+#define BATCH_SENTINEL -1L              // Tells one consumer to stop
+
+typedef enum { CONSUME_SINGLE, CONSUME_BATCH, CONSUME_BATCH_SPIN } consume_mode_t;
+static const char *consume_mode_names[] = { "single", "batch", "batch+spin" };
+
+typedef struct {
+    long items;
+    long work_ns;                       // Busy work between items
+    long first;
+} batch_producer_t;
+
+typedef struct {
+    consume_mode_t mode;
+    long sum;
+    bounded_queue_consumer_t stats;
+} batch_consumer_t;
+
+static bounded_queue_t batch_queue;
+
+static void busy_work(long ns) {
+    if (ns > 0) {
+        uint64_t end = locks_now_ns() + (uint64_t)ns;
+        while (locks_now_ns() < end) {
+        }
+    }
+}
+
+static void *batch_producer(void *arg) {
+    batch_producer_t *p = (batch_producer_t *)arg;
+    for (long i = 0; i < p->items; i++) {
+        long item = p->first + i;
+        busy_work(p->work_ns);
+        bounded_queue_put(&batch_queue, &item);
+    }
+    return NULL;
+}
+
+static void *batch_consumer(void *arg) {
+    batch_consumer_t *c = (batch_consumer_t *)arg;
+    long items[BATCH_MAX];
+
+    for (;;) {
+        size_t n;
+        if (c->mode == CONSUME_SINGLE) {
+            bounded_queue_get(&batch_queue, &items[0]);
+            c->stats.batches++;
+            c->stats.items++;
+            n = 1;
+        } else {
+            n = bounded_queue_get_batch(&batch_queue, items, BATCH_MAX, &c->stats,
+                                        c->mode == CONSUME_BATCH_SPIN);
+        }
+
+        int stop = 0;
+        for (size_t i = 0; i < n; i++) {
+            if (items[i] != BATCH_SENTINEL) {
+                c->sum += items[i];
+            } else if (!stop) {
+                stop = 1;
+            } else {
+                // Drained a sentinel meant for another consumer
+                bounded_queue_put(&batch_queue, &items[i]);
+            }
+        }
+        if (stop) {
+            return NULL;
+        }
+    }
+}
+
+static void batch_run(consume_mode_t mode, int num_producers, long items, long work_ns) {
+    pthread_t producers[NUM_PRODUCERS * 8], consumers[NUM_CONSUMERS];
+    batch_producer_t prod[NUM_PRODUCERS * 8];
+    batch_consumer_t cons[NUM_CONSUMERS];
+    struct rusage before, after;
+    long sum = 0, total = num_producers * items;
+    unsigned long batches = 0, sleeps = 0, spin_hits = 0;
+
+    bounded_queue_init(&batch_queue, BATCH_CAPACITY, sizeof(long));
+    getrusage(RUSAGE_SELF, &before);
+    double start = GetTime();
+
+    for (int i = 0; i < NUM_CONSUMERS; i++) {
+        memset(&cons[i], 0, sizeof(cons[i]));
+        cons[i].mode = mode;
+        pthread_create(&consumers[i], NULL, batch_consumer, &cons[i]);
+    }
+    for (int i = 0; i < num_producers; i++) {
+        prod[i].items = items;
+        prod[i].work_ns = work_ns;
+        prod[i].first = i * items;
+        pthread_create(&producers[i], NULL, batch_producer, &prod[i]);
+    }
+    for (int i = 0; i < num_producers; i++) {
+        pthread_join(producers[i], NULL);
+    }
+    for (int i = 0; i < NUM_CONSUMERS; i++) {
+        long sentinel = BATCH_SENTINEL;
+        bounded_queue_put(&batch_queue, &sentinel);
+    }
+    for (int i = 0; i < NUM_CONSUMERS; i++) {
+        pthread_join(consumers[i], NULL);
+        sum += cons[i].sum;
+        batches += cons[i].stats.batches;
+        sleeps += cons[i].stats.sleeps;
+        spin_hits += cons[i].stats.spin_hits;
+    }
+
+    double elapsed = GetTime() - start;
+    getrusage(RUSAGE_SELF, &after);
+    bounded_queue_destroy(&batch_queue);
+
+    double cpu = (after.ru_utime.tv_sec - before.ru_utime.tv_sec) +
+                 (after.ru_utime.tv_usec - before.ru_utime.tv_usec) / 1e6 +
+                 (after.ru_stime.tv_sec - before.ru_stime.tv_sec) +
+                 (after.ru_stime.tv_usec - before.ru_stime.tv_usec) / 1e6;
+
+    char sleeps_text[32];
+    if (mode == CONSUME_SINGLE) {
+        strcpy(sleeps_text, "-");       // bounded_queue_get() keeps no stats
+    } else {
+        snprintf(sleeps_text, sizeof(sleeps_text), "%lu", sleeps);
+    }
+    printf("%-11s %8ld %12.0f %8.2f %7.0f%% %9.1f %9s %9lu  %s\n",
+           consume_mode_names[mode], work_ns, total / elapsed, cpu,
+           100.0 * cpu / elapsed, (double)total / batches, sleeps_text, spin_hits,
+           sum == total * (total - 1) / 2 ? "ok" : "MISMATCH");
+}
+
+static int batch_benchmark(int argc, char *argv[]) {
+    int num_producers = argc > 0 ? atoi(argv[0]) : NUM_PRODUCERS;
+    long items = argc > 1 ? atol(argv[1]) : 200000;
+    long work[] = { 0, 1000, 20000 };
+
+    if (num_producers < 1 || num_producers > NUM_PRODUCERS * 8 || items < 1) {
+        fprintf(stderr, "Usage: bounded_buffer batch [producers 1-%d] [items per producer]\n",
+                NUM_PRODUCERS * 8);
+        return 1;
+    }
+
+    printf("Batch consumers: %d producers x %ld items -> %d consumers, capacity %d, batch <= %d\n",
+           num_producers, items, NUM_CONSUMERS, BATCH_CAPACITY, BATCH_MAX);
+    printf("work = producer busy time per item; cpu = process CPU seconds (user + sys)\n\n");
+    printf("%-11s %8s %12s %8s %8s %9s %9s %9s  %s\n", "consumer", "work(ns)",
+           "items/s", "cpu(s)", "cpu", "per-lock", "sleeps", "spin-hits", "check");
+
+    for (size_t w = 0; w < sizeof(work) / sizeof(work[0]); w++) {
+        // Keep the slow-producer runs short
+        long n = work[w] > 0 ? items / (1 + work[w] / 1000) : items;
+        for (consume_mode_t m = CONSUME_SINGLE; m <= CONSUME_BATCH_SPIN; m++) {
+            batch_run(m, num_producers, n, work[w]);
+        }
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    if (argc > 1 && strcmp(argv[1], "batch") == 0) {
+        return batch_benchmark(argc - 2, argv + 2);
+    }
+    if (argc > 1 && strcmp(argv[1], "mpsc") == 0) {
+        return fanin_benchmark(argc - 2, argv + 2);
+    }
+    
     // Thread identifiers
     pthread_t producers[NUM_PRODUCERS];
     pthread_t consumers[NUM_CONSUMERS];
@@ -113,10 +492,17 @@ int main() {
     // Seed the random number generator
     srand(time(NULL));
     
+    if (bounded_queue_init(&buffer, BUFFER_SIZE, sizeof(int)) != 0) {
+        fprintf(stderr, "Failed to allocate the buffer\n");
+        return 1;
+    }
+    flow_metrics_init(&flow, buffer.capacity, HIGH_WATERMARK, LOW_WATERMARK);
+    flow_metrics_on_watermark(&flow, on_high_watermark, on_low_watermark, NULL);
+    
     printf("Bounded Buffer Problem - Condition Variables Demonstration\n");
     printf("-------------------------------------------------------\n");
-    printf("Buffer size: %d, Producers: %d, Consumers: %d\n", 
-           BUFFER_SIZE, NUM_PRODUCERS, NUM_CONSUMERS);
+    printf("Buffer size: %zu, Producers: %d, Consumers: %d\n", 
+           buffer.capacity, NUM_PRODUCERS, NUM_CONSUMERS);
     printf("Each producer creates %d items, each consumer consumes %d items\n",
            ITEMS_PER_PRODUCER, ITEMS_PER_CONSUMER);
     printf("-------------------------------------------------------\n\n");
@@ -144,12 +530,15 @@ int main() {
     }
     
     printf("\n-------------------------------------------------------\n");
-    printf("All threads completed successfully.\n");
+    printf("All threads completed successfully.\n\n");
+    
+    flow_snapshot_t snap;
+    flow_metrics_snapshot(&flow, &snap);
+    flow_snapshot_print(&snap);
+    flow_metrics_destroy(&flow);
     
-    // Clean up synchronization primitives
-    pthread_mutex_destroy(&mutex);
-    pthread_cond_destroy(&not_full);
-    pthread_cond_destroy(&not_empty);
+    // Free the buffer and its synchronization primitives
+    bounded_queue_destroy(&buffer);
     
     return 0;
 }
\ No newline at end of file
@@ -0,0 +1,243 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+
+#include "../../common.h"
+#include "../../bounded_queue.h"
+#include "../../disruptor.h"
+
+/*
+ * disruptor_benchmark.c - Multicast: every consumer sees every item
+ *
+ * One producer (two in the `disruptor-2p` rows) publishes items; each
+ * of K consumers must process all of them. Compared:
+ *
+ *   queue-fanout   one bounded_queue_t per consumer; the producer puts
+ *                  every item into all K queues (K copies, K locks)
+ *   queue+batch    the same, with consumers draining their queue in
+ *                  batches (bounded_queue_get_batch)
+ *   disruptor      one disruptor.h ring; every consumer reads every
+ *                  entry in place and only advances its own cursor
+ *   chain          the same ring, but consumer i depends on consumer
+ *                  i-1 (a sequence barrier): it may only see an entry
+ *                  after i-1 has finished with it. Each consumer stamps
+ *                  the entry, and the next one checks the stamp.
+ *   disruptor-2p   two producers claiming slots with fetch-and-add
+ *
+ * Check: every consumer gets every item exactly once, and (one
+ * producer) in order. `batch` is the average number of entries a
+ * consumer found waiting per wait/get call.
+ *
+ * Usage: ./disruptor_benchmark [items] [max_consumers]
+ */
+
+#define RING_SIZE 1024
+#define MAX_CONSUMERS 16
+#define BATCH_MAX 64
+
+typedef struct {
+    int64_t seq;
+    int64_t value;
+    int64_t stamp;              // chain: last consumer that processed it
+    char payload[40];
+} entry_t;
+
+typedef enum { QUEUE_FANOUT, QUEUE_BATCH, DISRUPTOR, CHAIN, DISRUPTOR_2P } bench_mode_t;
+
+static const char *mode_names[] = {
+    "queue-fanout", "queue+batch", "disruptor", "chain", "disruptor-2p"
+};
+
+typedef struct {
+    int id;
+    bench_mode_t mode;
+    long items;                 // Items to receive
+    int producers;
+    unsigned long sum;
+    int errors;
+    unsigned long calls;        // Wait/get calls, for the batch column
+    bounded_queue_t *queue;
+    disruptor_consumer_t *cursor;
+} consumer_t;
+
+typedef struct {
+    int id;
+    bench_mode_t mode;
+    long items;                 // Items this producer sends
+    int consumers;
+} producer_t;
+
+static bounded_queue_t queues[MAX_CONSUMERS];
+static disruptor_t ring;
+static disruptor_consumer_t cursors[MAX_CONSUMERS];
+
+static void *producer(void *arg) {
+    producer_t *p = (producer_t *)arg;
+
+    for (long i = 0; i < p->items; i++) {
+        int64_t value = i * 2 + p->id;          // Distinct across 2 producers
+        if (p->mode == QUEUE_FANOUT || p->mode == QUEUE_BATCH) {
+            entry_t e = { .seq = i, .value = value, .stamp = 0 };
+            for (int c = 0; c < p->consumers; c++) {
+                bounded_queue_put(&queues[c], &e);
+            }
+        } else {
+            int64_t seq = disruptor_claim(&ring, 1);
+            entry_t *e = disruptor_entry(&ring, seq);
+            e->seq = seq;
+            e->value = p->mode == DISRUPTOR_2P ? value : seq * 2;
+            e->stamp = 0;
+            disruptor_publish(&ring, seq, seq);
+        }
+    }
+    return NULL;
+}
+
+// Check one received entry; `expect` is its position in the stream
+static inline void consume(consumer_t *c, const entry_t *e, long expect) {
+    c->sum += (unsigned long)e->value;
+    if (c->producers == 1 && (e->seq != expect || e->value != expect * 2)) {
+        c->errors++;
+    }
+}
+
+static void *consumer(void *arg) {
+    consumer_t *c = (consumer_t *)arg;
+    long received = 0;
+
+    if (c->mode == QUEUE_FANOUT) {
+        entry_t e;
+        while (received < c->items) {
+            bounded_queue_get(c->queue, &e);
+            c->calls++;
+            consume(c, &e, received++);
+        }
+    } else if (c->mode == QUEUE_BATCH) {
+        entry_t batch[BATCH_MAX];
+        bounded_queue_consumer_t stats = { 0 };
+        while (received < c->items) {
+            size_t n = bounded_queue_get_batch(c->queue, batch, BATCH_MAX, &stats, 1);
+            c->calls++;
+            for (size_t i = 0; i < n; i++) {
+                consume(c, &batch[i], received++);
+            }
+        }
+    } else {
+        int64_t next = 0;
+        while (next < c->items) {
+            int64_t avail = disruptor_wait(c->cursor, next);
+            c->calls++;
+            for (; next <= avail; next++) {
+                entry_t *e = disruptor_entry(&ring, next);
+                consume(c, e, next);
+                if (c->mode == CHAIN) {
+                    // The barrier guarantees consumer id-1 is done with it
+                    if (e->stamp != c->id) {
+                        c->errors++;
+                    }
+                    e->stamp = c->id + 1;
+                }
+            }
+            disruptor_release(c->cursor, avail);
+        }
+    }
+    return NULL;
+}
+
+static void run(bench_mode_t mode, int num_consumers, long items) {
+    pthread_t threads[MAX_CONSUMERS + 2];
+    consumer_t consumers[MAX_CONSUMERS];
+    producer_t producers[2];
+    int num_producers = mode == DISRUPTOR_2P ? 2 : 1;
+    long per_producer = items / num_producers;
+    long total = per_producer * num_producers;
+
+    if (mode == QUEUE_FANOUT || mode == QUEUE_BATCH) {
+        for (int c = 0; c < num_consumers; c++) {
+            bounded_queue_init(&queues[c], RING_SIZE, sizeof(entry_t));
+        }
+    } else {
+        disruptor_init(&ring, RING_SIZE, sizeof(entry_t), mode == DISRUPTOR_2P);
+        for (int c = 0; c < num_consumers; c++) {
+            disruptor_consumer_t *dep = c > 0 ? &cursors[c - 1] : NULL;
+            disruptor_consumer_init(&cursors[c], &ring, &dep,
+                                    mode == CHAIN && c > 0 ? 1 : 0);
+        }
+    }
+
+    double start = GetTime();
+    for (int c = 0; c < num_consumers; c++) {
+        consumer_t *w = &consumers[c];
+        memset(w, 0, sizeof(*w));
+        w->id = c;
+        w->mode = mode;
+        w->items = total;
+        w->producers = num_producers;
+        w->queue = &queues[c];
+        w->cursor = &cursors[c];
+        pthread_create(&threads[c], NULL, consumer, w);
+    }
+    for (int p = 0; p < num_producers; p++) {
+        producers[p] = (producer_t){ .id = p, .mode = mode, .items = per_producer,
+                                     .consumers = num_consumers };
+        pthread_create(&threads[num_consumers + p], NULL, producer, &producers[p]);
+    }
+    for (int i = 0; i < num_consumers + num_producers; i++) {
+        pthread_join(threads[i], NULL);
+    }
+    double elapsed = GetTime() - start;
+
+    // Sum of all values sent: 2*i + id for each producer and i
+    unsigned long expected = 0;
+    for (int p = 0; p < num_producers; p++) {
+        expected += (unsigned long)per_producer * (per_producer - 1) + (unsigned long)p * per_producer;
+    }
+    int ok = 1;
+    unsigned long calls = 0, sleeps = 0;
+    for (int c = 0; c < num_consumers; c++) {
+        ok &= consumers[c].sum == expected && consumers[c].errors == 0;
+        calls += consumers[c].calls;
+        if (mode != QUEUE_FANOUT && mode != QUEUE_BATCH) {
+            sleeps += cursors[c].sleeps;
+        }
+    }
+
+    printf("%-13s %9d %12.0f %9.1f %7.1f %9lu  %s\n", mode_names[mode], num_consumers,
+           total / elapsed, 1e9 * elapsed / total,
+           (double)total * num_consumers / calls, sleeps, ok ? "ok" : "MISMATCH");
+
+    if (mode == QUEUE_FANOUT || mode == QUEUE_BATCH) {
+        for (int c = 0; c < num_consumers; c++) {
+            bounded_queue_destroy(&queues[c]);
+        }
+    } else {
+        disruptor_destroy(&ring);
+    }
+    if (!ok) {
+        exit(1);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    long items = argc > 1 ? atol(argv[1]) : 1000000;
+    int max_consumers = argc > 2 ? atoi(argv[2]) : 4;
+
+    if (items < 2 || max_consumers < 1 || max_consumers > MAX_CONSUMERS) {
+        fprintf(stderr, "Usage: %s [items] [max_consumers 1-%d]\n", argv[0], MAX_CONSUMERS);
+        return 1;
+    }
+
+    printf("Multicast benchmark: %ld items, ring/queue size %d, %zu-byte entries\n\n",
+           items, RING_SIZE, sizeof(entry_t));
+    printf("%-13s %9s %12s %9s %7s %9s  %s\n",
+           "mode", "consumers", "items/s", "ns/item", "batch", "sleeps", "check");
+    for (int k = 1; k <= max_consumers; k *= 2) {
+        for (int m = QUEUE_FANOUT; m <= DISRUPTOR_2P; m++) {
+            run((bench_mode_t)m, k, items);
+        }
+    }
+    return 0;
+}
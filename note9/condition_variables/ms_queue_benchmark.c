@@ -0,0 +1,447 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <sched.h>
+#include <pthread.h>
+
+#include "../../common.h"
+#include "../../bounded_queue.h"
+#include "../../ms_queue.h"
+
+/*
+ * ms_queue_benchmark.c - Lock-free Michael-Scott queue: checks and speed
+ *
+ * Three modes:
+ *
+ *   stress  - P producers and C consumers move tagged values
+ *             (producer id, sequence number) through the MS queue under
+ *             both reclamation schemes. Checks that every value arrives
+ *             exactly once and that each consumer sees every producer's
+ *             values in increasing order (FIFO per producer).
+ *
+ *   aba     - Every thread repeatedly dequeues a value and enqueues it
+ *             again on a queue that holds only a handful of values.
+ *             Each dequeue frees a node and each enqueue mallocs one, so
+ *             the allocator keeps recycling the same few addresses: the
+ *             worst case for ABA. Checks that the multiset of values in
+ *             the queue is unchanged at the end.
+ *
+ *   bench   - Throughput for several producer/consumer mixes of
+ *               ms-hazard  MS queue, hazard-pointer reclamation
+ *               ms-epoch   MS queue, epoch-based reclamation
+ *               condvar    bounded_queue_t (mutex + condition variables,
+ *                          the buffer_t replacement from producer_consumer.c)
+ *               ring       lock-free bounded ring with per-slot sequence
+ *                          numbers (Vyukov's MPMC array queue)
+ *
+ * Usage: ./ms_queue_benchmark [stress|aba|bench] [items] [max threads per side]
+ */
+
+#define MAX_SIDE 32
+#define RING_CAPACITY 1024
+
+typedef enum { Q_MS_HAZARD, Q_MS_EPOCH, Q_CONDVAR, Q_RING } queue_kind_t;
+static const char *queue_names[] = { "ms-hazard", "ms-epoch", "condvar", "ring" };
+
+/*
+ * Lock-Free Bounded Ring (Vyukov)
+ * ===============================
+ *
+ * Slot i carries a sequence number: seq == pos means free for the
+ * producer claiming position pos, seq == pos + 1 means it holds the
+ * value for the consumer claiming pos. Producers and consumers claim
+ * positions with CAS on their own counter.
+ */
+typedef struct {
+    size_t seq;
+    void *value;
+} ring_slot_t;
+
+static struct {
+    ring_slot_t slots[RING_CAPACITY];
+    char pad1[64];
+    size_t enqueue_pos;
+    char pad2[64];
+    size_t dequeue_pos;
+} ring;
+
+static void ring_init(void) {
+    for (size_t i = 0; i < RING_CAPACITY; i++) {
+        ring.slots[i].seq = i;
+    }
+    ring.enqueue_pos = ring.dequeue_pos = 0;
+}
+
+static int ring_try_put(void *value) {
+    size_t pos = __atomic_load_n(&ring.enqueue_pos, __ATOMIC_RELAXED);
+    for (;;) {
+        ring_slot_t *slot = &ring.slots[pos & (RING_CAPACITY - 1)];
+        size_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        long diff = (long)seq - (long)pos;
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&ring.enqueue_pos, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                slot->value = value;
+                __atomic_store_n(&slot->seq, pos + 1, __ATOMIC_RELEASE);
+                return 1;
+            }
+        } else if (diff < 0) {
+            return 0;                   // Full
+        } else {
+            pos = __atomic_load_n(&ring.enqueue_pos, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+static int ring_try_get(void **value) {
+    size_t pos = __atomic_load_n(&ring.dequeue_pos, __ATOMIC_RELAXED);
+    for (;;) {
+        ring_slot_t *slot = &ring.slots[pos & (RING_CAPACITY - 1)];
+        size_t seq = __atomic_load_n(&slot->seq, __ATOMIC_ACQUIRE);
+        long diff = (long)seq - (long)(pos + 1);
+        if (diff == 0) {
+            if (__atomic_compare_exchange_n(&ring.dequeue_pos, &pos, pos + 1, 1,
+                                            __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+                *value = slot->value;
+                __atomic_store_n(&slot->seq, pos + RING_CAPACITY, __ATOMIC_RELEASE);
+                return 1;
+            }
+        } else if (diff < 0) {
+            return 0;                   // Empty
+        } else {
+            pos = __atomic_load_n(&ring.dequeue_pos, __ATOMIC_RELAXED);
+        }
+    }
+}
+
+/*
+ * Common Driver
+ * =============
+ */
+static queue_kind_t kind;
+static ms_queue_t msq;
+static bounded_queue_t condvar_queue;
+static long consumed_total;             // Shared count, ends the consumers
+static long target_total;
+
+typedef struct {
+    int id;
+    long items;                         // Producers: values to send
+    int num_producers;
+    long *last_seq;                     // Consumers: per-producer last seen
+    unsigned char *seen;                // Stress: one byte per value
+    long received;
+    long order_errors;
+    long duplicates;
+    unsigned long freed;                // Nodes this thread reclaimed
+} worker_t;
+
+static inline uintptr_t encode(int producer, long seq) {
+    return ((uintptr_t)producer << 40) | (uintptr_t)seq;
+}
+
+static void put(ms_thread_t *t, void *value) {
+    switch (kind) {
+        case Q_MS_HAZARD:
+        case Q_MS_EPOCH:
+            ms_queue_enqueue(&msq, t, value);
+            break;
+        case Q_CONDVAR:
+            bounded_queue_put(&condvar_queue, &value);
+            break;
+        case Q_RING:
+            while (!ring_try_put(value)) {
+                sched_yield();
+            }
+            break;
+    }
+}
+
+// Non-blocking get; the condvar queue uses a short timed wait so that
+// consumers notice when everything has been consumed
+static int get(ms_thread_t *t, void **value) {
+    switch (kind) {
+        case Q_MS_HAZARD:
+        case Q_MS_EPOCH:
+            return ms_queue_dequeue(&msq, t, value);
+        case Q_CONDVAR:
+            return bounded_queue_timed_get(&condvar_queue, value, 1000000) == 0;
+        case Q_RING:
+            return ring_try_get(value);
+    }
+    return 0;
+}
+
+static void *producer(void *arg) {
+    worker_t *w = (worker_t *)arg;
+    ms_thread_t *t = kind <= Q_MS_EPOCH ? ms_queue_register(&msq) : NULL;
+
+    for (long i = 0; i < w->items; i++) {
+        put(t, (void *)encode(w->id, i));
+    }
+    if (t != NULL) {
+        w->freed = t->freed;
+        ms_queue_unregister(&msq, t);
+    }
+    return NULL;
+}
+
+static void *consumer(void *arg) {
+    worker_t *w = (worker_t *)arg;
+    ms_thread_t *t = kind <= Q_MS_EPOCH ? ms_queue_register(&msq) : NULL;
+    void *value;
+
+    while (__atomic_load_n(&consumed_total, __ATOMIC_RELAXED) < target_total) {
+        if (!get(t, &value)) {
+            sched_yield();
+            continue;
+        }
+        __atomic_fetch_add(&consumed_total, 1, __ATOMIC_RELAXED);
+        w->received++;
+
+        if (w->last_seq != NULL) {
+            int producer = (int)((uintptr_t)value >> 40);
+            long seq = (long)((uintptr_t)value & ((1UL << 40) - 1));
+            if (seq <= w->last_seq[producer]) {
+                w->order_errors++;
+            }
+            w->last_seq[producer] = seq;
+            // Each value has its own byte, so no two threads share one
+            unsigned char *mark = &w->seen[producer * w->items + seq];
+            if (__atomic_exchange_n(mark, 1, __ATOMIC_RELAXED)) {
+                w->duplicates++;
+            }
+        }
+    }
+    if (t != NULL) {
+        w->freed = t->freed;
+        ms_queue_unregister(&msq, t);
+    }
+    return NULL;
+}
+
+typedef struct {
+    double elapsed;
+    long received, order_errors, duplicates, missing;
+    unsigned long freed;
+} result_t;
+
+static result_t run(queue_kind_t k, int producers, int consumers, long items, int check) {
+    pthread_t threads[2 * MAX_SIDE];
+    worker_t workers[2 * MAX_SIDE];
+    unsigned char *seen = NULL;
+    result_t r;
+
+    memset(&r, 0, sizeof(r));
+    memset(workers, 0, sizeof(workers));
+    kind = k;
+    consumed_total = 0;
+    target_total = producers * items;
+
+    if (k <= Q_MS_EPOCH) {
+        ms_queue_init(&msq, k == Q_MS_HAZARD ? MS_RECLAIM_HAZARD : MS_RECLAIM_EPOCH);
+    } else if (k == Q_CONDVAR) {
+        bounded_queue_init(&condvar_queue, RING_CAPACITY, sizeof(void *));
+    } else {
+        ring_init();
+    }
+    if (check) {
+        seen = calloc(target_total, 1);
+    }
+
+    double start = GetTime();
+    for (int i = 0; i < producers + consumers; i++) {
+        worker_t *w = &workers[i];
+        w->id = i;
+        w->items = items;
+        w->num_producers = producers;
+        if (i < producers) {
+            pthread_create(&threads[i], NULL, producer, w);
+        } else {
+            if (check) {
+                w->last_seq = malloc(producers * sizeof(long));
+                for (int p = 0; p < producers; p++) {
+                    w->last_seq[p] = -1;
+                }
+                w->seen = seen;
+            }
+            pthread_create(&threads[i], NULL, consumer, w);
+        }
+    }
+    for (int i = 0; i < producers + consumers; i++) {
+        pthread_join(threads[i], NULL);
+        r.received += workers[i].received;
+        r.order_errors += workers[i].order_errors;
+        r.duplicates += workers[i].duplicates;
+        r.freed += workers[i].freed;
+        free(workers[i].last_seq);
+    }
+    r.elapsed = GetTime() - start;
+
+    if (check) {
+        for (long i = 0; i < target_total; i++) {
+            r.missing += !seen[i];
+        }
+        free(seen);
+    }
+    if (k <= Q_MS_EPOCH) {
+        ms_queue_destroy(&msq);
+    } else if (k == Q_CONDVAR) {
+        bounded_queue_destroy(&condvar_queue);
+    }
+    return r;
+}
+
+/*
+ * Modes
+ * =====
+ */
+static int stress(long items, int max_side) {
+    int failures = 0;
+
+    printf("Stress: every value exactly once, FIFO per producer\n\n");
+    printf("%-10s %5s %5s %10s %8s %6s %6s %10s  %s\n", "queue", "prod", "cons",
+           "values", "missing", "dups", "order", "reclaimed", "check");
+
+    for (queue_kind_t k = Q_MS_HAZARD; k <= Q_MS_EPOCH; k++) {
+        for (int p = 1; p <= max_side; p *= 2) {
+            for (int c = 1; c <= max_side; c *= 2) {
+                result_t r = run(k, p, c, items, 1);
+                int ok = r.received == p * items && r.missing == 0 &&
+                         r.duplicates == 0 && r.order_errors == 0;
+                failures += !ok;
+                printf("%-10s %5d %5d %10ld %8ld %6ld %6ld %10lu  %s\n",
+                       queue_names[k], p, c, r.received, r.missing, r.duplicates,
+                       r.order_errors, r.freed, ok ? "ok" : "FAILED");
+            }
+        }
+    }
+    return failures ? 1 : 0;
+}
+
+#define ABA_VALUES 4                    // Values circulating in the queue
+
+typedef struct {
+    long rounds;
+    unsigned long freed;
+} aba_worker_t;
+
+static void *aba_worker(void *arg) {
+    aba_worker_t *w = (aba_worker_t *)arg;
+    ms_thread_t *t = ms_queue_register(&msq);
+    void *value;
+
+    for (long i = 0; i < w->rounds; i++) {
+        if (ms_queue_dequeue(&msq, t, &value)) {
+            ms_queue_enqueue(&msq, t, value);
+        }
+    }
+    w->freed = t->freed;
+    ms_queue_unregister(&msq, t);
+    return NULL;
+}
+
+static int aba(long rounds, int max_threads) {
+    int failures = 0;
+
+    printf("ABA: threads dequeue and re-enqueue %d values; nodes are freed and\n"
+           "reallocated constantly, so the same addresses keep coming back\n\n",
+           ABA_VALUES);
+    printf("%-10s %7s %10s %10s  %s\n", "queue", "threads", "rounds", "reclaimed", "check");
+
+    for (queue_kind_t k = Q_MS_HAZARD; k <= Q_MS_EPOCH; k++) {
+        for (int n = 2; n <= 2 * max_threads; n *= 2) {
+            pthread_t threads[2 * MAX_SIDE];
+            aba_worker_t workers[2 * MAX_SIDE];
+            unsigned long freed = 0;
+            int counts[ABA_VALUES] = { 0 };
+            void *value;
+
+            ms_queue_init(&msq, k == Q_MS_HAZARD ? MS_RECLAIM_HAZARD : MS_RECLAIM_EPOCH);
+            ms_thread_t *t = ms_queue_register(&msq);
+            for (long v = 0; v < ABA_VALUES; v++) {
+                ms_queue_enqueue(&msq, t, (void *)v);
+            }
+            for (int i = 0; i < n; i++) {
+                workers[i].rounds = rounds;
+                pthread_create(&threads[i], NULL, aba_worker, &workers[i]);
+            }
+            for (int i = 0; i < n; i++) {
+                pthread_join(threads[i], NULL);
+                freed += workers[i].freed;
+            }
+
+            // A lost, duplicated or corrupted node shows up here
+            int total = 0, ok = 1;
+            while (ms_queue_dequeue(&msq, t, &value)) {
+                if ((uintptr_t)value >= ABA_VALUES) {
+                    ok = 0;
+                    break;
+                }
+                counts[(uintptr_t)value]++;
+                total++;
+            }
+            for (int v = 0; v < ABA_VALUES; v++) {
+                ok &= counts[v] == 1;
+            }
+            ok &= total == ABA_VALUES;
+            ms_queue_unregister(&msq, t);
+            ms_queue_destroy(&msq);
+
+            failures += !ok;
+            printf("%-10s %7d %10ld %10lu  %s\n", queue_names[k], n, rounds * n,
+                   freed, ok ? "ok" : "FAILED");
+        }
+    }
+    return failures ? 1 : 0;
+}
+
+static int bench(long items, int max_side) {
+    int mixes[][2] = { {1, 1}, {1, 4}, {4, 1}, {4, 4}, {16, 16} };
+
+    printf("Throughput (values/s), %ld values per producer\n\n", items);
+    printf("%5s %5s", "prod", "cons");
+    for (queue_kind_t k = Q_MS_HAZARD; k <= Q_RING; k++) {
+        printf(" %12s", queue_names[k]);
+    }
+    printf("\n");
+
+    for (size_t m = 0; m < sizeof(mixes) / sizeof(mixes[0]); m++) {
+        int p = mixes[m][0], c = mixes[m][1];
+        if (p > max_side || c > max_side) {
+            continue;
+        }
+        printf("%5d %5d", p, c);
+        for (queue_kind_t k = Q_MS_HAZARD; k <= Q_RING; k++) {
+            result_t r = run(k, p, c, items, 0);
+            printf(" %12.0f", r.received / r.elapsed);
+            fflush(stdout);
+        }
+        printf("\n");
+    }
+    return 0;
+}
+
+int main(int argc, char *argv[]) {
+    const char *mode = argc > 1 ? argv[1] : "bench";
+    long items = argc > 2 ? atol(argv[2]) : 200000;
+    int max_side = argc > 3 ? atoi(argv[3]) : 16;
+
+    if (items < 1 || max_side < 1 || max_side > MAX_SIDE) {
+        fprintf(stderr, "Usage: %s [stress|aba|bench] [items] [max threads per side 1-%d]\n",
+                argv[0], MAX_SIDE);
+        return 1;
+    }
+
+    if (strcmp(mode, "stress") == 0) {
+        return stress(items, max_side);
+    } else if (strcmp(mode, "aba") == 0) {
+        return aba(items, max_side);
+    } else if (strcmp(mode, "bench") == 0) {
+        return bench(items, max_side);
+    }
+    fprintf(stderr, "Unknown mode '%s' (stress, aba or bench)\n", mode);
+    return 1;
+}
@@ -0,0 +1,511 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <pthread.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "../../common.h"
+#include "../../locks.h"
+#include "../../pipeline.h"
+
+/*
+ * pipeline_benchmark.c - A 4-stage pipeline over a large text file
+ *
+ * The input is a CSV file (generated if none is given), cut into chunks
+ * of about CHUNK_SIZE bytes at line boundaries. Each chunk flows
+ * through four stages built with pipeline.h:
+ *
+ *   parse     - split lines and parse the fields into records
+ *   transform - derive new fields and format each record as text again
+ *   compress  - LZ77-style compression
+ *   write     - append the compressed chunk to an output file; ordered,
+ *               one worker, so the file comes out in input order
+ *
+ * Configurations:
+ *
+ *   serial    - one worker per stage
+ *   balanced  - workers set by hand in proportion to each stage's cost
+ *               (transform, which formats doubles, costs the most)
+ *   autotune  - starts at one worker per stage; the pipeline moves
+ *               workers to whichever stage is the bottleneck
+ *   unordered - the balanced counts, but the write stage takes chunks
+ *               in whatever order they finish
+ *
+ * Check: the ordered runs must write a byte-identical file (same hash
+ * of the whole stream) as the serial run, and the unordered run the
+ * same set of chunks. The serial run also decompresses every chunk and
+ * compares it with the transform output.
+ *
+ * Usage: ./pipeline_benchmark [input_file | size_mb] [workers]
+ *
+ * `workers` is the thread budget for the balanced and autotune runs
+ * (default: the number of online CPUs).
+ */
+
+#define CHUNK_SIZE (256 * 1024)
+#define QUEUE_CAPACITY 16
+#define DEFAULT_SIZE_MB 64
+#define MAX_FIELDS 4
+#define HASH_BITS 12
+
+typedef struct {
+    long id;
+    long timestamp;
+    double value;
+    uint32_t name_hash;
+} record_t;
+
+typedef struct {
+    char *text;                 // Input lines
+    size_t len;
+    record_t *records;          // parse
+    size_t count;
+    char *formatted;            // transform
+    size_t formatted_len;
+    unsigned char *compressed;  // compress
+    size_t compressed_len;
+    uint64_t hash;              // FNV-1a of the compressed bytes
+} chunk_t;
+
+static uint64_t fnv1a(uint64_t h, const unsigned char *p, size_t n) {
+    for (size_t i = 0; i < n; i++) {
+        h = (h ^ p[i]) * 1099511628211ULL;
+    }
+    return h;
+}
+
+#define FNV_INIT 14695981039346656037ULL
+
+/*
+ * Input
+ * =====
+ */
+static int generate_input(const char *path, long size_mb) {
+    FILE *f = fopen(path, "w");
+    if (f == NULL) {
+        return -1;
+    }
+    static const char *names[] = { "alpha", "bravo", "charlie", "delta", "echo",
+                                   "foxtrot", "golf", "hotel" };
+    uint64_t x = 88172645463325252ULL;
+    long bytes = 0, id = 0;
+    while (bytes < size_mb * 1024 * 1024) {
+        x ^= x << 13;
+        x ^= x >> 7;
+        x ^= x << 17;
+        int n = fprintf(f, "%ld,%s,%lu.%02lu,%lu\n", id, names[x % 8],
+                        (unsigned long)(x >> 40) % 10000, (unsigned long)(x >> 20) % 100,
+                        1700000000UL + (unsigned long)(id * 7));
+        bytes += n;
+        id++;
+    }
+    fclose(f);
+    return 0;
+}
+
+typedef struct {
+    int fd;
+    char carry[CHUNK_SIZE];     // Partial last line of the previous read
+    size_t carry_len;
+    int eof;
+} reader_t;
+
+// Source: the next chunk, cut at the last newline
+static int read_chunk(void **data, void *arg) {
+    reader_t *r = (reader_t *)arg;
+    if (r->eof && r->carry_len == 0) {
+        return 0;
+    }
+
+    char *buf = malloc(2 * CHUNK_SIZE);
+    memcpy(buf, r->carry, r->carry_len);
+    size_t len = r->carry_len;
+    while (!r->eof && len < CHUNK_SIZE) {
+        ssize_t n = read(r->fd, buf + len, CHUNK_SIZE);
+        if (n <= 0) {
+            r->eof = 1;
+        } else {
+            len += (size_t)n;
+        }
+    }
+
+    size_t cut = len;
+    if (!r->eof) {
+        while (cut > 0 && buf[cut - 1] != '\n') {
+            cut--;
+        }
+        // A line longer than the carry can hold is cut mid-line: its
+        // pieces parse as malformed lines instead of ending the stream
+        if (cut == 0 || len - cut > CHUNK_SIZE) {
+            cut = len;
+        }
+    }
+    r->carry_len = len - cut;
+    memcpy(r->carry, buf + cut, r->carry_len);
+    if (cut == 0) {
+        free(buf);
+        return 0;
+    }
+
+    chunk_t *c = calloc(1, sizeof(chunk_t));
+    c->text = buf;
+    c->len = cut;
+    *data = c;
+    return 1;
+}
+
+/*
+ * Stages
+ * ======
+ */
+static void *parse_stage(void *data, void *arg) {
+    chunk_t *c = (chunk_t *)data;
+    (void)arg;
+
+    size_t lines = 0;
+    for (size_t i = 0; i < c->len; i++) {
+        lines += c->text[i] == '\n';
+    }
+    c->records = malloc((lines + 1) * sizeof(record_t));
+    c->count = 0;
+
+    char *p = c->text, *end = c->text + c->len;
+    while (p < end) {
+        record_t *r = &c->records[c->count];
+        char *field[MAX_FIELDS];
+        int n = 0;
+        field[n++] = p;
+        while (p < end && *p != '\n') {
+            if (*p == ',' && n < MAX_FIELDS) {
+                field[n++] = p + 1;
+            }
+            p++;
+        }
+        p++;
+        if (n < MAX_FIELDS) {
+            continue;           // Malformed line
+        }
+        r->id = strtol(field[0], NULL, 10);
+        r->name_hash = (uint32_t)fnv1a(FNV_INIT, (unsigned char *)field[1],
+                                       (size_t)(field[2] - field[1] - 1));
+        r->value = strtod(field[2], NULL);
+        r->timestamp = strtol(field[3], NULL, 10);
+        c->count++;
+    }
+    return c;
+}
+
+static void *transform_stage(void *data, void *arg) {
+    chunk_t *c = (chunk_t *)data;
+    (void)arg;
+
+    size_t cap = c->count * 96 + 1;
+    c->formatted = malloc(cap);
+    c->formatted_len = 0;
+    for (size_t i = 0; i < c->count; i++) {
+        record_t *r = &c->records[i];
+        double scaled = r->value * 1.0825 + (r->name_hash % 97);
+        long bucket = (r->timestamp / 3600) % 24;
+        int n = snprintf(c->formatted + c->formatted_len, cap - c->formatted_len,
+                         "{\"id\":%ld,\"tag\":%08x,\"v\":%.3f,\"hour\":%ld}\n",
+                         r->id, r->name_hash, scaled, bucket);
+        c->formatted_len += (size_t)n;
+    }
+    free(c->text);
+    c->text = NULL;
+    free(c->records);
+    c->records = NULL;
+    return c;
+}
+
+/*
+ * LZ77 with a 4-byte hash: tokens are either 1..128 literals
+ * (0x00 | len-1, then the bytes) or a match of 4..131 bytes up to 64 KB
+ * back (0x80 | len-4, then a 16-bit offset).
+ */
+static inline uint32_t lz_hash(const unsigned char *p) {
+    uint32_t v;
+    memcpy(&v, p, 4);
+    return (v * 2654435761u) >> (32 - HASH_BITS);
+}
+
+static size_t lz_compress(const unsigned char *in, size_t n, unsigned char *out) {
+    uint32_t table[1 << HASH_BITS];
+    size_t ip = 0, op = 0, lit = 0;
+
+    memset(table, 0, sizeof(table));
+    while (ip + 4 <= n) {
+        uint32_t h = lz_hash(in + ip);
+        size_t ref = table[h];
+        table[h] = (uint32_t)ip + 1;
+        size_t off = ref ? ip - (ref - 1) : 0;
+        if (ref && off < 65536 && memcmp(in + ref - 1, in + ip, 4) == 0) {
+            size_t len = 4;
+            while (ip + len < n && len < 131 && in[ref - 1 + len] == in[ip + len]) {
+                len++;
+            }
+            while (lit < ip) {
+                size_t run = ip - lit > 128 ? 128 : ip - lit;
+                out[op++] = (unsigned char)(run - 1);
+                memcpy(out + op, in + lit, run);
+                op += run;
+                lit += run;
+            }
+            out[op++] = (unsigned char)(0x80 | (len - 4));
+            out[op++] = (unsigned char)(off & 0xff);
+            out[op++] = (unsigned char)(off >> 8);
+            ip += len;
+            lit = ip;
+        } else {
+            ip++;
+        }
+    }
+    while (lit < n) {
+        size_t run = n - lit > 128 ? 128 : n - lit;
+        out[op++] = (unsigned char)(run - 1);
+        memcpy(out + op, in + lit, run);
+        op += run;
+        lit += run;
+    }
+    return op;
+}
+
+static size_t lz_decompress(const unsigned char *in, size_t n, unsigned char *out) {
+    size_t ip = 0, op = 0;
+    while (ip < n) {
+        unsigned char t = in[ip++];
+        if (t & 0x80) {
+            size_t len = (t & 0x7f) + 4;
+            size_t off = in[ip] | (size_t)in[ip + 1] << 8;
+            ip += 2;
+            for (size_t i = 0; i < len; i++, op++) {
+                out[op] = out[op - off];
+            }
+        } else {
+            memcpy(out + op, in + ip, t + 1u);
+            ip += t + 1u;
+            op += t + 1u;
+        }
+    }
+    return op;
+}
+
+static void *compress_stage(void *data, void *arg) {
+    chunk_t *c = (chunk_t *)data;
+    (void)arg;
+
+    // Worst case: one length byte per 128 literals
+    c->compressed = malloc(c->formatted_len + c->formatted_len / 128 + 16);
+    c->compressed_len = lz_compress((unsigned char *)c->formatted, c->formatted_len,
+                                    c->compressed);
+    c->hash = fnv1a(FNV_INIT, c->compressed, c->compressed_len);
+    return c;
+}
+
+typedef struct {
+    int fd;
+    uint64_t stream_hash;       // Order-sensitive: hash of the whole file
+    uint64_t chunk_hash_sum;    // Order-insensitive: sum of chunk hashes
+    uint64_t bytes_in, bytes_out;
+    int verify;                 // Round-trip each chunk
+    int verify_failures;
+} writer_t;
+
+static void *write_stage(void *data, void *arg) {
+    chunk_t *c = (chunk_t *)data;
+    writer_t *w = (writer_t *)arg;
+
+    size_t done = 0;
+    while (done < c->compressed_len) {
+        ssize_t n = write(w->fd, c->compressed + done, c->compressed_len - done);
+        if (n <= 0) {
+            perror("write");
+            exit(1);
+        }
+        done += (size_t)n;
+    }
+    // One worker (or the unordered run's one worker): no lock needed
+    w->stream_hash = fnv1a(w->stream_hash, c->compressed, c->compressed_len);
+    w->chunk_hash_sum += c->hash;
+    w->bytes_in += c->formatted_len;
+    w->bytes_out += c->compressed_len;
+    return c;
+}
+
+// pipeline_run() passes one argument to both the source and the sink
+typedef struct {
+    reader_t *reader;
+    writer_t *writer;
+} job_t;
+
+static int source_chunk(void **data, void *arg) {
+    return read_chunk(data, ((job_t *)arg)->reader);
+}
+
+// Sink: optionally check the round trip, then free the chunk
+static void release_chunk(void *data, uint64_t seq, void *arg) {
+    chunk_t *c = (chunk_t *)data;
+    writer_t *w = ((job_t *)arg)->writer;
+    (void)seq;
+
+    if (w->verify) {
+        unsigned char *check = malloc(c->formatted_len + 1);
+        size_t n = lz_decompress(c->compressed, c->compressed_len, check);
+        if (n != c->formatted_len || memcmp(check, c->formatted, n) != 0) {
+            w->verify_failures++;
+        }
+        free(check);
+    }
+    free(c->formatted);
+    free(c->compressed);
+    free(c);
+}
+
+/*
+ * Runs
+ * ====
+ */
+typedef struct {
+    const char *name;
+    int workers[4];             // Initial workers per stage
+    int autotune;
+    int ordered;                // Write stage and output ordered
+    int verify;
+} config_t;
+
+static const char *stage_names[] = { "parse", "transform", "compress", "write" };
+
+static uint64_t expected_stream, expected_sum;
+
+static void run(const config_t *cfg, const char *input, int out_fd, int cpus) {
+    static reader_t reader;
+    writer_t writer = { .fd = out_fd, .stream_hash = FNV_INIT, .verify = cfg->verify };
+    job_t job = { .reader = &reader, .writer = &writer };
+    pipeline_fn fns[4] = { parse_stage, transform_stage, compress_stage, write_stage };
+    pipeline_t p;
+
+    reader.fd = open(input, O_RDONLY);
+    if (reader.fd < 0) {
+        perror(input);
+        exit(1);
+    }
+    reader.carry_len = 0;
+    reader.eof = 0;
+    if (ftruncate(out_fd, 0) != 0 || lseek(out_fd, 0, SEEK_SET) != 0) {
+        perror("output file");
+        exit(1);
+    }
+
+    pipeline_init(&p, QUEUE_CAPACITY, cfg->ordered);
+    for (int i = 0; i < 4; i++) {
+        int is_write = i == 3;
+        int max = is_write ? 1 : (cfg->autotune ? cpus : cfg->workers[i]);
+        if (max < cfg->workers[i]) {
+            max = cfg->workers[i];
+        }
+        pipeline_add_stage(&p, stage_names[i], fns[i], is_write ? (void *)&writer : NULL,
+                           cfg->workers[i], max, is_write && cfg->ordered);
+    }
+    if (cfg->autotune) {
+        pipeline_autotune(&p, cpus > 4 ? cpus : 4, 20 * 1000 * 1000);
+    }
+
+    double start = GetTime();
+    int rc = pipeline_run(&p, source_chunk, release_chunk, &job);
+    double elapsed = GetTime() - start;
+    close(reader.fd);
+    if (rc != 0) {
+        fprintf(stderr, "pipeline_run failed: %s\n", strerror(rc));
+        exit(1);
+    }
+
+    if (cfg->verify) {
+        expected_stream = writer.stream_hash;
+        expected_sum = writer.chunk_hash_sum;
+    }
+    int ok = writer.verify_failures == 0 && writer.chunk_hash_sum == expected_sum &&
+             (!cfg->ordered || writer.stream_hash == expected_stream);
+
+    char workers[32];
+    snprintf(workers, sizeof(workers), "%d/%d/%d/%d", p.stages[0].target,
+             p.stages[1].target, p.stages[2].target, p.stages[3].target);
+    printf("%-10s %-10s %9.1f %8.2f %6.2fx %6d  %s\n", cfg->name, workers,
+           writer.bytes_in / elapsed / 1e6, elapsed,
+           writer.bytes_out ? (double)writer.bytes_in / writer.bytes_out : 0.0, p.tune_steps,
+           ok ? "ok" : "MISMATCH");
+
+    if (cfg->autotune) {
+        printf("           per stage: ");
+        for (int i = 0; i < 4; i++) {
+            uint64_t busy_ns;
+            uint64_t items = pipeline_stage_items(&p.stages[i], &busy_ns);
+            printf("%s %.0f us/chunk%s", stage_names[i],
+                   items ? busy_ns / 1e3 / items : 0.0, i < 3 ? ", " : "\n");
+        }
+    }
+    pipeline_destroy(&p);
+    if (!ok) {
+        exit(1);
+    }
+}
+
+int main(int argc, char *argv[]) {
+    char input[64] = "";
+    const char *path = input;
+    long size_mb = DEFAULT_SIZE_MB;
+    int cpus = argc > 2 ? atoi(argv[2]) : locks_online_cpus();
+
+    if (cpus < 1 || cpus > PIPELINE_MAX_WORKERS) {
+        fprintf(stderr, "Usage: %s [input_file | size_mb] [workers 1-%d]\n",
+                argv[0], PIPELINE_MAX_WORKERS);
+        return 1;
+    }
+    if (argc > 1 && atol(argv[1]) > 0) {
+        size_mb = atol(argv[1]);
+    } else if (argc > 1) {
+        path = argv[1];
+    }
+    if (path == input) {
+        snprintf(input, sizeof(input), "/tmp/pipeline_input_%d.csv", (int)getpid());
+        if (generate_input(input, size_mb) != 0) {
+            perror(input);
+            return 1;
+        }
+    }
+
+    char output[] = "/tmp/pipeline_output_XXXXXX";
+    int out_fd = mkstemp(output);
+    if (out_fd < 0) {
+        perror("mkstemp");
+        return 1;
+    }
+    unlink(output);
+
+    // Roughly parse 1 : transform 2 : compress 1 by measured cost
+    int parse = cpus >= 4 ? cpus / 4 : 1;
+    int transform = cpus >= 2 ? cpus / 2 : 1;
+    int compress = cpus >= 4 ? cpus / 4 : 1;
+    config_t configs[] = {
+        { .name = "serial",    .workers = { 1, 1, 1, 1 }, .ordered = 1, .verify = 1 },
+        { .name = "balanced",  .workers = { parse, transform, compress, 1 }, .ordered = 1 },
+        { .name = "autotune",  .workers = { 1, 1, 1, 1 }, .autotune = 1, .ordered = 1 },
+        { .name = "unordered", .workers = { parse, transform, compress, 1 }, .ordered = 0 },
+    };
+
+    printf("Pipeline benchmark: %s, %d KB chunks, %d worker(s)\n\n", path,
+           CHUNK_SIZE / 1024, cpus);
+    printf("%-10s %-10s %9s %8s %7s %6s  %s\n",
+           "config", "p/t/c/w", "MB/s", "secs", "ratio", "tunes", "check");
+    for (size_t i = 0; i < sizeof(configs) / sizeof(configs[0]); i++) {
+        run(&configs[i], path, out_fd, cpus);
+    }
+
+    close(out_fd);
+    if (path == input) {
+        unlink(input);
+    }
+    return 0;
+}
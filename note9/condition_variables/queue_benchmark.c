@@ -0,0 +1,250 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include "../../common.h"
+#include "../../bounded_queue.h"
+
+/*
+ * queue_benchmark.c - bounded_queue_t throughput by element size
+ *
+ * Producers build elements of 8 B to 4 KB and consumers checksum them,
+ * through the two bounded_queue.h APIs:
+ *
+ *   copy     - build the element in a local buffer, bounded_queue_put()
+ *              copies it in; bounded_queue_get() copies it out again
+ *   in-place - build the element directly in the slot returned by
+ *              bounded_queue_emplace(), checksum it in the slot returned
+ *              by bounded_queue_consume()
+ *
+ * For small elements both cost about the same, because the lock and
+ * wakeups dominate. As elements grow, the two extra memcpy calls in the
+ * copy path start to show up.
+ *
+ * The first row is the old int-only ring from producer_consumer.c
+ * (capacity 5, `%` indexing) for reference.
+ *
+ * Usage: ./queue_benchmark [items] [capacity] [producers] [consumers]
+ */
+
+#define MAX_THREADS 64
+#define MAX_ELEM_SIZE 4096
+
+typedef enum { API_COPY, API_INPLACE } api_t;
+static const char *api_names[] = { "copy", "in-place" };
+
+static bounded_queue_t queue;
+
+typedef struct {
+    api_t api;
+    long items;             // Items this thread produces or consumes
+    long first;             // First sequence number (producers)
+    size_t elem_size;
+    unsigned long sum;      // Checksum of consumed sequence numbers
+} worker_t;
+
+// Fill an element: sequence number up front, payload after it
+static inline void fill_element(char *elem, size_t size, long seq) {
+    memcpy(elem, &seq, sizeof(seq));
+    memset(elem + sizeof(seq), (int)(seq & 0xff), size - sizeof(seq));
+}
+
+// Read the sequence number and touch the payload so it is really loaded
+static inline unsigned long read_element(const char *elem, size_t size) {
+    long seq;
+    memcpy(&seq, elem, sizeof(seq));
+    unsigned long sum = (unsigned long)seq;
+    for (size_t i = sizeof(seq); i < size; i += 64) {
+        sum += (unsigned char)elem[i] == (unsigned char)(seq & 0xff) ? 0 : 1000000007UL;
+    }
+    return sum;
+}
+
+static void *producer(void *arg) {
+    worker_t *w = (worker_t *)arg;
+    char local[MAX_ELEM_SIZE];
+
+    for (long i = 0; i < w->items; i++) {
+        long seq = w->first + i;
+        if (w->api == API_COPY) {
+            fill_element(local, w->elem_size, seq);
+            bounded_queue_put(&queue, local);
+        } else {
+            fill_element(bounded_queue_emplace(&queue), w->elem_size, seq);
+            bounded_queue_emplace_commit(&queue);
+        }
+    }
+    return NULL;
+}
+
+static void *consumer(void *arg) {
+    worker_t *w = (worker_t *)arg;
+    char local[MAX_ELEM_SIZE];
+
+    for (long i = 0; i < w->items; i++) {
+        if (w->api == API_COPY) {
+            bounded_queue_get(&queue, local);
+            w->sum += read_element(local, w->elem_size);
+        } else {
+            w->sum += read_element(bounded_queue_consume(&queue), w->elem_size);
+            bounded_queue_consume_commit(&queue);
+        }
+    }
+    return NULL;
+}
+
+static void run(api_t api, size_t elem_size, long items, size_t capacity,
+                int producers, int consumers) {
+    pthread_t threads[2 * MAX_THREADS];
+    worker_t workers[2 * MAX_THREADS];
+    long total = (items / producers) * producers;   // Split evenly
+    int n = producers + consumers;
+
+    if (bounded_queue_init(&queue, capacity, elem_size) != 0) {
+        fprintf(stderr, "bounded_queue_init failed for %zu-byte elements\n", elem_size);
+        exit(1);
+    }
+
+    pmu_t pmu;
+    pmu_sample_t counters;
+    char counter_text[160];
+
+    pmu_begin(&pmu, PMU_INHERIT);       // Counts the threads created below
+    double start = GetTime();
+    for (int i = 0; i < n; i++) {
+        worker_t *w = &workers[i];
+        w->api = api;
+        w->elem_size = elem_size;
+        w->sum = 0;
+        if (i < producers) {
+            w->items = total / producers;
+            w->first = i * w->items;
+            pthread_create(&threads[i], NULL, producer, w);
+        } else {
+            int c = i - producers;
+            w->items = total / consumers + (c < total % consumers ? 1 : 0);
+            pthread_create(&threads[i], NULL, consumer, w);
+        }
+    }
+
+    unsigned long sum = 0;
+    for (int i = 0; i < n; i++) {
+        pthread_join(threads[i], NULL);
+        sum += workers[i].sum;
+    }
+    double elapsed = GetTime() - start;
+    pmu_end(&pmu, &counters);
+
+    bounded_queue_destroy(&queue);
+
+    unsigned long expected = (unsigned long)total * (total - 1) / 2;
+    printf("%-9s %7zu %12.0f %10.1f %9.1f  %-8s  %s\n",
+           api_names[api], elem_size, total / elapsed,
+           total * elem_size / elapsed / 1e6, 1e9 * elapsed / total,
+           sum == expected ? "ok" : "MISMATCH",
+           pmu_format(&counters, counter_text, sizeof(counter_text)));
+}
+
+/*
+ * The pre-bounded_queue_t ring from producer_consumer.c: fixed `int`
+ * slots, capacity 5, `%` indexing. One producer, one consumer.
+ */
+#define LEGACY_SIZE 5
+
+static struct {
+    int buffer[LEGACY_SIZE];
+    int count, in, out;
+    pthread_mutex_t mutex;
+    pthread_cond_t not_full, not_empty;
+} legacy = { .mutex = PTHREAD_MUTEX_INITIALIZER,
+             .not_full = PTHREAD_COND_INITIALIZER,
+             .not_empty = PTHREAD_COND_INITIALIZER };
+
+static void *legacy_producer(void *arg) {
+    long items = *(long *)arg;
+    for (long i = 0; i < items; i++) {
+        pthread_mutex_lock(&legacy.mutex);
+        while (legacy.count == LEGACY_SIZE) {
+            pthread_cond_wait(&legacy.not_full, &legacy.mutex);
+        }
+        legacy.buffer[legacy.in] = (int)i;
+        legacy.in = (legacy.in + 1) % LEGACY_SIZE;
+        legacy.count++;
+        pthread_cond_signal(&legacy.not_empty);
+        pthread_mutex_unlock(&legacy.mutex);
+    }
+    return NULL;
+}
+
+static void *legacy_consumer(void *arg) {
+    long items = *(long *)arg;
+    unsigned long sum = 0;
+    for (long i = 0; i < items; i++) {
+        pthread_mutex_lock(&legacy.mutex);
+        while (legacy.count == 0) {
+            pthread_cond_wait(&legacy.not_empty, &legacy.mutex);
+        }
+        sum += (unsigned long)legacy.buffer[legacy.out];
+        legacy.out = (legacy.out + 1) % LEGACY_SIZE;
+        legacy.count--;
+        pthread_cond_signal(&legacy.not_full);
+        pthread_mutex_unlock(&legacy.mutex);
+    }
+    *(long *)arg = (long)sum;
+    return NULL;
+}
+
+static void run_legacy(long items) {
+    pthread_t prod, cons;
+    long prod_items = items, cons_items = items;
+    pmu_t pmu;
+    pmu_sample_t counters;
+    char counter_text[160];
+
+    pmu_begin(&pmu, PMU_INHERIT);
+    double start = GetTime();
+    pthread_create(&prod, NULL, legacy_producer, &prod_items);
+    pthread_create(&cons, NULL, legacy_consumer, &cons_items);
+    pthread_join(prod, NULL);
+    pthread_join(cons, NULL);
+    double elapsed = GetTime() - start;
+    pmu_end(&pmu, &counters);
+
+    unsigned long expected = (unsigned long)items * (items - 1) / 2;
+    printf("%-9s %7zu %12.0f %10.1f %9.1f  %-8s  %s\n",
+           "legacy", sizeof(int), items / elapsed,
+           items * sizeof(int) / elapsed / 1e6, 1e9 * elapsed / items,
+           (unsigned long)cons_items == expected ? "ok" : "MISMATCH",
+           pmu_format(&counters, counter_text, sizeof(counter_text)));
+}
+
+int main(int argc, char *argv[]) {
+    long items = argc > 1 ? atol(argv[1]) : 1000000;
+    long capacity = argc > 2 ? atol(argv[2]) : 1024;
+    int producers = argc > 3 ? atoi(argv[3]) : 1;
+    int consumers = argc > 4 ? atoi(argv[4]) : 1;
+    size_t sizes[] = { 8, 64, 256, 1024, 4096 };
+
+    if (items < 1 || capacity < 1 || producers < 1 || producers > MAX_THREADS ||
+        consumers < 1 || consumers > MAX_THREADS || items < producers) {
+        fprintf(stderr, "Usage: %s [items] [capacity] [producers 1-%d] [consumers 1-%d]\n",
+                argv[0], MAX_THREADS, MAX_THREADS);
+        return 1;
+    }
+
+    printf("Bounded queue benchmark: %ld items, capacity %zu, %d producer(s), %d consumer(s)\n",
+           items, bounded_queue_round_up((size_t)capacity), producers, consumers);
+    pmu_describe(stdout);
+    printf("\n%-9s %7s %12s %10s %9s  %-8s  %s\n",
+           "api", "bytes", "items/s", "MB/s", "ns/item", "check", "counters (all threads)");
+
+    run_legacy(items);
+    for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++) {
+        run(API_COPY, sizes[i], items, (size_t)capacity, producers, consumers);
+        run(API_INPLACE, sizes[i], items, (size_t)capacity, producers, consumers);
+    }
+
+    return 0;
+}
@@ -0,0 +1,311 @@
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include <limits.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include <sys/syscall.h>
+#include <linux/futex.h>
+
+#include "../../locks.h"
+
+/*
+ * wakeup_benchmark.c - How fast, and how fairly, do sleeping threads wake?
+ *
+ * N waiter threads sleep. The main thread wakes them, and each woken
+ * waiter records the time from the wakeup call to the moment it runs
+ * again, holding the mutex for the condition variable methods:
+ *
+ *   signal-in     pthread_cond_signal() with the mutex held
+ *   signal-out    pthread_cond_signal() after unlocking
+ *   broadcast-in  pthread_cond_broadcast() with the mutex held
+ *   broadcast-out pthread_cond_broadcast() after unlocking
+ *   futex-one     FUTEX_WAKE of one thread, no mutex at all
+ *   futex-all     FUTEX_WAKE of every thread
+ *
+ * The signal methods wake one waiter per round; the broadcast methods
+ * wake all N. Signalling with the mutex held can make the woken thread
+ * run straight into the still-locked mutex and go back to sleep ("hurry
+ * up and wait"). Signalling after unlocking avoids that, and a bare
+ * futex skips the mutex entirely.
+ *
+ * Columns:
+ *   p50/p99  - wakeup latency over all woken waiters
+ *   all-p50  - broadcasts: median time until the *last* waiter runs
+ *   fair     - Jain's fairness index of how often each waiter was the
+ *              first to wake: 1.0 = evenly spread, 1/N = always the same
+ *              thread
+ *
+ * Before every round the main thread waits until all N waiters are
+ * parked, then sleeps SETTLE_US so they are really asleep in the
+ * kernel.
+ *
+ * Usage: ./wakeup_benchmark [rounds] [max_waiters]
+ */
+
+#define MAX_WAITERS 64
+#define SETTLE_US 20
+
+typedef enum {
+    SIGNAL_IN, SIGNAL_OUT, BROADCAST_IN, BROADCAST_OUT, FUTEX_ONE, FUTEX_ALL
+} method_t;
+
+static const char *method_names[] = {
+    "signal-in", "signal-out", "broadcast-in", "broadcast-out", "futex-one", "futex-all"
+};
+
+static struct {
+    method_t method;
+    int waiters;
+    pthread_mutex_t mutex;
+    pthread_cond_t cond;
+    int tickets;                // Signal methods: wakeups not yet taken
+    unsigned int generation;    // Broadcast methods (also the futex word)
+    int parked;                 // Waiters currently waiting
+    int woken;                  // Waiters woken this round
+    int stop;
+    uint64_t wake_ns;           // When the wakeup call was made
+    uint64_t *samples;          // Latencies, one per woken waiter
+    size_t nsamples;
+    uint64_t last_ns;           // This round's latest wakeup
+    long first[MAX_WAITERS];    // Times each waiter woke first
+} bench;
+
+static long futex(unsigned int *addr, int op, unsigned int val) {
+    return syscall(SYS_futex, addr, op, val, NULL, NULL, 0);
+}
+
+// Record a wakeup; called by the woken waiter
+static void record(int id) {
+    uint64_t latency = locks_clock_ns() - __atomic_load_n(&bench.wake_ns, __ATOMIC_ACQUIRE);
+    size_t slot = __atomic_fetch_add(&bench.nsamples, 1, __ATOMIC_RELAXED);
+    bench.samples[slot] = latency;
+    if (__atomic_fetch_add(&bench.woken, 1, __ATOMIC_ACQ_REL) == 0) {
+        bench.first[id]++;
+    }
+    uint64_t last = __atomic_load_n(&bench.last_ns, __ATOMIC_RELAXED);
+    while (latency > last &&
+           !__atomic_compare_exchange_n(&bench.last_ns, &last, latency, 1,
+                                        __ATOMIC_RELAXED, __ATOMIC_RELAXED)) {
+    }
+}
+
+static void *cond_waiter(void *arg) {
+    int id = (int)(long)arg;
+    int broadcast = bench.method == BROADCAST_IN || bench.method == BROADCAST_OUT;
+
+    pthread_mutex_lock(&bench.mutex);
+    for (;;) {
+        unsigned int gen = bench.generation;
+        bench.parked++;
+        if (broadcast) {
+            while (bench.generation == gen && !bench.stop) {
+                pthread_cond_wait(&bench.cond, &bench.mutex);
+            }
+        } else {
+            while (bench.tickets == 0 && !bench.stop) {
+                pthread_cond_wait(&bench.cond, &bench.mutex);
+            }
+        }
+        bench.parked--;
+        if (bench.stop) {
+            break;
+        }
+        if (!broadcast) {
+            bench.tickets--;
+        }
+        record(id);
+    }
+    pthread_mutex_unlock(&bench.mutex);
+    return NULL;
+}
+
+static void *futex_waiter(void *arg) {
+    int id = (int)(long)arg;
+
+    for (;;) {
+        unsigned int gen = __atomic_load_n(&bench.generation, __ATOMIC_ACQUIRE);
+        __atomic_add_fetch(&bench.parked, 1, __ATOMIC_ACQ_REL);
+        for (;;) {
+            if (__atomic_load_n(&bench.stop, __ATOMIC_ACQUIRE)) {
+                return NULL;
+            }
+            if (bench.method == FUTEX_ONE) {
+                // Take a ticket if one is there
+                int t = __atomic_load_n(&bench.tickets, __ATOMIC_ACQUIRE);
+                if (t > 0 && __atomic_compare_exchange_n(&bench.tickets, &t, t - 1, 0,
+                                                         __ATOMIC_ACQ_REL, __ATOMIC_RELAXED)) {
+                    break;
+                }
+            } else if (__atomic_load_n(&bench.generation, __ATOMIC_ACQUIRE) != gen) {
+                break;
+            }
+            // Sleeps only if the word still equals gen
+            futex(&bench.generation, FUTEX_WAIT_PRIVATE, gen);
+            if (bench.method == FUTEX_ONE) {
+                gen = __atomic_load_n(&bench.generation, __ATOMIC_ACQUIRE);
+            }
+        }
+        __atomic_sub_fetch(&bench.parked, 1, __ATOMIC_ACQ_REL);
+        record(id);
+    }
+}
+
+// Wait until at least `parked` waiters are parked and `woken` have woken
+static void wait_for(int parked, int woken) {
+    while (__atomic_load_n(&bench.parked, __ATOMIC_ACQUIRE) < parked ||
+           __atomic_load_n(&bench.woken, __ATOMIC_ACQUIRE) < woken) {
+        sched_yield();
+    }
+}
+
+// One round: wake one waiter (signal) or all of them (broadcast)
+static void wake(void) {
+    switch (bench.method) {
+    case SIGNAL_IN:
+    case BROADCAST_IN:
+        pthread_mutex_lock(&bench.mutex);
+        if (bench.method == SIGNAL_IN) {
+            bench.tickets++;
+        } else {
+            bench.generation++;
+        }
+        __atomic_store_n(&bench.wake_ns, locks_clock_ns(), __ATOMIC_RELEASE);
+        if (bench.method == SIGNAL_IN) {
+            pthread_cond_signal(&bench.cond);
+        } else {
+            pthread_cond_broadcast(&bench.cond);
+        }
+        pthread_mutex_unlock(&bench.mutex);
+        break;
+    case SIGNAL_OUT:
+    case BROADCAST_OUT:
+        pthread_mutex_lock(&bench.mutex);
+        if (bench.method == SIGNAL_OUT) {
+            bench.tickets++;
+        } else {
+            bench.generation++;
+        }
+        // Stamp before unlocking: a spurious wakeup must not see last
+        // round's time
+        __atomic_store_n(&bench.wake_ns, locks_clock_ns(), __ATOMIC_RELEASE);
+        pthread_mutex_unlock(&bench.mutex);
+        if (bench.method == SIGNAL_OUT) {
+            pthread_cond_signal(&bench.cond);
+        } else {
+            pthread_cond_broadcast(&bench.cond);
+        }
+        break;
+    case FUTEX_ONE:
+    case FUTEX_ALL:
+        __atomic_store_n(&bench.wake_ns, locks_clock_ns(), __ATOMIC_RELEASE);
+        if (bench.method == FUTEX_ONE) {
+            __atomic_add_fetch(&bench.tickets, 1, __ATOMIC_ACQ_REL);
+        }
+        __atomic_add_fetch(&bench.generation, 1, __ATOMIC_ACQ_REL);
+        futex(&bench.generation, FUTEX_WAKE_PRIVATE, bench.method == FUTEX_ONE ? 1 : INT_MAX);
+        break;
+    }
+}
+
+static int compare_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+static void run(method_t method, int waiters, int rounds) {
+    pthread_t threads[MAX_WAITERS];
+    int broadcast = method == BROADCAST_IN || method == BROADCAST_OUT || method == FUTEX_ALL;
+    int per_round = broadcast ? waiters : 1;
+    uint64_t *last = malloc(rounds * sizeof(uint64_t));
+
+    memset(&bench.first, 0, sizeof(bench.first));
+    bench.method = method;
+    bench.waiters = waiters;
+    bench.tickets = 0;
+    bench.generation = 0;
+    bench.parked = 0;
+    bench.stop = 0;
+    bench.nsamples = 0;
+    bench.samples = malloc((size_t)rounds * per_round * sizeof(uint64_t));
+    pthread_mutex_init(&bench.mutex, NULL);
+    pthread_cond_init(&bench.cond, NULL);
+
+    for (int i = 0; i < waiters; i++) {
+        pthread_create(&threads[i], NULL,
+                       method == FUTEX_ONE || method == FUTEX_ALL ? futex_waiter : cond_waiter,
+                       (void *)(long)i);
+    }
+
+    for (int r = 0; r < rounds; r++) {
+        wait_for(waiters, 0);
+        usleep(SETTLE_US);
+        __atomic_store_n(&bench.woken, 0, __ATOMIC_RELEASE);
+        __atomic_store_n(&bench.last_ns, 0, __ATOMIC_RELEASE);
+        wake();
+        wait_for(0, per_round);
+        last[r] = bench.last_ns;
+    }
+
+    // Let every waiter park once more, then release them for good
+    wait_for(waiters, 0);
+    pthread_mutex_lock(&bench.mutex);
+    __atomic_store_n(&bench.stop, 1, __ATOMIC_RELEASE);
+    pthread_cond_broadcast(&bench.cond);
+    pthread_mutex_unlock(&bench.mutex);
+    __atomic_add_fetch(&bench.generation, 1, __ATOMIC_ACQ_REL);
+    futex(&bench.generation, FUTEX_WAKE_PRIVATE, INT_MAX);
+    for (int i = 0; i < waiters; i++) {
+        pthread_join(threads[i], NULL);
+    }
+
+    // Jain's index over "woke first" counts
+    double sum = 0, sum_sq = 0;
+    for (int i = 0; i < waiters; i++) {
+        sum += bench.first[i];
+        sum_sq += (double)bench.first[i] * bench.first[i];
+    }
+    double fairness = sum_sq > 0 ? sum * sum / (waiters * sum_sq) : 0.0;
+
+    size_t n = bench.nsamples;
+    qsort(bench.samples, n, sizeof(uint64_t), compare_u64);
+    qsort(last, rounds, sizeof(uint64_t), compare_u64);
+    printf("%-14s %7d %9.1f %9.1f ", method_names[method], waiters,
+           bench.samples[n / 2] / 1e3, bench.samples[n * 99 / 100] / 1e3);
+    if (broadcast) {
+        printf("%9.1f", last[rounds / 2] / 1e3);
+    } else {
+        printf("%9s", "-");
+    }
+    printf(" %6.2f  %s\n", fairness,
+           n == (size_t)rounds * per_round ? "ok" : "MISMATCH");
+
+    free(bench.samples);
+    free(last);
+    pthread_mutex_destroy(&bench.mutex);
+    pthread_cond_destroy(&bench.cond);
+}
+
+int main(int argc, char *argv[]) {
+    int rounds = argc > 1 ? atoi(argv[1]) : 1000;
+    int max_waiters = argc > 2 ? atoi(argv[2]) : MAX_WAITERS;
+
+    if (rounds < 1 || max_waiters < 1 || max_waiters > MAX_WAITERS) {
+        fprintf(stderr, "Usage: %s [rounds] [max_waiters 1-%d]\n", argv[0], MAX_WAITERS);
+        return 1;
+    }
+
+    printf("Wakeup latency: %d rounds, %d CPU(s), latencies in microseconds\n\n",
+           rounds, locks_online_cpus());
+    printf("%-14s %7s %9s %9s %9s %6s  %s\n",
+           "method", "waiters", "p50", "p99", "all-p50", "fair", "check");
+    for (int m = SIGNAL_IN; m <= FUTEX_ALL; m++) {
+        for (int n = 1; n <= max_waiters; n *= 2) {
+            run((method_t)m, n, rounds);
+        }
+    }
+    return 0;
+}
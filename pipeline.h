@@ -0,0 +1,589 @@
+/*
+ * ===================================================================
+ * CP386 Operating Systems Course - Stage-Parallel Pipeline
+ * ===================================================================
+ *
+ * A producer/consumer chain with more than one link: a source thread
+ * feeds stage 0, each stage's workers pass their results to the next
+ * stage through a bounded_queue_t, and the calling thread hands the
+ * final results to a sink.
+ *
+ *   source -> [queue] -> stage 0 (k0 workers) -> [queue] -> stage 1 ...
+ *          ... -> stage N-1 (kN-1 workers) -> [queue] -> sink
+ *
+ * Key Components:
+ * - Per-stage worker count: a slow stage (compression, say) gets more
+ *   threads than a fast one, so no single stage limits the pipeline.
+ * - Ordering: every item carries the sequence number the source gave
+ *   it. A stage marked `ordered` receives its input in sequence order,
+ *   and with `ordered_output` the sink does too. Out-of-order arrivals
+ *   wait in a reorder window (pipeline_gate_t) until the gap before
+ *   them is filled. An ordered stage with one worker, such as a file
+ *   writer, therefore sees the items exactly in input order.
+ * - Auto-tuning: each worker measures the time it spends in the stage
+ *   function. Every tune interval the pipeline estimates each stage's
+ *   throughput (active workers / time per item), and gives one more
+ *   worker to the slowest stage, taking it from the stage with the most
+ *   spare throughput once the worker budget is used up. Every stage
+ *   starts max_workers threads up front; threads above the stage's
+ *   current target sleep until the tuner needs them.
+ *
+ * In-flight limit: the source takes a token per item and the sink
+ * returns it, so at most `max_in_flight` items are anywhere between the
+ * two. That bounds how far apart two sequence numbers can be at any
+ * reorder point, so a window of that size never overflows, however slow
+ * one item is.
+ *
+ * Shutdown: after the last item the source sends an end marker. The
+ * first worker of a stage to see it puts it back for its siblings; the
+ * last one to exit forwards it to the next stage. The end marker's
+ * sequence number is the item count, so ordered stages pass it on
+ * last.
+ *
+ * Functions that can fail return 0 or an error number, like pthreads.
+ *
+ * References:
+ * - OSTEP Chapter 30: Condition Variables (the producer/consumer problem)
+ * - M. McCool, A. Robison, J. Reinders, "Structured Parallel
+ *   Programming", Chapter 9: Pipeline
+ */
+
+#ifndef __pipeline_h__
+#define __pipeline_h__
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "bounded_queue.h"
+
+#define PIPELINE_MAX_STAGES 8
+#define PIPELINE_MAX_WORKERS 32         // Per stage
+
+// Stage function: transform one item, return the item for the next stage
+typedef void *(*pipeline_fn)(void *data, void *arg);
+
+// Source: store the next item in *data and return 1, or return 0 at the end
+typedef int (*pipeline_source_fn)(void **data, void *arg);
+
+// Sink: runs in the thread that called pipeline_run()
+typedef void (*pipeline_sink_fn)(void *data, uint64_t seq, void *arg);
+
+typedef struct {
+    uint64_t seq;
+    void *data;
+    int end;                    // End-of-stream marker
+} pipeline_msg_t;
+
+/*
+ * Reorder window: messages arrive in any order and leave in sequence
+ * order. The window is larger than the in-flight limit, so a slot is
+ * always free when a message arrives.
+ */
+typedef struct {
+    pthread_mutex_t mutex;
+    pipeline_msg_t *window;
+    unsigned char *present;
+    size_t mask;
+    uint64_t next;              // Next sequence number to release
+    bounded_queue_t *out;
+} pipeline_gate_t;
+
+struct pipeline;
+
+typedef struct {
+    uint64_t items;
+    uint64_t busy_ns;           // Time spent inside the stage function
+    struct pipeline_stage *stage;
+    int index;
+} __attribute__((aligned(64))) pipeline_worker_t;
+
+typedef struct pipeline_stage {
+    const char *name;
+    pipeline_fn fn;
+    void *arg;
+    int ordered;                // Deliver input in sequence order
+    int max_workers;            // Threads started
+    int target;                 // Threads allowed to work right now
+    int live;                   // Threads not yet exited
+    int stopping;               // End marker seen
+    bounded_queue_t in;
+    pipeline_gate_t gate;       // Feeds `in` when ordered
+    pthread_mutex_t tune_mutex;
+    pthread_cond_t tune_cond;   // Parked workers wait here
+    uint64_t tuned_items;       // Totals at the previous tune step
+    uint64_t tuned_busy_ns;
+    struct pipeline *pipeline;
+    pthread_t threads[PIPELINE_MAX_WORKERS];
+    pipeline_worker_t workers[PIPELINE_MAX_WORKERS];
+} pipeline_stage_t;
+
+typedef struct pipeline {
+    pipeline_stage_t stages[PIPELINE_MAX_STAGES];
+    int num_stages;
+    size_t capacity;            // Per queue
+    int ordered_output;
+    int worker_budget;          // Auto-tuning: total active workers (0: off)
+    long tune_interval_ns;
+    int tune_steps;             // Worker moves made by the tuner
+    bounded_queue_t out;
+    pipeline_gate_t out_gate;
+    uint64_t produced;          // Items the source has emitted
+    size_t max_in_flight;       // Tokens: items between source and sink
+    size_t in_flight;
+    pthread_mutex_t token_mutex;
+    pthread_cond_t token_freed;
+    pipeline_source_fn source;
+    void *source_arg;
+} pipeline_t;
+
+/*
+ * pipeline_init() - Start an empty pipeline description
+ *
+ * @capacity:       slots in each inter-stage queue (at least 2)
+ * @ordered_output: deliver items to the sink in source order
+ */
+static inline int pipeline_init(pipeline_t *p, size_t capacity, int ordered_output) {
+    if (capacity < 2) {
+        return EINVAL;
+    }
+    memset(p, 0, sizeof(*p));
+    p->capacity = capacity;
+    p->ordered_output = ordered_output;
+    pthread_mutex_init(&p->token_mutex, NULL);
+    pthread_cond_init(&p->token_freed, NULL);
+    return 0;
+}
+
+static inline void pipeline_destroy(pipeline_t *p) {
+    pthread_mutex_destroy(&p->token_mutex);
+    pthread_cond_destroy(&p->token_freed);
+}
+
+/*
+ * pipeline_add_stage() - Append a stage
+ *
+ * @workers:     threads working from the start (1..max_workers)
+ * @max_workers: threads started; more than @workers only helps with
+ *               auto-tuning
+ * @ordered:     this stage receives its input in sequence order
+ */
+static inline int pipeline_add_stage(pipeline_t *p, const char *name, pipeline_fn fn,
+                                     void *arg, int workers, int max_workers, int ordered) {
+    if (p->num_stages == PIPELINE_MAX_STAGES || workers < 1 ||
+        max_workers < workers || max_workers > PIPELINE_MAX_WORKERS) {
+        return EINVAL;
+    }
+    pipeline_stage_t *s = &p->stages[p->num_stages];
+    s->name = name;
+    s->fn = fn;
+    s->arg = arg;
+    s->target = workers;
+    s->max_workers = max_workers;
+    s->ordered = ordered;
+    s->pipeline = p;
+    p->num_stages++;
+    return 0;
+}
+
+/*
+ * pipeline_autotune() - Let the pipeline move workers between stages
+ *
+ * @budget:      total workers active at once, over all stages
+ * @interval_ns: time between tune steps
+ */
+static inline void pipeline_autotune(pipeline_t *p, int budget, long interval_ns) {
+    p->worker_budget = budget;
+    p->tune_interval_ns = interval_ns;
+}
+
+/*
+ * Reorder Gate
+ * ============
+ */
+static inline int pipeline_gate_init(pipeline_gate_t *g, size_t window, bounded_queue_t *out) {
+    window = bounded_queue_round_up(window);
+    g->window = malloc(window * sizeof(pipeline_msg_t));
+    g->present = calloc(window, 1);
+    if (g->window == NULL || g->present == NULL) {
+        free(g->window);
+        free(g->present);
+        return ENOMEM;
+    }
+    g->mask = window - 1;
+    g->next = 0;
+    g->out = out;
+    pthread_mutex_init(&g->mutex, NULL);
+    return 0;
+}
+
+static inline void pipeline_gate_destroy(pipeline_gate_t *g) {
+    pthread_mutex_destroy(&g->mutex);
+    free(g->window);
+    free(g->present);
+}
+
+// Park a message; release it and any successors now in sequence
+static inline void pipeline_gate_push(pipeline_gate_t *g, const pipeline_msg_t *msg) {
+    pthread_mutex_lock(&g->mutex);
+    size_t slot = msg->seq & g->mask;
+    g->window[slot] = *msg;
+    g->present[slot] = 1;
+    while (g->present[slot = g->next & g->mask]) {
+        // May block on a full queue; the next stage drains it without
+        // needing this lock
+        bounded_queue_put(g->out, &g->window[slot]);
+        g->present[slot] = 0;
+        g->next++;
+    }
+    pthread_mutex_unlock(&g->mutex);
+}
+
+/*
+ * Workers
+ * =======
+ */
+
+// Hand a message to stage `to` (num_stages: the sink)
+static inline void pipeline_forward(pipeline_t *p, int to, const pipeline_msg_t *msg) {
+    if (to == p->num_stages) {
+        if (p->ordered_output) {
+            pipeline_gate_push(&p->out_gate, msg);
+        } else {
+            bounded_queue_put(&p->out, msg);
+        }
+    } else if (p->stages[to].ordered) {
+        pipeline_gate_push(&p->stages[to].gate, msg);
+    } else {
+        bounded_queue_put(&p->stages[to].in, msg);
+    }
+}
+
+// Wait while this worker is above the stage's target; 0 if stopping
+static inline int pipeline_worker_park(pipeline_stage_t *s, int index) {
+    int run = 1;
+    if (index >= __atomic_load_n(&s->target, __ATOMIC_RELAXED)) {
+        pthread_mutex_lock(&s->tune_mutex);
+        while (index >= s->target && !s->stopping) {
+            pthread_cond_wait(&s->tune_cond, &s->tune_mutex);
+        }
+        run = !s->stopping;
+        pthread_mutex_unlock(&s->tune_mutex);
+    }
+    return run;
+}
+
+static inline void *pipeline_worker(void *arg) {
+    pipeline_worker_t *w = (pipeline_worker_t *)arg;
+    pipeline_stage_t *s = w->stage;
+    pipeline_t *p = s->pipeline;
+    int next = (int)(s - p->stages) + 1;
+    pipeline_msg_t msg;
+
+    while (pipeline_worker_park(s, w->index)) {
+        bounded_queue_get(&s->in, &msg);
+        if (msg.end) {
+            // Wake parked siblings so they exit, and leave the marker
+            // for the active ones
+            pthread_mutex_lock(&s->tune_mutex);
+            s->stopping = 1;
+            pthread_cond_broadcast(&s->tune_cond);
+            pthread_mutex_unlock(&s->tune_mutex);
+            bounded_queue_put(&s->in, &msg);
+            break;
+        }
+
+        uint64_t start = bounded_queue_now_ns();
+        msg.data = s->fn(msg.data, s->arg);
+        uint64_t busy = bounded_queue_now_ns() - start;
+
+        // Only this thread writes its counters; the tuner reads them
+        __atomic_store_n(&w->items, w->items + 1, __ATOMIC_RELAXED);
+        __atomic_store_n(&w->busy_ns, w->busy_ns + busy, __ATOMIC_RELAXED);
+
+        pipeline_forward(p, next, &msg);
+    }
+
+    if (__atomic_sub_fetch(&s->live, 1, __ATOMIC_ACQ_REL) == 0) {
+        pipeline_msg_t end = { .seq = __atomic_load_n(&p->produced, __ATOMIC_ACQUIRE),
+                               .data = NULL, .end = 1 };
+        pipeline_forward(p, next, &end);
+    }
+    return NULL;
+}
+
+static inline void *pipeline_source_thread(void *arg) {
+    pipeline_t *p = (pipeline_t *)arg;
+    pipeline_msg_t msg = { .seq = 0, .data = NULL, .end = 0 };
+
+    for (;;) {
+        pthread_mutex_lock(&p->token_mutex);
+        while (p->in_flight == p->max_in_flight) {
+            pthread_cond_wait(&p->token_freed, &p->token_mutex);
+        }
+        p->in_flight++;
+        pthread_mutex_unlock(&p->token_mutex);
+
+        if (!p->source(&msg.data, p->source_arg)) {
+            break;
+        }
+        pipeline_forward(p, 0, &msg);
+        msg.seq++;
+    }
+    __atomic_store_n(&p->produced, msg.seq, __ATOMIC_RELEASE);
+    msg.end = 1;
+    msg.data = NULL;
+    pipeline_forward(p, 0, &msg);
+    return NULL;
+}
+
+/*
+ * Auto-Tuning
+ * ===========
+ */
+
+// Sum a stage's counters; return items and busy time since the last call
+static inline uint64_t pipeline_stage_delta(pipeline_stage_t *s, uint64_t *busy_ns) {
+    uint64_t items = 0, busy = 0;
+    for (int i = 0; i < s->max_workers; i++) {
+        items += __atomic_load_n(&s->workers[i].items, __ATOMIC_RELAXED);
+        busy += __atomic_load_n(&s->workers[i].busy_ns, __ATOMIC_RELAXED);
+    }
+    uint64_t d_items = items - s->tuned_items;
+    *busy_ns = busy - s->tuned_busy_ns;
+    s->tuned_items = items;
+    s->tuned_busy_ns = busy;
+    return d_items;
+}
+
+static inline void pipeline_set_target(pipeline_stage_t *s, int target) {
+    pthread_mutex_lock(&s->tune_mutex);
+    __atomic_store_n(&s->target, target, __ATOMIC_RELAXED);   // Workers peek without the lock
+    pthread_cond_broadcast(&s->tune_cond);
+    pthread_mutex_unlock(&s->tune_mutex);
+}
+
+/*
+ * pipeline_tune() - Move one worker towards the bottleneck stage
+ *
+ * A stage with k active workers and t ns of work per item can process
+ * k * 1e9 / t items per second. The stage with the lowest rate limits
+ * the whole pipeline, so it gets the next worker.
+ */
+static inline void pipeline_tune(pipeline_t *p) {
+    double rate[PIPELINE_MAX_STAGES];
+    int active = 0, slowest = -1, fastest = -1;
+
+    for (int i = 0; i < p->num_stages; i++) {
+        pipeline_stage_t *s = &p->stages[i];
+        uint64_t busy_ns;
+        uint64_t items = pipeline_stage_delta(s, &busy_ns);
+        if (items == 0 || busy_ns == 0) {
+            return;             // Not enough data yet (or draining)
+        }
+        rate[i] = s->target * 1e9 * items / busy_ns;
+        active += s->target;
+    }
+
+    for (int i = 0; i < p->num_stages; i++) {
+        pipeline_stage_t *s = &p->stages[i];
+        if (s->target < s->max_workers && (slowest < 0 || rate[i] < rate[slowest])) {
+            slowest = i;
+        }
+    }
+    if (slowest < 0) {
+        return;
+    }
+
+    if (active < p->worker_budget) {
+        pipeline_set_target(&p->stages[slowest], p->stages[slowest].target + 1);
+        p->tune_steps++;
+        return;
+    }
+
+    // Budget used up: take a worker from the stage that would still be
+    // well ahead of the bottleneck without it
+    for (int i = 0; i < p->num_stages; i++) {
+        pipeline_stage_t *s = &p->stages[i];
+        if (i == slowest || s->target == 1) {
+            continue;
+        }
+        double rate_without = rate[i] * (s->target - 1) / s->target;
+        if (rate_without > 1.25 * rate[slowest] &&
+            (fastest < 0 || rate_without > rate[fastest] * (p->stages[fastest].target - 1) /
+                                           p->stages[fastest].target)) {
+            fastest = i;
+        }
+    }
+    if (fastest >= 0) {
+        pipeline_set_target(&p->stages[fastest], p->stages[fastest].target - 1);
+        pipeline_set_target(&p->stages[slowest], p->stages[slowest].target + 1);
+        p->tune_steps++;
+    }
+}
+
+/*
+ * Running
+ * =======
+ */
+static inline void pipeline_destroy_queues(pipeline_t *p, int stages) {
+    for (int i = 0; i < stages; i++) {
+        pipeline_stage_t *s = &p->stages[i];
+        if (s->ordered) {
+            pipeline_gate_destroy(&s->gate);
+        }
+        bounded_queue_destroy(&s->in);
+        pthread_mutex_destroy(&s->tune_mutex);
+        pthread_cond_destroy(&s->tune_cond);
+    }
+}
+
+// Stop every created worker after a failed start (source not running)
+static inline void pipeline_abort(pipeline_t *p) {
+    pipeline_msg_t end = { .seq = 0, .data = NULL, .end = 1 };
+    for (int i = 0; i < p->num_stages; i++) {
+        bounded_queue_put(&p->stages[i].in, &end);
+    }
+}
+
+/*
+ * pipeline_run() - Run items from @source through all stages to @sink
+ *
+ * Blocks until the source is exhausted and every item has reached the
+ * sink. Can be called again on the same pipeline; the worker targets
+ * chosen by the tuner carry over.
+ *
+ * Return: 0, EINVAL for a pipeline without stages, ENOMEM, or the
+ *         error from pthread_create()
+ */
+static inline int pipeline_run(pipeline_t *p, pipeline_source_fn source,
+                               pipeline_sink_fn sink, void *arg) {
+    size_t window;
+    int rc = 0, ready = 0;
+    int started[PIPELINE_MAX_STAGES] = { 0 };  // Worker threads to join per stage
+
+    if (p->num_stages == 0) {
+        return EINVAL;
+    }
+
+    // Enough tokens to fill every queue and keep every worker busy; the
+    // window also holds the end marker
+    p->max_in_flight = p->capacity;
+    for (int i = 0; i < p->num_stages; i++) {
+        p->max_in_flight += p->capacity + p->stages[i].max_workers;
+    }
+    p->in_flight = 0;
+    window = p->max_in_flight + 1;
+
+    if (bounded_queue_init(&p->out, p->capacity, sizeof(pipeline_msg_t)) != 0) {
+        return ENOMEM;
+    }
+    if (p->ordered_output && pipeline_gate_init(&p->out_gate, window, &p->out) != 0) {
+        bounded_queue_destroy(&p->out);
+        return ENOMEM;
+    }
+    for (; ready < p->num_stages; ready++) {
+        pipeline_stage_t *s = &p->stages[ready];
+        if (bounded_queue_init(&s->in, p->capacity, sizeof(pipeline_msg_t)) != 0) {
+            rc = ENOMEM;
+            break;
+        }
+        if (s->ordered && pipeline_gate_init(&s->gate, window, &s->in) != 0) {
+            bounded_queue_destroy(&s->in);
+            rc = ENOMEM;
+            break;
+        }
+        pthread_mutex_init(&s->tune_mutex, NULL);
+        pthread_cond_init(&s->tune_cond, NULL);
+        s->stopping = 0;
+        s->live = 0;
+    }
+    if (rc != 0) {
+        pipeline_destroy_queues(p, ready);
+        if (p->ordered_output) {
+            pipeline_gate_destroy(&p->out_gate);
+        }
+        bounded_queue_destroy(&p->out);
+        return rc;
+    }
+
+    // Start all workers; parked ones cost only a thread stack
+    for (int i = 0; i < p->num_stages && rc == 0; i++) {
+        pipeline_stage_t *s = &p->stages[i];
+        for (int w = 0; w < s->max_workers; w++) {
+            s->workers[w].stage = s;
+            s->workers[w].index = w;
+            __atomic_add_fetch(&s->live, 1, __ATOMIC_RELAXED);
+            rc = pthread_create(&s->threads[w], NULL, pipeline_worker, &s->workers[w]);
+            if (rc != 0) {
+                __atomic_sub_fetch(&s->live, 1, __ATOMIC_RELAXED);
+                break;
+            }
+            started[i]++;
+        }
+        uint64_t busy_ns;
+        pipeline_stage_delta(s, &busy_ns);      // Tuner starts from here
+    }
+
+    pthread_t source_thread;
+    p->source = source;
+    p->source_arg = arg;
+    p->produced = 0;
+    if (rc == 0) {
+        rc = pthread_create(&source_thread, NULL, pipeline_source_thread, p);
+    }
+
+    if (rc != 0) {
+        pipeline_abort(p);
+    } else {
+        uint64_t last_tune = bounded_queue_now_ns();
+        long wait_ns = p->worker_budget > 0 ? p->tune_interval_ns : -1;
+        pipeline_msg_t msg;
+
+        for (;;) {
+            if (bounded_queue_timed_get(&p->out, &msg, wait_ns) == 0) {
+                if (msg.end) {
+                    break;
+                }
+                sink(msg.data, msg.seq, arg);
+                pthread_mutex_lock(&p->token_mutex);
+                p->in_flight--;
+                pthread_cond_signal(&p->token_freed);
+                pthread_mutex_unlock(&p->token_mutex);
+            }
+            if (wait_ns > 0 && bounded_queue_now_ns() - last_tune >= (uint64_t)wait_ns) {
+                pipeline_tune(p);
+                last_tune = bounded_queue_now_ns();
+            }
+        }
+        pthread_join(source_thread, NULL);
+    }
+
+    for (int i = 0; i < p->num_stages; i++) {
+        for (int w = 0; w < started[i]; w++) {
+            pthread_join(p->stages[i].threads[w], NULL);
+        }
+    }
+
+    pipeline_destroy_queues(p, p->num_stages);
+    if (p->ordered_output) {
+        pipeline_gate_destroy(&p->out_gate);
+    }
+    bounded_queue_destroy(&p->out);
+    return rc;
+}
+
+// Items and busy time of one stage over all runs so far
+static inline uint64_t pipeline_stage_items(pipeline_stage_t *s, uint64_t *busy_ns) {
+    uint64_t items = 0;
+    *busy_ns = 0;
+    for (int i = 0; i < s->max_workers; i++) {
+        items += s->workers[i].items;
+        *busy_ns += s->workers[i].busy_ns;
+    }
+    return items;
+}
+
+#endif // __pipeline_h__
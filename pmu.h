@@ -0,0 +1,239 @@
+/*
+ * ===================================================================
+ * CP386 Operating Systems Course - Hardware Performance Counters
+ * ===================================================================
+ *
+ * Wall-clock time says how long something took, not why. The CPU's
+ * performance monitoring unit (PMU) counts what happened meanwhile:
+ * cycles, instructions retired, cache and branch misses. The kernel
+ * adds software counters for context switches and page faults. Linux
+ * exposes all of them through perf_event_open(2). This header wraps
+ * the system call for the common case, "count these six things
+ * around a block of code":
+ *
+ *   pmu_t pmu;
+ *   pmu_sample_t s;
+ *   pmu_open(&pmu, 0);              // or PMU_INHERIT to count children too
+ *   pmu_start(&pmu);
+ *   ... code under test ...
+ *   pmu_stop(&pmu, &s);
+ *   printf("IPC %.2f\n", pmu_ipc(&s));
+ *   pmu_close(&pmu);
+ *
+ * Key Components:
+ * - Grouped counters: every event is opened in one group behind the
+ *   first one that opens, so the kernel schedules them onto the PMU
+ *   together and the ratios (IPC, misses per instruction) describe the
+ *   same stretch of execution.
+ * - Multiplexing: if there are more events than hardware counters, the
+ *   kernel rotates them; each value is scaled by enabled/running time.
+ * - Graceful degradation: an event that cannot be opened is marked
+ *   invalid and reported as "n/a". Typical reasons are a virtual machine
+ *   without a virtual PMU (ENOENT), perf_event_paranoid forbidding it
+ *   (EACCES), or a container without the system call (ENOSYS). Kernel-
+ *   side counting is tried first and dropped on EACCES. Counting
+ *   user space only loses the context switches, which happen in the
+ *   kernel. Nothing here fails the program.
+ * - Per-thread by default: the counters follow the calling thread.
+ *   PMU_INHERIT also counts threads and processes it creates after
+ *   pmu_open(), which suits fork()-based demos.
+ *
+ * References:
+ * - perf_event_open(2), /proc/sys/kernel/perf_event_paranoid
+ * - Brendan Gregg, "Systems Performance", Chapter 6: CPUs
+ */
+
+#ifndef __pmu_h__
+#define __pmu_h__
+
+#include <errno.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <linux/perf_event.h>
+
+#define PMU_INHERIT 1           // pmu_open() flag: count future children too
+
+typedef enum {
+    PMU_CYCLES,
+    PMU_INSTRUCTIONS,
+    PMU_CACHE_MISSES,
+    PMU_BRANCH_MISSES,
+    PMU_CONTEXT_SWITCHES,
+    PMU_PAGE_FAULTS,
+    PMU_EVENTS
+} pmu_event_t;
+
+static const struct {
+    uint32_t type;
+    uint64_t config;
+    const char *name;
+} pmu_events[PMU_EVENTS] = {
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CPU_CYCLES,       "cycles" },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_INSTRUCTIONS,     "instructions" },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_CACHE_MISSES,     "cache-misses" },
+    { PERF_TYPE_HARDWARE, PERF_COUNT_HW_BRANCH_MISSES,    "branch-misses" },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_CONTEXT_SWITCHES, "context-switches" },
+    { PERF_TYPE_SOFTWARE, PERF_COUNT_SW_PAGE_FAULTS,      "page-faults" },
+};
+
+typedef struct {
+    int fd[PMU_EVENTS];         // -1: not available
+    int leader;                 // Group leader's fd, or -1 if nothing opened
+    int error;                  // First open failure (errno)
+} pmu_t;
+
+typedef struct {
+    uint64_t value[PMU_EVENTS];
+    int valid[PMU_EVENTS];
+} pmu_sample_t;
+
+static inline int pmu_open_event(pmu_event_t e, int group, int flags, int exclude_kernel) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = pmu_events[e].type;
+    attr.config = pmu_events[e].config;
+    attr.disabled = group == -1;        // The leader starts the group
+    attr.inherit = (flags & PMU_INHERIT) != 0;
+    attr.exclude_kernel = exclude_kernel;
+    attr.exclude_hv = 1;
+    attr.read_format = PERF_FORMAT_TOTAL_TIME_ENABLED | PERF_FORMAT_TOTAL_TIME_RUNNING;
+    return (int)syscall(SYS_perf_event_open, &attr, 0, -1, group, 0);
+}
+
+/*
+ * pmu_open() - Open every counter the kernel and hardware allow
+ *
+ * @flags: 0 or PMU_INHERIT
+ *
+ * Return: 0 if at least one counter opened, otherwise the first errno
+ *         (the pmu_t is still safe to start, stop and close)
+ */
+static inline int pmu_open(pmu_t *p, int flags) {
+    p->leader = -1;
+    p->error = 0;
+    for (int e = 0; e < PMU_EVENTS; e++) {
+        int fd = pmu_open_event((pmu_event_t)e, p->leader, flags, 0);
+        if (fd < 0 && errno == EACCES) {
+            fd = pmu_open_event((pmu_event_t)e, p->leader, flags, 1);
+        }
+        if (fd < 0 && p->error == 0) {
+            p->error = errno;
+        }
+        p->fd[e] = fd;
+        if (fd >= 0 && p->leader == -1) {
+            p->leader = fd;
+        }
+    }
+    return p->leader >= 0 ? 0 : p->error;
+}
+
+// Zero the counters and start counting
+static inline void pmu_start(pmu_t *p) {
+    if (p->leader >= 0) {
+        ioctl(p->leader, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+        ioctl(p->leader, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+    }
+}
+
+// Stop counting and read every counter into @s, scaled for multiplexing
+static inline void pmu_stop(pmu_t *p, pmu_sample_t *s) {
+    if (p->leader >= 0) {
+        ioctl(p->leader, PERF_EVENT_IOC_DISABLE, PERF_IOC_FLAG_GROUP);
+    }
+    for (int e = 0; e < PMU_EVENTS; e++) {
+        uint64_t v[3];          // value, time enabled, time running
+        s->value[e] = 0;
+        s->valid[e] = p->fd[e] >= 0 && read(p->fd[e], v, sizeof(v)) == (ssize_t)sizeof(v);
+        if (s->valid[e] && v[2] > 0) {
+            s->value[e] = v[2] < v[1] ? (uint64_t)((double)v[0] * v[1] / v[2]) : v[0];
+        } else if (s->valid[e] && v[1] > 0) {
+            s->valid[e] = 0;    // Enabled but never got a hardware counter
+        }
+    }
+}
+
+static inline void pmu_close(pmu_t *p) {
+    for (int e = 0; e < PMU_EVENTS; e++) {
+        if (p->fd[e] >= 0) {
+            close(p->fd[e]);
+            p->fd[e] = -1;
+        }
+    }
+    p->leader = -1;
+}
+
+// Instructions per cycle, or -1 if either counter is unavailable
+static inline double pmu_ipc(const pmu_sample_t *s) {
+    if (!s->valid[PMU_CYCLES] || !s->valid[PMU_INSTRUCTIONS] || s->value[PMU_CYCLES] == 0) {
+        return -1;
+    }
+    return (double)s->value[PMU_INSTRUCTIONS] / s->value[PMU_CYCLES];
+}
+
+/*
+ * pmu_format() - One line summary: IPC, misses and kernel events
+ *
+ * Hardware events that are missing print as "n/a", e.g.
+ *   "IPC 1.84, cache-misses 12034, branch-misses 881, cs 3, faults 15"
+ *   "IPC n/a, cache-misses n/a, branch-misses n/a, cs 3, faults 15"
+ *
+ * Return: @buf
+ */
+static inline char *pmu_format(const pmu_sample_t *s, char *buf, size_t len) {
+    static const struct { pmu_event_t e; const char *label; } shown[] = {
+        { PMU_CACHE_MISSES, "cache-misses" },
+        { PMU_BRANCH_MISSES, "branch-misses" },
+        { PMU_CONTEXT_SWITCHES, "cs" },
+        { PMU_PAGE_FAULTS, "faults" },
+    };
+    double ipc = pmu_ipc(s);
+    size_t used = ipc < 0 ? (size_t)snprintf(buf, len, "IPC n/a")
+                          : (size_t)snprintf(buf, len, "IPC %.2f", ipc);
+    for (size_t i = 0; i < sizeof(shown) / sizeof(shown[0]) && used < len; i++) {
+        if (s->valid[shown[i].e]) {
+            used += snprintf(buf + used, len - used, ", %s %llu", shown[i].label,
+                             (unsigned long long)s->value[shown[i].e]);
+        } else {
+            used += snprintf(buf + used, len - used, ", %s n/a", shown[i].label);
+        }
+    }
+    return buf;
+}
+
+// Open and start in one call, for code that measures one block
+static inline void pmu_begin(pmu_t *p, int flags) {
+    pmu_open(p, flags);
+    pmu_start(p);
+}
+
+static inline void pmu_end(pmu_t *p, pmu_sample_t *s) {
+    pmu_stop(p, s);
+    pmu_close(p);
+}
+
+// Which counters work here, and why not the others: for a benchmark header
+static inline void pmu_describe(FILE *out) {
+    pmu_t p;
+    int n = 0;
+    pmu_open(&p, 0);
+    fprintf(out, "PMU counters:");
+    for (int e = 0; e < PMU_EVENTS; e++) {
+        if (p.fd[e] >= 0) {
+            fprintf(out, " %s", pmu_events[e].name);
+            n++;
+        }
+    }
+    if (n < PMU_EVENTS) {
+        fprintf(out, "%s (others unavailable: %s)", n == 0 ? " none" : "",
+                strerror(p.error));
+    }
+    fprintf(out, "\n");
+    pmu_close(&p);
+}
+
+#endif // __pmu_h__
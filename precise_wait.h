@@ -0,0 +1,175 @@
+/*
+ * ===================================================================
+ * CP386 Operating Systems Course - Precise Waits and Calibrated Work
+ * ===================================================================
+ *
+ * Spin() in common.h burns whole seconds by polling gettimeofday(), and
+ * usleep() for a sub-millisecond wait usually oversleeps by 50 us or
+ * more: the kernel adds the thread's timer slack (50 us by default) so
+ * it can batch wakeups, and then the scheduler has to run the thread.
+ * This header waits for a nanosecond duration and lands close to it.
+ *
+ *   precise_sleep_ns(250 * 1000);            // 250 us, off by ~1 us
+ *   precise_sleep_until(deadline_ns);        // absolute CLOCK_MONOTONIC
+ *   busy_work_ns(100 * 1000);                // ~100 us of pure computation
+ *
+ * Key Components:
+ * - Hybrid sleep: clock_nanosleep(TIMER_ABSTIME) until `margin` before
+ *   the deadline, then spin on the clock for the rest. The margin is
+ *   measured at startup as the usual wakeup overshoot, so the thread
+ *   sleeps through most of the wait and spins only for the last part.
+ *   An absolute deadline does not drift when a loop waits repeatedly.
+ * - precise_spin_until(): a pure busy-wait on CLOCK_MONOTONIC (through
+ *   the vDSO, so no system call), with cpu_relax() between reads.
+ * - busy_work(): a fixed instruction mix - multiply, add, shift, xor
+ *   and rotate in one dependency chain, which the compiler can neither
+ *   drop nor vectorize. busy_work_ns() converts nanoseconds into
+ *   iterations with a rate measured at startup and never reads the
+ *   clock, so it behaves like real computation: if the thread is
+ *   preempted the work takes longer, unlike Spin().
+ *
+ * Calibration runs once, on first use (about 10 ms), or explicitly with
+ * precise_calibrate(). busy_work_ns() assumes the CPU frequency stays
+ * what it was during calibration; turbo and power saving make it drift.
+ *
+ * References:
+ * - clock_nanosleep(2), prctl(2) PR_SET_TIMERSLACK, time(7)
+ * - OSTEP Chapter 6: Limited Direct Execution (timer interrupts)
+ */
+
+#ifndef __precise_wait_h__
+#define __precise_wait_h__
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "locks.h"
+
+#define PRECISE_MARGIN_MIN_NS 2000          // Always spin at least this long
+#define PRECISE_MARGIN_MAX_NS 2000000       // Overshoot beyond this is noise
+#define PRECISE_CALIBRATE_SLEEPS 16
+#define PRECISE_CALIBRATE_SLEEP_NS 200000
+
+typedef struct {
+    uint64_t margin_ns;         // Wake this long before the deadline, then spin
+    double work_per_ns;         // busy_work() iterations per nanosecond
+} precise_calibration_t;
+
+static precise_calibration_t precise_cal;
+static pthread_once_t precise_once = PTHREAD_ONCE_INIT;
+
+// CLOCK_MONOTONIC in nanoseconds
+static inline uint64_t precise_now_ns(void) {
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return (uint64_t)ts.tv_sec * 1000000000ull + (uint64_t)ts.tv_nsec;
+}
+
+/*
+ * busy_work() - Run @iterations of a fixed instruction mix
+ *
+ * One dependent chain of five integer operations per iteration (about
+ * 5 cycles on a modern core). The empty asm makes `x` opaque to the
+ * compiler each time around, so the loop cannot be folded or removed.
+ *
+ * Return: a value derived from the work, to keep it observable
+ */
+static inline uint64_t busy_work(uint64_t iterations) {
+    uint64_t x = 0x9e3779b97f4a7c15ull;
+    for (uint64_t i = 0; i < iterations; i++) {
+        x = x * 6364136223846793005ull + 1442695040888963407ull;
+        x ^= x >> 29;
+        x = (x << 17) | (x >> 47);
+        __asm__ __volatile__("" : "+r"(x));
+    }
+    return x;
+}
+
+// Busy-wait on the clock until @deadline_ns (CLOCK_MONOTONIC)
+static inline void precise_spin_until(uint64_t deadline_ns) {
+    while (precise_now_ns() < deadline_ns) {
+        cpu_relax();
+    }
+}
+
+static inline int precise_cmp_u64(const void *a, const void *b) {
+    uint64_t x = *(const uint64_t *)a, y = *(const uint64_t *)b;
+    return (x > y) - (x < y);
+}
+
+static inline void precise_calibrate_once(void) {
+    // Sleep margin: the 90th percentile of how late an absolute sleep wakes
+    uint64_t late[PRECISE_CALIBRATE_SLEEPS];
+    for (int i = 0; i < PRECISE_CALIBRATE_SLEEPS; i++) {
+        uint64_t deadline = precise_now_ns() + PRECISE_CALIBRATE_SLEEP_NS;
+        struct timespec ts = { (time_t)(deadline / 1000000000ull),
+                               (long)(deadline % 1000000000ull) };
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+        }
+        late[i] = precise_now_ns() - deadline;
+    }
+    qsort(late, PRECISE_CALIBRATE_SLEEPS, sizeof(uint64_t), precise_cmp_u64);
+    uint64_t margin = late[PRECISE_CALIBRATE_SLEEPS * 9 / 10] + PRECISE_MARGIN_MIN_NS;
+    precise_cal.margin_ns = margin > PRECISE_MARGIN_MAX_NS ? PRECISE_MARGIN_MAX_NS : margin;
+
+    // Work rate: grow the batch until it takes 1 ms, then keep the
+    // fastest of five runs (the others were interrupted)
+    uint64_t iterations = 1024, best = UINT64_MAX;
+    for (;;) {
+        uint64_t start = precise_now_ns();
+        busy_work(iterations);
+        if (precise_now_ns() - start >= 1000000) {
+            break;
+        }
+        iterations *= 2;
+    }
+    for (int run = 0; run < 5; run++) {
+        uint64_t start = precise_now_ns();
+        busy_work(iterations);
+        uint64_t elapsed = precise_now_ns() - start;
+        best = elapsed < best ? elapsed : best;
+    }
+    precise_cal.work_per_ns = (double)iterations / (double)best;
+}
+
+/*
+ * precise_calibrate() - Measure the sleep margin and the work rate
+ *
+ * Runs once per process; later calls return the same numbers. Called
+ * automatically by the functions below, but calling it at startup keeps
+ * the ~10 ms it takes out of the first measured wait.
+ */
+static inline const precise_calibration_t *precise_calibrate(void) {
+    pthread_once(&precise_once, precise_calibrate_once);
+    return &precise_cal;
+}
+
+// Sleep until @deadline_ns (CLOCK_MONOTONIC), spinning for the last stretch
+static inline void precise_sleep_until(uint64_t deadline_ns) {
+    uint64_t margin = precise_calibrate()->margin_ns;
+    if (deadline_ns > precise_now_ns() + margin) {
+        uint64_t wake = deadline_ns - margin;
+        struct timespec ts = { (time_t)(wake / 1000000000ull), (long)(wake % 1000000000ull) };
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {
+        }
+    }
+    precise_spin_until(deadline_ns);
+}
+
+static inline void precise_sleep_ns(uint64_t ns) {
+    precise_sleep_until(precise_now_ns() + ns);
+}
+
+/*
+ * busy_work_ns() - Compute for about @ns nanoseconds without reading the clock
+ *
+ * Return: busy_work()'s result
+ */
+static inline uint64_t busy_work_ns(uint64_t ns) {
+    return busy_work((uint64_t)(ns * precise_calibrate()->work_per_ns));
+}
+
+#endif // __precise_wait_h__
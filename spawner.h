@@ -0,0 +1,244 @@
+/*
+ * ===================================================================
+ * CP386 Operating Systems Course - Caching Thread Spawner
+ * ===================================================================
+ *
+ * pthread_create() + pthread_join() for short-lived threads, without
+ * creating a kernel thread each time. Creating a thread means a clone()
+ * system call, setting up its stack, TLS and guard page, and the
+ * scheduler placing a brand new task; joining means the exit path and
+ * a futex wakeup. For a thread that runs for microseconds that setup is
+ * most of the cost.
+ *
+ *   spawner_t sp;
+ *   spawner_job_t job;
+ *   spawner_init(&sp, 64 * 1024, 16);
+ *   spawner_spawn(&sp, &job, handle_request, req);
+ *   void *result = spawner_join(&sp, &job);
+ *   spawner_destroy(&sp);
+ *
+ * Key Components:
+ * - Thread cache: when a function returns, its thread parks on its own
+ *   condition variable in an idle list instead of exiting. The next
+ *   spawner_spawn() hands the function to an idle thread with one
+ *   signal; only when the list is empty is a new thread created.
+ * - Bounded: at most `max_idle` threads wait in the cache; extra ones
+ *   exit when their function returns, so a burst does not leave
+ *   hundreds of threads behind.
+ * - Jobs are owned by the caller: spawner_job_t carries the result and
+ *   the "finished" condition, so a thread goes back to the cache as soon
+ *   as its function returns, whether or not anyone has joined it yet.
+ *   Pass a NULL job for a detached spawn.
+ *
+ * A reused thread keeps whatever the previous function left in it:
+ * thread-local variables, signal mask, scheduling policy, name. Reset
+ * them in the function if it changes them. Cancellation and
+ * pthread_exit() from inside a job are not supported.
+ *
+ * References:
+ * - OSTEP Chapter 27: Interlude: Thread API
+ * - The same idea as a thread pool (note4 thread_pool.c), but keeping
+ *   the create/join interface instead of a task queue
+ */
+
+#ifndef __spawner_h__
+#define __spawner_h__
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdlib.h>
+
+typedef void *(*spawner_fn)(void *arg);
+
+typedef struct {
+    void *result;
+    int done;
+    pthread_cond_t finished;
+} spawner_job_t;
+
+typedef struct spawner_thread {
+    struct spawner *owner;
+    pthread_cond_t wake;
+    int has_work;
+    spawner_fn fn;
+    void *arg;
+    spawner_job_t *job;
+    struct spawner_thread *next;    // Idle list link
+} spawner_thread_t;
+
+typedef struct spawner {
+    pthread_mutex_t mutex;
+    pthread_cond_t all_exited;
+    pthread_attr_t attr;            // Detached, with the requested stack
+    spawner_thread_t *idle;
+    int num_idle;
+    int max_idle;
+    int live;                       // Threads not yet exited
+    int shutdown;
+    unsigned long created;          // Threads created so far
+    unsigned long reused;           // Spawns served from the cache
+} spawner_t;
+
+static inline void *spawner_thread_main(void *arg) {
+    spawner_thread_t *t = (spawner_thread_t *)arg;
+    spawner_t *sp = t->owner;
+
+    pthread_mutex_lock(&sp->mutex);
+    for (;;) {
+        while (!t->has_work && !sp->shutdown) {
+            pthread_cond_wait(&t->wake, &sp->mutex);
+        }
+        if (!t->has_work) {
+            break;                  // Shut down while idle
+        }
+        spawner_fn fn = t->fn;
+        void *fn_arg = t->arg;
+        spawner_job_t *job = t->job;
+        t->has_work = 0;
+        pthread_mutex_unlock(&sp->mutex);
+
+        void *result = fn(fn_arg);
+
+        pthread_mutex_lock(&sp->mutex);
+        if (job != NULL) {
+            job->result = result;
+            job->done = 1;
+            pthread_cond_signal(&job->finished);
+        }
+        if (sp->shutdown || sp->num_idle >= sp->max_idle) {
+            break;
+        }
+        t->next = sp->idle;
+        sp->idle = t;
+        sp->num_idle++;
+    }
+    if (--sp->live == 0) {
+        pthread_cond_signal(&sp->all_exited);
+    }
+    pthread_mutex_unlock(&sp->mutex);
+    pthread_cond_destroy(&t->wake);
+    free(t);
+    return NULL;
+}
+
+/*
+ * spawner_init() - Set up an empty cache
+ *
+ * @stack_size: stack of every thread it creates (0: the default)
+ * @max_idle:   threads kept waiting for reuse
+ *
+ * Return: 0, or an error number from pthread_attr_setstacksize()
+ */
+static inline int spawner_init(spawner_t *sp, size_t stack_size, int max_idle) {
+    pthread_attr_init(&sp->attr);
+    pthread_attr_setdetachstate(&sp->attr, PTHREAD_CREATE_DETACHED);
+    if (stack_size != 0) {
+        int rc = pthread_attr_setstacksize(&sp->attr, stack_size);
+        if (rc != 0) {
+            pthread_attr_destroy(&sp->attr);
+            return rc;
+        }
+    }
+    pthread_mutex_init(&sp->mutex, NULL);
+    pthread_cond_init(&sp->all_exited, NULL);
+    sp->idle = NULL;
+    sp->num_idle = 0;
+    sp->max_idle = max_idle;
+    sp->live = 0;
+    sp->shutdown = 0;
+    sp->created = sp->reused = 0;
+    return 0;
+}
+
+/*
+ * spawner_spawn() - Run @fn(@arg) on a cached or new thread
+ *
+ * @job: where spawner_join() finds the result, or NULL (detached)
+ *
+ * Return: 0, or an error number from pthread_create()
+ */
+static inline int spawner_spawn(spawner_t *sp, spawner_job_t *job, spawner_fn fn, void *arg) {
+    if (job != NULL) {
+        job->done = 0;
+        job->result = NULL;
+        pthread_cond_init(&job->finished, NULL);
+    }
+
+    pthread_mutex_lock(&sp->mutex);
+    spawner_thread_t *t = sp->idle;
+    if (t != NULL) {
+        sp->idle = t->next;
+        sp->num_idle--;
+        sp->reused++;
+        t->fn = fn;
+        t->arg = arg;
+        t->job = job;
+        t->has_work = 1;
+        pthread_cond_signal(&t->wake);
+        pthread_mutex_unlock(&sp->mutex);
+        return 0;
+    }
+    sp->live++;
+    sp->created++;
+    pthread_mutex_unlock(&sp->mutex);
+
+    int rc = ENOMEM;
+    t = malloc(sizeof(*t));
+    if (t != NULL) {
+        t->owner = sp;
+        pthread_cond_init(&t->wake, NULL);
+        t->has_work = 1;
+        t->fn = fn;
+        t->arg = arg;
+        t->job = job;
+        pthread_t thread;
+        rc = pthread_create(&thread, &sp->attr, spawner_thread_main, t);
+        if (rc != 0) {
+            pthread_cond_destroy(&t->wake);
+            free(t);
+        }
+    }
+    if (rc != 0) {
+        pthread_mutex_lock(&sp->mutex);
+        if (--sp->live == 0) {
+            pthread_cond_signal(&sp->all_exited);
+        }
+        pthread_mutex_unlock(&sp->mutex);
+        if (job != NULL) {
+            pthread_cond_destroy(&job->finished);
+        }
+    }
+    return rc;
+}
+
+// Wait for a spawned function to return. Return: its result
+static inline void *spawner_join(spawner_t *sp, spawner_job_t *job) {
+    pthread_mutex_lock(&sp->mutex);
+    while (!job->done) {
+        pthread_cond_wait(&job->finished, &sp->mutex);
+    }
+    pthread_mutex_unlock(&sp->mutex);
+    pthread_cond_destroy(&job->finished);
+    return job->result;
+}
+
+// Let the running functions finish, then end every thread
+static inline void spawner_destroy(spawner_t *sp) {
+    pthread_mutex_lock(&sp->mutex);
+    sp->shutdown = 1;
+    while (sp->idle != NULL) {
+        spawner_thread_t *t = sp->idle;
+        sp->idle = t->next;
+        pthread_cond_signal(&t->wake);
+    }
+    sp->num_idle = 0;
+    while (sp->live > 0) {
+        pthread_cond_wait(&sp->all_exited, &sp->mutex);
+    }
+    pthread_mutex_unlock(&sp->mutex);
+    pthread_cond_destroy(&sp->all_exited);
+    pthread_mutex_destroy(&sp->mutex);
+    pthread_attr_destroy(&sp->attr);
+}
+
+#endif // __spawner_h__
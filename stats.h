@@ -0,0 +1,206 @@
+/*
+ * ===================================================================
+ * CP386 Operating Systems Course - Per-Thread Statistics Registry
+ * ===================================================================
+ *
+ * Named counters that many threads bump and any thread can read. The
+ * obvious version - one shared `unsigned long` per counter, updated
+ * with an atomic add - makes every increment pull the counter's cache
+ * line away from the core that touched it last. With 32 threads the
+ * counter, not the work, becomes the bottleneck.
+ *
+ * Here every thread owns a slot with its own copy of each counter, and
+ * a reader sums the slots.
+ *
+ *   writer:  stats_slot_t *s = stats_register(&reg);    // once
+ *            stats_add(s, STAT_X, 1);                  // no shared line
+ *            stats_update_begin(s);                    // several counters
+ *            stats_add(s, STAT_TRIES, 1);              //   that must be
+ *            stats_add(s, STAT_FAILS, 1);              //   seen together
+ *            stats_update_end(s);
+ *            stats_unregister(&reg, s);                // before exiting
+ *
+ *   reader:  stats_snapshot(&reg, totals);
+ *
+ * Key Components:
+ * - stats_slot_t: one per thread, cache-line aligned. Only its owner
+ *   writes it, with relaxed load/store pairs (no locked instruction).
+ * - Consistent snapshots without stopping writers: each slot carries a
+ *   sequence number, as in a seqlock. stats_update_begin() makes it odd
+ *   and stats_update_end() even again; a reader that sees an odd or
+ *   changed sequence re-reads that slot. So an update group is always
+ *   seen whole: if every group keeps `tries >= fails`, so does every
+ *   snapshot. Readers never block writers, and writers never wait.
+ * - Slots are read one after another, so a snapshot is not one global
+ *   instant; it is a sum of per-thread states, each of them consistent,
+ *   and totals never go backwards.
+ * - Exiting threads fold their counts into `retired` under the registry
+ *   mutex, and the slot is reused. Register/unregister and snapshots
+ *   take the mutex; increments never do.
+ *
+ * References:
+ * - OSTEP Chapter 29: Lock-based Concurrent Data Structures
+ *   (approximate counters)
+ * - P. McKenney, "Is Parallel Programming Hard, And, If So, What Can
+ *   You Do About It?", Chapter 5: Counting
+ */
+
+#ifndef __stats_h__
+#define __stats_h__
+
+#include <errno.h>
+#include <pthread.h>
+#include <sched.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#define STATS_MAX_COUNTERS 16
+#define STATS_MAX_THREADS 128
+
+typedef struct {
+    unsigned seq;                       // Odd while an update group runs
+    int in_use;
+    uint64_t value[STATS_MAX_COUNTERS];
+} __attribute__((aligned(64))) stats_slot_t;
+
+typedef struct {
+    const char *names[STATS_MAX_COUNTERS];
+    int num_counters;
+    pthread_mutex_t mutex;              // Slot allocation and snapshots
+    uint64_t retired[STATS_MAX_COUNTERS];   // Counts of exited threads
+    stats_slot_t slots[STATS_MAX_THREADS];
+} stats_registry_t;
+
+/*
+ * stats_init() - Set up a registry with @num_counters named counters
+ *
+ * @names must stay valid for the registry's lifetime.
+ *
+ * Return: 0, or EINVAL if @num_counters is out of range
+ */
+static inline int stats_init(stats_registry_t *r, const char *const *names, int num_counters) {
+    if (num_counters < 1 || num_counters > STATS_MAX_COUNTERS) {
+        return EINVAL;
+    }
+    memset(r, 0, sizeof(*r));
+    for (int i = 0; i < num_counters; i++) {
+        r->names[i] = names[i];
+    }
+    r->num_counters = num_counters;
+    pthread_mutex_init(&r->mutex, NULL);
+    return 0;
+}
+
+static inline void stats_destroy(stats_registry_t *r) {
+    pthread_mutex_destroy(&r->mutex);
+}
+
+/*
+ * stats_register() - Claim a zeroed slot for the calling thread
+ *
+ * Return: the slot, or NULL once STATS_MAX_THREADS threads hold one
+ */
+static inline stats_slot_t *stats_register(stats_registry_t *r) {
+    stats_slot_t *s = NULL;
+
+    pthread_mutex_lock(&r->mutex);
+    for (int i = 0; i < STATS_MAX_THREADS; i++) {
+        if (!r->slots[i].in_use) {
+            s = &r->slots[i];
+            memset(s->value, 0, sizeof(s->value));
+            s->in_use = 1;
+            break;
+        }
+    }
+    pthread_mutex_unlock(&r->mutex);
+    return s;
+}
+
+// Fold a finished thread's counts into the registry and free its slot
+static inline void stats_unregister(stats_registry_t *r, stats_slot_t *s) {
+    pthread_mutex_lock(&r->mutex);
+    for (int i = 0; i < r->num_counters; i++) {
+        r->retired[i] += s->value[i];
+    }
+    s->in_use = 0;
+    pthread_mutex_unlock(&r->mutex);
+}
+
+// Owner-only increment: a relaxed load/store pair, never a locked RMW
+static inline void stats_add(stats_slot_t *s, int counter, uint64_t n) {
+    __atomic_store_n(&s->value[counter],
+                     __atomic_load_n(&s->value[counter], __ATOMIC_RELAXED) + n,
+                     __ATOMIC_RELAXED);
+}
+
+/*
+ * stats_update_begin() / stats_update_end() - Group several stats_add()s
+ *
+ * A snapshot sees either none or all of the adds in between. Groups
+ * must not nest.
+ */
+static inline void stats_update_begin(stats_slot_t *s) {
+    __atomic_store_n(&s->seq, s->seq + 1, __ATOMIC_RELAXED);
+    // Order the odd sequence before the counter stores that follow
+    __atomic_thread_fence(__ATOMIC_RELEASE);
+}
+
+static inline void stats_update_end(stats_slot_t *s) {
+    __atomic_store_n(&s->seq, s->seq + 1, __ATOMIC_RELEASE);
+}
+
+/*
+ * stats_snapshot() - Sum every thread's counters into @out
+ *
+ * @out: num_counters totals
+ *
+ * Runs alongside the writers. Each slot is re-read until its sequence
+ * is even and unchanged across the read (a writer in the middle of a
+ * group is at most a few stores from done).
+ *
+ * Return: the number of registered threads
+ */
+static inline int stats_snapshot(stats_registry_t *r, uint64_t *out) {
+    uint64_t v[STATS_MAX_COUNTERS];
+    int threads = 0;
+
+    pthread_mutex_lock(&r->mutex);
+    for (int i = 0; i < r->num_counters; i++) {
+        out[i] = r->retired[i];
+    }
+    for (int t = 0; t < STATS_MAX_THREADS; t++) {
+        stats_slot_t *s = &r->slots[t];
+        if (!s->in_use) {
+            continue;
+        }
+        unsigned before, after;
+        do {
+            while ((before = __atomic_load_n(&s->seq, __ATOMIC_ACQUIRE)) & 1) {
+                sched_yield();
+            }
+            for (int i = 0; i < r->num_counters; i++) {
+                v[i] = __atomic_load_n(&s->value[i], __ATOMIC_RELAXED);
+            }
+            // Order the counter loads before the second sequence load
+            __atomic_thread_fence(__ATOMIC_ACQUIRE);
+            after = __atomic_load_n(&s->seq, __ATOMIC_RELAXED);
+        } while (before != after);
+
+        for (int i = 0; i < r->num_counters; i++) {
+            out[i] += v[i];
+        }
+        threads++;
+    }
+    pthread_mutex_unlock(&r->mutex);
+    return threads;
+}
+
+// Print a snapshot as "name: value" lines
+static inline void stats_print(const stats_registry_t *r, const uint64_t *totals) {
+    for (int i = 0; i < r->num_counters; i++) {
+        printf("  %-20s %12llu\n", r->names[i], (unsigned long long)totals[i]);
+    }
+}
+
+#endif // __stats_h__
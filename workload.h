@@ -0,0 +1,277 @@
+/*
+ * ===================================================================
+ * CP386 Operating Systems Course - Calibrated CPU Workloads
+ * ===================================================================
+ *
+ * Scheduling and locking experiments need jobs whose cost is known. An
+ * empty `for` loop is the wrong tool. The compiler may delete it, or it
+ * turns into a volatile store per iteration. Its cost also differs from
+ * machine to machine and from one kind of "work" to the next. This
+ * header gives five kernels that each stress one part of the core, and
+ * a common unit for them: one work unit is one microsecond of that
+ * kernel on this machine, measured at startup.
+ *
+ *   workload_run(WORK_FP, 50000);       // ~50 ms of floating point
+ *   workload_run(WORK_CHASE, 1000);     // ~1 ms of cache misses
+ *
+ * Key Components:
+ * - WORK_ALU: busy_work() from precise_wait.h - multiply, add, shift,
+ *   xor and rotate in one dependency chain.
+ * - WORK_FP: a dependent multiply-add-divide chain in double precision
+ *   that converges instead of overflowing.
+ * - WORK_CHASE: memory latency. Each step loads the next index from a
+ *   random cyclic permutation of 64-byte nodes in a WORK_BUFFER_BYTES
+ *   buffer, so every load waits for the one before it and most miss
+ *   in the cache.
+ * - WORK_STREAM: memory bandwidth. Sums a WORK_BUFFER_BYTES buffer
+ *   sequentially, one cache line per iteration; the hardware
+ *   prefetcher and vector units can go as fast as they like.
+ * - WORK_BRANCH: a pseudo-random bit decides each of two branches, so
+ *   the branch predictor is wrong about half the time. An empty
+ *   volatile asm in each arm stops the compiler from replacing the
+ *   branches with conditional moves.
+ *
+ * The memory kernels share two read-only buffers, allocated once. Each
+ * thread continues from where its last call stopped, so short jobs do
+ * not keep re-reading the same cache-hot prefix; the branch kernel
+ * likewise continues its random sequence, because modern predictors
+ * learn a sequence that repeats every call. A fork()ed child
+ * shares the buffers copy-on-write.
+ *
+ * The same number of units costs about the same time on any machine.
+ * Jobs defined in units are therefore reproducible, while the work
+ * behind a unit scales with the hardware. Calibration runs once, on
+ * first use (about 0.2 s), or explicitly with workload_init().
+ *
+ * References:
+ * - OSTEP Chapter 7: Scheduling: Introduction (job lengths)
+ * - J. McCalpin, STREAM benchmark; lmbench lat_mem_rd (pointer chase)
+ */
+
+#ifndef __workload_h__
+#define __workload_h__
+
+#include <errno.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "precise_wait.h"
+
+#define WORK_UNIT_NS 1000                   // One unit: 1 us on this machine
+#define WORK_BUFFER_BYTES (32u << 20)       // Per memory kernel; beyond most LLCs
+#define WORK_LINE 64
+
+typedef enum {
+    WORK_ALU,
+    WORK_FP,
+    WORK_CHASE,
+    WORK_STREAM,
+    WORK_BRANCH,
+    WORK_KINDS
+} work_kind_t;
+
+static const char *const workload_names[WORK_KINDS] = {
+    "alu", "fp", "chase", "stream", "branch"
+};
+
+typedef struct {
+    uint64_t next;              // Index of the next node in the cycle
+    uint64_t pad[WORK_LINE / sizeof(uint64_t) - 1];
+} work_node_t;
+
+static struct {
+    work_node_t *chase;
+    uint64_t *stream;
+    size_t nodes;               // chase entries
+    size_t words;               // stream entries
+    double per_unit[WORK_KINDS];    // Kernel iterations per work unit
+    int error;                  // From workload_init(): 0 or ENOMEM
+} workload;
+
+static pthread_once_t workload_once = PTHREAD_ONCE_INIT;
+static __thread uint64_t workload_chase_pos;
+static __thread uint64_t workload_stream_pos;
+static __thread uint64_t workload_branch_seed = 0x2545f4914f6cdd1dull;
+
+/*
+ * Kernels
+ * =======
+ * Each runs @n iterations of its fixed body and returns a value that
+ * depends on all of them.
+ */
+
+static inline uint64_t work_fp(uint64_t n) {
+    double x = 1.0;
+    for (uint64_t i = 0; i < n; i++) {
+        x = (x * 1.000001 + 0.5) / 1.0005;  // Converges to ~1000
+    }
+    return (uint64_t)x;
+}
+
+static inline uint64_t work_chase(uint64_t n) {
+    const work_node_t *nodes = workload.chase;
+    uint64_t p = workload_chase_pos;
+    for (uint64_t i = 0; i < n; i++) {
+        p = nodes[p].next;
+    }
+    workload_chase_pos = p;
+    return p;
+}
+
+static inline uint64_t work_stream(uint64_t n) {
+    const uint64_t *words = workload.stream;
+    const size_t per_line = WORK_LINE / sizeof(uint64_t);
+    size_t w = workload_stream_pos;
+    uint64_t sum = 0;
+    for (uint64_t i = 0; i < n; i++) {
+        for (size_t k = 0; k < per_line; k++) {
+            sum += words[w + k];
+        }
+        w += per_line;
+        if (w >= workload.words) {
+            w = 0;
+        }
+    }
+    workload_stream_pos = w;
+    return sum;
+}
+
+static inline uint64_t work_branch(uint64_t n) {
+    uint64_t r = workload_branch_seed, a = 0, b = 0;
+    for (uint64_t i = 0; i < n; i++) {
+        r ^= r << 13;           // xorshift64
+        r ^= r >> 7;
+        r ^= r << 17;
+        if (r & 1) {
+            __asm__ __volatile__("");
+            a += r;
+        } else {
+            __asm__ __volatile__("");
+            b ^= r;
+        }
+        if (r & 2) {
+            __asm__ __volatile__("");
+            a ^= b;
+        }
+    }
+    workload_branch_seed = r;   // A repeated sequence would be learned
+    return a + b;
+}
+
+static inline uint64_t work_kernel(work_kind_t kind, uint64_t n) {
+    switch (kind) {
+    case WORK_ALU:    return busy_work(n);
+    case WORK_FP:     return work_fp(n);
+    case WORK_CHASE:  return work_chase(n);
+    case WORK_STREAM: return work_stream(n);
+    case WORK_BRANCH: return work_branch(n);
+    default:          return 0;
+    }
+}
+
+/*
+ * Calibration
+ * ===========
+ */
+
+static inline void workload_setup(void) {
+    workload.nodes = WORK_BUFFER_BYTES / sizeof(work_node_t);
+    workload.words = WORK_BUFFER_BYTES / sizeof(uint64_t);
+    workload.chase = malloc(WORK_BUFFER_BYTES);
+    workload.stream = malloc(WORK_BUFFER_BYTES);
+    if (workload.chase == NULL || workload.stream == NULL) {
+        free(workload.chase);
+        free(workload.stream);
+        workload.chase = NULL;
+        workload.stream = NULL;
+        workload.error = ENOMEM;
+        return;
+    }
+
+    // Sattolo's shuffle: one random cycle through every node, with a
+    // fixed seed so every run walks the same order
+    uint64_t seed = 88172645463325252ull;
+    for (size_t i = 0; i < workload.nodes; i++) {
+        workload.chase[i].next = i;
+    }
+    for (size_t i = workload.nodes - 1; i > 0; i--) {
+        seed ^= seed << 13;
+        seed ^= seed >> 7;
+        seed ^= seed << 17;
+        size_t j = seed % i;
+        uint64_t t = workload.chase[i].next;
+        workload.chase[i].next = workload.chase[j].next;
+        workload.chase[j].next = t;
+    }
+    for (size_t i = 0; i < workload.words; i++) {
+        workload.stream[i] = i;
+    }
+
+    // Per kernel: grow a batch until it takes 2 ms, then keep the
+    // median of five runs. Not the fastest: memory kernels vary from
+    // run to run, and jobs should cost what a typical run costs
+    for (int kind = 0; kind < WORK_KINDS; kind++) {
+        uint64_t n = 256, runs[5];
+        for (;;) {
+            uint64_t start = precise_now_ns();
+            work_kernel((work_kind_t)kind, n);
+            if (precise_now_ns() - start >= 2000000) {
+                break;
+            }
+            n *= 2;
+        }
+        for (int run = 0; run < 5; run++) {
+            uint64_t start = precise_now_ns();
+            work_kernel((work_kind_t)kind, n);
+            runs[run] = precise_now_ns() - start;
+        }
+        qsort(runs, 5, sizeof(uint64_t), precise_cmp_u64);
+        workload.per_unit[kind] = (double)n * WORK_UNIT_NS / (double)runs[2];
+    }
+}
+
+/*
+ * workload_init() - Allocate the buffers and calibrate every kernel
+ *
+ * Runs once per process; later calls return the first result. Call it
+ * before fork() so the children share the calibration.
+ *
+ * Return: 0, or ENOMEM if the buffers could not be allocated
+ */
+static inline int workload_init(void) {
+    pthread_once(&workload_once, workload_setup);
+    return workload.error;
+}
+
+// Kernel iterations in one work unit of @kind
+static inline double workload_per_unit(work_kind_t kind) {
+    workload_init();
+    return workload.per_unit[kind];
+}
+
+/*
+ * workload_run() - Do @units microseconds' worth of @kind work
+ *
+ * Return: the kernel's result (use it, or store it to a volatile, so
+ *         the call is not optimized away), or 0 if workload_init() failed
+ */
+static inline uint64_t workload_run(work_kind_t kind, uint64_t units) {
+    if (workload_init() != 0 || kind >= WORK_KINDS) {
+        return 0;
+    }
+    return work_kernel(kind, (uint64_t)(units * workload.per_unit[kind]));
+}
+
+// "alu", "fp", ... -> work_kind_t; WORK_KINDS if unknown
+static inline work_kind_t workload_parse(const char *name) {
+    for (int kind = 0; kind < WORK_KINDS; kind++) {
+        if (strcmp(name, workload_names[kind]) == 0) {
+            return (work_kind_t)kind;
+        }
+    }
+    return WORK_KINDS;
+}
+
+#endif // __workload_h__